@@ -0,0 +1,70 @@
+#include "Benchmark.h"
+
+#include <glad/glad.h>
+
+// the first frames of a step upload new buffer sizes and build programs, they are not measured
+const unsigned int WARMUP_FRAMES = 3;
+const unsigned int MEASURED_FRAMES = 10;
+
+static double elapsedMs(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void Benchmark::startSteps(size_t stepsNum)
+{
+    this->stepsNum = stepsNum;
+    step = 0;
+    frame = 0;
+    totals = BenchmarkTimes();
+}
+
+bool Benchmark::measured() const
+{
+    return frame >= WARMUP_FRAMES;
+}
+
+void Benchmark::beginCPU()
+{
+    cpuStart = std::chrono::steady_clock::now();
+}
+
+void Benchmark::endCPU()
+{
+    if (measured())
+        totals.cpu += elapsedMs(cpuStart);
+}
+
+void Benchmark::beginGPU()
+{
+    glFinish();
+    gpuStart = std::chrono::steady_clock::now();
+}
+
+void Benchmark::endSubmit()
+{
+    if (measured())
+        totals.submit += elapsedMs(gpuStart);
+}
+
+void Benchmark::endGPU()
+{
+    glFinish();
+    if (measured())
+        totals.gpu += elapsedMs(gpuStart);
+}
+
+void Benchmark::endFrame()
+{
+    if (!active())
+        return;
+
+    if (++frame < WARMUP_FRAMES + MEASURED_FRAMES)
+        return;
+
+    BenchmarkTimes times = { totals.cpu / MEASURED_FRAMES, totals.submit / MEASURED_FRAMES, totals.gpu / MEASURED_FRAMES };
+    step++;
+    frame = 0;
+    totals = BenchmarkTimes();
+    stepMeasured(step - 1, times);
+}
@@ -0,0 +1,56 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <chrono>
+
+// average ms per measured frame of one step
+struct BenchmarkTimes
+{
+    double cpu;
+    double submit;
+    double gpu;
+};
+
+// Steps and timing shared by the benchmarks. Every step renders a few frames that are not measured (new buffer
+// sizes are uploaded and programs built in them) and then a fixed number that are, the averages go to
+// stepMeasured(). The GPU time is taken between two glFinish calls instead of with a timer query, software and
+// tiled renderers run the commands at the next flush and their queries miss most of the work; the submit time
+// runs from the same start until the draw calls return.
+class Benchmark
+{
+public:
+
+    virtual ~Benchmark() = default;
+
+    bool active() const { return step < stepsNum; }
+
+    void beginCPU();
+    void endCPU();
+    void beginGPU();
+    void endSubmit();
+    void endGPU();
+    // moves to the next step once enough frames are measured
+    void endFrame();
+
+protected:
+
+    // the first step is measured from the next frame
+    void startSteps(size_t stepsNum);
+    size_t currentStep() const { return step; }
+
+    // runs once a step is measured, after the move to the next one (active() is false after the last step)
+    virtual void stepMeasured(size_t step, const BenchmarkTimes& times) = 0;
+
+private:
+
+    size_t stepsNum = 0;
+    size_t step = 0;
+    unsigned int frame = 0;
+    std::chrono::steady_clock::time_point cpuStart;
+    std::chrono::steady_clock::time_point gpuStart;
+    BenchmarkTimes totals = {};
+
+    bool measured() const;
+
+};
+#endif
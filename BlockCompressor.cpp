@@ -0,0 +1,383 @@
+#include "BlockCompressor.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define BLOCK_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+const int BLOCK_ROWS_PER_TASK = 8;
+
+uint16_t packColor565(const int color[3])
+{
+    return (uint16_t)(((color[0] * 31 + 127) / 255) << 11 | ((color[1] * 63 + 127) / 255) << 5 | ((color[2] * 31 + 127) / 255));
+}
+
+void unpackColor565(uint16_t packed, int color[3])
+{
+    int r = (packed >> 11) & 31, g = (packed >> 5) & 63, b = packed & 31;
+    color[0] = (r << 3) | (r >> 2);
+    color[1] = (g << 2) | (g >> 4);
+    color[2] = (b << 3) | (b >> 2);
+}
+
+// per channel minimum and maximum of the 16 pixels
+void colorBounds(const unsigned char* rgba, int minColor[3], int maxColor[3])
+{
+#ifdef BLOCK_SSE2
+    __m128i p0 = _mm_loadu_si128((const __m128i*)rgba);
+    __m128i p1 = _mm_loadu_si128((const __m128i*)(rgba + 16));
+    __m128i p2 = _mm_loadu_si128((const __m128i*)(rgba + 32));
+    __m128i p3 = _mm_loadu_si128((const __m128i*)(rgba + 48));
+    __m128i low = _mm_min_epu8(_mm_min_epu8(p0, p1), _mm_min_epu8(p2, p3));
+    __m128i high = _mm_max_epu8(_mm_max_epu8(p0, p1), _mm_max_epu8(p2, p3));
+    low = _mm_min_epu8(low, _mm_srli_si128(low, 8));
+    low = _mm_min_epu8(low, _mm_srli_si128(low, 4));
+    high = _mm_max_epu8(high, _mm_srli_si128(high, 8));
+    high = _mm_max_epu8(high, _mm_srli_si128(high, 4));
+    uint32_t packedLow = (uint32_t)_mm_cvtsi128_si32(low), packedHigh = (uint32_t)_mm_cvtsi128_si32(high);
+    for (int c = 0; c < 3; c++) {
+        minColor[c] = (packedLow >> (8 * c)) & 0xFF;
+        maxColor[c] = (packedHigh >> (8 * c)) & 0xFF;
+    }
+#else
+    for (int c = 0; c < 3; c++) {
+        minColor[c] = 255;
+        maxColor[c] = 0;
+    }
+    for (int i = 0; i < 16; i++)
+        for (int c = 0; c < 3; c++) {
+            minColor[c] = std::min(minColor[c], (int)rgba[4 * i + c]);
+            maxColor[c] = std::max(maxColor[c], (int)rgba[4 * i + c]);
+        }
+#endif
+}
+
+// projects every pixel on the e1 -> e0 line and picks the nearest of the four palette entries
+uint32_t colorIndices(const unsigned char* rgba, const int e0[3], const int e1[3])
+{
+    int dir[3] = { e0[0] - e1[0], e0[1] - e1[1], e0[2] - e1[2] };
+    int lengthSquared = dir[0] * dir[0] + dir[1] * dir[1] + dir[2] * dir[2];
+    if (lengthSquared == 0)
+        return 0;
+
+    // position on the line (0 = e1, 3 = e0) to BC1 index
+    static const uint32_t remap[4] = { 1, 3, 2, 0 };
+    float base = (float)(e1[0] * dir[0] + e1[1] * dir[1] + e1[2] * dir[2]);
+    float scale = 3.0f / lengthSquared;
+    int steps[16];
+
+#ifdef BLOCK_SSE2
+    __m128i zero = _mm_setzero_si128();
+    __m128i dirVec = _mm_setr_epi16((short)dir[0], (short)dir[1], (short)dir[2], 0, (short)dir[0], (short)dir[1], (short)dir[2], 0);
+    __m128 baseVec = _mm_set1_ps(base), scaleVec = _mm_set1_ps(scale);
+    __m128i three = _mm_set1_epi32(3);
+    for (int i = 0; i < 4; i++) {
+        __m128i pixels = _mm_loadu_si128((const __m128i*)(rgba + 16 * i));
+        // [r*dr + g*dg, b*db] for two pixels per register, then summed into lanes 0 and 2
+        __m128i low = _mm_madd_epi16(_mm_unpacklo_epi8(pixels, zero), dirVec);
+        __m128i high = _mm_madd_epi16(_mm_unpackhi_epi8(pixels, zero), dirVec);
+        low = _mm_add_epi32(low, _mm_shuffle_epi32(low, _MM_SHUFFLE(2, 3, 0, 1)));
+        high = _mm_add_epi32(high, _mm_shuffle_epi32(high, _MM_SHUFFLE(2, 3, 0, 1)));
+        __m128i dots = _mm_castps_si128(_mm_shuffle_ps(_mm_castsi128_ps(low), _mm_castsi128_ps(high), _MM_SHUFFLE(2, 0, 2, 0)));
+        __m128i t = _mm_cvtps_epi32(_mm_mul_ps(_mm_sub_ps(_mm_cvtepi32_ps(dots), baseVec), scaleVec));
+        t = _mm_min_epi16(_mm_max_epi16(t, zero), three);
+        _mm_storeu_si128((__m128i*)(steps + 4 * i), t);
+    }
+#else
+    for (int i = 0; i < 16; i++) {
+        const unsigned char* p = rgba + 4 * i;
+        float t = ((p[0] * dir[0] + p[1] * dir[1] + p[2] * dir[2]) - base) * scale;
+        steps[i] = std::min(3, std::max(0, (int)(t + 0.5f)));
+    }
+#endif
+
+    uint32_t indices = 0;
+    for (int i = 0; i < 16; i++)
+        indices |= remap[steps[i]] << (2 * i);
+    return indices;
+}
+
+void colorPalette(uint16_t c0, uint16_t c1, int palette[4][3])
+{
+    unpackColor565(c0, palette[0]);
+    unpackColor565(c1, palette[1]);
+    for (int c = 0; c < 3; c++) {
+        palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+        palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+    }
+}
+
+int colorError(const unsigned char* rgba, uint16_t c0, uint16_t c1, uint32_t indices)
+{
+    int palette[4][3];
+    colorPalette(c0, c1, palette);
+
+    int error = 0;
+    for (int i = 0; i < 16; i++) {
+        const int* entry = palette[(indices >> (2 * i)) & 3];
+        for (int c = 0; c < 3; c++) {
+            int d = rgba[4 * i + c] - entry[c];
+            error += d * d;
+        }
+    }
+    return error;
+}
+
+// least squares endpoints for fixed indices, false when the system is degenerate
+bool refineEndpoints(const unsigned char* rgba, uint32_t indices, uint16_t& c0, uint16_t& c1)
+{
+    static const float weights[4] = { 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f };
+
+    float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+    float ax[3] = { 0.0f, 0.0f, 0.0f }, bx[3] = { 0.0f, 0.0f, 0.0f };
+    for (int i = 0; i < 16; i++) {
+        float a = weights[(indices >> (2 * i)) & 3], b = 1.0f - a;
+        aa += a * a;
+        ab += a * b;
+        bb += b * b;
+        for (int c = 0; c < 3; c++) {
+            ax[c] += a * rgba[4 * i + c];
+            bx[c] += b * rgba[4 * i + c];
+        }
+    }
+
+    float det = aa * bb - ab * ab;
+    if (std::abs(det) < 1e-4f)
+        return false;
+
+    int e0[3], e1[3];
+    for (int c = 0; c < 3; c++) {
+        float v0 = (ax[c] * bb - bx[c] * ab) / det;
+        float v1 = (bx[c] * aa - ax[c] * ab) / det;
+        e0[c] = std::min(255, std::max(0, (int)(v0 + 0.5f)));
+        e1[c] = std::min(255, std::max(0, (int)(v1 + 0.5f)));
+    }
+    c0 = packColor565(e0);
+    c1 = packColor565(e1);
+    return true;
+}
+
+void encodeColor(const unsigned char* rgba, unsigned char* out)
+{
+    int minColor[3], maxColor[3];
+    colorBounds(rgba, minColor, maxColor);
+
+    // shrink the box a little, the extremes are rarely the best endpoints
+    for (int c = 0; c < 3; c++) {
+        int inset = (maxColor[c] - minColor[c]) >> 4;
+        minColor[c] += inset;
+        maxColor[c] -= inset;
+    }
+
+    // pick the box diagonal that follows the colour distribution
+    int center[3] = { (minColor[0] + maxColor[0]) / 2, (minColor[1] + maxColor[1]) / 2, (minColor[2] + maxColor[2]) / 2 };
+    int covGreen = 0, covBlue = 0;
+    for (int i = 0; i < 16; i++) {
+        int r = rgba[4 * i] - center[0];
+        covGreen += r * (rgba[4 * i + 1] - center[1]);
+        covBlue += r * (rgba[4 * i + 2] - center[2]);
+    }
+    if (covGreen < 0)
+        std::swap(minColor[1], maxColor[1]);
+    if (covBlue < 0)
+        std::swap(minColor[2], maxColor[2]);
+
+    uint16_t c0 = packColor565(maxColor), c1 = packColor565(minColor);
+    int palette[4][3];
+    colorPalette(c0, c1, palette);
+    uint32_t indices = colorIndices(rgba, palette[0], palette[1]);
+    int error = colorError(rgba, c0, c1, indices);
+
+    uint16_t r0 = c0, r1 = c1;
+    if (refineEndpoints(rgba, indices, r0, r1)) {
+        colorPalette(r0, r1, palette);
+        uint32_t refined = colorIndices(rgba, palette[0], palette[1]);
+        int refinedError = colorError(rgba, r0, r1, refined);
+        if (refinedError < error) {
+            c0 = r0;
+            c1 = r1;
+            indices = refined;
+        }
+    }
+
+    // four colour mode needs c0 > c1, swapping the endpoints flips 0 <-> 1 and 2 <-> 3
+    if (c0 < c1) {
+        std::swap(c0, c1);
+        indices ^= 0x55555555u;
+    }
+    else if (c0 == c1)
+        indices = 0;
+
+    out[0] = (unsigned char)(c0 & 0xFF);
+    out[1] = (unsigned char)(c0 >> 8);
+    out[2] = (unsigned char)(c1 & 0xFF);
+    out[3] = (unsigned char)(c1 >> 8);
+    std::memcpy(out + 4, &indices, 4);
+}
+
+// BC4 block of one channel
+void encodeChannel(const unsigned char* rgba, int channel, unsigned char* out)
+{
+    unsigned char values[16];
+    for (int i = 0; i < 16; i++)
+        values[i] = rgba[4 * i + channel];
+
+    int low, high;
+#ifdef BLOCK_SSE2
+    __m128i v = _mm_loadu_si128((const __m128i*)values);
+    __m128i minV = _mm_min_epu8(v, _mm_srli_si128(v, 8));
+    __m128i maxV = _mm_max_epu8(v, _mm_srli_si128(v, 8));
+    minV = _mm_min_epu8(minV, _mm_srli_si128(minV, 4));
+    maxV = _mm_max_epu8(maxV, _mm_srli_si128(maxV, 4));
+    minV = _mm_min_epu8(minV, _mm_srli_si128(minV, 2));
+    maxV = _mm_max_epu8(maxV, _mm_srli_si128(maxV, 2));
+    minV = _mm_min_epu8(minV, _mm_srli_si128(minV, 1));
+    maxV = _mm_max_epu8(maxV, _mm_srli_si128(maxV, 1));
+    low = _mm_cvtsi128_si32(minV) & 0xFF;
+    high = _mm_cvtsi128_si32(maxV) & 0xFF;
+#else
+    low = 255;
+    high = 0;
+    for (int i = 0; i < 16; i++) {
+        low = std::min(low, (int)values[i]);
+        high = std::max(high, (int)values[i]);
+    }
+#endif
+
+    // eight value mode: index 0 = high, 1 = low, 2..7 interpolate from high to low
+    out[0] = (unsigned char)high;
+    out[1] = (unsigned char)low;
+
+    uint64_t indices = 0;
+    int range = high - low;
+    if (range > 0) {
+        static const uint64_t remap[8] = { 1, 7, 6, 5, 4, 3, 2, 0 };
+        for (int i = 0; i < 16; i++) {
+            int step = ((values[i] - low) * 14 + range) / (2 * range);
+            indices |= remap[step] << (3 * i);
+        }
+    }
+    for (int i = 0; i < 6; i++)
+        out[2 + i] = (unsigned char)(indices >> (8 * i));
+}
+
+// 4x4 block of a level as RGBA8, edge pixels are repeated for levels smaller than a block
+void fetchBlock(const unsigned char* pixels, int width, int height, int channelsNum, int blockX, int blockY, unsigned char* rgba)
+{
+    for (int y = 0; y < 4; y++) {
+        int py = std::min(blockY * 4 + y, height - 1);
+        for (int x = 0; x < 4; x++) {
+            int px = std::min(blockX * 4 + x, width - 1);
+            const unsigned char* src = pixels + ((size_t)py * width + px) * channelsNum;
+            unsigned char* dst = rgba + 4 * (y * 4 + x);
+            switch (channelsNum) {
+            case 1:
+                dst[0] = dst[1] = dst[2] = src[0];
+                dst[3] = 255;
+                break;
+            case 2:
+                dst[0] = dst[1] = dst[2] = src[0];
+                dst[3] = src[1];
+                break;
+            case 3:
+                dst[0] = src[0];
+                dst[1] = src[1];
+                dst[2] = src[2];
+                dst[3] = 255;
+                break;
+            default:
+                std::memcpy(dst, src, 4);
+            }
+        }
+    }
+}
+
+}
+
+void compressBlockBC1(const unsigned char* rgba, unsigned char* out)
+{
+    encodeColor(rgba, out);
+}
+
+void compressBlockBC3(const unsigned char* rgba, unsigned char* out)
+{
+    encodeChannel(rgba, 3, out);
+    encodeColor(rgba, out + 8);
+}
+
+void compressBlockBC5(const unsigned char* rgba, unsigned char* out)
+{
+    encodeChannel(rgba, 0, out);
+    encodeChannel(rgba, 1, out + 8);
+}
+
+size_t blockSize(BlockFormat format)
+{
+    switch (format) {
+    case BlockFormat::BC1:
+        return 8;
+    case BlockFormat::BC3:
+    case BlockFormat::BC5:
+        return 16;
+    default:
+        return 0;
+    }
+}
+
+size_t compressedLevelSize(BlockFormat format, int width, int height)
+{
+    return (size_t)((width + 3) / 4) * ((height + 3) / 4) * blockSize(format);
+}
+
+MipChain compressMipChain(const MipChain& chain, BlockFormat format)
+{
+    if (format == BlockFormat::NONE || chain.format != BlockFormat::NONE)
+        return chain;
+
+    void (*compressBlock)(const unsigned char*, unsigned char*) = compressBlockBC1;
+    if (format == BlockFormat::BC3)
+        compressBlock = compressBlockBC3;
+    else if (format == BlockFormat::BC5)
+        compressBlock = compressBlockBC5;
+
+    MipChain result;
+    result.width = chain.width;
+    result.height = chain.height;
+    result.channelsNum = chain.channelsNum;
+    result.format = format;
+
+    size_t total = 0;
+    for (const MipLevel& level : chain.levels) {
+        size_t size = compressedLevelSize(format, level.width, level.height);
+        result.levels.push_back(MipLevel{ level.width, level.height, total, size });
+        total += size;
+    }
+    result.pixels.resize(total);
+
+    ThreadPool& pool = ThreadPool::shared();
+    size_t bytesPerBlock = blockSize(format);
+    for (size_t i = 0; i < chain.levels.size(); i++) {
+        const MipLevel& src = chain.levels[i];
+        const unsigned char* pixels = chain.levelData(i);
+        unsigned char* out = result.pixels.data() + result.levels[i].offset;
+        int blocksX = (src.width + 3) / 4, blocksY = (src.height + 3) / 4;
+
+        pool.parallelFor(blocksY, BLOCK_ROWS_PER_TASK, [&](size_t begin, size_t end) {
+            unsigned char rgba[64];
+            for (size_t by = begin; by < end; by++)
+                for (int bx = 0; bx < blocksX; bx++) {
+                    fetchBlock(pixels, src.width, src.height, chain.channelsNum, bx, (int)by, rgba);
+                    compressBlock(rgba, out + (by * blocksX + bx) * bytesPerBlock);
+                }
+        });
+    }
+
+    return result;
+}
@@ -0,0 +1,23 @@
+#ifndef BLOCK_COMPRESSOR_H
+#define BLOCK_COMPRESSOR_H
+
+#include <cstddef>
+
+#include "MipmapGenerator.h"
+
+// BC1: opaque colour, 8 bytes per block
+// BC3: colour + interpolated alpha, 16 bytes per block
+// BC5: two interpolated channels (red and green), 16 bytes per block, used for tangent space normals
+
+size_t blockSize(BlockFormat format);
+size_t compressedLevelSize(BlockFormat format, int width, int height);
+
+// encodes a 4x4 block of RGBA8 pixels (row major)
+void compressBlockBC1(const unsigned char* rgba, unsigned char* out);
+void compressBlockBC3(const unsigned char* rgba, unsigned char* out);
+void compressBlockBC5(const unsigned char* rgba, unsigned char* out);
+
+// compresses every level of an 8-bit chain, block rows are split across ThreadPool::shared()
+MipChain compressMipChain(const MipChain& chain, BlockFormat format);
+
+#endif
@@ -0,0 +1,426 @@
+#include "Bvh.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
+#include <cmath>
+#include <mutex>
+
+#include "Float4.h"
+
+namespace {
+
+const unsigned int BINS_NUM = 16;
+const uint32_t MAX_LEAF_SIZE = 4;
+// cost of stepping into a node relative to a triangle test
+const float TRAVERSAL_COST = 1.0f;
+// nodes of more triangles are binned by the pool and build their two subtrees as separate tasks
+const uint32_t PARALLEL_SIZE = 4096;
+const size_t BIN_GRAIN = 1024;
+const uint32_t EMPTY = 0xFFFFFFFFu;
+const int STACK_SIZE = 256;
+
+struct Box
+{
+    glm::vec3 min = glm::vec3(FLT_MAX);
+    glm::vec3 max = glm::vec3(-FLT_MAX);
+
+    void grow(const glm::vec3& point)
+    {
+        min = glm::min(min, point);
+        max = glm::max(max, point);
+    }
+
+    void grow(const Box& box)
+    {
+        min = glm::min(min, box.min);
+        max = glm::max(max, box.max);
+    }
+
+    float area() const
+    {
+        glm::vec3 size = max - min;
+        if (size.x < 0.0f)
+            return 0.0f;
+        return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+    }
+};
+
+struct BinaryNode
+{
+    Box box;
+    uint32_t first;     // the first child, the second one follows it, or the first triangle of a leaf
+    uint32_t count;     // triangles of a leaf, 0 for an inner node
+};
+
+// bounds and triangle counts of the centroid bins along the three axes
+struct Bins
+{
+    Box boxes[3][BINS_NUM];
+    uint32_t counts[3][BINS_NUM] = {};
+
+    void merge(const Bins& other)
+    {
+        for (int axis = 0; axis < 3; axis++) {
+            for (unsigned int i = 0; i < BINS_NUM; i++) {
+                boxes[axis][i].grow(other.boxes[axis][i]);
+                counts[axis][i] += other.counts[axis][i];
+            }
+        }
+    }
+};
+
+// binned SAH build of the binary tree, the subtrees write their nodes to slots taken with an atomic counter
+class Builder
+{
+public:
+
+    std::vector<Box> boxes;
+    std::vector<glm::vec3> centroids;
+    std::vector<uint32_t> order;
+    std::vector<BinaryNode> nodes;
+    std::atomic<uint32_t> nodesNum{ 1 };
+
+    explicit Builder(ThreadPool& pool) : pool(pool) {}
+
+    void build(uint32_t node, uint32_t begin, uint32_t end)
+    {
+        uint32_t count = end - begin;
+        Box box, centroidBox;
+        bounds(begin, end, box, centroidBox);
+        nodes[node].box = box;
+
+        uint32_t middle = begin + count / 2;
+        glm::vec3 extent = centroidBox.max - centroidBox.min;
+        if (count <= 1) {
+            makeLeaf(node, begin, count);
+            return;
+        }
+        if (extent.x > 0.0f || extent.y > 0.0f || extent.z > 0.0f) {
+            Bins bins;
+            bin(begin, end, centroidBox, bins);
+
+            // costs without the common 1 / area of the node: the child areas weighted by their triangle counts
+            int bestAxis = -1;
+            unsigned int bestSplit = 0;
+            float bestCost = FLT_MAX;
+            for (int axis = 0; axis < 3; axis++) {
+                if (!(extent[axis] > 0.0f))
+                    continue;
+                float rightCosts[BINS_NUM];
+                Box right;
+                uint32_t rightCount = 0;
+                for (unsigned int i = BINS_NUM - 1; i > 0; i--) {
+                    right.grow(bins.boxes[axis][i]);
+                    rightCount += bins.counts[axis][i];
+                    rightCosts[i] = right.area() * rightCount;
+                }
+                Box left;
+                uint32_t leftCount = 0;
+                for (unsigned int i = 1; i < BINS_NUM; i++) {
+                    left.grow(bins.boxes[axis][i - 1]);
+                    leftCount += bins.counts[axis][i - 1];
+                    float cost = left.area() * leftCount + rightCosts[i];
+                    if (leftCount > 0 && leftCount < count && cost < bestCost) {
+                        bestCost = cost;
+                        bestAxis = axis;
+                        bestSplit = i;
+                    }
+                }
+            }
+
+            float leafCost = box.area() * count;
+            if (count <= MAX_LEAF_SIZE && (bestAxis < 0 || leafCost <= TRAVERSAL_COST * box.area() + bestCost)) {
+                makeLeaf(node, begin, count);
+                return;
+            }
+            if (bestAxis >= 0) {
+                float low = centroidBox.min[bestAxis], scale = BINS_NUM / extent[bestAxis];
+                middle = (uint32_t)(std::partition(order.begin() + begin, order.begin() + end, [&](uint32_t triangle) {
+                    return binIndex(centroids[triangle][bestAxis], low, scale) < bestSplit;
+                }) - order.begin());
+            }
+        }
+        else if (count <= MAX_LEAF_SIZE) {
+            makeLeaf(node, begin, count);
+            return;
+        }
+        // coinciding centroids are split in halves in whatever order they are
+
+        uint32_t children = nodesNum.fetch_add(2);
+        nodes[node].first = children;
+        nodes[node].count = 0;
+        if (count > PARALLEL_SIZE) {
+            pool.parallelFor(2, 1, [&](size_t first, size_t last) {
+                for (size_t i = first; i < last; i++)
+                    build(children + (uint32_t)i, i == 0 ? begin : middle, i == 0 ? middle : end);
+            });
+        }
+        else {
+            build(children, begin, middle);
+            build(children + 1, middle, end);
+        }
+    }
+
+private:
+
+    ThreadPool& pool;
+
+    static unsigned int binIndex(float centroid, float low, float scale)
+    {
+        return std::min((unsigned int)((centroid - low) * scale), BINS_NUM - 1);
+    }
+
+    void makeLeaf(uint32_t node, uint32_t begin, uint32_t count)
+    {
+        nodes[node].first = begin;
+        nodes[node].count = count;
+    }
+
+    // the chunks of large nodes are processed by the pool, each into its own result merged under the lock
+    template<class Result, class Body, class Merge>
+    void reduce(uint32_t begin, uint32_t end, Result& result, Body body, Merge merge)
+    {
+        if (end - begin <= PARALLEL_SIZE) {
+            body(begin, end, result);
+            return;
+        }
+        std::mutex resultMutex;
+        pool.parallelFor(end - begin, BIN_GRAIN, [&](size_t first, size_t last) {
+            Result partial;
+            body(begin + (uint32_t)first, begin + (uint32_t)last, partial);
+            std::lock_guard<std::mutex> lock(resultMutex);
+            merge(result, partial);
+        });
+    }
+
+    void bounds(uint32_t begin, uint32_t end, Box& box, Box& centroidBox)
+    {
+        std::pair<Box, Box> result;
+        reduce(begin, end, result, [&](uint32_t first, uint32_t last, std::pair<Box, Box>& partial) {
+            for (uint32_t i = first; i < last; i++) {
+                partial.first.grow(boxes[order[i]]);
+                partial.second.grow(centroids[order[i]]);
+            }
+        }, [](std::pair<Box, Box>& total, const std::pair<Box, Box>& partial) {
+            total.first.grow(partial.first);
+            total.second.grow(partial.second);
+        });
+        box = result.first;
+        centroidBox = result.second;
+    }
+
+    void bin(uint32_t begin, uint32_t end, const Box& centroidBox, Bins& bins)
+    {
+        glm::vec3 extent = centroidBox.max - centroidBox.min;
+        reduce(begin, end, bins, [&](uint32_t first, uint32_t last, Bins& partial) {
+            for (uint32_t i = first; i < last; i++) {
+                uint32_t triangle = order[i];
+                for (int axis = 0; axis < 3; axis++) {
+                    if (!(extent[axis] > 0.0f))
+                        continue;
+                    unsigned int index = binIndex(centroids[triangle][axis], centroidBox.min[axis], BINS_NUM / extent[axis]);
+                    partial.boxes[axis][index].grow(boxes[triangle]);
+                    partial.counts[axis][index]++;
+                }
+            }
+        }, [](Bins& total, const Bins& partial) { total.merge(partial); });
+    }
+
+};
+
+}
+
+Bvh::Bvh(ThreadPool& pool)
+    : pool(pool)
+{
+}
+
+void Bvh::build(const std::vector<glm::vec3>& positions)
+{
+    nodes.clear();
+    triangles.clear();
+    uint32_t trianglesNum = (uint32_t)(positions.size() / 3);
+    if (trianglesNum == 0)
+        return;
+
+    Builder builder(pool);
+    builder.boxes.resize(trianglesNum);
+    builder.centroids.resize(trianglesNum);
+    builder.order.resize(trianglesNum);
+    pool.parallelFor(trianglesNum, BIN_GRAIN, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            Box box;
+            for (int k = 0; k < 3; k++)
+                box.grow(positions[i * 3 + k]);
+            builder.boxes[i] = box;
+            builder.centroids[i] = 0.5f * (box.min + box.max);
+            builder.order[i] = (uint32_t)i;
+        }
+    });
+    builder.nodes.resize((size_t)trianglesNum * 2);
+    builder.build(0, 0, trianglesNum);
+
+    // the triangles in leaf order, so that a leaf reads consecutive ones
+    triangles.resize(trianglesNum);
+    for (uint32_t i = 0; i < trianglesNum; i++) {
+        uint32_t index = builder.order[i];
+        const glm::vec3* corners = &positions[(size_t)index * 3];
+        triangles[i] = Triangle{ corners[0], corners[1] - corners[0], corners[2] - corners[0], index };
+    }
+
+    // every 4-wide node takes the children of a binary node and keeps opening the largest inner one of them
+    // until it has four; a leaf root becomes the only child of the root
+    const std::vector<BinaryNode>& binary = builder.nodes;
+    struct Pending
+    {
+        uint32_t binary;
+        uint32_t node;
+    };
+    std::vector<Pending> pending{ Pending{ 0, 0 } };
+    nodes.push_back(Node());
+    while (!pending.empty()) {
+        Pending current = pending.back();
+        pending.pop_back();
+
+        uint32_t slots[4];
+        int slotsNum = 0;
+        const BinaryNode& source = binary[current.binary];
+        if (source.count > 0) {
+            slots[slotsNum++] = current.binary;
+        }
+        else {
+            slots[slotsNum++] = source.first;
+            slots[slotsNum++] = source.first + 1;
+        }
+        while (slotsNum < 4) {
+            int largest = -1;
+            float largestArea = -1.0f;
+            for (int i = 0; i < slotsNum; i++) {
+                if (binary[slots[i]].count == 0 && binary[slots[i]].box.area() > largestArea) {
+                    largest = i;
+                    largestArea = binary[slots[i]].box.area();
+                }
+            }
+            if (largest < 0)
+                break;
+            uint32_t first = binary[slots[largest]].first;
+            slots[largest] = first;
+            slots[slotsNum++] = first + 1;
+        }
+
+        for (int i = 0; i < 4; i++) {
+            Node& node = nodes[current.node];
+            if (i >= slotsNum) {
+                for (int c = 0; c < 3; c++) {
+                    node.bounds[c][i] = FLT_MAX;
+                    node.bounds[3 + c][i] = -FLT_MAX;
+                }
+                node.child[i] = EMPTY;
+                node.count[i] = 0;
+                continue;
+            }
+            const BinaryNode& child = binary[slots[i]];
+            for (int c = 0; c < 3; c++) {
+                node.bounds[c][i] = child.box.min[c];
+                node.bounds[3 + c][i] = child.box.max[c];
+            }
+            node.count[i] = child.count;
+            if (child.count > 0) {
+                node.child[i] = child.first;
+            }
+            else {
+                node.child[i] = (uint32_t)nodes.size();
+                pending.push_back(Pending{ slots[i], (uint32_t)nodes.size() });
+                nodes.push_back(Node());
+            }
+        }
+    }
+}
+
+bool Bvh::intersect(const glm::vec3& origin, const glm::vec3& direction, float tMin, float tMax, BvhHit& hit) const
+{
+    if (nodes.empty())
+        return false;
+
+    // zero components would give NaN slab distances, they are made tiny instead; the near and far planes of the
+    // slabs are picked by the signs, so that the inverted boxes of empty children are never hit
+    glm::vec3 inverse;
+    for (int c = 0; c < 3; c++) {
+        float component = direction[c];
+        if (std::fabs(component) < 1e-20f)
+            component = component < 0.0f ? -1e-20f : 1e-20f;
+        inverse[c] = 1.0f / component;
+    }
+    int nearX = inverse.x < 0.0f ? 3 : 0, nearY = inverse.y < 0.0f ? 4 : 1, nearZ = inverse.z < 0.0f ? 5 : 2;
+    int farX = nearX < 3 ? 3 : 0, farY = nearY < 3 ? 4 : 1, farZ = nearZ < 3 ? 5 : 2;
+    Float4 originX(origin.x), originY(origin.y), originZ(origin.z);
+    Float4 inverseX(inverse.x), inverseY(inverse.y), inverseZ(inverse.z);
+
+    bool found = false;
+    float nearest = tMax;
+    uint32_t stack[STACK_SIZE];
+    int stackSize = 0;
+    stack[stackSize++] = 0;
+    while (stackSize > 0) {
+        const Node& node = nodes[stack[--stackSize]];
+        Float4 entry = max(max((Float4::load(node.bounds[nearX]) - originX) * inverseX, (Float4::load(node.bounds[nearY]) - originY) * inverseY),
+            max((Float4::load(node.bounds[nearZ]) - originZ) * inverseZ, Float4(tMin)));
+        Float4 exit = min(min((Float4::load(node.bounds[farX]) - originX) * inverseX, (Float4::load(node.bounds[farY]) - originY) * inverseY),
+            min((Float4::load(node.bounds[farZ]) - originZ) * inverseZ, Float4(nearest)));
+        int bits = laneBits(entry <= exit);
+        if (bits == 0)
+            continue;
+
+        // children hit, nearest first
+        float distances[4];
+        entry.store(distances);
+        int hitOrder[4], hitsNum = 0;
+        for (int i = 0; i < 4; i++) {
+            if (!(bits >> i & 1))
+                continue;
+            int k = hitsNum++;
+            while (k > 0 && distances[hitOrder[k - 1]] > distances[i]) {
+                hitOrder[k] = hitOrder[k - 1];
+                k--;
+            }
+            hitOrder[k] = i;
+        }
+
+        // leaves are tested right away, inner nodes are pushed with the nearest on top
+        for (int k = 0; k < hitsNum; k++) {
+            int i = hitOrder[k];
+            if (node.count[i] == 0)
+                continue;
+            for (uint32_t j = node.child[i]; j < node.child[i] + node.count[i]; j++) {
+                // Moller-Trumbore, both sides
+                const Triangle& triangle = triangles[j];
+                glm::vec3 p = glm::cross(direction, triangle.edge2);
+                float determinant = glm::dot(triangle.edge1, p);
+                if (std::fabs(determinant) < 1e-12f)
+                    continue;
+                float inverseDeterminant = 1.0f / determinant;
+                glm::vec3 s = origin - triangle.origin;
+                float u = glm::dot(s, p) * inverseDeterminant;
+                if (u < 0.0f || u > 1.0f)
+                    continue;
+                glm::vec3 q = glm::cross(s, triangle.edge1);
+                float v = glm::dot(direction, q) * inverseDeterminant;
+                if (v < 0.0f || u + v > 1.0f)
+                    continue;
+                float t = glm::dot(triangle.edge2, q) * inverseDeterminant;
+                if (t > tMin && t < nearest) {
+                    nearest = t;
+                    hit = BvhHit{ t, triangle.index, u, v };
+                    found = true;
+                }
+            }
+        }
+        for (int k = hitsNum - 1; k >= 0; k--) {
+            int i = hitOrder[k];
+            if (node.count[i] == 0 && node.child[i] != EMPTY && stackSize < STACK_SIZE)
+                stack[stackSize++] = node.child[i];
+        }
+    }
+    return found;
+}
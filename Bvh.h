@@ -0,0 +1,62 @@
+#ifndef BVH_H
+#define BVH_H
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "ThreadPool.h"
+
+// the nearest hit of a ray: distance along it, triangle and the barycentric weights of its second and third corners
+struct BvhHit
+{
+    float t;
+    uint32_t triangle;
+    float u, v;
+};
+
+// Bounding volume hierarchy of triangles with four children per node. The build bins the triangle centroids and
+// splits by the surface area heuristic (SAH), with the binning of large nodes and the subtrees spread over the
+// pool; the binary tree is then collapsed into 4-wide nodes, whose four boxes a ray tests at once with SSE.
+class Bvh
+{
+public:
+
+    explicit Bvh(ThreadPool& pool = ThreadPool::shared());
+
+    // `positions` holds the three corners of every triangle
+    void build(const std::vector<glm::vec3>& positions);
+
+    // nearest triangle along origin + t * direction with t in (tMin, tMax)
+    bool intersect(const glm::vec3& origin, const glm::vec3& direction, float tMin, float tMax, BvhHit& hit) const;
+
+    size_t nodesNum() const { return nodes.size(); }
+    size_t trianglesNum() const { return triangles.size(); }
+
+private:
+
+    // boxes of the four children as minimum and maximum x, y and z of each; a child is a node, a leaf of
+    // `count` triangles from `child`, or empty (count 0 and child EMPTY, its box never hit)
+    struct Node
+    {
+        float bounds[6][4];
+        uint32_t child[4];
+        uint32_t count[4];
+    };
+
+    // in leaf order, the first corner and the two edges from it
+    struct Triangle
+    {
+        glm::vec3 origin, edge1, edge2;
+        uint32_t index;
+    };
+
+    ThreadPool& pool;
+    std::vector<Node> nodes;
+    std::vector<Triangle> triangles;
+
+};
+
+#endif
@@ -1,10 +1,15 @@
 #include "Camera.h"
 
-glm::mat4 Camera::getViewMatrix()
+glm::mat4 Camera::getViewMatrix() const
 {
     return glm::lookAt(Position, Position + Front, Up);
 }
 
+Frustum Camera::getFrustum(const glm::mat4& projection) const
+{
+    return Frustum::fromMatrix(projection * getViewMatrix());
+}
+
 void Camera::processKeyboard(CameraMovement direction, float deltaTime)
 {
     float velocity = Speed * deltaTime;
@@ -45,6 +50,15 @@ void Camera::processMouseScroll(float yoffset)
         Zoom = 45.0f;
 }
 
+void Camera::lookAt(const glm::vec3& position, const glm::vec3& target)
+{
+    glm::vec3 direction = glm::normalize(target - position);
+    Position = position;
+    Yaw = glm::degrees(atan2(direction.z, direction.x));
+    Pitch = glm::degrees(asin(glm::clamp(direction.y, -1.0f, 1.0f)));
+    updateCameraVectors();
+}
+
 void Camera::updateCameraVectors()
 {
     glm::vec3 front;
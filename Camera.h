@@ -7,6 +7,8 @@
 
 #include <vector>
 
+#include "FrustumCulling.h"
+
 enum class CameraMovement {
     FORWARD,
     BACKWARD,
@@ -55,10 +57,14 @@ public:
         updateCameraVectors();
     }
 
-    glm::mat4 getViewMatrix();
+    glm::mat4 getViewMatrix() const;
+    // planes of the volume seen through `projection` from the current position and direction
+    Frustum getFrustum(const glm::mat4& projection) const;
     void processKeyboard(CameraMovement direction, float deltaTime);
     void processMouseMovement(float xoffset, float yoffset, GLboolean constrainPitch = true);
     void processMouseScroll(float yoffset);
+    // moves to `position` and turns towards `target`
+    void lookAt(const glm::vec3& position, const glm::vec3& target);
 
 private:
 
@@ -0,0 +1,101 @@
+#include "CameraPath.h"
+
+#include <glm/gtc/constants.hpp>
+
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+static glm::vec3 catmullRom(const glm::vec3& p0, const glm::vec3& p1, const glm::vec3& p2, const glm::vec3& p3, float t)
+{
+    float t2 = t * t, t3 = t2 * t;
+    return 0.5f * (2.0f * p1 + (p2 - p0) * t + (2.0f * p0 - 5.0f * p1 + 4.0f * p2 - p3) * t2 + (3.0f * p1 - p0 - 3.0f * p2 + p3) * t3);
+}
+
+bool CameraPath::load(const std::string& path)
+{
+    std::ifstream file(path);
+    if (!file) {
+        std::cerr << "ERROR: camera path reading failed: " << path << std::endl;
+        return false;
+    }
+
+    std::vector<Key> loaded;
+    std::string line;
+    int lineNum = 0;
+    while (std::getline(file, line)) {
+        lineNum++;
+        line = line.substr(0, line.find('#'));
+        if (line.find_first_not_of(" \t\r") == std::string::npos)
+            continue;
+
+        std::istringstream values(line);
+        Key key;
+        values >> key.time >> key.position.x >> key.position.y >> key.position.z >> key.target.x >> key.target.y >> key.target.z;
+        if (values.fail() || (!loaded.empty() && key.time <= loaded.back().time)) {
+            std::cerr << "ERROR: invalid camera key at " << path << ":" << lineNum << std::endl;
+            return false;
+        }
+        loaded.push_back(key);
+    }
+    if (loaded.empty()) {
+        std::cerr << "ERROR: camera path has no keys: " << path << std::endl;
+        return false;
+    }
+
+    keys = std::move(loaded);
+    looped = false;
+    return true;
+}
+
+CameraPath CameraPath::orbit(const glm::vec3& center, float radius, float height, float period, unsigned int keysNum)
+{
+    CameraPath path;
+    for (unsigned int i = 0; i < keysNum; i++) {
+        float angle = glm::two_pi<float>() * i / keysNum;
+        Key key;
+        key.time = period * i / keysNum;
+        key.position = center + glm::vec3(radius * std::sin(angle), height, -radius * std::cos(angle));
+        key.target = center;
+        path.keys.push_back(key);
+    }
+    path.looped = true;
+    path.period = period;
+    return path;
+}
+
+void CameraPath::sample(float time, glm::vec3& position, glm::vec3& target) const
+{
+    size_t n = keys.size();
+    if (n == 0)
+        return;
+    if (looped)
+        time = std::fmod(time, period);
+    else if (time >= keys.back().time) {
+        position = keys.back().position;
+        target = keys.back().target;
+        return;
+    }
+    if (n == 1 || time <= keys.front().time) {
+        position = keys.front().position;
+        target = keys.front().target;
+        return;
+    }
+
+    // the segment from key i to the next, the keys around it shape the tangents (repeated at the ends of open paths)
+    size_t i = 0;
+    while (i + 1 < n && keys[i + 1].time <= time)
+        i++;
+    auto key = [&](long offset) -> const Key& {
+        long index = (long)i + offset;
+        if (looped)
+            return keys[(index + (long)n) % (long)n];
+        return keys[glm::clamp(index, 0L, (long)n - 1)];
+    };
+    float endTime = i + 1 < n ? keys[i + 1].time : period;
+    float t = (time - keys[i].time) / (endTime - keys[i].time);
+
+    position = catmullRom(key(-1).position, key(0).position, key(1).position, key(2).position, t);
+    target = catmullRom(key(-1).target, key(0).target, key(1).target, key(2).target, t);
+}
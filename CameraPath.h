@@ -0,0 +1,37 @@
+#ifndef CAMERA_PATH_H
+#define CAMERA_PATH_H
+
+#include <glm/glm.hpp>
+
+#include <string>
+#include <vector>
+
+// Scripted camera: keyframed positions and look-at targets, interpolated with Catmull-Rom splines.
+// Open paths hold their last key, looped ones start over after the last key.
+class CameraPath
+{
+public:
+
+    struct Key
+    {
+        float time;
+        glm::vec3 position;
+        glm::vec3 target;
+    };
+
+    // reads one "time px py pz tx ty tz" key per line in increasing time, # starts a comment
+    bool load(const std::string& path);
+
+    // a looped turn around `center` at `radius` and `height` above it, starting on the -Z side, in `period` seconds
+    static CameraPath orbit(const glm::vec3& center, float radius, float height, float period, unsigned int keysNum = 16);
+
+    void sample(float time, glm::vec3& position, glm::vec3& target) const;
+
+private:
+
+    std::vector<Key> keys;
+    bool looped = false;
+    float period = 0.0f;
+
+};
+#endif
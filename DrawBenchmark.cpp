@@ -0,0 +1,80 @@
+#include "DrawBenchmark.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <cstdio>
+#include <iostream>
+#include <random>
+
+#include "GLExtensions.h"
+
+DrawBenchmark::DrawBenchmark()
+    : counts{ 5, 100, 1000, 10000, 100000 }
+{
+}
+
+void DrawBenchmark::start(const glm::vec3& center, const glm::vec3& extent)
+{
+    if (!hasMultiDrawIndirect()) {
+        std::cerr << "ERROR: the draw benchmark needs multi-draw indirect and ARB_shader_draw_parameters" << std::endl;
+        return;
+    }
+
+    this->center = center;
+    this->extent = extent;
+    results.clear();
+    startSteps(counts.size() * SUBMISSIONS_NUM);
+    generate();
+    std::cout << "Draw benchmark started\n";
+}
+
+void DrawBenchmark::generate()
+{
+    // the same boxes for every submission of a count
+    unsigned int count = counts[currentStep() / SUBMISSIONS_NUM];
+    std::mt19937 random(count);
+    std::uniform_real_distribution<float> offset(-1.0f, 1.0f);
+    std::uniform_real_distribution<float> angle(0.0f, glm::radians(180.0f));
+    std::uniform_real_distribution<float> scale(0.1f, 0.3f);
+    boxes.resize(count);
+    for (glm::mat4& box : boxes) {
+        glm::vec3 position = center + extent * glm::vec3(offset(random), offset(random), offset(random));
+        glm::vec3 axis(offset(random), offset(random), offset(random));
+        box = glm::translate(glm::mat4(1.0f), position);
+        if (glm::length(axis) > 0.0f)
+            box = glm::rotate(box, angle(random), glm::normalize(axis));
+        box = glm::scale(box, glm::vec3(scale(random)));
+    }
+}
+
+void DrawBenchmark::stepMeasured(size_t step, const BenchmarkTimes& times)
+{
+    unsigned int submission = step % SUBMISSIONS_NUM;
+    if (submission == 0)
+        results.push_back(Result{ counts[step / SUBMISSIONS_NUM], {}, {}, {} });
+    results.back().cpuTime[submission] = times.cpu;
+    results.back().submitTime[submission] = times.submit;
+    results.back().gpuTime[submission] = times.gpu;
+
+    if (active()) {
+        if (currentStep() % SUBMISSIONS_NUM == 0)
+            generate();
+    }
+    else
+        printResults();
+}
+
+void DrawBenchmark::printResults() const
+{
+    const char* names[SUBMISSIONS_NUM] = { "instanced", "separate", "multi-draw" };
+    std::cout << "Draw benchmark, ms per frame (CPU: culling and building the draws, submit: draw calls, GPU: until finished)\n";
+    std::cout << "     boxes | submission |         CPU |      submit |         GPU\n";
+    for (const Result& result : results) {
+        for (unsigned int i = 0; i < SUBMISSIONS_NUM; i++) {
+            char line[128];
+            snprintf(line, sizeof(line), "%10u | %10s | %11.3f | %11.3f | %11.3f\n", result.count, names[i],
+                result.cpuTime[i], result.submitTime[i], result.gpuTime[i]);
+            std::cout << line;
+        }
+    }
+}
@@ -0,0 +1,51 @@
+#ifndef DRAW_BENCHMARK_H
+#define DRAW_BENCHMARK_H
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+#include "Benchmark.h"
+#include "IndirectDrawBuffer.h"
+
+// Replaces the boxes with growing numbers of randomly placed ones and submits every count in one instanced call,
+// with one call per box and with one multi-draw indirect call. Each frame records the CPU time of culling and
+// building the draws, the time the draw calls take to return and the time until the GPU has finished them,
+// the averages are printed as a table at the end.
+class DrawBenchmark : public Benchmark
+{
+public:
+
+    DrawBenchmark();
+
+    // boxes are spread over the box (center, extent); does nothing without multi-draw indirect support
+    void start(const glm::vec3& center, const glm::vec3& extent);
+
+    // boxes and submission of the current step
+    const std::vector<glm::mat4>& models() const { return boxes; }
+    DrawSubmission submission() const { return (DrawSubmission)(currentStep() % SUBMISSIONS_NUM); }
+
+private:
+
+    static const unsigned int SUBMISSIONS_NUM = 3;
+
+    struct Result
+    {
+        unsigned int count;
+        double cpuTime[SUBMISSIONS_NUM];
+        double submitTime[SUBMISSIONS_NUM];
+        double gpuTime[SUBMISSIONS_NUM];
+    };
+
+    std::vector<unsigned int> counts;
+    glm::vec3 center;
+    glm::vec3 extent;
+    std::vector<glm::mat4> boxes;
+    std::vector<Result> results;
+
+    void stepMeasured(size_t step, const BenchmarkTimes& times) override;
+    void generate();
+    void printResults() const;
+
+};
+#endif
@@ -0,0 +1,279 @@
+#ifndef FLOAT4_H
+#define FLOAT4_H
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define FLOAT4_SSE2
+#include <emmintrin.h>
+#endif
+
+// Four floats processed together, one SSE register where SSE2 is available and plain arrays elsewhere.
+// The software renderer shades 2x2 pixel quads with them, lane i is pixel (i & 1, i >> 1) of the quad.
+// Comparisons return masks with all bits of a lane set where they hold, select() and the bit operators take them.
+struct Float4
+{
+#ifdef FLOAT4_SSE2
+    __m128 v;
+
+    Float4() = default;
+    Float4(__m128 v) : v(v) {}
+    Float4(float s) : v(_mm_set1_ps(s)) {}
+    Float4(float a, float b, float c, float d) : v(_mm_setr_ps(a, b, c, d)) {}
+
+    static Float4 load(const float* p) { return _mm_loadu_ps(p); }
+    void store(float* p) const { _mm_storeu_ps(p, v); }
+#else
+    float v[4];
+
+    Float4() = default;
+    Float4(float s) : v{ s, s, s, s } {}
+    Float4(float a, float b, float c, float d) : v{ a, b, c, d } {}
+
+    static Float4 load(const float* p) { return Float4(p[0], p[1], p[2], p[3]); }
+    void store(float* p) const { memcpy(p, v, sizeof(v)); }
+#endif
+
+    float operator[](int i) const
+    {
+        float lanes[4];
+        store(lanes);
+        return lanes[i];
+    }
+
+    // mask with lanes set where the bits of `bits` are, lane i from bit i
+    static Float4 laneMask(int bits)
+    {
+        uint32_t lanes[4];
+        for (int i = 0; i < 4; i++)
+            lanes[i] = bits >> i & 1 ? 0xFFFFFFFFu : 0u;
+        float values[4];
+        memcpy(values, lanes, sizeof(values));
+        return load(values);
+    }
+};
+
+#ifdef FLOAT4_SSE2
+
+inline Float4 operator+(Float4 a, Float4 b) { return _mm_add_ps(a.v, b.v); }
+inline Float4 operator-(Float4 a, Float4 b) { return _mm_sub_ps(a.v, b.v); }
+inline Float4 operator*(Float4 a, Float4 b) { return _mm_mul_ps(a.v, b.v); }
+inline Float4 operator/(Float4 a, Float4 b) { return _mm_div_ps(a.v, b.v); }
+inline Float4 operator-(Float4 a) { return _mm_xor_ps(a.v, _mm_set1_ps(-0.0f)); }
+
+inline Float4 operator<(Float4 a, Float4 b) { return _mm_cmplt_ps(a.v, b.v); }
+inline Float4 operator<=(Float4 a, Float4 b) { return _mm_cmple_ps(a.v, b.v); }
+inline Float4 operator>(Float4 a, Float4 b) { return _mm_cmpgt_ps(a.v, b.v); }
+inline Float4 operator>=(Float4 a, Float4 b) { return _mm_cmpge_ps(a.v, b.v); }
+inline Float4 operator==(Float4 a, Float4 b) { return _mm_cmpeq_ps(a.v, b.v); }
+
+inline Float4 operator&(Float4 a, Float4 b) { return _mm_and_ps(a.v, b.v); }
+inline Float4 operator|(Float4 a, Float4 b) { return _mm_or_ps(a.v, b.v); }
+// a without the lanes of mask b
+inline Float4 andNot(Float4 a, Float4 b) { return _mm_andnot_ps(b.v, a.v); }
+
+inline Float4 min(Float4 a, Float4 b) { return _mm_min_ps(a.v, b.v); }
+inline Float4 max(Float4 a, Float4 b) { return _mm_max_ps(a.v, b.v); }
+inline Float4 sqrt(Float4 a) { return _mm_sqrt_ps(a.v); }
+inline Float4 abs(Float4 a) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a.v); }
+
+// lanes of a where mask is set, of b elsewhere
+inline Float4 select(Float4 mask, Float4 a, Float4 b) { return _mm_or_ps(_mm_and_ps(mask.v, a.v), _mm_andnot_ps(mask.v, b.v)); }
+
+// bit i is set when lane i of the mask is
+inline int laneBits(Float4 mask) { return _mm_movemask_ps(mask.v); }
+
+inline Float4 floor(Float4 a)
+{
+    // truncation rounds toward zero, one is taken off the negative lanes it rounded up (|a| < 2^31 is assumed)
+    __m128 truncated = _mm_cvtepi32_ps(_mm_cvttps_epi32(a.v));
+    return _mm_sub_ps(truncated, _mm_and_ps(_mm_cmpgt_ps(truncated, a.v), _mm_set1_ps(1.0f)));
+}
+
+#else
+
+template<class F>
+inline Float4 lanewise(Float4 a, Float4 b, F f)
+{
+    return Float4(f(a.v[0], b.v[0]), f(a.v[1], b.v[1]), f(a.v[2], b.v[2]), f(a.v[3], b.v[3]));
+}
+
+inline float maskLane(bool set)
+{
+    uint32_t bits = set ? 0xFFFFFFFFu : 0u;
+    float lane;
+    memcpy(&lane, &bits, sizeof(lane));
+    return lane;
+}
+
+inline uint32_t laneBitsOf(float lane)
+{
+    uint32_t bits;
+    memcpy(&bits, &lane, sizeof(bits));
+    return bits;
+}
+
+inline float bitsLane(uint32_t bits)
+{
+    float lane;
+    memcpy(&lane, &bits, sizeof(lane));
+    return lane;
+}
+
+inline Float4 operator+(Float4 a, Float4 b) { return lanewise(a, b, [](float x, float y) { return x + y; }); }
+inline Float4 operator-(Float4 a, Float4 b) { return lanewise(a, b, [](float x, float y) { return x - y; }); }
+inline Float4 operator*(Float4 a, Float4 b) { return lanewise(a, b, [](float x, float y) { return x * y; }); }
+inline Float4 operator/(Float4 a, Float4 b) { return lanewise(a, b, [](float x, float y) { return x / y; }); }
+inline Float4 operator-(Float4 a) { return Float4(-a.v[0], -a.v[1], -a.v[2], -a.v[3]); }
+
+inline Float4 operator<(Float4 a, Float4 b) { return lanewise(a, b, [](float x, float y) { return maskLane(x < y); }); }
+inline Float4 operator<=(Float4 a, Float4 b) { return lanewise(a, b, [](float x, float y) { return maskLane(x <= y); }); }
+inline Float4 operator>(Float4 a, Float4 b) { return lanewise(a, b, [](float x, float y) { return maskLane(x > y); }); }
+inline Float4 operator>=(Float4 a, Float4 b) { return lanewise(a, b, [](float x, float y) { return maskLane(x >= y); }); }
+inline Float4 operator==(Float4 a, Float4 b) { return lanewise(a, b, [](float x, float y) { return maskLane(x == y); }); }
+
+inline Float4 operator&(Float4 a, Float4 b) { return lanewise(a, b, [](float x, float y) { return bitsLane(laneBitsOf(x) & laneBitsOf(y)); }); }
+inline Float4 operator|(Float4 a, Float4 b) { return lanewise(a, b, [](float x, float y) { return bitsLane(laneBitsOf(x) | laneBitsOf(y)); }); }
+inline Float4 andNot(Float4 a, Float4 b) { return lanewise(a, b, [](float x, float y) { return bitsLane(laneBitsOf(x) & ~laneBitsOf(y)); }); }
+
+inline Float4 min(Float4 a, Float4 b) { return lanewise(a, b, [](float x, float y) { return x < y ? x : y; }); }
+inline Float4 max(Float4 a, Float4 b) { return lanewise(a, b, [](float x, float y) { return x > y ? x : y; }); }
+inline Float4 sqrt(Float4 a) { return Float4(std::sqrt(a.v[0]), std::sqrt(a.v[1]), std::sqrt(a.v[2]), std::sqrt(a.v[3])); }
+inline Float4 abs(Float4 a) { return Float4(std::fabs(a.v[0]), std::fabs(a.v[1]), std::fabs(a.v[2]), std::fabs(a.v[3])); }
+
+inline Float4 select(Float4 mask, Float4 a, Float4 b) { return (mask & a) | andNot(b, mask); }
+
+inline int laneBits(Float4 mask)
+{
+    int bits = 0;
+    for (int i = 0; i < 4; i++)
+        bits |= (laneBitsOf(mask.v[i]) >> 31) << i;
+    return bits;
+}
+
+inline Float4 floor(Float4 a) { return Float4(std::floor(a.v[0]), std::floor(a.v[1]), std::floor(a.v[2]), std::floor(a.v[3])); }
+
+#endif
+
+// Four 32-bit integers, the texel addresses and packed colours of the software texture sampler.
+// Shifts to the right are logical, lanes are treated as unsigned there.
+struct Int4
+{
+#ifdef FLOAT4_SSE2
+    __m128i v;
+
+    Int4() = default;
+    Int4(__m128i v) : v(v) {}
+    Int4(int32_t s) : v(_mm_set1_epi32(s)) {}
+    Int4(int32_t a, int32_t b, int32_t c, int32_t d) : v(_mm_setr_epi32(a, b, c, d)) {}
+
+    void store(int32_t* p) const { _mm_storeu_si128((__m128i*)p, v); }
+#else
+    int32_t v[4];
+
+    Int4() = default;
+    Int4(int32_t s) : v{ s, s, s, s } {}
+    Int4(int32_t a, int32_t b, int32_t c, int32_t d) : v{ a, b, c, d } {}
+
+    void store(int32_t* p) const { memcpy(p, v, sizeof(v)); }
+#endif
+};
+
+#ifdef FLOAT4_SSE2
+
+inline Int4 operator+(Int4 a, Int4 b) { return _mm_add_epi32(a.v, b.v); }
+inline Int4 operator&(Int4 a, Int4 b) { return _mm_and_si128(a.v, b.v); }
+inline Int4 operator|(Int4 a, Int4 b) { return _mm_or_si128(a.v, b.v); }
+inline Int4 operator<<(Int4 a, int bits) { return _mm_slli_epi32(a.v, bits); }
+inline Int4 operator>>(Int4 a, int bits) { return _mm_srli_epi32(a.v, bits); }
+
+inline Int4 operator*(Int4 a, Int4 b)
+{
+    // SSE2 multiplies the even lanes only, the odd ones are moved down and multiplied separately
+    __m128i even = _mm_mul_epu32(a.v, b.v);
+    __m128i odd = _mm_mul_epu32(_mm_srli_si128(a.v, 4), _mm_srli_si128(b.v, 4));
+    return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)), _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+
+// conversions, the float one truncates toward zero
+inline Int4 toInt4(Float4 a) { return _mm_cvttps_epi32(a.v); }
+inline Float4 toFloat4(Int4 a) { return _mm_cvtepi32_ps(a.v); }
+
+#else
+
+template<class F>
+inline Int4 lanewise(Int4 a, Int4 b, F f)
+{
+    return Int4(f(a.v[0], b.v[0]), f(a.v[1], b.v[1]), f(a.v[2], b.v[2]), f(a.v[3], b.v[3]));
+}
+
+inline Int4 operator+(Int4 a, Int4 b) { return lanewise(a, b, [](int32_t x, int32_t y) { return (int32_t)((uint32_t)x + (uint32_t)y); }); }
+inline Int4 operator*(Int4 a, Int4 b) { return lanewise(a, b, [](int32_t x, int32_t y) { return (int32_t)((uint32_t)x * (uint32_t)y); }); }
+inline Int4 operator&(Int4 a, Int4 b) { return lanewise(a, b, [](int32_t x, int32_t y) { return x & y; }); }
+inline Int4 operator|(Int4 a, Int4 b) { return lanewise(a, b, [](int32_t x, int32_t y) { return x | y; }); }
+inline Int4 operator<<(Int4 a, int bits) { return lanewise(a, Int4(bits), [](int32_t x, int32_t n) { return (int32_t)((uint32_t)x << n); }); }
+inline Int4 operator>>(Int4 a, int bits) { return lanewise(a, Int4(bits), [](int32_t x, int32_t n) { return (int32_t)((uint32_t)x >> n); }); }
+
+inline Int4 toInt4(Float4 a) { return Int4((int32_t)a.v[0], (int32_t)a.v[1], (int32_t)a.v[2], (int32_t)a.v[3]); }
+inline Float4 toFloat4(Int4 a) { return Float4((float)a.v[0], (float)a.v[1], (float)a.v[2], (float)a.v[3]); }
+
+#endif
+
+inline Float4 clamp(Float4 a, Float4 low, Float4 high) { return min(max(a, low), high); }
+inline Float4 mix(Float4 a, Float4 b, Float4 t) { return a + (b - a) * t; }
+
+// lanes one at a time, for the functions SSE has no instruction for
+template<class F>
+inline Float4 perLane(Float4 a, F f)
+{
+    float lanes[4];
+    a.store(lanes);
+    return Float4(f(lanes[0]), f(lanes[1]), f(lanes[2]), f(lanes[3]));
+}
+
+inline Float4 pow(Float4 a, Float4 b)
+{
+    float x[4], y[4];
+    a.store(x);
+    b.store(y);
+    return Float4(std::pow(x[0], y[0]), std::pow(x[1], y[1]), std::pow(x[2], y[2]), std::pow(x[3], y[3]));
+}
+
+// 3D vectors of four lanes, the shading math of the software renderer
+struct Vec3x4
+{
+    Float4 x, y, z;
+
+    Vec3x4() = default;
+    Vec3x4(Float4 x, Float4 y, Float4 z) : x(x), y(y), z(z) {}
+    Vec3x4(float x, float y, float z) : x(x), y(y), z(z) {}
+};
+
+inline Vec3x4 operator+(const Vec3x4& a, const Vec3x4& b) { return Vec3x4(a.x + b.x, a.y + b.y, a.z + b.z); }
+inline Vec3x4 operator-(const Vec3x4& a, const Vec3x4& b) { return Vec3x4(a.x - b.x, a.y - b.y, a.z - b.z); }
+inline Vec3x4 operator*(const Vec3x4& a, Float4 s) { return Vec3x4(a.x * s, a.y * s, a.z * s); }
+inline Vec3x4 operator-(const Vec3x4& a) { return Vec3x4(-a.x, -a.y, -a.z); }
+
+inline Float4 dot(const Vec3x4& a, const Vec3x4& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+inline Vec3x4 cross(const Vec3x4& a, const Vec3x4& b) { return Vec3x4(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x); }
+
+inline Vec3x4 normalize(const Vec3x4& a)
+{
+    Float4 scale = Float4(1.0f) / sqrt(dot(a, a));
+    return a * scale;
+}
+
+// direction of `incident` mirrored about the unit `normal`, as reflect() of GLSL
+inline Vec3x4 reflect(const Vec3x4& incident, const Vec3x4& normal)
+{
+    return incident - normal * (Float4(2.0f) * dot(normal, incident));
+}
+
+inline Vec3x4 select(Float4 mask, const Vec3x4& a, const Vec3x4& b)
+{
+    return Vec3x4(select(mask, a.x, b.x), select(mask, a.y, b.y), select(mask, a.z, b.z));
+}
+
+#endif
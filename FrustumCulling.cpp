@@ -0,0 +1,189 @@
+#include "FrustumCulling.h"
+#include "ThreadPool.h"
+
+#include <atomic>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CULLING_SSE2
+#include <emmintrin.h>
+#endif
+#if defined(__AVX__)
+#define CULLING_AVX
+#include <immintrin.h>
+#endif
+
+// volumes handled by one task of the thread pool, smaller sets are culled on the calling thread
+const size_t CULLING_GRAIN = 4096;
+
+Frustum Frustum::fromMatrix(const glm::mat4& viewProjection)
+{
+    // rows of the matrix, glm stores columns
+    glm::mat4 m = glm::transpose(viewProjection);
+
+    Frustum frustum;
+    frustum.planes[0] = m[3] + m[0];
+    frustum.planes[1] = m[3] - m[0];
+    frustum.planes[2] = m[3] + m[1];
+    frustum.planes[3] = m[3] - m[1];
+    frustum.planes[4] = m[3] + m[2];
+    frustum.planes[5] = m[3] - m[2];
+    for (glm::vec4& plane : frustum.planes)
+        plane /= glm::length(glm::vec3(plane));
+    return frustum;
+}
+
+void BoundingBoxes::clear()
+{
+    centerX.clear();
+    centerY.clear();
+    centerZ.clear();
+    extentX.clear();
+    extentY.clear();
+    extentZ.clear();
+}
+
+unsigned int BoundingBoxes::add(const glm::vec3& center, const glm::vec3& extent)
+{
+    centerX.push_back(center.x);
+    centerY.push_back(center.y);
+    centerZ.push_back(center.z);
+    extentX.push_back(extent.x);
+    extentY.push_back(extent.y);
+    extentZ.push_back(extent.z);
+    return (unsigned int)centerX.size() - 1;
+}
+
+unsigned int BoundingBoxes::add(const glm::mat4& model, const glm::vec3& center, const glm::vec3& extent)
+{
+    // every axis of the box contributes the absolute value of its transformed half size
+    glm::vec3 worldExtent = glm::abs(glm::vec3(model[0])) * extent.x
+        + glm::abs(glm::vec3(model[1])) * extent.y
+        + glm::abs(glm::vec3(model[2])) * extent.z;
+    return add(glm::vec3(model * glm::vec4(center, 1.0f)), worldExtent);
+}
+
+void BoundingSpheres::clear()
+{
+    centerX.clear();
+    centerY.clear();
+    centerZ.clear();
+    radius.clear();
+}
+
+unsigned int BoundingSpheres::add(const glm::vec3& center, float radius)
+{
+    centerX.push_back(center.x);
+    centerY.push_back(center.y);
+    centerZ.push_back(center.z);
+    this->radius.push_back(radius);
+    return (unsigned int)centerX.size() - 1;
+}
+
+// Volumes in [begin, end) are tested against every plane: a volume is outside when its center lies further
+// behind a plane than its radius. The radius of a box against a plane is its half size projected on the normal.
+// Spheres pass their radii and no extents.
+static size_t cullRange(const Frustum& frustum, const float* centerX, const float* centerY, const float* centerZ,
+    const float* extentX, const float* extentY, const float* extentZ, const float* radius,
+    size_t begin, size_t end, unsigned char* visible)
+{
+    size_t visibleNum = 0;
+    size_t i = begin;
+
+#ifdef CULLING_AVX
+    const __m256 signMask8 = _mm256_set1_ps(-0.0f);
+    for (; i + 8 <= end; i += 8) {
+        __m256 x = _mm256_loadu_ps(centerX + i);
+        __m256 y = _mm256_loadu_ps(centerY + i);
+        __m256 z = _mm256_loadu_ps(centerZ + i);
+        __m256 outside = _mm256_setzero_ps();
+        for (const glm::vec4& plane : frustum.planes) {
+            __m256 nx = _mm256_set1_ps(plane.x), ny = _mm256_set1_ps(plane.y), nz = _mm256_set1_ps(plane.z);
+            __m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(nx, x), _mm256_mul_ps(ny, y)),
+                _mm256_add_ps(_mm256_mul_ps(nz, z), _mm256_set1_ps(plane.w)));
+            __m256 r;
+            if (radius)
+                r = _mm256_loadu_ps(radius + i);
+            else
+                r = _mm256_add_ps(_mm256_add_ps(
+                    _mm256_mul_ps(_mm256_andnot_ps(signMask8, nx), _mm256_loadu_ps(extentX + i)),
+                    _mm256_mul_ps(_mm256_andnot_ps(signMask8, ny), _mm256_loadu_ps(extentY + i))),
+                    _mm256_mul_ps(_mm256_andnot_ps(signMask8, nz), _mm256_loadu_ps(extentZ + i)));
+            outside = _mm256_or_ps(outside, _mm256_cmp_ps(_mm256_add_ps(distance, r), _mm256_setzero_ps(), _CMP_LT_OQ));
+        }
+        int mask = _mm256_movemask_ps(outside);
+        for (int k = 0; k < 8; k++) {
+            visible[i + k] = (mask >> k & 1) ? 0 : 1;
+            visibleNum += visible[i + k];
+        }
+    }
+#endif
+
+#ifdef CULLING_SSE2
+    // eight volumes per iteration as two halves
+    const __m128 signMask4 = _mm_set1_ps(-0.0f);
+    for (; i + 8 <= end; i += 8) {
+        __m128 x[2] = { _mm_loadu_ps(centerX + i), _mm_loadu_ps(centerX + i + 4) };
+        __m128 y[2] = { _mm_loadu_ps(centerY + i), _mm_loadu_ps(centerY + i + 4) };
+        __m128 z[2] = { _mm_loadu_ps(centerZ + i), _mm_loadu_ps(centerZ + i + 4) };
+        __m128 outside[2] = { _mm_setzero_ps(), _mm_setzero_ps() };
+        for (const glm::vec4& plane : frustum.planes) {
+            __m128 nx = _mm_set1_ps(plane.x), ny = _mm_set1_ps(plane.y), nz = _mm_set1_ps(plane.z);
+            __m128 absX = _mm_andnot_ps(signMask4, nx), absY = _mm_andnot_ps(signMask4, ny), absZ = _mm_andnot_ps(signMask4, nz);
+            for (int h = 0; h < 2; h++) {
+                size_t j = i + 4 * h;
+                __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, x[h]), _mm_mul_ps(ny, y[h])),
+                    _mm_add_ps(_mm_mul_ps(nz, z[h]), _mm_set1_ps(plane.w)));
+                __m128 r;
+                if (radius)
+                    r = _mm_loadu_ps(radius + j);
+                else
+                    r = _mm_add_ps(_mm_add_ps(_mm_mul_ps(absX, _mm_loadu_ps(extentX + j)), _mm_mul_ps(absY, _mm_loadu_ps(extentY + j))),
+                        _mm_mul_ps(absZ, _mm_loadu_ps(extentZ + j)));
+                outside[h] = _mm_or_ps(outside[h], _mm_cmplt_ps(_mm_add_ps(distance, r), _mm_setzero_ps()));
+            }
+        }
+        int mask = _mm_movemask_ps(outside[0]) | _mm_movemask_ps(outside[1]) << 4;
+        for (int k = 0; k < 8; k++) {
+            visible[i + k] = (mask >> k & 1) ? 0 : 1;
+            visibleNum += visible[i + k];
+        }
+    }
+#endif
+
+    for (; i < end; i++) {
+        bool outside = false;
+        for (const glm::vec4& plane : frustum.planes) {
+            float distance = plane.x * centerX[i] + plane.y * centerY[i] + plane.z * centerZ[i] + plane.w;
+            float r = radius ? radius[i]
+                : std::fabs(plane.x) * extentX[i] + std::fabs(plane.y) * extentY[i] + std::fabs(plane.z) * extentZ[i];
+            outside = outside || distance + r < 0.0f;
+        }
+        visible[i] = outside ? 0 : 1;
+        visibleNum += visible[i];
+    }
+    return visibleNum;
+}
+
+static size_t cullParallel(const Frustum& frustum, size_t count, const float* centerX, const float* centerY, const float* centerZ,
+    const float* extentX, const float* extentY, const float* extentZ, const float* radius, std::vector<unsigned char>& visible)
+{
+    visible.resize(count);
+    std::atomic<size_t> visibleNum{ 0 };
+    ThreadPool::shared().parallelFor(count, CULLING_GRAIN, [&](size_t begin, size_t end) {
+        visibleNum += cullRange(frustum, centerX, centerY, centerZ, extentX, extentY, extentZ, radius, begin, end, visible.data());
+    });
+    return visibleNum;
+}
+
+size_t cullBoxes(const Frustum& frustum, const BoundingBoxes& boxes, std::vector<unsigned char>& visible)
+{
+    return cullParallel(frustum, boxes.size(), boxes.centerX.data(), boxes.centerY.data(), boxes.centerZ.data(),
+        boxes.extentX.data(), boxes.extentY.data(), boxes.extentZ.data(), nullptr, visible);
+}
+
+size_t cullSpheres(const Frustum& frustum, const BoundingSpheres& spheres, std::vector<unsigned char>& visible)
+{
+    return cullParallel(frustum, spheres.size(), spheres.centerX.data(), spheres.centerY.data(), spheres.centerZ.data(),
+        nullptr, nullptr, nullptr, spheres.radius.data(), visible);
+}
@@ -0,0 +1,50 @@
+#ifndef FRUSTUM_CULLING_H
+#define FRUSTUM_CULLING_H
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <vector>
+
+// Planes of a view frustum stored as (normal, distance), normals point inside and are normalized,
+// so dot(normal, p) + distance is the signed distance of p to the plane
+struct Frustum
+{
+    glm::vec4 planes[6];    // left, right, bottom, top, near, far
+
+    // Gribb-Hartmann extraction from a view-projection matrix with OpenGL clip space (-w <= z <= w)
+    static Frustum fromMatrix(const glm::mat4& viewProjection);
+};
+
+// World space axis aligned boxes as separate coordinate arrays, so that eight of them fill an AVX register
+struct BoundingBoxes
+{
+    std::vector<float> centerX, centerY, centerZ;
+    std::vector<float> extentX, extentY, extentZ;   // half sizes
+
+    size_t size() const { return centerX.size(); }
+    void clear();
+
+    // both return the index of the new box
+    unsigned int add(const glm::vec3& center, const glm::vec3& extent);
+    // box enclosing the model space box (center, extent) transformed by `model`
+    unsigned int add(const glm::mat4& model, const glm::vec3& center, const glm::vec3& extent);
+};
+
+struct BoundingSpheres
+{
+    std::vector<float> centerX, centerY, centerZ;
+    std::vector<float> radius;
+
+    size_t size() const { return centerX.size(); }
+    void clear();
+
+    unsigned int add(const glm::vec3& center, float radius);
+};
+
+// visible[i] is set to 1 when the volume intersects the frustum and to 0 when it is entirely outside one of the planes,
+// returns the number of visible volumes; large sets are split across ThreadPool::shared()
+size_t cullBoxes(const Frustum& frustum, const BoundingBoxes& boxes, std::vector<unsigned char>& visible);
+size_t cullSpheres(const Frustum& frustum, const BoundingSpheres& spheres, std::vector<unsigned char>& visible);
+
+#endif
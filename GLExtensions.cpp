@@ -0,0 +1,76 @@
+#include "GLExtensions.h"
+
+#include <string>
+#include <unordered_set>
+
+#ifndef GL_VERSION_4_1
+PFNGLGETPROGRAMBINARYPROC glGetProgramBinary = nullptr;
+PFNGLPROGRAMBINARYPROC glProgramBinary = nullptr;
+PFNGLPROGRAMPARAMETERIPROC glProgramParameteri = nullptr;
+#endif
+
+#ifndef GL_KHR_parallel_shader_compile
+PFNGLMAXSHADERCOMPILERTHREADSKHRPROC glMaxShaderCompilerThreadsKHR = nullptr;
+#endif
+
+#ifndef GL_VERSION_4_3
+PFNGLMULTIDRAWELEMENTSINDIRECTPROC glMultiDrawElementsIndirect = nullptr;
+#endif
+
+static bool hasGLVersion(int major, int minor)
+{
+    return GLVersion.major > major || (GLVersion.major == major && GLVersion.minor >= minor);
+}
+
+bool hasGLExtension(const char* name)
+{
+    static const std::unordered_set<std::string> extensions = []() {
+        std::unordered_set<std::string> names;
+        GLint extensionsNum = 0;
+        glGetIntegerv(GL_NUM_EXTENSIONS, &extensionsNum);
+        for (GLint i = 0; i < extensionsNum; i++)
+            names.insert((const char*)glGetStringi(GL_EXTENSIONS, i));
+        return names;
+    }();
+    return extensions.count(name) > 0;
+}
+
+void loadGLExtensions(GLADloadproc load)
+{
+#ifndef GL_VERSION_4_1
+    if (hasGLVersion(4, 1) || hasGLExtension("GL_ARB_get_program_binary")) {
+        glGetProgramBinary = (PFNGLGETPROGRAMBINARYPROC)load("glGetProgramBinary");
+        glProgramBinary = (PFNGLPROGRAMBINARYPROC)load("glProgramBinary");
+        glProgramParameteri = (PFNGLPROGRAMPARAMETERIPROC)load("glProgramParameteri");
+    }
+#endif
+
+#ifndef GL_KHR_parallel_shader_compile
+    if (hasGLExtension("GL_KHR_parallel_shader_compile"))
+        glMaxShaderCompilerThreadsKHR = (PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)load("glMaxShaderCompilerThreadsKHR");
+    else if (hasGLExtension("GL_ARB_parallel_shader_compile"))
+        glMaxShaderCompilerThreadsKHR = (PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)load("glMaxShaderCompilerThreadsARB");
+#endif
+
+#ifndef GL_VERSION_4_3
+    if (hasGLVersion(4, 3) || hasGLExtension("GL_ARB_multi_draw_indirect"))
+        glMultiDrawElementsIndirect = (PFNGLMULTIDRAWELEMENTSINDIRECTPROC)load("glMultiDrawElementsIndirect");
+#endif
+}
+
+bool hasProgramBinaries()
+{
+    if (!glGetProgramBinary || !glProgramBinary || !glProgramParameteri)
+        return false;
+
+    // drivers may expose the entry points without supporting a single binary format
+    GLint formatsNum = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatsNum);
+    return formatsNum > 0;
+}
+
+bool hasMultiDrawIndirect()
+{
+    static const bool supported = glMultiDrawElementsIndirect && hasGLExtension("GL_ARB_shader_draw_parameters");
+    return supported;
+}
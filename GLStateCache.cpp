@@ -0,0 +1,186 @@
+#include "GLStateCache.h"
+
+const GLuint UNKNOWN_STATE = 0xFFFFFFFF;
+
+static int textureTargetIndex(GLenum target)
+{
+    switch (target) {
+    case GL_TEXTURE_2D: return 0;
+    case GL_TEXTURE_2D_ARRAY: return 1;
+    case GL_TEXTURE_CUBE_MAP: return 2;
+    case GL_TEXTURE_BUFFER: return 3;
+    default: return -1;
+    }
+}
+
+static int capabilityIndex(GLenum capability)
+{
+    switch (capability) {
+    case GL_BLEND: return 0;
+    case GL_DEPTH_TEST: return 1;
+    case GL_CULL_FACE: return 2;
+    case GL_STENCIL_TEST: return 3;
+    default: return -1;
+    }
+}
+
+GLStateCache::GLStateCache()
+{
+    invalidate();
+}
+
+void GLStateCache::invalidate()
+{
+    program = UNKNOWN_STATE;
+    vao = UNKNOWN_STATE;
+    activeUnit = UNKNOWN_STATE;
+    for (auto& unit : textures)
+        for (GLuint& texture : unit)
+            texture = UNKNOWN_STATE;
+    drawFramebuffer = UNKNOWN_STATE;
+    readFramebuffer = UNKNOWN_STATE;
+    for (GLuint& capability : capabilities)
+        capability = UNKNOWN_STATE;
+    for (GLenum& factor : blend)
+        factor = UNKNOWN_STATE;
+    depthFunction = UNKNOWN_STATE;
+    depthWrites = UNKNOWN_STATE;
+}
+
+bool GLStateCache::update(GLuint& cached, GLuint value)
+{
+    if (cached == value) {
+        counters.elided++;
+        return false;
+    }
+    cached = value;
+    counters.issued++;
+    return true;
+}
+
+void GLStateCache::useProgram(GLuint program)
+{
+    if (update(this->program, program))
+        glUseProgram(program);
+}
+
+void GLStateCache::bindVertexArray(GLuint vao)
+{
+    if (update(this->vao, vao))
+        glBindVertexArray(vao);
+}
+
+void GLStateCache::activeTexture(GLenum unit)
+{
+    if (update(activeUnit, unit - GL_TEXTURE0))
+        glActiveTexture(unit);
+}
+
+void GLStateCache::bindTexture(GLenum target, GLuint texture)
+{
+    int index = textureTargetIndex(target);
+    if (index < 0 || activeUnit >= TEXTURE_UNITS) {
+        counters.issued++;
+        glBindTexture(target, texture);
+        return;
+    }
+    if (update(textures[activeUnit][index], texture))
+        glBindTexture(target, texture);
+}
+
+void GLStateCache::bindTexture(GLuint unit, GLenum target, GLuint texture)
+{
+    activeTexture(GL_TEXTURE0 + unit);
+    bindTexture(target, texture);
+}
+
+void GLStateCache::bindFramebuffer(GLenum target, GLuint framebuffer)
+{
+    if (target == GL_FRAMEBUFFER) {
+        // sets both bindings, one call is enough unless both already match
+        if (drawFramebuffer == framebuffer && readFramebuffer == framebuffer) {
+            counters.elided++;
+            return;
+        }
+        drawFramebuffer = readFramebuffer = framebuffer;
+        counters.issued++;
+        glBindFramebuffer(target, framebuffer);
+    }
+    else if (update(target == GL_READ_FRAMEBUFFER ? readFramebuffer : drawFramebuffer, framebuffer))
+        glBindFramebuffer(target, framebuffer);
+}
+
+void GLStateCache::setCapability(GLenum capability, bool enabled)
+{
+    int index = capabilityIndex(capability);
+    if (index >= 0 && !update(capabilities[index], enabled ? 1 : 0))
+        return;
+    if (index < 0)
+        counters.issued++;
+
+    if (enabled)
+        glEnable(capability);
+    else
+        glDisable(capability);
+}
+
+void GLStateCache::enable(GLenum capability)
+{
+    setCapability(capability, true);
+}
+
+void GLStateCache::disable(GLenum capability)
+{
+    setCapability(capability, false);
+}
+
+void GLStateCache::blendFunc(GLenum source, GLenum destination)
+{
+    if (blend[0] == source && blend[1] == destination && blend[2] == source && blend[3] == destination) {
+        counters.elided++;
+        return;
+    }
+    blend[0] = blend[2] = source;
+    blend[1] = blend[3] = destination;
+    counters.issued++;
+    glBlendFunc(source, destination);
+}
+
+void GLStateCache::blendFuncSeparate(GLenum sourceRGB, GLenum destinationRGB, GLenum sourceAlpha, GLenum destinationAlpha)
+{
+    if (blend[0] == sourceRGB && blend[1] == destinationRGB && blend[2] == sourceAlpha && blend[3] == destinationAlpha) {
+        counters.elided++;
+        return;
+    }
+    blend[0] = sourceRGB;
+    blend[1] = destinationRGB;
+    blend[2] = sourceAlpha;
+    blend[3] = destinationAlpha;
+    counters.issued++;
+    glBlendFuncSeparate(sourceRGB, destinationRGB, sourceAlpha, destinationAlpha);
+}
+
+void GLStateCache::depthFunc(GLenum function)
+{
+    if (update(depthFunction, function))
+        glDepthFunc(function);
+}
+
+void GLStateCache::depthMask(GLboolean mask)
+{
+    if (update(depthWrites, mask ? 1 : 0))
+        glDepthMask(mask);
+}
+
+GLStateCounters GLStateCache::endFrame()
+{
+    GLStateCounters frame = counters;
+    counters = GLStateCounters();
+    return frame;
+}
+
+GLStateCache& GLStateCache::shared()
+{
+    static GLStateCache cache;
+    return cache;
+}
@@ -0,0 +1,72 @@
+#ifndef GL_STATE_CACHE_H
+#define GL_STATE_CACHE_H
+
+#include <glad/glad.h>
+
+// calls passed on to GL and calls dropped because they would not have changed anything
+struct GLStateCounters
+{
+    unsigned int issued = 0;
+    unsigned int elided = 0;
+};
+
+// Shadow copy of the bindings and fixed-function state the renderer changes every frame: program, vertex array,
+// active unit and textures per unit, framebuffers, capabilities, blend function and depth state. A call that
+// would set what is already set is dropped. Everything starts unknown, so the first call of each kind reaches GL.
+// State changed behind the cache's back (another library, objects deleted while bound) needs invalidate().
+class GLStateCache
+{
+public:
+
+    static const unsigned int TEXTURE_UNITS = 16;
+
+    GLStateCache();
+
+    // forgets the shadowed state, the next call of each kind is issued
+    void invalidate();
+
+    void useProgram(GLuint program);
+    void bindVertexArray(GLuint vao);
+    void activeTexture(GLenum unit);
+    // binds to the active unit
+    void bindTexture(GLenum target, GLuint texture);
+    // activates GL_TEXTURE0 + unit and binds
+    void bindTexture(GLuint unit, GLenum target, GLuint texture);
+    void bindFramebuffer(GLenum target, GLuint framebuffer);
+
+    void enable(GLenum capability);
+    void disable(GLenum capability);
+    void blendFunc(GLenum source, GLenum destination);
+    void blendFuncSeparate(GLenum sourceRGB, GLenum destinationRGB, GLenum sourceAlpha, GLenum destinationAlpha);
+    void depthFunc(GLenum function);
+    void depthMask(GLboolean mask);
+
+    // counters since the previous call
+    GLStateCounters endFrame();
+
+    // cache used by the whole renderer, GL state belongs to the context and the application has one
+    static GLStateCache& shared();
+
+private:
+
+    static const unsigned int TEXTURE_TARGETS = 4;
+    static const unsigned int CAPABILITIES = 4;
+
+    GLuint program;
+    GLuint vao;
+    GLuint activeUnit;
+    GLuint textures[TEXTURE_UNITS][TEXTURE_TARGETS];
+    GLuint drawFramebuffer;
+    GLuint readFramebuffer;
+    GLuint capabilities[CAPABILITIES];
+    GLenum blend[4];
+    GLenum depthFunction;
+    GLuint depthWrites;
+    GLStateCounters counters;
+
+    // true (and counted as issued) when `cached` changes to `value`
+    bool update(GLuint& cached, GLuint value);
+    void setCapability(GLenum capability, bool enabled);
+
+};
+#endif
@@ -0,0 +1,268 @@
+#include "GeometryBuffer.h"
+
+#include <algorithm>
+#include <iostream>
+
+#include "GLStateCache.h"
+
+const size_t NO_RANGE = (size_t)-1;
+
+GeometryBuffer::GeometryBuffer(size_t initialVertices, size_t initialIndices)
+    : initialVertices(initialVertices), initialIndices(initialIndices)
+{
+}
+
+GeometryBuffer::~GeometryBuffer()
+{
+    for (const Pool& pool : pools) {
+        glDeleteVertexArrays(1, &pool.vao);
+        glDeleteBuffers(1, &pool.vbo);
+        glDeleteBuffers(1, &pool.ibo);
+    }
+    // deleting unbinds, and the names can be handed out again
+    GLStateCache::shared().invalidate();
+}
+
+uint64_t GeometryBuffer::formatKey(const QuantizedMesh& mesh)
+{
+    const VertexLayout& layout = mesh.layout;
+    return (uint64_t)mesh.stride | (uint64_t)layout.positionComponents << 16 | (uint64_t)layout.normal << 20
+        | (uint64_t)layout.texCoord << 21 | (uint64_t)layout.tangentFrame << 22
+        | (uint64_t)mesh.positionFormat << 24 | (uint64_t)mesh.texCoordFormat << 28;
+}
+
+size_t GeometryBuffer::allocate(std::vector<Range>& freeList, size_t size)
+{
+    for (size_t i = 0; i < freeList.size(); i++) {
+        Range& range = freeList[i];
+        if (range.size < size)
+            continue;
+
+        size_t offset = range.offset;
+        range.offset += size;
+        range.size -= size;
+        if (range.size == 0)
+            freeList.erase(freeList.begin() + i);
+        return offset;
+    }
+    return NO_RANGE;
+}
+
+void GeometryBuffer::release(std::vector<Range>& freeList, Range range)
+{
+    if (range.size == 0)
+        return;
+
+    // the list is sorted by offset, the range is merged with the free ranges right before and after it
+    auto next = std::lower_bound(freeList.begin(), freeList.end(), range,
+        [](const Range& a, const Range& b) { return a.offset < b.offset; });
+    if (next != freeList.end() && range.offset + range.size == next->offset) {
+        range.size += next->size;
+        next = freeList.erase(next);
+    }
+    if (next != freeList.begin()) {
+        Range& previous = *(next - 1);
+        if (previous.offset + previous.size == range.offset) {
+            previous.size += range.size;
+            return;
+        }
+    }
+    freeList.insert(next, range);
+}
+
+void GeometryBuffer::setupVertexArray(const Pool& pool) const
+{
+    GLStateCache& state = GLStateCache::shared();
+    state.bindVertexArray(pool.vao);
+    glBindBuffer(GL_ARRAY_BUFFER, pool.vbo);
+    pool.attributes.setAttributes();
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, pool.ibo);
+    state.bindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+unsigned int GeometryBuffer::findPool(const QuantizedMesh& mesh, size_t vertexCount, size_t indexCount)
+{
+    uint64_t format = formatKey(mesh);
+    for (unsigned int i = 0; i < pools.size(); i++) {
+        if (pools[i].format == format)
+            return i;
+    }
+
+    Pool pool;
+    pool.format = format;
+    pool.attributes.stride = mesh.stride;
+    pool.attributes.layout = mesh.layout;
+    pool.attributes.positionFormat = mesh.positionFormat;
+    pool.attributes.texCoordFormat = mesh.texCoordFormat;
+    pool.vertexCapacity = std::max(initialVertices, vertexCount);
+    pool.indexCapacity = std::max(initialIndices, indexCount);
+    pool.freeVertices.push_back({ 0, pool.vertexCapacity });
+    pool.freeIndices.push_back({ 0, pool.indexCapacity });
+
+    glGenVertexArrays(1, &pool.vao);
+    glGenBuffers(1, &pool.vbo);
+    glGenBuffers(1, &pool.ibo);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, pool.vbo);
+    glBufferData(GL_COPY_WRITE_BUFFER, pool.vertexCapacity * pool.attributes.stride, nullptr, GL_STATIC_DRAW);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, pool.ibo);
+    glBufferData(GL_COPY_WRITE_BUFFER, pool.indexCapacity * sizeof(unsigned int), nullptr, GL_STATIC_DRAW);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    setupVertexArray(pool);
+
+    pools.push_back(pool);
+    return (unsigned int)pools.size() - 1;
+}
+
+void GeometryBuffer::rebuild(unsigned int poolIndex, size_t vertexCapacity, size_t indexCapacity, bool pack)
+{
+    Pool& pool = pools[poolIndex];
+    GLuint vbo, ibo;
+    glGenBuffers(1, &vbo);
+    glGenBuffers(1, &ibo);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, vbo);
+    glBufferData(GL_COPY_WRITE_BUFFER, vertexCapacity * pool.attributes.stride, nullptr, GL_STATIC_DRAW);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, ibo);
+    glBufferData(GL_COPY_WRITE_BUFFER, indexCapacity * sizeof(unsigned int), nullptr, GL_STATIC_DRAW);
+
+    // live ranges are copied in buffer order, so packing keeps meshes added together next to each other
+    std::vector<Allocation*> live;
+    for (Allocation& allocation : allocations) {
+        if (allocation.live && allocation.pool == poolIndex)
+            live.push_back(&allocation);
+    }
+    std::sort(live.begin(), live.end(), [](const Allocation* a, const Allocation* b) { return a->vertices.offset < b->vertices.offset; });
+
+    size_t vertexCursor = 0, indexCursor = 0;
+    for (Allocation* allocation : live) {
+        size_t vertexOffset = pack ? vertexCursor : allocation->vertices.offset;
+        size_t indexOffset = pack ? indexCursor : allocation->indices.offset;
+
+        glBindBuffer(GL_COPY_READ_BUFFER, pool.vbo);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, vbo);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, allocation->vertices.offset * pool.attributes.stride,
+            vertexOffset * pool.attributes.stride, allocation->vertices.size * pool.attributes.stride);
+        glBindBuffer(GL_COPY_READ_BUFFER, pool.ibo);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, ibo);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, allocation->indices.offset * sizeof(unsigned int),
+            indexOffset * sizeof(unsigned int), allocation->indices.size * sizeof(unsigned int));
+
+        allocation->vertices.offset = vertexOffset;
+        allocation->indices.offset = indexOffset;
+        vertexCursor += allocation->vertices.size;
+        indexCursor += allocation->indices.size;
+    }
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    if (pack) {
+        pool.freeVertices.assign(1, { vertexCursor, vertexCapacity - vertexCursor });
+        pool.freeIndices.assign(1, { indexCursor, indexCapacity - indexCursor });
+    }
+    else {
+        release(pool.freeVertices, { pool.vertexCapacity, vertexCapacity - pool.vertexCapacity });
+        release(pool.freeIndices, { pool.indexCapacity, indexCapacity - pool.indexCapacity });
+    }
+
+    glDeleteBuffers(1, &pool.vbo);
+    glDeleteBuffers(1, &pool.ibo);
+    pool.vbo = vbo;
+    pool.ibo = ibo;
+    pool.vertexCapacity = vertexCapacity;
+    pool.indexCapacity = indexCapacity;
+    setupVertexArray(pool);
+}
+
+GeometryHandle GeometryBuffer::add(const QuantizedMesh& mesh, const std::vector<unsigned int>& indices)
+{
+    size_t vertexCount = mesh.vertices.size() / mesh.stride;
+    unsigned int poolIndex = findPool(mesh, vertexCount, indices.size());
+
+    size_t vertexOffset = allocate(pools[poolIndex].freeVertices, vertexCount);
+    size_t indexOffset = allocate(pools[poolIndex].freeIndices, indices.size());
+    if (vertexOffset == NO_RANGE || indexOffset == NO_RANGE) {
+        // growing keeps every range where it is, the new space is appended to the free lists
+        Pool& pool = pools[poolIndex];
+        if (vertexOffset != NO_RANGE)
+            release(pool.freeVertices, { vertexOffset, vertexCount });
+        if (indexOffset != NO_RANGE)
+            release(pool.freeIndices, { indexOffset, indices.size() });
+        rebuild(poolIndex, std::max(pool.vertexCapacity * 2, pool.vertexCapacity + vertexCount),
+            std::max(pool.indexCapacity * 2, pool.indexCapacity + indices.size()), false);
+        vertexOffset = allocate(pools[poolIndex].freeVertices, vertexCount);
+        indexOffset = allocate(pools[poolIndex].freeIndices, indices.size());
+    }
+
+    const Pool& pool = pools[poolIndex];
+    glBindBuffer(GL_COPY_WRITE_BUFFER, pool.vbo);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, vertexOffset * pool.attributes.stride, mesh.vertices.size(), mesh.vertices.data());
+    glBindBuffer(GL_COPY_WRITE_BUFFER, pool.ibo);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, indexOffset * sizeof(unsigned int), indices.size() * sizeof(unsigned int), indices.data());
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    Allocation allocation = { poolIndex, { vertexOffset, vertexCount }, { indexOffset, indices.size() }, true };
+    if (!freeHandles.empty()) {
+        GeometryHandle handle = freeHandles.back();
+        freeHandles.pop_back();
+        allocations[handle] = allocation;
+        return handle;
+    }
+    allocations.push_back(allocation);
+    return (GeometryHandle)allocations.size() - 1;
+}
+
+void GeometryBuffer::remove(GeometryHandle mesh)
+{
+    if (mesh >= allocations.size() || !allocations[mesh].live) {
+        std::cerr << "ERROR: geometry " << mesh << " was already removed" << std::endl;
+        return;
+    }
+
+    Allocation& allocation = allocations[mesh];
+    release(pools[allocation.pool].freeVertices, allocation.vertices);
+    release(pools[allocation.pool].freeIndices, allocation.indices);
+    allocation.live = false;
+    freeHandles.push_back(mesh);
+}
+
+void GeometryBuffer::defragment()
+{
+    for (unsigned int i = 0; i < pools.size(); i++) {
+        // a single free range at the end means the pool is packed already
+        const Pool& pool = pools[i];
+        bool packed = pool.freeVertices.size() <= 1 && pool.freeIndices.size() <= 1
+            && (pool.freeVertices.empty() || pool.freeVertices[0].offset + pool.freeVertices[0].size == pool.vertexCapacity)
+            && (pool.freeIndices.empty() || pool.freeIndices[0].offset + pool.freeIndices[0].size == pool.indexCapacity);
+        if (!packed)
+            rebuild(i, pool.vertexCapacity, pool.indexCapacity, true);
+    }
+}
+
+GLuint GeometryBuffer::vertexArray(GeometryHandle mesh) const
+{
+    return pools[allocations[mesh].pool].vao;
+}
+
+GLsizei GeometryBuffer::indexCount(GeometryHandle mesh) const
+{
+    return (GLsizei)allocations[mesh].indices.size;
+}
+
+DrawElementsIndirectCommand GeometryBuffer::indirectCommand(GeometryHandle mesh, GLuint instances) const
+{
+    const Allocation& allocation = allocations[mesh];
+    return DrawElementsIndirectCommand{ (GLuint)allocation.indices.size, instances, (GLuint)allocation.indices.offset,
+        (GLint)allocation.vertices.offset, 0 };
+}
+
+void GeometryBuffer::draw(GeometryHandle mesh, GLsizei instances) const
+{
+    const Allocation& allocation = allocations[mesh];
+    GLStateCache::shared().bindVertexArray(pools[allocation.pool].vao);
+    void* firstIndex = (void*)(allocation.indices.offset * sizeof(unsigned int));
+    if (instances == 1)
+        glDrawElementsBaseVertex(GL_TRIANGLES, (GLsizei)allocation.indices.size, GL_UNSIGNED_INT, firstIndex, (GLint)allocation.vertices.offset);
+    else
+        glDrawElementsInstancedBaseVertex(GL_TRIANGLES, (GLsizei)allocation.indices.size, GL_UNSIGNED_INT, firstIndex,
+            instances, (GLint)allocation.vertices.offset);
+}
@@ -0,0 +1,88 @@
+#ifndef GEOMETRY_BUFFER_H
+#define GEOMETRY_BUFFER_H
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "VertexQuantizer.h"
+
+typedef unsigned int GeometryHandle;
+
+// record read by glMultiDrawElementsIndirect from GL_DRAW_INDIRECT_BUFFER
+struct DrawElementsIndirectCommand
+{
+    GLuint count;
+    GLuint instanceCount;
+    GLuint firstIndex;
+    GLint baseVertex;
+    GLuint baseInstance;
+};
+
+// Meshes of the same vertex format share one vertex buffer, one index buffer and one vertex array.
+// Every mesh keeps its own indices, draws add the first vertex of its range as the base vertex.
+// Freed ranges go to per-buffer free lists that merge neighbours and are reused first-fit; when nothing fits the
+// buffers grow, and defragment() packs the live ranges to the front again. Handles stay valid through both.
+class GeometryBuffer
+{
+public:
+
+    explicit GeometryBuffer(size_t initialVertices = 4096, size_t initialIndices = 16384);
+    ~GeometryBuffer();
+
+    GeometryHandle add(const QuantizedMesh& mesh, const std::vector<unsigned int>& indices);
+    void remove(GeometryHandle mesh);
+    void defragment();
+
+    // the vertex array shared by all meshes of the format of `mesh`, to attach instance attributes to it
+    GLuint vertexArray(GeometryHandle mesh) const;
+    GLsizei indexCount(GeometryHandle mesh) const;
+    // the ranges of the mesh as an indirect draw of its vertex array
+    DrawElementsIndirectCommand indirectCommand(GeometryHandle mesh, GLuint instances = 1) const;
+
+    // binds the vertex array of the mesh and draws it
+    void draw(GeometryHandle mesh, GLsizei instances = 1) const;
+
+private:
+
+    struct Range
+    {
+        size_t offset;
+        size_t size;
+    };
+
+    struct Pool
+    {
+        uint64_t format;
+        QuantizedMesh attributes;   // format of the pool, without vertices
+        GLuint vao, vbo, ibo;
+        size_t vertexCapacity, indexCapacity;
+        std::vector<Range> freeVertices, freeIndices;
+    };
+
+    struct Allocation
+    {
+        unsigned int pool;
+        Range vertices;
+        Range indices;
+        bool live;
+    };
+
+    size_t initialVertices, initialIndices;
+    std::vector<Pool> pools;
+    std::vector<Allocation> allocations;
+    std::vector<GeometryHandle> freeHandles;
+
+    static uint64_t formatKey(const QuantizedMesh& mesh);
+    static size_t allocate(std::vector<Range>& freeList, size_t size);
+    static void release(std::vector<Range>& freeList, Range range);
+
+    unsigned int findPool(const QuantizedMesh& mesh, size_t vertexCount, size_t indexCount);
+    // moves the pool into new buffers of the given capacities, `pack` puts the live ranges next to each other
+    void rebuild(unsigned int poolIndex, size_t vertexCapacity, size_t indexCapacity, bool pack);
+    void setupVertexArray(const Pool& pool) const;
+
+};
+#endif
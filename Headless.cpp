@@ -0,0 +1,242 @@
+#include "Headless.h"
+#include "GLStateCache.h"
+#include "PngWriter.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#if defined(__has_include)
+#if __has_include(<EGL/egl.h>)
+#define HEADLESS_EGL
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+#endif
+
+static void printUsage()
+{
+    std::cerr << "usage: CompGraph [--headless [--frames N] [--size WxH] [--fps F] [--camera keys.txt] [--png directory]\n"
+        << "                  [--timings frames.csv] [--skybox] [--monochrome] [--oit] [--indirect] [--software] [--raytrace]\n"
+        << "                  [--transparency-benchmark] [--draw-benchmark]]" << std::endl;
+}
+
+bool parseHeadlessOptions(int argc, char* argv[], HeadlessOptions& options)
+{
+    for (int i = 1; i < argc; i++) {
+        std::string argument = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+        bool valid = true;
+
+        if (argument == "--headless")
+            options.enabled = true;
+        else if (argument == "--skybox")
+            options.skybox = true;
+        else if (argument == "--monochrome")
+            options.monochrome = true;
+        else if (argument == "--oit")
+            options.weightedBlended = true;
+        else if (argument == "--indirect")
+            options.indirect = true;
+        else if (argument == "--software")
+            options.software = true;
+        else if (argument == "--raytrace")
+            options.software = options.raytrace = true;
+        else if (argument == "--transparency-benchmark")
+            options.transparencyBenchmark = true;
+        else if (argument == "--draw-benchmark")
+            options.drawBenchmark = true;
+        else if (!value)
+            valid = false;
+        else {
+            i++;
+            if (argument == "--frames")
+                valid = sscanf(value, "%u", &options.frames) == 1 && options.frames > 0;
+            else if (argument == "--size")
+                valid = sscanf(value, "%ux%u", &options.width, &options.height) == 2 && options.width > 0 && options.height > 0;
+            else if (argument == "--fps")
+                valid = sscanf(value, "%f", &options.frameRate) == 1 && options.frameRate > 0.0f;
+            else if (argument == "--camera")
+                options.cameraPath = value;
+            else if (argument == "--png")
+                options.pngDirectory = value;
+            else if (argument == "--timings")
+                options.timingsPath = value;
+            else
+                valid = false;
+        }
+
+        if (!valid) {
+            std::cerr << "ERROR: invalid argument: " << argument << std::endl;
+            printUsage();
+            return false;
+        }
+    }
+    return true;
+}
+
+#ifdef HEADLESS_EGL
+
+static bool hasEGLExtension(EGLDisplay display, const char* name)
+{
+    const char* extensions = eglQueryString(display, EGL_EXTENSIONS);
+    if (!extensions)
+        return false;
+    size_t length = strlen(name);
+    for (const char* found = strstr(extensions, name); found; found = strstr(found + length, name))
+        if ((found == extensions || found[-1] == ' ') && (found[length] == ' ' || found[length] == '\0'))
+            return true;
+    return false;
+}
+
+static void* loadProc(const char* name)
+{
+    return (void*)eglGetProcAddress(name);
+}
+
+HeadlessContext::~HeadlessContext()
+{
+    if (context) {
+        eglMakeCurrent((EGLDisplay)display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        eglDestroyContext((EGLDisplay)display, (EGLContext)context);
+    }
+    if (display)
+        eglTerminate((EGLDisplay)display);
+}
+
+bool HeadlessContext::create()
+{
+    // the surfaceless platform needs neither a display server nor a GPU, the client extensions tell if it is there
+    EGLDisplay eglDisplay = EGL_NO_DISPLAY;
+    auto getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+    if (getPlatformDisplay && hasEGLExtension(EGL_NO_DISPLAY, "EGL_MESA_platform_surfaceless"))
+        eglDisplay = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+    if (eglDisplay == EGL_NO_DISPLAY)
+        eglDisplay = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    if (eglDisplay == EGL_NO_DISPLAY || !eglInitialize(eglDisplay, nullptr, nullptr)) {
+        std::cerr << "ERROR: EGL initialization failed" << std::endl;
+        return false;
+    }
+    display = eglDisplay;
+
+    if (!hasEGLExtension(eglDisplay, "EGL_KHR_surfaceless_context")) {
+        std::cerr << "ERROR: EGL contexts without a surface are not supported" << std::endl;
+        return false;
+    }
+
+    // nothing is drawn to a surface of the config, the frames go to framebuffer objects
+    const EGLint configAttributes[] = { EGL_SURFACE_TYPE, 0, EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE };
+    EGLConfig config;
+    EGLint configsNum = 0;
+    if (!eglBindAPI(EGL_OPENGL_API) || !eglChooseConfig(eglDisplay, configAttributes, &config, 1, &configsNum) || configsNum == 0) {
+        std::cerr << "ERROR: EGL has no OpenGL config" << std::endl;
+        return false;
+    }
+
+    const EGLint contextAttributes[] = {
+        EGL_CONTEXT_MAJOR_VERSION, 3, EGL_CONTEXT_MINOR_VERSION, 3,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT, EGL_NONE
+    };
+    EGLContext eglContext = eglCreateContext(eglDisplay, config, EGL_NO_CONTEXT, contextAttributes);
+    if (eglContext == EGL_NO_CONTEXT) {
+        std::cerr << "ERROR: EGL context creation failed" << std::endl;
+        return false;
+    }
+    context = eglContext;
+
+    if (!eglMakeCurrent(eglDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, eglContext)) {
+        std::cerr << "ERROR: EGL context activation failed" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+GLADloadproc HeadlessContext::loader()
+{
+    return &loadProc;
+}
+
+#else
+
+HeadlessContext::~HeadlessContext()
+{
+}
+
+bool HeadlessContext::create()
+{
+    std::cerr << "ERROR: headless mode needs EGL, this build has none" << std::endl;
+    return false;
+}
+
+GLADloadproc HeadlessContext::loader()
+{
+    return nullptr;
+}
+
+#endif
+
+void FrameTimings::add(double time, double cpuMs, double frameMs)
+{
+    frames.push_back(Frame{ time, cpuMs, frameMs });
+}
+
+void FrameTimings::report() const
+{
+    if (frames.empty())
+        return;
+
+    char line[256];
+    snprintf(line, sizeof(line), "First frame: %.2f ms (CPU %.2f ms)\n", frames[0].frameMs, frames[0].cpuMs);
+    std::cout << line;
+    if (frames.size() < 2)
+        return;
+
+    std::vector<double> frameMs, cpuMs;
+    for (size_t i = 1; i < frames.size(); i++) {
+        frameMs.push_back(frames[i].frameMs);
+        cpuMs.push_back(frames[i].cpuMs);
+    }
+    auto average = [](const std::vector<double>& values) {
+        double sum = 0.0;
+        for (double value : values)
+            sum += value;
+        return sum / values.size();
+    };
+    double frameAverage = average(frameMs), cpuAverage = average(cpuMs);
+    std::sort(frameMs.begin(), frameMs.end());
+    auto percentile = [&](double p) { return frameMs[std::min(frameMs.size() - 1, (size_t)(p * frameMs.size()))]; };
+
+    snprintf(line, sizeof(line), "Other %d frames: average %.2f ms (%.1f fps, CPU %.2f ms), min %.2f, median %.2f, 95%% %.2f, max %.2f ms\n",
+        (int)frameMs.size(), frameAverage, 1000.0 / frameAverage, cpuAverage, frameMs.front(), percentile(0.5), percentile(0.95), frameMs.back());
+    std::cout << line;
+}
+
+bool FrameTimings::writeCSV(const std::string& path) const
+{
+    std::ofstream file(path);
+    if (!file) {
+        std::cerr << "ERROR: timings writing failed: " << path << std::endl;
+        return false;
+    }
+    file << "frame,time,cpu_ms,frame_ms\n";
+    for (size_t i = 0; i < frames.size(); i++)
+        file << i << "," << frames[i].time << "," << frames[i].cpuMs << "," << frames[i].frameMs << "\n";
+    return true;
+}
+
+bool captureFrame(GLuint framebuffer, unsigned int width, unsigned int height, const std::string& path)
+{
+    std::vector<unsigned char> pixels((size_t)width * height * 3);
+    GLStateCache::shared().bindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, pixels.data());
+
+    // GL rows start at the bottom, PNG rows at the top
+    size_t rowSize = (size_t)width * 3;
+    for (unsigned int y = 0; y < height / 2; y++)
+        std::swap_ranges(pixels.begin() + y * rowSize, pixels.begin() + (y + 1) * rowSize, pixels.begin() + (height - 1 - y) * rowSize);
+    return writePNG(path, width, height, 3, pixels.data());
+}
@@ -0,0 +1,94 @@
+#ifndef HEADLESS_H
+#define HEADLESS_H
+
+#include <glad/glad.h>
+
+#include <string>
+#include <vector>
+
+// Command line of the headless mode:
+//   CompGraph --headless [--frames N] [--size WxH] [--fps F] [--camera keys.txt] [--png directory] [--timings frames.csv]
+//             [--skybox] [--monochrome] [--oit] [--indirect] [--software] [--raytrace] [--transparency-benchmark]
+//             [--draw-benchmark]
+// Frames are rendered into a framebuffer object of the given size and stepped by a scripted clock at F frames
+// per second, so that two runs render the same images. The camera follows the key file or orbits the scene.
+// With --software the frames are drawn by SoftwareRenderer on the CPU and no GL context is created at all,
+// --raytrace has them ray traced by it instead (and implies --software). --transparency-benchmark and
+// --draw-benchmark run TransparencyBenchmark and DrawBenchmark from the first frame and render until they have
+// finished, whatever the frame count.
+struct HeadlessOptions
+{
+    bool enabled = false;
+    unsigned int frames = 300;
+    unsigned int width = 1280;
+    unsigned int height = 720;
+    float frameRate = 60.0f;
+    std::string cameraPath;     // keys read by CameraPath::load, the default orbit when empty
+    std::string pngDirectory;   // frame_0000.png, frame_0001.png, ... when set
+    std::string timingsPath;    // one CSV line per frame when set
+    bool skybox = false;
+    bool monochrome = false;
+    bool weightedBlended = false;
+    bool indirect = false;
+    bool software = false;
+    bool raytrace = false;
+    bool transparencyBenchmark = false;
+    bool drawBenchmark = false;
+};
+
+// prints the usage and returns false on an unknown or incomplete argument
+bool parseHeadlessOptions(int argc, char* argv[], HeadlessOptions& options);
+
+// OpenGL 3.3 core context without a window or a display server: EGL on the surfaceless platform of Mesa
+// (llvmpipe renders on the CPU) or on the default display of other drivers. Builds without EGL headers
+// (the Windows one) have no headless mode.
+class HeadlessContext
+{
+public:
+
+    HeadlessContext() = default;
+    ~HeadlessContext();
+    HeadlessContext(const HeadlessContext&) = delete;
+    HeadlessContext& operator=(const HeadlessContext&) = delete;
+
+    // creates the context and makes it current on the calling thread
+    bool create();
+
+    // entry point loader for gladLoadGLLoader and loadGLExtensions
+    static GLADloadproc loader();
+
+private:
+
+    void* display = nullptr;
+    void* context = nullptr;
+
+};
+
+// CPU and complete (after glFinish) times of every frame, summarized at the end of the run
+class FrameTimings
+{
+public:
+
+    void add(double time, double cpuMs, double frameMs);
+
+    // the first frame is reported apart, it includes finishing the shaders and the first texture uses
+    void report() const;
+    bool writeCSV(const std::string& path) const;
+
+private:
+
+    struct Frame
+    {
+        double time;
+        double cpuMs;
+        double frameMs;
+    };
+
+    std::vector<Frame> frames;
+
+};
+
+// reads the colour of `framebuffer` and writes it as a PNG
+bool captureFrame(GLuint framebuffer, unsigned int width, unsigned int height, const std::string& path);
+
+#endif
@@ -0,0 +1,111 @@
+#include "IndirectDrawBuffer.h"
+
+#include <iostream>
+
+#include "GLExtensions.h"
+#include "GLStateCache.h"
+
+IndirectDrawBuffer::IndirectDrawBuffer()
+    : capacity(0)
+{
+    glGenBuffers(1, &commandBuffer);
+    glGenBuffers(1, &dataBuffer);
+    glGenTextures(1, &dataTexture);
+
+    glBindBuffer(GL_TEXTURE_BUFFER, dataBuffer);
+    glBufferData(GL_TEXTURE_BUFFER, sizeof(DrawData), nullptr, GL_STREAM_DRAW);
+    GLStateCache& state = GLStateCache::shared();
+    state.bindTexture(GL_TEXTURE_BUFFER, dataTexture);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, dataBuffer);
+    state.bindTexture(GL_TEXTURE_BUFFER, 0);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+IndirectDrawBuffer::~IndirectDrawBuffer()
+{
+    glDeleteTextures(1, &dataTexture);
+    glDeleteBuffers(1, &dataBuffer);
+    glDeleteBuffers(1, &commandBuffer);
+    GLStateCache::shared().invalidate();
+}
+
+void IndirectDrawBuffer::clear()
+{
+    commands.clear();
+    draws.clear();
+}
+
+void IndirectDrawBuffer::add(const GeometryBuffer& geometry, GeometryHandle mesh, const glm::mat4& model, float shininess, float layer)
+{
+    GLuint meshVAO = geometry.vertexArray(mesh);
+    if (commands.empty())
+        vao = meshVAO;
+    else if (meshVAO != vao) {
+        std::cerr << "ERROR: indirect draws have to share a vertex format, mesh " << mesh << " is skipped" << std::endl;
+        return;
+    }
+
+    commands.push_back(geometry.indirectCommand(mesh));
+
+    DrawData draw;
+    draw.model = model;
+    glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(model)));
+    for (int i = 0; i < 3; i++)
+        draw.normalMatrix[i] = glm::vec4(normalMatrix[i], 0.0f);
+    draw.material = glm::vec4(shininess, layer, 0.0f, 0.0f);
+    draws.push_back(draw);
+}
+
+void IndirectDrawBuffer::upload()
+{
+    if (commands.empty())
+        return;
+
+    // orphaning the storage keeps the driver from waiting for draws of the previous frame
+    if (commands.size() > capacity)
+        capacity = commands.size();
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+    glBufferData(GL_DRAW_INDIRECT_BUFFER, capacity * sizeof(DrawElementsIndirectCommand), nullptr, GL_STREAM_DRAW);
+    glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, commands.size() * sizeof(DrawElementsIndirectCommand), commands.data());
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+    glBindBuffer(GL_TEXTURE_BUFFER, dataBuffer);
+    glBufferData(GL_TEXTURE_BUFFER, capacity * sizeof(DrawData), nullptr, GL_STREAM_DRAW);
+    glBufferSubData(GL_TEXTURE_BUFFER, 0, draws.size() * sizeof(DrawData), draws.data());
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+void IndirectDrawBuffer::bind() const
+{
+    GLStateCache& state = GLStateCache::shared();
+    state.bindTexture(DRAW_DATA_TEXTURE_UNIT, GL_TEXTURE_BUFFER, dataTexture);
+    state.activeTexture(GL_TEXTURE0);
+    state.bindVertexArray(vao);
+}
+
+void IndirectDrawBuffer::draw() const
+{
+    if (commands.empty())
+        return;
+
+    bind();
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+    glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, nullptr, (GLsizei)commands.size(), 0);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
+
+void IndirectDrawBuffer::drawSeparately(const Shader& shader) const
+{
+    if (commands.empty())
+        return;
+
+    bind();
+    GLint drawOffset = shader.uniform("drawOffset");
+    for (size_t i = 0; i < commands.size(); i++) {
+        const DrawElementsIndirectCommand& command = commands[i];
+        shader.setInt(drawOffset, (int)i);
+        glDrawElementsBaseVertex(GL_TRIANGLES, command.count, GL_UNSIGNED_INT,
+            (void*)(command.firstIndex * sizeof(unsigned int)), command.baseVertex);
+    }
+    shader.setInt(drawOffset, 0);
+}
@@ -0,0 +1,61 @@
+#ifndef INDIRECT_DRAW_BUFFER_H
+#define INDIRECT_DRAW_BUFFER_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+#include "GeometryBuffer.h"
+#include "Shader.h"
+
+// texture unit of the per-draw data, see DRAW_ID in the shaders
+const GLuint DRAW_DATA_TEXTURE_UNIT = 3;
+
+// per-draw data, read from a texture buffer as 8 RGBA32F texels at gl_DrawIDARB * 8
+struct DrawData
+{
+    glm::mat4 model;
+    glm::vec4 normalMatrix[3];  // columns of the inverse transpose of the upper 3x3 of model
+    glm::vec4 material;         // shininess and texture array layer
+};
+
+// how the boxes are submitted
+enum class DrawSubmission { INSTANCED, SEPARATE, MULTI_DRAW };
+
+// Objects collected while the frame is prepared as DrawElementsIndirectCommand records and submitted with a
+// single glMultiDrawElementsIndirect call. All meshes have to come from one vertex array of a GeometryBuffer,
+// each object is a draw of its own and its shader finds its data by draw ID. Both buffers grow to the largest
+// count seen and are orphaned on every upload.
+class IndirectDrawBuffer
+{
+public:
+
+    IndirectDrawBuffer();
+    ~IndirectDrawBuffer();
+
+    void clear();
+    void add(const GeometryBuffer& geometry, GeometryHandle mesh, const glm::mat4& model, float shininess = 0.0f, float layer = 0.0f);
+    void upload();
+
+    GLsizei size() const { return (GLsizei)commands.size(); }
+
+    // one glMultiDrawElementsIndirect call, needs hasMultiDrawIndirect()
+    void draw() const;
+    // the same draws with one call each, the draw ID comes from the drawOffset uniform of `shader` then
+    void drawSeparately(const Shader& shader) const;
+
+private:
+
+    GLuint commandBuffer;
+    GLuint dataBuffer;
+    GLuint dataTexture;
+    GLuint vao = 0;
+    size_t capacity;
+    std::vector<DrawElementsIndirectCommand> commands;
+    std::vector<DrawData> draws;
+
+    void bind() const;
+
+};
+#endif
@@ -0,0 +1,71 @@
+#include "InstanceBuffer.h"
+
+#include <cstddef>
+
+#include "GLStateCache.h"
+
+InstanceBuffer::InstanceBuffer()
+    : capacity(0)
+{
+    glGenBuffers(1, &buffer);
+}
+
+InstanceBuffer::~InstanceBuffer()
+{
+    glDeleteBuffers(1, &buffer);
+}
+
+void InstanceBuffer::attach(GLuint vao) const
+{
+    GLStateCache& state = GLStateCache::shared();
+    state.bindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+
+    // matrices take one location per column
+    const GLsizei stride = sizeof(InstanceData);
+    GLuint location = INSTANCE_ATTRIBUTES_LOCATION;
+    for (int i = 0; i < 4; i++, location++) {
+        glEnableVertexAttribArray(location);
+        glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, stride, (void*)(offsetof(InstanceData, model) + i * sizeof(glm::vec4)));
+        glVertexAttribDivisor(location, 1);
+    }
+    for (int i = 0; i < 3; i++, location++) {
+        glEnableVertexAttribArray(location);
+        glVertexAttribPointer(location, 3, GL_FLOAT, GL_FALSE, stride, (void*)(offsetof(InstanceData, normalMatrix) + i * sizeof(glm::vec3)));
+        glVertexAttribDivisor(location, 1);
+    }
+    glEnableVertexAttribArray(location);
+    glVertexAttribPointer(location, 2, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(InstanceData, material));
+    glVertexAttribDivisor(location, 1);
+
+    state.bindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void InstanceBuffer::clear()
+{
+    instances.clear();
+}
+
+void InstanceBuffer::add(const glm::mat4& model, float shininess, float layer)
+{
+    InstanceData instance;
+    instance.model = model;
+    instance.normalMatrix = glm::transpose(glm::inverse(glm::mat3(model)));
+    instance.material = glm::vec2(shininess, layer);
+    instances.push_back(instance);
+}
+
+void InstanceBuffer::upload()
+{
+    if (instances.empty())
+        return;
+
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+    if (instances.size() > capacity)
+        capacity = instances.size();
+    // orphaning the storage keeps the driver from waiting for draws of the previous frame
+    glBufferData(GL_ARRAY_BUFFER, capacity * sizeof(InstanceData), nullptr, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, instances.size() * sizeof(InstanceData), instances.data());
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
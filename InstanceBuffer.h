@@ -0,0 +1,45 @@
+#ifndef INSTANCE_BUFFER_H
+#define INSTANCE_BUFFER_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+// first vertex attribute location of the per-instance data, see INSTANCED in the shaders
+const GLuint INSTANCE_ATTRIBUTES_LOCATION = 3;
+
+// per-instance vertex attributes: model at locations 3-6, normalMatrix at 7-9, material at 10
+struct InstanceData
+{
+    glm::mat4 model;
+    glm::mat3 normalMatrix; // inverse transpose of the upper 3x3 of model
+    glm::vec2 material;     // shininess and texture array layer
+};
+
+// Instances of one object class collected while the frame is prepared and drawn with a single
+// instanced draw. The buffer grows to the largest count seen and is orphaned on every upload.
+class InstanceBuffer
+{
+public:
+
+    InstanceBuffer();
+    ~InstanceBuffer();
+
+    // adds the instance attributes to `vao`, its vertex attributes have to use the locations below INSTANCE_ATTRIBUTES_LOCATION
+    void attach(GLuint vao) const;
+
+    void clear();
+    void add(const glm::mat4& model, float shininess = 0.0f, float layer = 0.0f);
+    void upload();
+
+    GLsizei size() const { return (GLsizei)instances.size(); }
+
+private:
+
+    GLuint buffer;
+    size_t capacity;
+    std::vector<InstanceData> instances;
+
+};
+#endif
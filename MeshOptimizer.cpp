@@ -0,0 +1,354 @@
+#include "MeshOptimizer.h"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <unordered_map>
+
+// vertex cache modelled by the Forsyth scores, larger than the FIFO used for the statistics on purpose
+const int FORSYTH_CACHE_SIZE = 32;
+const unsigned int NO_TRIANGLE = 0xFFFFFFFF;
+
+struct VertexKey
+{
+    const float* data;
+    unsigned int stride;
+
+    bool operator==(const VertexKey& other) const
+    {
+        return memcmp(data, other.data, stride * sizeof(float)) == 0;
+    }
+};
+
+struct VertexKeyHash
+{
+    size_t operator()(const VertexKey& key) const
+    {
+        // FNV-1a over the bytes of the vertex
+        const unsigned char* bytes = (const unsigned char*)key.data;
+        uint64_t hash = 14695981039346656037ull;
+        for (size_t i = 0; i < key.stride * sizeof(float); i++) {
+            hash ^= bytes[i];
+            hash *= 1099511628211ull;
+        }
+        return (size_t)hash;
+    }
+};
+
+Mesh weldVertices(const float* vertices, size_t vertexCount, unsigned int stride)
+{
+    Mesh mesh;
+    mesh.stride = stride;
+    mesh.indices.reserve(vertexCount);
+
+    std::unordered_map<VertexKey, unsigned int, VertexKeyHash> unique;
+    for (size_t i = 0; i < vertexCount; i++) {
+        const float* vertex = vertices + i * stride;
+        auto inserted = unique.emplace(VertexKey{ vertex, stride }, (unsigned int)mesh.vertexCount());
+        if (inserted.second)
+            mesh.vertices.insert(mesh.vertices.end(), vertex, vertex + stride);
+        mesh.indices.push_back(inserted.first->second);
+    }
+    return mesh;
+}
+
+static float vertexScore(int cachePosition, unsigned int remainingTriangles)
+{
+    if (remainingTriangles == 0)
+        return -1.0f;
+
+    float score = 0.0f;
+    if (cachePosition >= 0) {
+        // the vertices of the last triangle get a fixed score, so that the next one does not simply reuse its edge
+        if (cachePosition < 3)
+            score = 0.75f;
+        else
+            score = powf(1.0f - (cachePosition - 3) / (float)(FORSYTH_CACHE_SIZE - 3), 1.5f);
+    }
+    // vertices with few triangles left are finished first so that they leave the cache for good
+    return score + 2.0f * powf((float)remainingTriangles, -0.5f);
+}
+
+void optimizeVertexCache(std::vector<unsigned int>& indices, size_t vertexCount)
+{
+    size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0)
+        return;
+
+    // triangles around every vertex, the ones still to be emitted are kept at the front of each list
+    std::vector<unsigned int> remaining(vertexCount, 0);
+    for (unsigned int index : indices)
+        remaining[index]++;
+    std::vector<unsigned int> offsets(vertexCount + 1, 0);
+    for (size_t v = 0; v < vertexCount; v++)
+        offsets[v + 1] = offsets[v] + remaining[v];
+    std::vector<unsigned int> adjacency(indices.size());
+    std::vector<unsigned int> cursor(offsets.begin(), offsets.end() - 1);
+    for (size_t i = 0; i < indices.size(); i++)
+        adjacency[cursor[indices[i]]++] = (unsigned int)(i / 3);
+
+    std::vector<int> cachePosition(vertexCount, -1);
+    std::vector<float> vertexScores(vertexCount);
+    for (size_t v = 0; v < vertexCount; v++)
+        vertexScores[v] = vertexScore(-1, remaining[v]);
+
+    std::vector<float> triangleScores(triangleCount);
+    std::vector<bool> emitted(triangleCount, false);
+    unsigned int best = 0;
+    for (size_t t = 0; t < triangleCount; t++) {
+        triangleScores[t] = vertexScores[indices[3 * t]] + vertexScores[indices[3 * t + 1]] + vertexScores[indices[3 * t + 2]];
+        if (triangleScores[t] > triangleScores[best])
+            best = (unsigned int)t;
+    }
+
+    std::vector<unsigned int> result;
+    result.reserve(indices.size());
+    std::vector<unsigned int> cache, newCache;
+    size_t scan = 0;
+
+    for (size_t n = 0; n < triangleCount; n++) {
+        if (best == NO_TRIANGLE) {
+            // nothing in the cache has triangles left, continuing with the first one not emitted yet
+            while (emitted[scan])
+                scan++;
+            best = (unsigned int)scan;
+        }
+
+        const unsigned int* triangle = &indices[3 * best];
+        result.insert(result.end(), triangle, triangle + 3);
+        emitted[best] = true;
+
+        for (int k = 0; k < 3; k++) {
+            unsigned int v = triangle[k];
+            unsigned int* list = &adjacency[offsets[v]];
+            unsigned int* found = std::find(list, list + remaining[v], best);
+            std::swap(*found, list[remaining[v] - 1]);
+            remaining[v]--;
+        }
+
+        // the triangle's vertices move to the front of the cache, the ones pushed past its end are evicted
+        newCache.assign(triangle, triangle + 3);
+        for (unsigned int v : cache) {
+            if (v != triangle[0] && v != triangle[1] && v != triangle[2])
+                newCache.push_back(v);
+        }
+        for (size_t i = 0; i < newCache.size(); i++) {
+            unsigned int v = newCache[i];
+            cachePosition[v] = i < FORSYTH_CACHE_SIZE ? (int)i : -1;
+            vertexScores[v] = vertexScore(cachePosition[v], remaining[v]);
+        }
+
+        // only triangles around the vertices whose scores changed can become the best one
+        best = NO_TRIANGLE;
+        float bestScore = -1.0f;
+        for (unsigned int v : newCache) {
+            for (unsigned int i = 0; i < remaining[v]; i++) {
+                unsigned int t = adjacency[offsets[v] + i];
+                float score = vertexScores[indices[3 * t]] + vertexScores[indices[3 * t + 1]] + vertexScores[indices[3 * t + 2]];
+                triangleScores[t] = score;
+                if (score > bestScore) {
+                    bestScore = score;
+                    best = t;
+                }
+            }
+        }
+
+        if (newCache.size() > FORSYTH_CACHE_SIZE)
+            newCache.resize(FORSYTH_CACHE_SIZE);
+        cache.swap(newCache);
+    }
+
+    indices.swap(result);
+}
+
+// FIFO cache simulation with timestamps, a vertex is a hit while fewer than cacheSize misses happened since it was loaded
+class FifoCache
+{
+public:
+
+    FifoCache(size_t vertexCount, unsigned int cacheSize)
+        : timestamps(vertexCount, 0), cacheSize(cacheSize), time(cacheSize + 1)
+    {
+    }
+
+    void reset() { time += cacheSize + 1; }
+
+    unsigned int misses(const unsigned int* triangle)
+    {
+        unsigned int count = 0;
+        for (int k = 0; k < 3; k++) {
+            if (time - timestamps[triangle[k]] > cacheSize) {
+                timestamps[triangle[k]] = time++;
+                count++;
+            }
+        }
+        return count;
+    }
+
+private:
+
+    std::vector<unsigned int> timestamps;
+    unsigned int cacheSize;
+    unsigned int time;
+
+};
+
+VertexCacheStats analyzeVertexCache(const std::vector<unsigned int>& indices, size_t vertexCount, unsigned int cacheSize)
+{
+    VertexCacheStats stats = { 0.0f, 0.0f };
+    size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0)
+        return stats;
+
+    FifoCache cache(vertexCount, cacheSize);
+    std::vector<bool> used(vertexCount, false);
+    size_t misses = 0, usedCount = 0;
+    for (size_t t = 0; t < triangleCount; t++)
+        misses += cache.misses(&indices[3 * t]);
+    for (unsigned int index : indices) {
+        if (!used[index]) {
+            used[index] = true;
+            usedCount++;
+        }
+    }
+
+    stats.acmr = (float)misses / triangleCount;
+    stats.atvr = (float)misses / usedCount;
+    return stats;
+}
+
+void optimizeOverdraw(std::vector<unsigned int>& indices, const std::vector<float>& vertices, unsigned int stride,
+    unsigned int positionComponents, float threshold)
+{
+    const unsigned int cacheSize = 16;
+    size_t triangleCount = indices.size() / 3;
+    size_t vertexCount = vertices.size() / stride;
+    if (triangleCount < 2)
+        return;
+
+    auto position = [&](unsigned int v) {
+        const float* p = &vertices[v * stride];
+        return glm::vec3(p[0], p[1], positionComponents > 2 ? p[2] : 0.0f);
+    };
+
+    // hard boundaries: triangles that miss with all three vertices start with a cold cache anyway; the first
+    // triangle starts one whatever its misses (a degenerate one has fewer than three)
+    std::vector<size_t> hardClusters;
+    FifoCache cache(vertexCount, cacheSize);
+    for (size_t t = 0; t < triangleCount; t++) {
+        if (cache.misses(&indices[3 * t]) == 3 || t == 0)
+            hardClusters.push_back(t);
+    }
+    hardClusters.push_back(triangleCount);
+
+    // soft boundaries: a hard cluster is split once its running ACMR comes within `threshold` of the whole cluster's
+    std::vector<size_t> clusters;
+    for (size_t c = 0; c + 1 < hardClusters.size(); c++) {
+        size_t start = hardClusters[c], end = hardClusters[c + 1];
+        cache.reset();
+        size_t clusterMisses = 0;
+        for (size_t t = start; t < end; t++)
+            clusterMisses += cache.misses(&indices[3 * t]);
+        float clusterAcmr = (float)clusterMisses / (end - start);
+
+        clusters.push_back(start);
+        cache.reset();
+        size_t subStart = start, subMisses = 0;
+        for (size_t t = start; t < end; t++) {
+            subMisses += cache.misses(&indices[3 * t]);
+            if (t + 1 < end && (float)subMisses / (t + 1 - subStart) <= threshold * clusterAcmr) {
+                clusters.push_back(t + 1);
+                cache.reset();
+                subStart = t + 1;
+                subMisses = 0;
+            }
+        }
+    }
+    clusters.push_back(triangleCount);
+
+    // clusters facing away from the mesh centre are drawn first, they are the ones most likely in front
+    glm::vec3 meshCentroid(0.0f);
+    for (size_t v = 0; v < vertexCount; v++)
+        meshCentroid += position((unsigned int)v);
+    meshCentroid /= (float)vertexCount;
+
+    size_t clusterCount = clusters.size() - 1;
+    std::vector<float> sortKeys(clusterCount);
+    for (size_t c = 0; c < clusterCount; c++) {
+        glm::vec3 centroid(0.0f), normal(0.0f);
+        float area = 0.0f;
+        for (size_t t = clusters[c]; t < clusters[c + 1]; t++) {
+            glm::vec3 a = position(indices[3 * t]), b = position(indices[3 * t + 1]), c3 = position(indices[3 * t + 2]);
+            glm::vec3 areaNormal = glm::cross(b - a, c3 - a);
+            float triangleArea = glm::length(areaNormal);
+            centroid += (a + b + c3) / 3.0f * triangleArea;
+            normal += areaNormal;
+            area += triangleArea;
+        }
+        centroid = area > 0.0f ? centroid / area : position(indices[3 * clusters[c]]);
+        float normalLength = glm::length(normal);
+        sortKeys[c] = normalLength > 0.0f ? glm::dot(centroid - meshCentroid, normal / normalLength) : 0.0f;
+    }
+
+    std::vector<size_t> order(clusterCount);
+    for (size_t c = 0; c < clusterCount; c++)
+        order[c] = c;
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return sortKeys[a] > sortKeys[b]; });
+
+    std::vector<unsigned int> result;
+    result.reserve(indices.size());
+    for (size_t c : order)
+        result.insert(result.end(), indices.begin() + 3 * clusters[c], indices.begin() + 3 * clusters[c + 1]);
+    if (result.size() != indices.size()) {
+        std::cerr << "ERROR: overdraw ordering lost " << indices.size() - result.size() << " of " << indices.size()
+            << " indices, the triangle order is kept" << std::endl;
+        return;
+    }
+    indices.swap(result);
+}
+
+void optimizeVertexFetch(Mesh& mesh)
+{
+    const unsigned int unassigned = 0xFFFFFFFF;
+    std::vector<unsigned int> remap(mesh.vertexCount(), unassigned);
+    std::vector<float> vertices;
+    vertices.reserve(mesh.vertices.size());
+
+    for (unsigned int& index : mesh.indices) {
+        if (remap[index] == unassigned) {
+            remap[index] = (unsigned int)(vertices.size() / mesh.stride);
+            const float* vertex = &mesh.vertices[index * mesh.stride];
+            vertices.insert(vertices.end(), vertex, vertex + mesh.stride);
+        }
+        index = remap[index];
+    }
+    mesh.vertices.swap(vertices);
+}
+
+Mesh optimizeMesh(const std::string& name, Mesh mesh, unsigned int positionComponents)
+{
+    // a triangle soup would have a vertex per index
+    size_t vertexCount = mesh.indices.size();
+    VertexCacheStats before = analyzeVertexCache(mesh.indices, mesh.vertexCount());
+
+    optimizeVertexCache(mesh.indices, mesh.vertexCount());
+    optimizeOverdraw(mesh.indices, mesh.vertices, mesh.stride, positionComponents);
+    optimizeVertexFetch(mesh);
+    VertexCacheStats after = analyzeVertexCache(mesh.indices, mesh.vertexCount());
+
+    char line[160];
+    snprintf(line, sizeof(line), "Mesh %s: %zu -> %zu vertices, ACMR %.2f -> %.2f, ATVR %.2f -> %.2f\n", name.c_str(),
+        vertexCount, mesh.vertexCount(), before.acmr, after.acmr, before.atvr, after.atvr);
+    std::cout << line;
+    return mesh;
+}
+
+Mesh buildMesh(const std::string& name, const float* vertices, size_t vertexCount, unsigned int stride, unsigned int positionComponents)
+{
+    return optimizeMesh(name, weldVertices(vertices, vertexCount, stride), positionComponents);
+}
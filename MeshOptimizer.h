@@ -0,0 +1,50 @@
+#ifndef MESH_OPTIMIZER_H
+#define MESH_OPTIMIZER_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// indexed triangle list, vertices are `stride` floats with the position in the first components
+struct Mesh
+{
+    std::vector<float> vertices;
+    std::vector<unsigned int> indices;
+    unsigned int stride = 0;
+
+    size_t vertexCount() const { return stride ? vertices.size() / stride : 0; }
+};
+
+struct VertexCacheStats
+{
+    float acmr;     // average cache miss ratio, transformed vertices per triangle (0.5 - 3.0)
+    float atvr;     // average transformed vertex ratio, transformed vertices per used vertex (1.0 at best)
+};
+
+// merges bitwise equal vertices of a triangle soup of `vertexCount` vertices
+Mesh weldVertices(const float* vertices, size_t vertexCount, unsigned int stride);
+
+// Forsyth's linear-speed vertex cache optimization, orders triangles so that vertices are reused while
+// they are still in the post-transform cache
+void optimizeVertexCache(std::vector<unsigned int>& indices, size_t vertexCount);
+
+// Splits the cache-optimized order into clusters where the cache would be cold anyway (or where the cache
+// efficiency allows it, `threshold` is the ACMR ratio that may be lost) and draws outward facing clusters first,
+// so that they hide the rest (Sander, Nehab and Barczak, 2007). Positions have `positionComponents` floats.
+void optimizeOverdraw(std::vector<unsigned int>& indices, const std::vector<float>& vertices, unsigned int stride,
+    unsigned int positionComponents = 3, float threshold = 1.05f);
+
+// renumbers vertices in the order in which the triangles first reference them, so vertex fetches walk the buffer forward
+void optimizeVertexFetch(Mesh& mesh);
+
+// simulates a FIFO post-transform cache of `cacheSize` vertices
+VertexCacheStats analyzeVertexCache(const std::vector<unsigned int>& indices, size_t vertexCount, unsigned int cacheSize = 16);
+
+// runs all optimizations on an indexed mesh, printing the cache statistics before and after them
+Mesh optimizeMesh(const std::string& name, Mesh mesh, unsigned int positionComponents = 3);
+
+// welds the soup and runs all optimizations on it
+Mesh buildMesh(const std::string& name, const float* vertices, size_t vertexCount, unsigned int stride,
+    unsigned int positionComponents = 3);
+
+#endif
@@ -0,0 +1,424 @@
+#include "MipmapGenerator.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MIPMAP_SSE2
+#include <emmintrin.h>
+#endif
+#if defined(__AVX2__)
+#define MIPMAP_AVX2
+#include <immintrin.h>
+#endif
+
+namespace {
+
+const float PI = 3.14159265358979f;
+const int ROWS_PER_TASK = 16;
+
+// four floats per pixel whatever the channel count of the source
+struct FloatImage
+{
+    int width = 0;
+    int height = 0;
+    std::vector<float> pixels;
+
+    FloatImage() = default;
+    FloatImage(int width, int height) : width(width), height(height), pixels((size_t)width * height * 4) {}
+
+    float* row(int y) { return pixels.data() + (size_t)y * width * 4; }
+    const float* row(int y) const { return pixels.data() + (size_t)y * width * 4; }
+};
+
+// 2:1 polyphase kernel, every destination pixel uses the same weights
+struct Kernel
+{
+    int first;
+    std::vector<float> weights;
+};
+
+float sinc(float x)
+{
+    if (std::fabs(x) < 1e-6f)
+        return 1.0f;
+    x *= PI;
+    return std::sin(x) / x;
+}
+
+float besselI0(float x)
+{
+    float sum = 1.0f, term = 1.0f;
+    for (int k = 1; k < 32; k++) {
+        float factor = x / (2.0f * k);
+        term *= factor * factor;
+        sum += term;
+    }
+    return sum;
+}
+
+float kernelSupport(MipFilter filter)
+{
+    return filter == MipFilter::BOX ? 0.5f : 3.0f;
+}
+
+float kernelValue(MipFilter filter, float t)
+{
+    t = std::fabs(t);
+    switch (filter) {
+    case MipFilter::BOX:
+        return t <= 0.5f ? 1.0f : 0.0f;
+    case MipFilter::LANCZOS:
+        return t < 3.0f ? sinc(t) * sinc(t / 3.0f) : 0.0f;
+    case MipFilter::KAISER:
+    default:
+    {
+        const float width = 3.0f, alpha = 4.0f;
+        if (t >= width)
+            return 0.0f;
+        float ratio = t / width;
+        return sinc(t) * besselI0(alpha * std::sqrt(1.0f - ratio * ratio)) / besselI0(alpha);
+    }
+    }
+}
+
+Kernel makeKernel(MipFilter filter)
+{
+    // destination pixel x is centred on source coordinate 2x + 1, source pixel i on i + 0.5
+    int halfTaps = (int)std::ceil(2.0f * kernelSupport(filter));
+    Kernel kernel;
+    kernel.first = 1 - halfTaps;
+
+    float sum = 0.0f;
+    for (int offset = kernel.first; offset <= halfTaps; offset++) {
+        float weight = kernelValue(filter, (offset - 0.5f) * 0.5f);
+        kernel.weights.push_back(weight);
+        sum += weight;
+    }
+    for (float& weight : kernel.weights)
+        weight /= sum;
+
+    return kernel;
+}
+
+int wrap(int i, int n)
+{
+    i %= n;
+    return i < 0 ? i + n : i;
+}
+
+const float* srgbToLinearTable()
+{
+    static const std::vector<float> table = []() {
+        std::vector<float> values(256);
+        for (int i = 0; i < 256; i++) {
+            float c = i / 255.0f;
+            values[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+        }
+        return values;
+    }();
+    return table.data();
+}
+
+const int LINEAR_TABLE_SIZE = 4096;
+
+const unsigned char* linearToSrgbTable()
+{
+    static const std::vector<unsigned char> table = []() {
+        std::vector<unsigned char> values(LINEAR_TABLE_SIZE);
+        for (int i = 0; i < LINEAR_TABLE_SIZE; i++) {
+            float c = i / (float)(LINEAR_TABLE_SIZE - 1);
+            float s = c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f;
+            values[i] = (unsigned char)(std::min(1.0f, std::max(0.0f, s)) * 255.0f + 0.5f);
+        }
+        return values;
+    }();
+    return table.data();
+}
+
+// float lanes that the source channels map to: grey and grey+alpha images keep alpha in lane 3
+const int* channelLanes(int channelsNum)
+{
+    static const int lanes[5][4] = { { 0 }, { 0 }, { 0, 3 }, { 0, 1, 2 }, { 0, 1, 2, 3 } };
+    return lanes[channelsNum];
+}
+
+void decodeRow(const unsigned char* src, int width, int channelsNum, const MipSettings& settings, float* dst)
+{
+    const float* toLinear = srgbToLinearTable();
+    const int* lanes = channelLanes(channelsNum);
+
+    for (int x = 0; x < width; x++) {
+        float* pixel = dst + 4 * x;
+        pixel[0] = pixel[1] = pixel[2] = 0.0f;
+        pixel[3] = 1.0f;
+        for (int c = 0; c < channelsNum; c++) {
+            unsigned char value = src[x * channelsNum + c];
+            int lane = lanes[c];
+            if (lane < 3 && settings.normalMap)
+                pixel[lane] = value * (2.0f / 255.0f) - 1.0f;
+            else if (lane < 3 && settings.srgb)
+                pixel[lane] = toLinear[value];
+            else
+                pixel[lane] = value * (1.0f / 255.0f);
+        }
+    }
+}
+
+unsigned char quantize(float value)
+{
+    return (unsigned char)(std::min(1.0f, std::max(0.0f, value)) * 255.0f + 0.5f);
+}
+
+void encodeRow(const float* src, int width, int channelsNum, const MipSettings& settings, float alphaScale, unsigned char* dst)
+{
+    const unsigned char* toSrgb = linearToSrgbTable();
+    const int* lanes = channelLanes(channelsNum);
+
+    for (int x = 0; x < width; x++) {
+        const float* pixel = src + 4 * x;
+        for (int c = 0; c < channelsNum; c++) {
+            int lane = lanes[c];
+            float value = pixel[lane];
+            unsigned char result;
+            if (lane < 3 && settings.normalMap)
+                result = quantize(value * 0.5f + 0.5f);
+            else if (lane < 3 && settings.srgb)
+                result = toSrgb[(int)(std::min(1.0f, std::max(0.0f, value)) * (LINEAR_TABLE_SIZE - 1) + 0.5f)];
+            else if (lane == 3)
+                result = quantize(value * alphaScale);
+            else
+                result = quantize(value);
+            dst[x * channelsNum + c] = result;
+        }
+    }
+}
+
+// horizontal 2:1 pass over one row
+void filterRow(const float* src, int srcWidth, float* dst, int dstWidth, const Kernel& kernel)
+{
+    if (srcWidth == dstWidth) {
+        std::memcpy(dst, src, (size_t)srcWidth * 4 * sizeof(float));
+        return;
+    }
+
+    const int tapsNum = (int)kernel.weights.size();
+    const float* weights = kernel.weights.data();
+    int x = 0;
+
+#ifdef MIPMAP_AVX2
+    // two destination pixels per register, their taps are two source pixels apart
+    for (; x + 1 < dstWidth; x += 2) {
+        int start = 2 * x + kernel.first;
+        bool inside = start >= 0 && start + 2 + tapsNum <= srcWidth;
+        __m256 acc = _mm256_setzero_ps();
+        for (int k = 0; k < tapsNum; k++) {
+            int i0 = inside ? start + k : wrap(start + k, srcWidth);
+            int i1 = inside ? start + k + 2 : wrap(start + k + 2, srcWidth);
+            __m256 texels = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(src + 4 * i0)), _mm_loadu_ps(src + 4 * i1), 1);
+            acc = _mm256_add_ps(acc, _mm256_mul_ps(_mm256_set1_ps(weights[k]), texels));
+        }
+        _mm256_storeu_ps(dst + 4 * x, acc);
+    }
+#endif
+
+    for (; x < dstWidth; x++) {
+        int start = 2 * x + kernel.first;
+        bool inside = start >= 0 && start + tapsNum <= srcWidth;
+#ifdef MIPMAP_SSE2
+        __m128 acc = _mm_setzero_ps();
+        for (int k = 0; k < tapsNum; k++) {
+            int i = inside ? start + k : wrap(start + k, srcWidth);
+            acc = _mm_add_ps(acc, _mm_mul_ps(_mm_set1_ps(weights[k]), _mm_loadu_ps(src + 4 * i)));
+        }
+        _mm_storeu_ps(dst + 4 * x, acc);
+#else
+        float acc[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+        for (int k = 0; k < tapsNum; k++) {
+            int i = inside ? start + k : wrap(start + k, srcWidth);
+            for (int c = 0; c < 4; c++)
+                acc[c] += weights[k] * src[4 * i + c];
+        }
+        std::memcpy(dst + 4 * x, acc, sizeof(acc));
+#endif
+    }
+}
+
+// dst += weight * src over count floats
+void accumulateRow(float* dst, const float* src, float weight, size_t count)
+{
+    size_t i = 0;
+#ifdef MIPMAP_AVX2
+    __m256 weight8 = _mm256_set1_ps(weight);
+    for (; i + 8 <= count; i += 8)
+        _mm256_storeu_ps(dst + i, _mm256_add_ps(_mm256_loadu_ps(dst + i), _mm256_mul_ps(weight8, _mm256_loadu_ps(src + i))));
+#endif
+#ifdef MIPMAP_SSE2
+    __m128 weight4 = _mm_set1_ps(weight);
+    for (; i + 4 <= count; i += 4)
+        _mm_storeu_ps(dst + i, _mm_add_ps(_mm_loadu_ps(dst + i), _mm_mul_ps(weight4, _mm_loadu_ps(src + i))));
+#endif
+    for (; i < count; i++)
+        dst[i] += weight * src[i];
+}
+
+void normalizeRow(float* row, int width)
+{
+    for (int x = 0; x < width; x++) {
+        float* pixel = row + 4 * x;
+        float length = std::sqrt(pixel[0] * pixel[0] + pixel[1] * pixel[1] + pixel[2] * pixel[2]);
+        if (length > 1e-6f) {
+            pixel[0] /= length;
+            pixel[1] /= length;
+            pixel[2] /= length;
+        }
+        else {
+            pixel[0] = pixel[1] = 0.0f;
+            pixel[2] = 1.0f;
+        }
+    }
+}
+
+float alphaCoverage(const FloatImage& image, float reference, float scale)
+{
+    size_t covered = 0, count = (size_t)image.width * image.height;
+    for (size_t i = 0; i < count; i++)
+        if (std::min(1.0f, image.pixels[4 * i + 3] * scale) > reference)
+            covered++;
+    return (float)covered / count;
+}
+
+// alpha scale that makes the level cover the same share of pixels as the base level
+float coverageScale(const FloatImage& image, float reference, float target)
+{
+    float low = 0.0f, high = 4.0f, best = 1.0f, bestError = 2.0f;
+    for (int i = 0; i < 16; i++) {
+        float scale = 0.5f * (low + high);
+        float coverage = alphaCoverage(image, reference, scale);
+        float error = std::fabs(coverage - target);
+        if (error < bestError) {
+            best = scale;
+            bestError = error;
+        }
+        if (coverage < target)
+            low = scale;
+        else
+            high = scale;
+    }
+    return best;
+}
+
+}
+
+uint32_t MipSettings::key() const
+{
+    uint32_t alphaKey = (uint32_t)(std::min(1.0f, std::max(0.0f, alphaCoverage)) * 255.0f + 0.5f);
+    return (uint32_t)filter | (srgb ? 1u << 2 : 0u) | (normalMap ? 1u << 3 : 0u) | alphaKey << 8;
+}
+
+unsigned int mipChainLength(int width, int height)
+{
+    unsigned int levelsNum = 1;
+    while (width > 1 || height > 1) {
+        width = std::max(1, width / 2);
+        height = std::max(1, height / 2);
+        levelsNum++;
+    }
+    return levelsNum;
+}
+
+MipChain buildMipChain(const unsigned char* pixels, int width, int height, int channelsNum, const MipSettings& settings, bool mipmaps)
+{
+    MipChain chain;
+    chain.width = width;
+    chain.height = height;
+    chain.channelsNum = channelsNum;
+
+    size_t total = 0;
+    int w = width, h = height;
+    while (true) {
+        size_t size = (size_t)w * h * channelsNum;
+        chain.levels.push_back(MipLevel{ w, h, total, size });
+        total += size;
+        if (!mipmaps || (w == 1 && h == 1))
+            break;
+        w = std::max(1, w / 2);
+        h = std::max(1, h / 2);
+    }
+
+    chain.pixels.resize(total);
+    std::memcpy(chain.pixels.data(), pixels, chain.levels[0].size);
+    if (chain.levels.size() == 1)
+        return chain;
+
+    ThreadPool& pool = ThreadPool::shared();
+    Kernel kernel = makeKernel(settings.filter);
+    const int tapsNum = (int)kernel.weights.size();
+
+    bool hasAlpha = channelsNum == 2 || channelsNum == 4;
+    bool keepCoverage = hasAlpha && settings.alphaCoverage > 0.0f;
+    float targetCoverage = 0.0f;
+    if (keepCoverage) {
+        size_t covered = 0, count = (size_t)width * height;
+        for (size_t i = 0; i < count; i++)
+            if (pixels[i * channelsNum + channelsNum - 1] / 255.0f > settings.alphaCoverage)
+                covered++;
+        targetCoverage = (float)covered / count;
+    }
+
+    FloatImage current;
+    for (size_t i = 1; i < chain.levels.size(); i++) {
+        const MipLevel& src = chain.levels[i - 1];
+        const MipLevel& dst = chain.levels[i];
+
+        // horizontal pass, the base level is converted to float one row at a time
+        FloatImage columns(dst.width, src.height);
+        pool.parallelFor(src.height, ROWS_PER_TASK, [&](size_t begin, size_t end) {
+            std::vector<float> decoded;
+            for (size_t y = begin; y < end; y++) {
+                const float* row;
+                if (i == 1) {
+                    decoded.resize((size_t)src.width * 4);
+                    decodeRow(pixels + y * src.width * channelsNum, src.width, channelsNum, settings, decoded.data());
+                    row = decoded.data();
+                }
+                else
+                    row = current.row((int)y);
+                filterRow(row, src.width, columns.row((int)y), dst.width, kernel);
+            }
+        });
+
+        // vertical pass
+        FloatImage next(dst.width, dst.height);
+        pool.parallelFor(dst.height, ROWS_PER_TASK, [&](size_t begin, size_t end) {
+            size_t count = (size_t)dst.width * 4;
+            for (size_t y = begin; y < end; y++) {
+                float* out = next.row((int)y);
+                if (src.height == dst.height)
+                    std::memcpy(out, columns.row((int)y), count * sizeof(float));
+                else {
+                    int start = 2 * (int)y + kernel.first;
+                    for (int k = 0; k < tapsNum; k++)
+                        accumulateRow(out, columns.row(wrap(start + k, src.height)), kernel.weights[k], count);
+                }
+                if (settings.normalMap)
+                    normalizeRow(out, dst.width);
+            }
+        });
+
+        float alphaScale = keepCoverage ? coverageScale(next, settings.alphaCoverage, targetCoverage) : 1.0f;
+
+        unsigned char* out = chain.pixels.data() + dst.offset;
+        pool.parallelFor(dst.height, ROWS_PER_TASK, [&](size_t begin, size_t end) {
+            for (size_t y = begin; y < end; y++)
+                encodeRow(next.row((int)y), dst.width, channelsNum, settings, alphaScale, out + y * dst.width * channelsNum);
+        });
+
+        // the next level is filtered from unscaled alpha
+        current = std::move(next);
+    }
+
+    return chain;
+}
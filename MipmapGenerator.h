@@ -0,0 +1,63 @@
+#ifndef MIPMAP_GENERATOR_H
+#define MIPMAP_GENERATOR_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct MipLevel
+{
+    int width;
+    int height;
+    size_t offset;
+    size_t size;
+};
+
+// layout of MipChain pixels: 8-bit channels or 4x4 compressed blocks (see BlockCompressor.h)
+enum class BlockFormat {
+    NONE,
+    BC1,
+    BC3,
+    BC5
+};
+
+// all levels of an image packed one after another into a single buffer
+struct MipChain
+{
+    int width = 0;
+    int height = 0;
+    int channelsNum = 0;
+    BlockFormat format = BlockFormat::NONE;
+    std::vector<MipLevel> levels;
+    std::vector<unsigned char> pixels;
+
+    const unsigned char* levelData(size_t level) const { return pixels.data() + levels[level].offset; }
+};
+
+enum class MipFilter {
+    BOX,
+    KAISER,
+    LANCZOS
+};
+
+struct MipSettings
+{
+    MipFilter filter = MipFilter::KAISER;
+    bool srgb = false;          // colour channels are sRGB encoded and averaged in linear space
+    bool normalMap = false;     // RGB holds a unit vector that is renormalized on every level
+    float alphaCoverage = 0.0f; // when > 0, alpha test reference whose coverage is kept on every level
+
+    // identifies the settings in texture cache entries
+    uint32_t key() const;
+};
+
+// Builds the chain down to 1x1, or wraps the single base level when mipmaps is false.
+// Levels are filtered in float with wrap-around addressing (textures are sampled with GL_REPEAT),
+// rows of every level are split across ThreadPool::shared().
+MipChain buildMipChain(const unsigned char* pixels, int width, int height, int channelsNum,
+    const MipSettings& settings = MipSettings(), bool mipmaps = true);
+
+// number of levels of the chain down to 1x1
+unsigned int mipChainLength(int width, int height);
+
+#endif
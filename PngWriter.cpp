@@ -0,0 +1,123 @@
+#include "PngWriter.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <iostream>
+#include <vector>
+
+// largest payload of a stored deflate block
+const size_t STORED_BLOCK_SIZE = 65535;
+
+static uint32_t crc32(const unsigned char* data, size_t size, uint32_t crc = 0)
+{
+    static uint32_t table[256];
+    static bool tableReady = false;
+    if (!tableReady) {
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; k++)
+                c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            table[i] = c;
+        }
+        tableReady = true;
+    }
+
+    crc = ~crc;
+    for (size_t i = 0; i < size; i++)
+        crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+static uint32_t adler32(const unsigned char* data, size_t size)
+{
+    // 5552 bytes is the most that can be summed before the 32-bit sums have to be reduced
+    uint32_t a = 1, b = 0;
+    while (size > 0) {
+        size_t chunk = size < 5552 ? size : 5552;
+        for (size_t i = 0; i < chunk; i++) {
+            a += data[i];
+            b += a;
+        }
+        a %= 65521;
+        b %= 65521;
+        data += chunk;
+        size -= chunk;
+    }
+    return (b << 16) | a;
+}
+
+static void putBigEndian(std::vector<unsigned char>& out, uint32_t value)
+{
+    out.push_back((unsigned char)(value >> 24));
+    out.push_back((unsigned char)(value >> 16));
+    out.push_back((unsigned char)(value >> 8));
+    out.push_back((unsigned char)value);
+}
+
+static void putChunk(std::vector<unsigned char>& out, const char* type, const std::vector<unsigned char>& data)
+{
+    putBigEndian(out, (uint32_t)data.size());
+    size_t start = out.size();
+    out.insert(out.end(), type, type + 4);
+    out.insert(out.end(), data.begin(), data.end());
+    putBigEndian(out, crc32(&out[start], out.size() - start));
+}
+
+bool writePNG(const std::string& path, unsigned int width, unsigned int height, unsigned int channels, const unsigned char* pixels)
+{
+    static const unsigned char colorTypes[] = { 0, 4, 2, 6 };
+    if (channels < 1 || channels > 4 || width == 0 || height == 0) {
+        std::cerr << "ERROR: invalid PNG image: " << path << std::endl;
+        return false;
+    }
+
+    // every row starts with its filter type, 0 leaves the bytes as they are
+    size_t rowSize = (size_t)width * channels;
+    std::vector<unsigned char> raw;
+    raw.reserve((rowSize + 1) * height);
+    for (unsigned int y = 0; y < height; y++) {
+        raw.push_back(0);
+        raw.insert(raw.end(), pixels + y * rowSize, pixels + (y + 1) * rowSize);
+    }
+
+    // zlib stream of stored blocks
+    std::vector<unsigned char> idat;
+    idat.reserve(raw.size() + raw.size() / STORED_BLOCK_SIZE * 5 + 16);
+    idat.push_back(0x78);
+    idat.push_back(0x01);
+    for (size_t offset = 0; offset < raw.size(); offset += STORED_BLOCK_SIZE) {
+        size_t size = raw.size() - offset < STORED_BLOCK_SIZE ? raw.size() - offset : STORED_BLOCK_SIZE;
+        idat.push_back(offset + size == raw.size() ? 1 : 0);
+        idat.push_back((unsigned char)size);
+        idat.push_back((unsigned char)(size >> 8));
+        idat.push_back((unsigned char)~size);
+        idat.push_back((unsigned char)(~size >> 8));
+        idat.insert(idat.end(), raw.begin() + offset, raw.begin() + offset + size);
+    }
+    putBigEndian(idat, adler32(raw.data(), raw.size()));
+
+    std::vector<unsigned char> header;
+    putBigEndian(header, width);
+    putBigEndian(header, height);
+    header.push_back(8);
+    header.push_back(colorTypes[channels - 1]);
+    header.push_back(0);
+    header.push_back(0);
+    header.push_back(0);
+
+    static const unsigned char signature[] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    std::vector<unsigned char> file(signature, signature + sizeof(signature));
+    putChunk(file, "IHDR", header);
+    putChunk(file, "IDAT", idat);
+    putChunk(file, "IEND", std::vector<unsigned char>());
+
+    FILE* out = fopen(path.c_str(), "wb");
+    if (!out || fwrite(file.data(), 1, file.size(), out) != file.size()) {
+        std::cerr << "ERROR: PNG writing failed: " << path << std::endl;
+        if (out)
+            fclose(out);
+        return false;
+    }
+    fclose(out);
+    return true;
+}
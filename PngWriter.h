@@ -0,0 +1,11 @@
+#ifndef PNG_WRITER_H
+#define PNG_WRITER_H
+
+#include <string>
+
+// Writes 8-bit grey, grey-alpha, RGB or RGBA pixels (`channels` 1-4), rows from the top, as a PNG file.
+// The image data is stored uncompressed in deflate blocks: the files are larger than those of an image editor,
+// but no compression library is needed and writing costs no more than copying the pixels.
+bool writePNG(const std::string& path, unsigned int width, unsigned int height, unsigned int channels, const unsigned char* pixels);
+
+#endif
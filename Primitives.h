@@ -0,0 +1,227 @@
+#ifndef PRIMITIVES_H
+#define PRIMITIVES_H
+
+#include <cstddef>
+
+#include "MeshOptimizer.h"
+
+// Primitive meshes generated at compile time: a generator called in a constexpr initializer puts the vertices and
+// indices in read-only data. Vertices hold the attributes of `Format` in the order of VertexLayout, position first,
+// so draws that take only the leading attributes can share one mesh. Triangles wind counterclockwise seen from the
+// side the normals point to; texture coordinates go from 0 to 1 over a face, v up.
+
+template <unsigned int PositionComponents, bool Normal, bool TexCoord>
+struct VertexFormat
+{
+    static constexpr unsigned int positionComponents = PositionComponents;
+    static constexpr bool normal = Normal;
+    static constexpr bool texCoord = TexCoord;
+    static constexpr unsigned int stride = PositionComponents + (Normal ? 3 : 0) + (TexCoord ? 2 : 0);
+};
+
+typedef VertexFormat<3, false, false> PositionVertex;
+typedef VertexFormat<3, true, false> PositionNormalVertex;
+typedef VertexFormat<3, true, true> PositionNormalTexVertex;
+
+template <typename Format, size_t VertexCount, size_t IndexCount>
+struct Primitive
+{
+    static constexpr size_t vertexCount = VertexCount;
+    static constexpr size_t indexCount = IndexCount;
+
+    float vertices[VertexCount * Format::stride];
+    unsigned int indices[IndexCount];
+};
+
+namespace primitive_detail {
+
+constexpr double PI = 3.14159265358979323846;
+
+// sine and cosine for constant expressions, the angle is taken to [-pi/2, pi/2] where the series converges fast
+constexpr double sin(double x)
+{
+    while (x > PI)
+        x -= 2.0 * PI;
+    while (x < -PI)
+        x += 2.0 * PI;
+    if (x > PI / 2.0)
+        x = PI - x;
+    else if (x < -PI / 2.0)
+        x = -PI - x;
+
+    double term = x, sum = x;
+    for (int i = 1; i < 12; i++) {
+        term *= -x * x / ((2 * i) * (2 * i + 1));
+        sum += term;
+    }
+    return sum;
+}
+
+constexpr double cos(double x)
+{
+    return sin(x + PI / 2.0);
+}
+
+template <typename Format>
+constexpr void writeVertex(float* out, float x, float y, float z, float nx, float ny, float nz, float u, float v)
+{
+    out[0] = x;
+    out[1] = y;
+    if constexpr (Format::positionComponents == 3)
+        out[2] = z;
+    out += Format::positionComponents;
+    if constexpr (Format::normal) {
+        out[0] = nx;
+        out[1] = ny;
+        out[2] = nz;
+        out += 3;
+    }
+    if constexpr (Format::texCoord) {
+        out[0] = u;
+        out[1] = v;
+    }
+}
+
+// two triangles of the quad with these corners, by their texture coordinates (0, 0), (1, 0), (1, 1) and (0, 1),
+// split along the (0, 1) - (1, 0) diagonal; `flip` turns them to the other side
+constexpr unsigned int* writeQuad(unsigned int* out, unsigned int v00, unsigned int v10, unsigned int v11, unsigned int v01, bool flip = false)
+{
+    unsigned int corners[6] = { v01, v00, v10, v01, v10, v11 };
+    for (int i = 0; i < 6; i++) {
+        // flipping swaps the last two corners of each triangle
+        int corner = flip && i % 3 ? i + (i % 3 == 1 ? 1 : -1) : i;
+        out[i] = corners[corner];
+    }
+    return out + 6;
+}
+
+}
+
+// cube of side 2 around the origin, 4 vertices per face so that each has its own normal and texture coordinates
+template <typename Format>
+constexpr Primitive<Format, 24, 36> cube()
+{
+    // face normal and the directions of growing u and v on the face
+    constexpr float faces[6][3][3] = {
+        { {  0.0f,  0.0f, -1.0f }, { 1.0f, 0.0f, 0.0f }, { 0.0f, 1.0f,  0.0f } },  // back
+        { {  0.0f,  0.0f,  1.0f }, { 1.0f, 0.0f, 0.0f }, { 0.0f, 1.0f,  0.0f } },  // front
+        { { -1.0f,  0.0f,  0.0f }, { 0.0f, 1.0f, 0.0f }, { 0.0f, 0.0f, -1.0f } },  // left
+        { {  1.0f,  0.0f,  0.0f }, { 0.0f, 1.0f, 0.0f }, { 0.0f, 0.0f, -1.0f } },  // right
+        { {  0.0f, -1.0f,  0.0f }, { 1.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, -1.0f } },  // bottom
+        { {  0.0f,  1.0f,  0.0f }, { 1.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, -1.0f } }   // top
+    };
+
+    Primitive<Format, 24, 36> mesh{};
+    unsigned int* indices = mesh.indices;
+    for (unsigned int face = 0; face < 6; face++) {
+        const float* n = faces[face][0];
+        const float* a = faces[face][1];
+        const float* b = faces[face][2];
+        for (unsigned int corner = 0; corner < 4; corner++) {
+            float u = (float)(corner & 1), v = (float)(corner >> 1);
+            float s = 2.0f * u - 1.0f, t = 2.0f * v - 1.0f;
+            primitive_detail::writeVertex<Format>(mesh.vertices + (face * 4 + corner) * Format::stride,
+                n[0] + a[0] * s + b[0] * t, n[1] + a[1] * s + b[1] * t, n[2] + a[2] * s + b[2] * t, n[0], n[1], n[2], u, v);
+        }
+
+        // the triangles face out when u x v is the normal
+        float facing = n[0] * (a[1] * b[2] - a[2] * b[1]) + n[1] * (a[2] * b[0] - a[0] * b[2]) + n[2] * (a[0] * b[1] - a[1] * b[0]);
+        unsigned int first = face * 4;
+        indices = primitive_detail::writeQuad(indices, first, first + 1, first + 3, first + 2, facing < 0.0f);
+    }
+    return mesh;
+}
+
+// rectangle in the z = 0 plane facing +z, `flipV` runs v down from the top edge as image rows do
+template <typename Format>
+constexpr Primitive<Format, 4, 6> quad(float left, float bottom, float right, float top, bool flipV = false)
+{
+    Primitive<Format, 4, 6> mesh{};
+    for (unsigned int corner = 0; corner < 4; corner++) {
+        float u = (float)(corner & 1), v = (float)(corner >> 1);
+        primitive_detail::writeVertex<Format>(mesh.vertices + corner * Format::stride, u ? right : left, v ? top : bottom, 0.0f,
+            0.0f, 0.0f, 1.0f, u, flipV ? 1.0f - v : v);
+    }
+    primitive_detail::writeQuad(mesh.indices, 0, 1, 3, 2);
+    return mesh;
+}
+
+// square of side 2 * `halfSize` at `height` facing +y, cut into `Subdivisions` x `Subdivisions` cells; u runs
+// along +x and v along -z, from 0 to `texScale` across the plane
+template <typename Format, unsigned int Subdivisions>
+constexpr Primitive<Format, (Subdivisions + 1) * (Subdivisions + 1), Subdivisions * Subdivisions * 6>
+    plane(float halfSize, float height, float texScale = 1.0f)
+{
+    Primitive<Format, (Subdivisions + 1) * (Subdivisions + 1), Subdivisions * Subdivisions * 6> mesh{};
+    const unsigned int row = Subdivisions + 1;
+    for (unsigned int j = 0; j < row; j++) {
+        for (unsigned int i = 0; i < row; i++) {
+            float s = (float)i / Subdivisions, t = (float)j / Subdivisions;
+            primitive_detail::writeVertex<Format>(mesh.vertices + (j * row + i) * Format::stride,
+                halfSize * (2.0f * s - 1.0f), height, halfSize * (1.0f - 2.0f * t), 0.0f, 1.0f, 0.0f, texScale * s, texScale * t);
+        }
+    }
+
+    unsigned int* indices = mesh.indices;
+    for (unsigned int j = 0; j < Subdivisions; j++)
+        for (unsigned int i = 0; i < Subdivisions; i++)
+            indices = primitive_detail::writeQuad(indices, j * row + i, j * row + i + 1, (j + 1) * row + i + 1, (j + 1) * row + i);
+    return mesh;
+}
+
+// unit sphere of `Segments` slices around y and `Rings` bands from the top; u goes around from +z toward +x and v
+// from the bottom, the seam and the poles repeat their vertices for the texture coordinates
+template <typename Format, unsigned int Segments, unsigned int Rings>
+constexpr Primitive<Format, (Segments + 1) * (Rings + 1), Segments * (Rings - 1) * 6> sphere()
+{
+    static_assert(Segments >= 3 && Rings >= 2, "a sphere takes at least 3 segments and 2 rings");
+
+    Primitive<Format, (Segments + 1) * (Rings + 1), Segments * (Rings - 1) * 6> mesh{};
+    const unsigned int row = Segments + 1;
+    for (unsigned int ring = 0; ring <= Rings; ring++) {
+        double theta = primitive_detail::PI * ring / Rings;
+        double sinTheta = primitive_detail::sin(theta), cosTheta = primitive_detail::cos(theta);
+        for (unsigned int segment = 0; segment <= Segments; segment++) {
+            double phi = 2.0 * primitive_detail::PI * segment / Segments;
+            float x = (float)(sinTheta * primitive_detail::sin(phi));
+            float y = (float)cosTheta;
+            float z = (float)(sinTheta * primitive_detail::cos(phi));
+            primitive_detail::writeVertex<Format>(mesh.vertices + (ring * row + segment) * Format::stride, x, y, z, x, y, z,
+                (float)segment / Segments, 1.0f - (float)ring / Rings);
+        }
+    }
+
+    // the bands next to the poles keep one triangle of each quad, the other one has both pole corners
+    unsigned int* indices = mesh.indices;
+    for (unsigned int ring = 0; ring < Rings; ring++) {
+        for (unsigned int segment = 0; segment < Segments; segment++) {
+            unsigned int top = ring * row + segment, bottom = top + row;
+            if (ring != Rings - 1) {
+                indices[0] = top;
+                indices[1] = bottom;
+                indices[2] = bottom + 1;
+                indices += 3;
+            }
+            if (ring != 0) {
+                indices[0] = top;
+                indices[1] = bottom + 1;
+                indices[2] = top + 1;
+                indices += 3;
+            }
+        }
+    }
+    return mesh;
+}
+
+// copies the primitive into a mesh for the optimizer, the quantizer and the software renderers
+template <typename Format, size_t VertexCount, size_t IndexCount>
+Mesh toMesh(const Primitive<Format, VertexCount, IndexCount>& primitive)
+{
+    Mesh mesh;
+    mesh.vertices.assign(primitive.vertices, primitive.vertices + VertexCount * Format::stride);
+    mesh.indices.assign(primitive.indices, primitive.indices + IndexCount);
+    mesh.stride = Format::stride;
+    return mesh;
+}
+
+#endif
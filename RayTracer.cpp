@@ -0,0 +1,294 @@
+#include "RayTracer.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
+#include <chrono>
+
+static const size_t VERTEX_GRAIN = 256;
+// distance secondary rays start from the surface they leave, against hitting it again
+static const float SURFACE_OFFSET = 1e-3f;
+
+static inline uint32_t packColor(float r, float g, float b, float a)
+{
+    auto channel = [](float value) { return (uint32_t)(std::min(std::max(value, 0.0f), 1.0f) * 255.0f + 0.5f); };
+    return channel(r) | channel(g) << 8 | channel(b) << 16 | channel(a) << 24;
+}
+
+static inline Color4 select(Float4 mask, const Color4& a, const Color4& b)
+{
+    return Color4{ select(mask, a.r, b.r), select(mask, a.g, b.g), select(mask, a.b, b.b), select(mask, a.a, b.a) };
+}
+
+// barycentric weights of the second and third corners where the ray meets the plane of the triangle,
+// outside the triangle as well; false when the ray runs along the plane
+static bool planeBarycentrics(const glm::vec3* corners, const glm::vec3& origin, const glm::vec3& direction, float& u, float& v)
+{
+    glm::vec3 edge1 = corners[1] - corners[0], edge2 = corners[2] - corners[0];
+    glm::vec3 p = glm::cross(direction, edge2);
+    float determinant = glm::dot(edge1, p);
+    if (std::fabs(determinant) < 1e-12f)
+        return false;
+    glm::vec3 s = origin - corners[0];
+    u = glm::dot(s, p) / determinant;
+    v = glm::dot(direction, glm::cross(s, edge1)) / determinant;
+    return true;
+}
+
+RayTracer::RayTracer(ThreadPool& pool)
+    : pool(pool), bvh(pool)
+{
+}
+
+void RayTracer::begin(unsigned int width, unsigned int height, const glm::mat4& view, const glm::mat4& projection,
+    const glm::vec3& clearColor, const SoftwareCubeTexture* background)
+{
+    frameWidth = width;
+    frameHeight = height;
+    this->clearColor = clearColor;
+    this->background = background;
+
+    // in double, the clip positions of add() go back to world ones without visible error
+    clipToWorld = glm::inverse(glm::dmat4(projection) * glm::dmat4(view));
+    glm::mat4 cameraToWorld = glm::inverse(view);
+    cameraPosition = glm::vec3(cameraToWorld[3]);
+    forward = -glm::normalize(glm::vec3(cameraToWorld[2]));
+    nearPlane = projection[3][2] / (projection[2][2] - 1.0f);
+    farPlane = projection[3][2] / (projection[2][2] + 1.0f);
+
+    // points of the far plane are affine in the pixel coordinates
+    auto farPoint = [this](double x, double y) {
+        glm::dvec4 point = clipToWorld * glm::dvec4(x, y, 1.0, 1.0);
+        return glm::vec3(glm::dvec3(point) / point.w) - cameraPosition;
+    };
+    farCorner = farPoint(-1.0, 1.0);
+    farStepX = (farPoint(1.0, 1.0) - farCorner) / (float)std::max(width, 1u);
+    farStepY = (farPoint(-1.0, -1.0) - farCorner) / (float)std::max(height, 1u);
+
+    objects.clear();
+    vertexVaryings.clear();
+    vertexPositions.clear();
+    trianglePositions.clear();
+    triangleInfos.clear();
+    colorBuffer.assign((size_t)width * height, packColor(clearColor.r, clearColor.g, clearColor.b, 1.0f));
+}
+
+void RayTracer::add(const Mesh& mesh, const SoftwareProgram& program, TracedMaterial material, unsigned int instances)
+{
+    size_t vertexCount = mesh.vertexCount();
+    size_t trianglesNum = mesh.indices.size() / 3;
+    if (vertexCount == 0 || trianglesNum == 0 || instances == 0)
+        return;
+
+    uint32_t objectIndex = (uint32_t)objects.size();
+    objects.push_back(Object{ &program, material });
+
+    // vertex stage, every vertex of every instance once
+    size_t firstVertex = vertexPositions.size();
+    size_t shadedNum = vertexCount * instances;
+    vertexPositions.resize(firstVertex + shadedNum);
+    vertexVaryings.resize(vertexPositions.size() * MAX_VARYINGS, 0.0f);
+    pool.parallelFor(shadedNum, VERTEX_GRAIN, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            unsigned int instance = (unsigned int)(i / vertexCount);
+            float* varyings = &vertexVaryings[(firstVertex + i) * MAX_VARYINGS];
+            glm::dvec4 clip = glm::dvec4(program.shadeVertex(&mesh.vertices[(i % vertexCount) * mesh.stride], instance, varyings));
+            glm::dvec4 world = clipToWorld * clip;
+            vertexPositions[firstVertex + i] = glm::vec3(glm::dvec3(world) / world.w);
+        }
+    });
+
+    for (unsigned int instance = 0; instance < instances; instance++) {
+        size_t instanceBase = firstVertex + (size_t)instance * vertexCount;
+        for (size_t i = 0; i < trianglesNum; i++) {
+            TriangleInfo info{ objectIndex, {} };
+            for (int k = 0; k < 3; k++) {
+                info.vertices[k] = (uint32_t)(instanceBase + mesh.indices[i * 3 + k]);
+                trianglePositions.push_back(vertexPositions[info.vertices[k]]);
+            }
+            triangleInfos.push_back(info);
+        }
+    }
+}
+
+TraceStats RayTracer::finish()
+{
+    TraceStats stats;
+    auto buildStart = std::chrono::steady_clock::now();
+    bvh.build(trianglePositions);
+    stats.buildMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - buildStart).count();
+    stats.triangles = bvh.trianglesNum();
+    stats.bvhNodes = bvh.nodesNum();
+
+    // tiles are claimed one at a time, the expensive ones (mirrors, windows) do not hold the others up
+    unsigned int tilesX = (frameWidth + TRACE_TILE_SIZE - 1) / TRACE_TILE_SIZE;
+    unsigned int tilesY = (frameHeight + TRACE_TILE_SIZE - 1) / TRACE_TILE_SIZE;
+    std::atomic<size_t> primaryRays{ 0 }, secondaryRays{ 0 };
+    pool.parallelFor((size_t)tilesX * tilesY, 1, [&](size_t begin, size_t end) {
+        RayCounts counts;
+        for (size_t tile = begin; tile < end; tile++)
+            renderTile((unsigned int)tile, counts);
+        primaryRays += counts.primary;
+        secondaryRays += counts.secondary;
+    });
+    stats.primaryRays = primaryRays;
+    stats.secondaryRays = secondaryRays;
+    return stats;
+}
+
+void RayTracer::renderTile(unsigned int tile, RayCounts& counts)
+{
+    unsigned int tilesX = (frameWidth + TRACE_TILE_SIZE - 1) / TRACE_TILE_SIZE;
+    unsigned int minX = tile % tilesX * TRACE_TILE_SIZE, minY = tile / tilesX * TRACE_TILE_SIZE;
+    unsigned int maxX = std::min(minX + TRACE_TILE_SIZE, frameWidth), maxY = std::min(minY + TRACE_TILE_SIZE, frameHeight);
+
+    for (unsigned int y = minY; y < maxY; y += 2) {
+        for (unsigned int x = minX; x < maxX; x += 2) {
+            // lanes past the edge of the frame are traced too, as helpers of the others
+            Packet packet;
+            packet.x = Float4(0.5f, 1.5f, 0.5f, 1.5f) + Float4((float)x);
+            packet.y = Float4(0.5f, 0.5f, 1.5f, 1.5f) + Float4((float)y);
+            for (int i = 0; i < 4; i++) {
+                glm::vec3 direction = glm::normalize(farCorner + farStepX * packet.x[i] + farStepY * packet.y[i]);
+                float depthRate = glm::dot(direction, forward);
+                packet.origins[i] = cameraPosition;
+                packet.directions[i] = direction;
+                packet.tMin[i] = nearPlane / depthRate;
+                packet.tMax[i] = farPlane / depthRate;
+            }
+
+            Color4 color = trace(packet, 0xF, 0, counts);
+            float r[4], g[4], b[4];
+            color.r.store(r);
+            color.g.store(g);
+            color.b.store(b);
+            for (int i = 0; i < 4; i++) {
+                unsigned int pixelX = x + (i & 1), pixelY = y + (i >> 1);
+                if (pixelX < maxX && pixelY < maxY)
+                    colorBuffer[(size_t)pixelY * frameWidth + pixelX] = packColor(r[i], g[i], b[i], 1.0f);
+            }
+        }
+    }
+}
+
+Color4 RayTracer::trace(const Packet& packet, int lanes, unsigned int depth, RayCounts& counts) const
+{
+    BvhHit hits[4];
+    int hitLanes = 0;
+    for (int i = 0; i < 4; i++) {
+        if (!(lanes >> i & 1))
+            continue;
+        (depth == 0 ? counts.primary : counts.secondary)++;
+        if (bvh.intersect(packet.origins[i], packet.directions[i], packet.tMin[i], packet.tMax[i], hits[i]))
+            hitLanes |= 1 << i;
+    }
+
+    Color4 result = (lanes & ~hitLanes) ? missColor(packet) : Color4{ 0.0f, 0.0f, 0.0f, 1.0f };
+    // lanes are shaded triangle by triangle as on the GPU, lanes on other triangles (of other instances above all)
+    // would spoil the derivatives
+    int remaining = hitLanes;
+    while (remaining) {
+        int first = 0;
+        while (!(remaining >> first & 1))
+            first++;
+        int group = 0;
+        for (int i = first; i < 4; i++)
+            if ((remaining >> i & 1) && hits[i].triangle == hits[first].triangle)
+                group |= 1 << i;
+        remaining &= ~group;
+        result = select(Float4::laneMask(group), shadeHits(packet, hits, first, group, depth, counts), result);
+    }
+    return result;
+}
+
+Color4 RayTracer::shadeHits(const Packet& packet, const BvhHit hits[4], int first, int group, unsigned int depth, RayCounts& counts) const
+{
+    const TriangleInfo& reference = triangleInfos[hits[first].triangle];
+    const Object& object = objects[reference.object];
+
+    if (object.material == TracedMaterial::MIRROR) {
+        Packet reflected = packet;
+        for (int i = 0; i < 4; i++) {
+            if (!(group >> i & 1))
+                continue;
+            const glm::vec3* corners = &trianglePositions[(size_t)hits[i].triangle * 3];
+            glm::vec3 normal = glm::normalize(glm::cross(corners[1] - corners[0], corners[2] - corners[0]));
+            reflected.origins[i] = packet.origins[i] + packet.directions[i] * hits[i].t;
+            reflected.directions[i] = glm::reflect(packet.directions[i], normal);
+            reflected.tMin[i] = SURFACE_OFFSET;
+            reflected.tMax[i] = FLT_MAX;
+        }
+        return depth < MAX_TRACE_DEPTH ? trace(reflected, group, depth + 1, counts) : missColor(reflected);
+    }
+
+    // varyings at the hits, lanes of other objects take the plane of the first lane's triangle as helpers
+    FragmentQuad quad;
+    quad.x = packet.x;
+    quad.y = packet.y;
+    quad.depth = Float4(0.0f);
+    float lanes[MAX_VARYINGS][4];
+    const glm::vec3* referenceCorners = &trianglePositions[(size_t)hits[first].triangle * 3];
+    for (int i = 0; i < 4; i++) {
+        const TriangleInfo* info = &reference;
+        float u = hits[first].u, v = hits[first].v;
+        if (group >> i & 1) {
+            info = &triangleInfos[hits[i].triangle];
+            u = hits[i].u;
+            v = hits[i].v;
+        }
+        else {
+            planeBarycentrics(referenceCorners, packet.origins[i], packet.directions[i], u, v);
+        }
+        const float* a = &vertexVaryings[(size_t)info->vertices[0] * MAX_VARYINGS];
+        const float* b = &vertexVaryings[(size_t)info->vertices[1] * MAX_VARYINGS];
+        const float* c = &vertexVaryings[(size_t)info->vertices[2] * MAX_VARYINGS];
+        for (unsigned int k = 0; k < MAX_VARYINGS; k++)
+            lanes[k][i] = a[k] + u * (b[k] - a[k]) + v * (c[k] - a[k]);
+    }
+    unsigned int varyingsNum = std::min(object.program->varyingsNum(), MAX_VARYINGS);
+    for (unsigned int k = 0; k < varyingsNum; k++)
+        quad.varyings[k] = Float4::load(lanes[k]);
+
+    Float4 mask = Float4::laneMask(group);
+    Color4 color = object.program->shadeFragments(quad, mask);
+    int kept = laneBits(mask) & group;
+    int through = (group & ~kept) | (object.material == TracedMaterial::BLENDED ? kept : 0);
+    if (through == 0)
+        return color;
+
+    // on behind the surface, from just past the hit
+    Packet behind = packet;
+    for (int i = 0; i < 4; i++)
+        if (through >> i & 1)
+            behind.tMin[i] = hits[i].t + SURFACE_OFFSET;
+    Color4 back = depth < MAX_TRACE_DEPTH ? trace(behind, through, depth + 1, counts) : missColor(behind);
+    if (object.material == TracedMaterial::BLENDED)
+        color = Color4{ mix(back.r, color.r, color.a), mix(back.g, color.g, color.a), mix(back.b, color.b, color.a), Float4(1.0f) };
+    return select(Float4::laneMask(kept), color, back);
+}
+
+Color4 RayTracer::missColor(const Packet& packet) const
+{
+    if (!background)
+        return Color4{ clearColor.r, clearColor.g, clearColor.b, 1.0f };
+    const glm::vec3* d = packet.directions;
+    Color4 color = background->sample(Vec3x4(Float4(d[0].x, d[1].x, d[2].x, d[3].x), Float4(d[0].y, d[1].y, d[2].y, d[3].y), Float4(d[0].z, d[1].z, d[2].z, d[3].z)));
+    color.a = Float4(1.0f);
+    return color;
+}
+
+void RayTracer::readRGB(std::vector<unsigned char>& pixels) const
+{
+    pixels.resize(colorBuffer.size() * 3);
+    unsigned char* out = pixels.data();
+    for (uint32_t color : colorBuffer) {
+        *out++ = (unsigned char)color;
+        *out++ = (unsigned char)(color >> 8);
+        *out++ = (unsigned char)(color >> 16);
+    }
+}
+
+void RayTracer::readRGBA(std::vector<uint32_t>& pixels) const
+{
+    pixels = colorBuffer;
+}
@@ -0,0 +1,127 @@
+#ifndef RAY_TRACER_H
+#define RAY_TRACER_H
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "Bvh.h"
+#include "MeshOptimizer.h"
+#include "SoftwareRasterizer.h"
+#include "SoftwareTexture.h"
+#include "ThreadPool.h"
+
+// square screen tiles, a tile is rendered by one task
+const unsigned int TRACE_TILE_SIZE = 16;
+// mirror bounces and surfaces a ray passes through (blended or discarded) before it takes the background
+const unsigned int MAX_TRACE_DEPTH = 8;
+
+// how the surfaces of a traced object treat the rays hitting them
+enum class TracedMaterial {
+    OPAQUE,     // shaded by the program, rays go on through the fragments it discards
+    BLENDED,    // shaded and laid over what the ray meets behind by alpha, as GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA
+    MIRROR      // rays are reflected about the face, the program is not run
+};
+
+struct TraceStats
+{
+    size_t triangles = 0;
+    size_t bvhNodes = 0;
+    size_t primaryRays = 0;     // four per 2x2 pixel quad
+    size_t secondaryRays = 0;   // off mirrors and behind blended or discarded fragments
+    float buildMs = 0.0f;
+};
+
+// Ray tracer of the scenes SoftwareRasterizer draws, taking the same meshes and programs. add() runs the vertex
+// stage once per vertex and takes the world positions back from the clip ones; finish() builds a BVH of all the
+// triangles and renders the screen tiles in parallel. Rays go in packets of 2x2 pixels: the lanes hitting one
+// triangle are shaded together by the program of its object with the varyings interpolated at the hits, the other
+// lanes are extrapolated on the same triangle like the helper pixels of a quad, so texture LOD is taken as the
+// rasterizer takes it. The lighting is that of the programs, without shadows, so the images compare with the rasterized ones.
+class RayTracer
+{
+public:
+
+    explicit RayTracer(ThreadPool& pool = ThreadPool::shared());
+
+    // starts a frame seen through `view` and `projection`, whose near and far planes limit the primary rays as
+    // clipping does; rays that miss take `background` in their direction when it is set and `clearColor` otherwise
+    void begin(unsigned int width, unsigned int height, const glm::mat4& view, const glm::mat4& projection,
+        const glm::vec3& clearColor, const SoftwareCubeTexture* background = nullptr);
+
+    // adds the triangles of `mesh`, `instances` times; the program must stay alive until finish()
+    void add(const Mesh& mesh, const SoftwareProgram& program, TracedMaterial material = TracedMaterial::OPAQUE, unsigned int instances = 1);
+
+    // builds the BVH and renders the frame
+    TraceStats finish();
+
+    unsigned int width() const { return frameWidth; }
+    unsigned int height() const { return frameHeight; }
+
+    // the finished frame, rows from the top
+    void readRGB(std::vector<unsigned char>& pixels) const;
+    void readRGBA(std::vector<uint32_t>& pixels) const;
+
+private:
+
+    struct Object
+    {
+        const SoftwareProgram* program;
+        TracedMaterial material;
+    };
+
+    struct TriangleInfo
+    {
+        uint32_t object;
+        uint32_t vertices[3];   // shaded vertices, their varyings are at vertexVaryings[vertex * MAX_VARYINGS]
+    };
+
+    // rays of the four lanes, each with its own range of distances
+    struct Packet
+    {
+        Float4 x, y;            // pixel centres of the primary rays
+        glm::vec3 origins[4];
+        glm::vec3 directions[4];
+        float tMin[4];
+        float tMax[4];
+    };
+
+    struct RayCounts
+    {
+        size_t primary = 0;
+        size_t secondary = 0;
+    };
+
+    ThreadPool& pool;
+    Bvh bvh;
+
+    unsigned int frameWidth = 0;
+    unsigned int frameHeight = 0;
+    glm::dmat4 clipToWorld = glm::dmat4(1.0);
+    glm::vec3 cameraPosition = glm::vec3(0.0f);
+    glm::vec3 forward = glm::vec3(0.0f, 0.0f, -1.0f);
+    glm::vec3 farCorner = glm::vec3(0.0f);      // directions to the far plane at the top left pixel corner
+    glm::vec3 farStepX = glm::vec3(0.0f);       // and across one pixel
+    glm::vec3 farStepY = glm::vec3(0.0f);
+    float nearPlane = 0.1f;
+    float farPlane = 100.0f;
+    glm::vec3 clearColor = glm::vec3(0.0f);
+    const SoftwareCubeTexture* background = nullptr;
+
+    std::vector<Object> objects;
+    std::vector<float> vertexVaryings;
+    std::vector<glm::vec3> vertexPositions;
+    std::vector<glm::vec3> trianglePositions;
+    std::vector<TriangleInfo> triangleInfos;
+    std::vector<uint32_t> colorBuffer;
+
+    void renderTile(unsigned int tile, RayCounts& counts);
+    Color4 trace(const Packet& packet, int lanes, unsigned int depth, RayCounts& counts) const;
+    Color4 shadeHits(const Packet& packet, const BvhHit hits[4], int first, int group, unsigned int depth, RayCounts& counts) const;
+    Color4 missColor(const Packet& packet) const;
+
+};
+
+#endif
@@ -0,0 +1,161 @@
+#include "RenderQueue.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <utility>
+
+#include "GLStateCache.h"
+
+const int RADIX_BITS = 8;
+const uint32_t RADIX_SIZE = 1u << RADIX_BITS;
+
+const int PASS_SHIFT = 60;
+const int LAYER_SHIFT = 56;
+const uint64_t DEPTH_MASK = 0xFFFFFF;
+
+// Non-negative floats compare like their bit patterns, the top 24 bits keep the exponent and 15 bits of mantissa
+static inline uint64_t depthKey(float depth)
+{
+    if (!(depth > 0.0f))
+        return 0;
+    uint32_t bits;
+    memcpy(&bits, &depth, sizeof(bits));
+    return bits >> 8;
+}
+
+DrawPacket::DrawPacket(Shader& shader, GeometryHandle mesh, GLsizei instances)
+    : shader(&shader), mesh(mesh), instances(instances)
+{
+}
+
+DrawPacket::DrawPacket(Shader& shader, const IndirectDrawBuffer& indirect, DrawSubmission submission)
+    : shader(&shader), indirect(&indirect), submission(submission)
+{
+}
+
+void DrawPacket::addTexture(GLenum target, GLuint texture)
+{
+    if (textureCount == PACKET_TEXTURES) {
+        std::cerr << "ERROR: a draw packet holds at most " << PACKET_TEXTURES << " textures" << std::endl;
+        return;
+    }
+    textureTargets[textureCount] = target;
+    textures[textureCount] = texture;
+    textureCount++;
+}
+
+RenderQueue::RenderQueue(const GeometryBuffer& geometry, const UniformBuffers& uniformBuffers)
+    : geometry(geometry), uniformBuffers(uniformBuffers)
+{
+}
+
+void RenderQueue::clear()
+{
+    packets.clear();
+    keys.clear();
+    order.clear();
+}
+
+void RenderQueue::submit(RenderPass pass, RenderLayer layer, const DrawPacket& packet, float depth)
+{
+    uint64_t program = packet.shader->ID & 0xFFFF;
+    uint64_t texture = packet.textureCount > 0 ? packet.textures[0] & 0xFFFF : 0;
+    uint64_t key = ((uint64_t)pass << PASS_SHIFT) | ((uint64_t)layer << LAYER_SHIFT);
+    if (layer == RenderLayer::TRANSLUCENT)
+        key |= ((DEPTH_MASK - depthKey(depth)) << 32) | (program << 16) | texture;
+    else
+        key |= (program << 40) | (texture << 24) | depthKey(depth);
+
+    keys.push_back(key);
+    order.push_back((uint32_t)packets.size());
+    packets.push_back(packet);
+}
+
+void RenderQueue::sort()
+{
+    size_t n = keys.size();
+    tempKeys.resize(n);
+    tempOrder.resize(n);
+
+    uint64_t* srcKeys = keys.data();
+    uint64_t* dstKeys = tempKeys.data();
+    uint32_t* srcOrder = order.data();
+    uint32_t* dstOrder = tempOrder.data();
+
+    uint32_t histogram[RADIX_SIZE];
+    for (int shift = 0; shift < 64; shift += RADIX_BITS) {
+        std::fill(histogram, histogram + RADIX_SIZE, 0);
+        for (size_t i = 0; i < n; i++)
+            histogram[(srcKeys[i] >> shift) & (RADIX_SIZE - 1)]++;
+        // most digits are the same in every key (few passes, programs and textures)
+        if (n == 0 || histogram[(srcKeys[0] >> shift) & (RADIX_SIZE - 1)] == n)
+            continue;
+
+        uint32_t offset = 0;
+        for (uint32_t& bucket : histogram) {
+            uint32_t size = bucket;
+            bucket = offset;
+            offset += size;
+        }
+        for (size_t i = 0; i < n; i++) {
+            uint32_t position = histogram[(srcKeys[i] >> shift) & (RADIX_SIZE - 1)]++;
+            dstKeys[position] = srcKeys[i];
+            dstOrder[position] = srcOrder[i];
+        }
+        std::swap(srcKeys, dstKeys);
+        std::swap(srcOrder, dstOrder);
+    }
+
+    if (srcKeys != keys.data()) {
+        keys.swap(tempKeys);
+        order.swap(tempOrder);
+    }
+}
+
+void RenderQueue::range(RenderPass pass, RenderLayer layer, size_t& begin, size_t& end) const
+{
+    uint64_t first = ((uint64_t)pass << PASS_SHIFT) | ((uint64_t)layer << LAYER_SHIFT);
+    uint64_t last = first | ((1ull << LAYER_SHIFT) - 1);
+    begin = std::lower_bound(keys.begin(), keys.end(), first) - keys.begin();
+    end = std::upper_bound(keys.begin() + begin, keys.end(), last) - keys.begin();
+}
+
+size_t RenderQueue::count(RenderPass pass, RenderLayer layer) const
+{
+    size_t begin, end;
+    range(pass, layer, begin, end);
+    return end - begin;
+}
+
+void RenderQueue::execute(RenderPass pass, RenderLayer layer) const
+{
+    size_t begin, end;
+    range(pass, layer, begin, end);
+    if (begin == end)
+        return;
+
+    // programs and textures are rebound by every packet, the state cache drops what the previous one left bound
+    GLStateCache& state = GLStateCache::shared();
+    unsigned int object = NO_OBJECT;
+    for (size_t i = begin; i < end; i++) {
+        const DrawPacket& packet = packets[order[i]];
+        packet.shader->use();
+        for (unsigned int unit = 0; unit < packet.textureCount; unit++)
+            state.bindTexture(unit, packet.textureTargets[unit], packet.textures[unit]);
+        if (packet.object != NO_OBJECT && packet.object != object) {
+            uniformBuffers.bindObject(packet.object);
+            object = packet.object;
+        }
+
+        if (packet.indirect) {
+            if (packet.submission == DrawSubmission::MULTI_DRAW)
+                packet.indirect->draw();
+            else
+                packet.indirect->drawSeparately(*packet.shader);
+        }
+        else
+            geometry.draw(packet.mesh, packet.instances);
+    }
+    state.activeTexture(GL_TEXTURE0);
+}
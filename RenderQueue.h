@@ -0,0 +1,82 @@
+#ifndef RENDER_QUEUE_H
+#define RENDER_QUEUE_H
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "GeometryBuffer.h"
+#include "IndirectDrawBuffer.h"
+#include "Shader.h"
+#include "UniformBuffers.h"
+
+// target the draws go to, passes are separated by framebuffer changes made outside the queue
+enum class RenderPass : unsigned int { SCENE, POSTPROCESS };
+
+// order of the draws within a pass: opaque objects, the sky behind them, then blended ones back to front
+enum class RenderLayer : unsigned int { SOLID, SKY, TRANSLUCENT };
+
+// object slot of a draw without object uniforms
+const unsigned int NO_OBJECT = 0xFFFFFFFF;
+
+// textures of a packet, bound to units 0, 1, ...
+const unsigned int PACKET_TEXTURES = 3;
+
+// everything a draw needs besides the state set for its layer
+struct DrawPacket
+{
+    Shader* shader;
+    GeometryHandle mesh = 0;
+    GLsizei instances = 1;
+    unsigned int object = NO_OBJECT;                // slot in UniformBuffers
+    const IndirectDrawBuffer* indirect = nullptr;   // draws all of its objects instead of `mesh`
+    DrawSubmission submission = DrawSubmission::MULTI_DRAW;
+    unsigned int textureCount = 0;
+    GLenum textureTargets[PACKET_TEXTURES];
+    GLuint textures[PACKET_TEXTURES];
+
+    DrawPacket(Shader& shader, GeometryHandle mesh, GLsizei instances = 1);
+    DrawPacket(Shader& shader, const IndirectDrawBuffer& indirect, DrawSubmission submission);
+
+    void addTexture(GLenum target, GLuint texture);
+};
+
+// Draws of a frame collected in any order and executed sorted by a 64-bit key:
+//   pass (4 bits) | layer (4) | program (16) | first texture (16) | depth (24), nearest first
+// so that draws sharing a program and textures follow each other and the state cache drops the repeated binds.
+// Translucent draws need their depth order first, their key is pass | layer | depth (24), farthest first | program | texture.
+// Programs and textures enter the key by the low 16 bits of their names; names sharing them only cost extra binds.
+// The keys are sorted once per frame with an LSD radix sort, which keeps the submission order of equal keys.
+class RenderQueue
+{
+public:
+
+    RenderQueue(const GeometryBuffer& geometry, const UniformBuffers& uniformBuffers);
+
+    void clear();
+    // `depth` is the view space depth of the draw, it orders draws of the same program and textures
+    void submit(RenderPass pass, RenderLayer layer, const DrawPacket& packet, float depth = 0.0f);
+    void sort();
+
+    // number of sorted draws of the layer
+    size_t count(RenderPass pass, RenderLayer layer) const;
+    // draws the layer, the blend and depth state of the layer and the framebuffer of the pass are set by the caller
+    void execute(RenderPass pass, RenderLayer layer) const;
+
+private:
+
+    const GeometryBuffer& geometry;
+    const UniformBuffers& uniformBuffers;
+
+    std::vector<DrawPacket> packets;
+    std::vector<uint64_t> keys;
+    std::vector<uint32_t> order;
+    std::vector<uint64_t> tempKeys;
+    std::vector<uint32_t> tempOrder;
+
+    // range of the sorted draws of the layer
+    void range(RenderPass pass, RenderLayer layer, size_t& begin, size_t& end) const;
+
+};
+#endif
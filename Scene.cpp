@@ -0,0 +1,91 @@
+#include "Scene.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <utility>
+
+#include "Primitives.h"
+#include "TangentGenerator.h"
+
+const float boxShininess[boxesNum] = { 25.0f, 10.0f, 20.0f, 15.0f, 10.0f };
+
+const glm::vec3 windowPositions[windowsNum]
+{
+    glm::vec3(0.0f, 4.0f, -6.0f),
+    glm::vec3(-0.6f, 4.0f, -7.1f),
+    glm::vec3(1.5f, 4.0f, -6.5f),
+    glm::vec3(-1.3f, 4.0f, -8.7f),
+    glm::vec3(0.85f, 4.0f, -7.4f),
+    glm::vec3(-0.2f, 4.0f, -8.2f)
+};
+
+// positions, rotation axes and speeds and scales of the boxes
+static const glm::vec3 boxPositions[boxesNum] = {
+    glm::vec3(0.0f,  1.2f,  0.0f),
+    glm::vec3(-3.2f,  5.5f, 4.3f),
+    glm::vec3(6.1f, 2.7f, 2.4f),
+    glm::vec3(7.6f, 3.9f, -5.8f),
+    glm::vec3(-5.9f, 4.4f, -3.3f)
+};
+static const glm::vec3 boxAxes[boxesNum] = {
+    glm::vec3(0.0f, 1.0f, 0.0f),
+    glm::vec3(3.4f, 1.1f, 2.8f),
+    glm::vec3(-4.1f, 2.5f, -1.7f),
+    glm::vec3(-2.0f, 1.5f, 4.5f),
+    glm::vec3(1.4f, 3.3f, -3.6f)
+};
+static const float boxSpeeds[boxesNum] = { 0.25f, 0.5f, 0.75f, 1.25f, 1.0f };
+static const float boxScales[boxesNum] = { 1.25f, 0.5f, 0.75f, 1.1f, 0.9f };
+
+static const glm::vec3 wallPosition(-7.0f, 5.0f, 2.0f);
+
+// the meshes of the scene, generated at compile time
+
+static constexpr auto groundPrimitive = plane<PositionNormalTexVertex, 1>(10.0f, -0.5f, 10.0f);
+// boxes, the mirror cube, the light and the skybox, each draw takes the attributes it needs
+static constexpr auto cubePrimitive = cube<PositionNormalTexVertex>();
+// windows are placed by their left edge, their images are upright with rows from the top
+static constexpr auto windowPrimitive = quad<VertexFormat<3, false, true>>(0.0f, -0.5f, 1.0f, 0.5f, true);
+static constexpr auto wallPrimitive = quad<PositionNormalTexVertex>(-1.0f, -1.0f, 1.0f, 1.0f);
+static constexpr auto screenPrimitive = quad<VertexFormat<2, false, true>>(-1.0f, -1.0f, 1.0f, 1.0f);
+
+SceneMeshes buildSceneMeshes()
+{
+    // triangles are reordered for the vertex cache and overdraw, the wall gets the tangent frames of its normal map first
+    SceneMeshes meshes;
+    meshes.ground = optimizeMesh("ground", toMesh(groundPrimitive));
+    meshes.cube = optimizeMesh("cube", toMesh(cubePrimitive));
+    meshes.window = optimizeMesh("window", toMesh(windowPrimitive));
+    Mesh wall = toMesh(wallPrimitive);
+    std::vector<glm::vec4> wallTangents;
+    generateTangents(wall, TangentLayout(), wallTangents);
+    appendTangentFrames(wall, TangentLayout(), wallTangents);
+    meshes.wall = optimizeMesh("wall", std::move(wall));
+    meshes.screen = optimizeMesh("screen", toMesh(screenPrimitive), 2);
+    return meshes;
+}
+
+SceneTransforms animateScene(float time)
+{
+    SceneTransforms transforms;
+    for (unsigned int i = 0; i < boxesNum; i++) {
+        transforms.boxes[i] = glm::translate(glm::mat4(1.0f), boxPositions[i]);
+        transforms.boxes[i] = glm::rotate(transforms.boxes[i], boxSpeeds[i] * time, boxAxes[i]);
+        transforms.boxes[i] = glm::scale(transforms.boxes[i], glm::vec3(boxScales[i]));
+    }
+
+    transforms.wall = glm::mat4(1.0f);
+    transforms.wall = glm::translate(transforms.wall, wallPosition);
+    transforms.wall = glm::rotate(transforms.wall, -0.1f * time, glm::vec3(3.0f, 1.0f, 2.0f));
+    transforms.wall = glm::scale(transforms.wall, glm::vec3(2.5f));
+
+    transforms.light = glm::mat4(1.0f);
+    transforms.light = glm::translate(transforms.light, lightPosition);
+    transforms.light = glm::scale(transforms.light, glm::vec3(0.1f));
+
+    transforms.reflect = glm::mat4(1.0f);
+    transforms.reflect = glm::translate(transforms.reflect, glm::vec3(0.0f, 1.2f, 0.0f));
+    transforms.reflect = glm::rotate(transforms.reflect, 0.1f * time, glm::vec3(0.0f, 1.0f, 0.0f));
+    transforms.reflect = glm::scale(transforms.reflect, glm::vec3(1.25));
+    return transforms;
+}
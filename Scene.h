@@ -0,0 +1,61 @@
+#ifndef SCENE_H
+#define SCENE_H
+
+#include <glm/glm.hpp>
+
+#include <string>
+#include <vector>
+
+#include "MeshOptimizer.h"
+#include "SceneTextures.h"
+
+// Contents of the demo scene: meshes, placement and animation of the objects, their materials, the light, the fog
+// and the texture files. The OpenGL renderer of main.cpp and the software one (SoftwareRenderer.h) draw it alike.
+
+const unsigned int boxesNum = 5;
+const unsigned int windowsNum = 6;
+
+const glm::vec3 lightPosition(0.0f, 10.0f, 0.0f);
+const glm::vec3 LIGHT_COLOR(1.0f, 1.0f, 1.0f);
+const glm::vec3 CLEAR_COLOR(0.1f, 0.1f, 0.1f);
+const glm::vec3 FOG_COLOR(0.1f, 0.1f, 0.1f);
+const float FOG_DENSITY = 0.1f;
+const float FOG_GRADIENT = 0.9f;
+
+const float GROUND_SHININESS = 2.0f;
+const float WALL_SHININESS = 15.0f;
+const float bumpScale = 0.1f;
+extern const float boxShininess[boxesNum];
+
+// windows are billboards of 1.25 x 1.25 units facing the camera, placed by their left edge
+extern const glm::vec3 windowPositions[windowsNum];
+
+// optimized meshes (see optimizeMesh), their vertices are
+//   ground, cube: position, normal, texture coordinates
+//   window: position, texture coordinates
+//   wall: position, normal, texture coordinates, tangent, bitangent
+//   screen: 2D position, texture coordinates
+// the cube is shared by the boxes, the mirror cube (position and normal) and the light and the skybox (position)
+struct SceneMeshes
+{
+    Mesh ground;
+    Mesh cube;
+    Mesh window;
+    Mesh wall;
+    Mesh screen;
+};
+
+SceneMeshes buildSceneMeshes();
+
+// model transforms of the moving objects `time` seconds into the animation
+struct SceneTransforms
+{
+    glm::mat4 boxes[boxesNum];
+    glm::mat4 wall;
+    glm::mat4 light;
+    glm::mat4 reflect;  // mirror cube
+};
+
+SceneTransforms animateScene(float time);
+
+#endif
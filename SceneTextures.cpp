@@ -0,0 +1,35 @@
+#include "SceneTextures.h"
+
+SceneTextures::SceneTextures()
+    : ground("textures/Cement.jpg"),
+    boxes{ "textures/granite.jpg", "textures/bricks.jpg", "textures/stone.jpg", "textures/wood.png", "textures/yellowstone.jpg" },
+    window("textures/window.png"),
+    wallDiffuse("textures/wall_diffuse.jpg"),
+    wallNormal("textures/wall_normal.jpg"),
+    wallBump("textures/wall_bump.jpg"),
+    skyboxFaces{
+        "textures/posx.jpg", "textures/negx.jpg",
+        "textures/posy.jpg", "textures/negy.jpg",
+        "textures/posz.jpg", "textures/negz.jpg"
+    }
+{
+    colorMips.srgb = true;
+    windowMips = colorMips;
+    windowMips.alphaCoverage = 0.5f;
+    normalMips.normalMap = true;
+}
+
+std::vector<SceneTextureEntry> SceneTextures::cacheEntries() const
+{
+    std::vector<SceneTextureEntry> entries;
+    entries.push_back({ ground, colorMips, colorFormat, true });
+    for (const std::string& box : boxes)
+        entries.push_back({ box, colorMips, colorFormat, true });
+    entries.push_back({ window, windowMips, windowFormat, true });
+    entries.push_back({ wallDiffuse, colorMips, colorFormat, true });
+    entries.push_back({ wallNormal, normalMips, normalFormat, true });
+    entries.push_back({ wallBump, bumpMips, bumpFormat, true });
+    for (const std::string& face : skyboxFaces)
+        entries.push_back({ face, MipSettings(), skyboxFormat, false });
+    return entries;
+}
@@ -0,0 +1,46 @@
+#ifndef SCENE_TEXTURES_H
+#define SCENE_TEXTURES_H
+
+#include <string>
+#include <vector>
+
+#include "MipmapGenerator.h"
+
+// an image as the texture cache keeps it for the OpenGL renderer
+struct SceneTextureEntry
+{
+    std::string file;
+    MipSettings settings;
+    BlockFormat format;
+    bool mipmaps;
+};
+
+// texture files of the objects, the mip settings they are filtered with and the block formats they are uploaded in
+struct SceneTextures
+{
+    std::string ground;
+    std::vector<std::string> boxes;         // layers of one array, box i uses layer i % boxes.size()
+    std::string window;
+    std::string wallDiffuse;
+    std::string wallNormal;
+    std::string wallBump;
+    std::vector<std::string> skyboxFaces;   // +X, -X, +Y, -Y, +Z, -Z
+
+    MipSettings colorMips;
+    MipSettings windowMips;
+    MipSettings normalMips;
+    MipSettings bumpMips;
+
+    BlockFormat colorFormat = BlockFormat::BC1;
+    BlockFormat windowFormat = BlockFormat::BC3;
+    BlockFormat normalFormat = BlockFormat::BC5;
+    BlockFormat bumpFormat = BlockFormat::NONE;
+    BlockFormat skyboxFormat = BlockFormat::BC1;   // faces without mipmaps and with the default settings
+
+    SceneTextures();
+
+    // every cache entry the OpenGL renderer loads, TextureCook --scene cooks these
+    std::vector<SceneTextureEntry> cacheEntries() const;
+};
+
+#endif
@@ -1,140 +1,333 @@
 #include "Shader.h"
+#include "GLExtensions.h"
+#include "GLStateCache.h"
 
-Shader::Shader(const char* vertPath, const char* fragPath, const char* geomPath)
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <unordered_set>
+
+// reads a shader file and replaces every #include "file" line (the path is relative to the including file)
+// with the contents of that file, each file is included only once
+static std::string readSource(const std::string& path, std::unordered_set<std::string>& included)
 {
-    std::string vertCode, fragCode, geomCode;
-    std::ifstream vertSource, fragSource, geomSource;
-    vertSource.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-    fragSource.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-    geomSource.exceptions(std::ifstream::failbit | std::ifstream::badbit);
+    std::string code;
+    std::ifstream source;
+    source.exceptions(std::ifstream::failbit | std::ifstream::badbit);
 
     try
     {
-        vertSource.open(vertPath);
-        fragSource.open(fragPath);
-
-        std::stringstream vertStream, fragStream;
-        vertStream << vertSource.rdbuf();
-        fragStream << fragSource.rdbuf();
-        vertSource.close();
-        fragSource.close();
-
-        vertCode = vertStream.str();
-        fragCode = fragStream.str();
-
-        if (geomPath != nullptr) {
-            geomSource.open(geomPath);
-            std::stringstream geomStream;
-            geomStream << geomSource.rdbuf();
-            geomSource.close();
-            geomCode = geomStream.str();
-        }
+        source.open(path);
+        std::stringstream stream;
+        stream << source.rdbuf();
+        source.close();
+        code = stream.str();
     }
     catch (std::ifstream::failure& exception)
     {
-        std::cerr << "ERROR: shader file reading failed" << std::endl;
+        std::cerr << "ERROR: shader file reading failed: " << path << std::endl;
+        return std::string();
+    }
+
+    std::string directory = path.substr(0, path.find_last_of("/\\") + 1);
+    std::string result;
+    std::istringstream lines(code);
+    std::string line;
+    while (std::getline(lines, line)) {
+        size_t start = line.find_first_not_of(" \t");
+        if (start != std::string::npos && line.compare(start, 8, "#include") == 0) {
+            size_t open = line.find('"', start);
+            size_t close = open != std::string::npos ? line.find('"', open + 1) : std::string::npos;
+            if (close == std::string::npos) {
+                std::cerr << "ERROR: invalid #include in " << path << ": " << line << std::endl;
+                continue;
+            }
+            std::string includePath = directory + line.substr(open + 1, close - open - 1);
+            if (included.insert(includePath).second)
+                result += readSource(includePath, included);
+            continue;
+        }
+        result += line;
+        result += '\n';
     }
+    return result;
+}
 
-    const char* vertString = vertCode.c_str();
-    const char* fragString = fragCode.c_str();
-    unsigned int vert, frag;
-
-    vert = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vert, 1, &vertString, NULL);
-    glCompileShader(vert);
-    checkCompilation(vert, "vertex shader");
-
-    frag = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(frag, 1, &fragString, NULL);
-    glCompileShader(frag);
-    checkCompilation(frag, "fragment shader");
-
-    unsigned int geom;
-    if (geomPath != nullptr) {
-        const char* geomString = geomCode.c_str();
-        geom = glCreateShader(GL_GEOMETRY_SHADER);
-        glShaderSource(geom, 1, &geomString, NULL);
-        glCompileShader(geom);
-        checkCompilation(geom, "geometry shader");
+Shader::Shader(const char* vertPath, const char* fragPath, const char* geomPath, const std::vector<std::string>& defines, ShaderCache& cache)
+    : cache(&cache)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    name = vertPath;
+    if (!defines.empty()) {
+        name += " [";
+        for (size_t i = 0; i < defines.size(); i++)
+            name += (i > 0 ? " " : "") + defines[i];
+        name += "]";
     }
 
+    std::string vertCode = preprocess(vertPath, defines);
+    std::string fragCode = preprocess(fragPath, defines);
+    std::string geomCode = geomPath != nullptr ? preprocess(geomPath, defines) : std::string();
+
     ID = glCreateProgram();
-    glAttachShader(ID, vert);
-    glAttachShader(ID, frag);
-    if (geomPath != nullptr)
-        glAttachShader(ID, geom);
+
+    cacheKey = cache.key({ vertCode, fragCode, geomCode });
+    fromCache = cache.load(ID, cacheKey);
+    if (!fromCache)
+        submit(vertCode, fragCode, geomPath != nullptr ? geomCode.c_str() : nullptr, cache.enabled());
+    pending = true;
+
+    submitTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void Shader::submit(const std::string& vertCode, const std::string& fragCode, const char* geomCode, bool retrievable)
+{
+    // nothing here waits for the driver, statuses are queried in finish()
+    const char* codes[] = { vertCode.c_str(), fragCode.c_str(), geomCode };
+    const GLenum types[] = { GL_VERTEX_SHADER, GL_FRAGMENT_SHADER, GL_GEOMETRY_SHADER };
+    const char* typeNames[] = { "vertex shader", "fragment shader", "geometry shader" };
+
+    for (int i = 0; i < 3; i++) {
+        if (codes[i] == nullptr)
+            continue;
+
+        GLuint stage = glCreateShader(types[i]);
+        glShaderSource(stage, 1, &codes[i], NULL);
+        glCompileShader(stage);
+        glAttachShader(ID, stage);
+        stages.push_back(Stage{ stage, typeNames[i] });
+    }
+
+    if (retrievable)
+        glProgramParameteri(ID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
     glLinkProgram(ID);
-    checkCompilation(ID, "program");
+}
+
+void Shader::finish() const
+{
+    if (pending)
+        complete("at first use");
+}
+
+void Shader::complete(const char* when) const
+{
+    pending = false;
+
+    auto start = std::chrono::steady_clock::now();
+
+    GLint linked = 1;
+    if (!stages.empty()) {
+        // the link status covers every stage, compile logs are only read when something failed
+        glGetProgramiv(ID, GL_LINK_STATUS, &linked);
+        if (!linked) {
+            for (const Stage& stage : stages)
+                checkCompilation(stage.id, stage.type);
+            checkCompilation(ID, "program");
+        }
+        else
+            cache->store(ID, cacheKey);
+
+        for (const Stage& stage : stages) {
+            glDetachShader(ID, stage.id);
+            glDeleteShader(stage.id);
+        }
+        stages.clear();
+    }
+
+    loadUniforms();
+
+    double waitTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    char times[64];
+    snprintf(times, sizeof(times), "%.2f ms, waited %.2f ms", submitTime, waitTime);
+    std::cout << "Program " << name << (fromCache ? ": loaded from binary cache in " : linked ? ": compiled, submitted in " : ": failed, submitted in ")
+        << times << " " << when << "\n";
 
-    glDeleteShader(vert);
-    glDeleteShader(frag);
-    if (geomPath != nullptr)
-        glDeleteShader(geom);
+    if (onReady) {
+        auto callback = std::move(onReady);
+        onReady = nullptr;
+        callback(const_cast<Shader&>(*this));
+    }
+}
+
+bool Shader::ready() const
+{
+    if (!pending)
+        return true;
+    if (!glMaxShaderCompilerThreadsKHR)
+        return false;
+
+    // programs loaded from the binary cache have no stages left to wait for
+    GLint completed = GL_TRUE;
+    if (!stages.empty())
+        glGetProgramiv(ID, GL_COMPLETION_STATUS_KHR, &completed);
+    if (!completed)
+        return false;
+    complete("before use");
+    return true;
+}
+
+void Shader::whenReady(const std::function<void(Shader&)>& callback)
+{
+    if (pending)
+        onReady = callback;
+    else
+        callback(*this);
+}
+
+std::string Shader::preprocess(const char* path, const std::vector<std::string>& defines)
+{
+    std::unordered_set<std::string> included;
+    std::string code = readSource(path, included);
+
+    // defines can only follow the #version line
+    size_t definesPos = 0;
+    if (code.compare(0, 8, "#version") == 0)
+        definesPos = code.find('\n') + 1;
+
+    std::string defineLines;
+    for (const std::string& define : defines)
+        defineLines += "#define " + define + "\n";
+    code.insert(definesPos, defineLines);
+    return code;
+}
+
+GLint Shader::uniform(const std::string& name) const
+{
+    finish();
+    auto it = uniforms.find(name);
+    return it != uniforms.end() ? it->second : -1;
+}
+
+void Shader::bindUniformBlock(const std::string& name, GLuint binding) const
+{
+    finish();
+    GLuint index = glGetUniformBlockIndex(ID, name.c_str());
+    if (index != GL_INVALID_INDEX)
+        glUniformBlockBinding(ID, index, binding);
 }
 
 void Shader::setBool(const std::string& name, bool value) const
 {
-    glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value);
+    setBool(uniform(name), value);
 }
 
 void Shader::setInt(const std::string& name, int value) const
 {
-    glUniform1i(glGetUniformLocation(ID, name.c_str()), value);
+    setInt(uniform(name), value);
 }
 
 void Shader::setFloat(const std::string& name, float value) const
 {
-    glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
+    setFloat(uniform(name), value);
 }
 
 void Shader::setVec2(const std::string& name, const glm::vec2& value) const
 {
-    glUniform2fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+    setVec2(uniform(name), value);
 }
 void Shader::setVec2(const std::string& name, float x, float y) const
 {
-    glUniform2f(glGetUniformLocation(ID, name.c_str()), x, y);
+    setVec2(uniform(name), x, y);
 }
 // ------------------------------------------------------------------------
 void Shader::setVec3(const std::string& name, const glm::vec3& value) const
 {
-    glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+    setVec3(uniform(name), value);
 }
 void Shader::setVec3(const std::string& name, float x, float y, float z) const
 {
-    glUniform3f(glGetUniformLocation(ID, name.c_str()), x, y, z);
+    setVec3(uniform(name), x, y, z);
 }
 // ------------------------------------------------------------------------
 void Shader::setVec4(const std::string& name, const glm::vec4& value) const
 {
-    glUniform4fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+    setVec4(uniform(name), value);
 }
 void Shader::setVec4(const std::string& name, float x, float y, float z, float w)
 {
-    glUniform4f(glGetUniformLocation(ID, name.c_str()), x, y, z, w);
+    setVec4(uniform(name), x, y, z, w);
 }
 // ------------------------------------------------------------------------
 void Shader::setMat2(const std::string& name, const glm::mat2& mat) const
 {
-    glUniformMatrix2fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+    setMat2(uniform(name), mat);
 }
 // ------------------------------------------------------------------------
 void Shader::setMat3(const std::string& name, const glm::mat3& mat) const
 {
-    glUniformMatrix3fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+    setMat3(uniform(name), mat);
 }
 // ------------------------------------------------------------------------
 void Shader::setMat4(const std::string& name, const glm::mat4& mat) const
 {
-    glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+    setMat4(uniform(name), mat);
+}
+
+void Shader::setBool(GLint location, bool value) const
+{
+    glUniform1i(location, (int)value);
+}
+
+void Shader::setInt(GLint location, int value) const
+{
+    glUniform1i(location, value);
+}
+
+void Shader::setFloat(GLint location, float value) const
+{
+    glUniform1f(location, value);
+}
+
+void Shader::setVec2(GLint location, const glm::vec2& value) const
+{
+    glUniform2fv(location, 1, &value[0]);
+}
+void Shader::setVec2(GLint location, float x, float y) const
+{
+    glUniform2f(location, x, y);
+}
+// ------------------------------------------------------------------------
+void Shader::setVec3(GLint location, const glm::vec3& value) const
+{
+    glUniform3fv(location, 1, &value[0]);
+}
+void Shader::setVec3(GLint location, float x, float y, float z) const
+{
+    glUniform3f(location, x, y, z);
+}
+// ------------------------------------------------------------------------
+void Shader::setVec4(GLint location, const glm::vec4& value) const
+{
+    glUniform4fv(location, 1, &value[0]);
+}
+void Shader::setVec4(GLint location, float x, float y, float z, float w) const
+{
+    glUniform4f(location, x, y, z, w);
+}
+// ------------------------------------------------------------------------
+void Shader::setMat2(GLint location, const glm::mat2& mat) const
+{
+    glUniformMatrix2fv(location, 1, GL_FALSE, &mat[0][0]);
+}
+// ------------------------------------------------------------------------
+void Shader::setMat3(GLint location, const glm::mat3& mat) const
+{
+    glUniformMatrix3fv(location, 1, GL_FALSE, &mat[0][0]);
+}
+// ------------------------------------------------------------------------
+void Shader::setMat4(GLint location, const glm::mat4& mat) const
+{
+    glUniformMatrix4fv(location, 1, GL_FALSE, &mat[0][0]);
 }
 
 void Shader::use()
 {
-    glUseProgram(ID);
+    finish();
+    GLStateCache::shared().useProgram(ID);
 }
 
-void Shader::checkCompilation(GLuint shaderID, std::string type)
+bool Shader::checkCompilation(GLuint shaderID, std::string type) const
 {
     GLint success;
     GLchar info[1024];
@@ -153,4 +346,31 @@ void Shader::checkCompilation(GLuint shaderID, std::string type)
             std::cerr << "ERROR: failed to compile shader of type: " << type << "\n" << info << "\n" << std::endl;
         }
     }
+    return success != 0;
+}
+
+void Shader::loadUniforms() const
+{
+    GLint uniformsNum = 0, maxLength = 0;
+    glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &uniformsNum);
+    glGetProgramiv(ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+
+    std::string name(std::max(maxLength, 1), '\0');
+    for (GLint i = 0; i < uniformsNum; i++) {
+        GLsizei length = 0;
+        GLint size = 0;
+        GLenum type = 0;
+        glGetActiveUniform(ID, (GLuint)i, maxLength, &length, &size, &type, &name[0]);
+
+        // uniforms inside blocks have no location
+        std::string uniformName(name.data(), length);
+        GLint location = glGetUniformLocation(ID, uniformName.c_str());
+        if (location < 0)
+            continue;
+
+        uniforms[uniformName] = location;
+        // arrays are reported as "name[0]", they are also set by plain name
+        if (uniformName.size() > 3 && uniformName.compare(uniformName.size() - 3, 3, "[0]") == 0)
+            uniforms[uniformName.substr(0, uniformName.size() - 3)] = location;
+    }
 }
\ No newline at end of file
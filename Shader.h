@@ -8,6 +8,11 @@
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+#include "ShaderCache.h"
 
 class Shader
 {
@@ -15,7 +20,30 @@ public:
 
     unsigned int ID;
 
-    Shader(const char* vertPath, const char* fragPath, const char* geomPath = nullptr);
+    // Sources may #include other files, every entry of `defines` becomes a "#define" line after #version.
+    // The program is loaded from the binary cache when the sources and the driver match a stored entry.
+    // Compilation is only submitted here: the driver may build several programs at once (on its own threads
+    // with KHR_parallel_shader_compile), the status is checked when the program is first used.
+    Shader(const char* vertPath, const char* fragPath, const char* geomPath = nullptr,
+        const std::vector<std::string>& defines = std::vector<std::string>(), ShaderCache& cache = ShaderCache::shared());
+
+    // source of a stage after #include and #define processing
+    static std::string preprocess(const char* path, const std::vector<std::string>& defines);
+
+    // waits for the program and checks it, called by every method that needs the linked program
+    void finish() const;
+    // finishes the program only if the driver reports it done (GL_COMPLETION_STATUS_KHR), never waits;
+    // without parallel compilation the query would block, so the program is left to its first use
+    bool ready() const;
+    // `callback` runs once the program is finished, right away if it already is
+    void whenReady(const std::function<void(Shader&)>& callback);
+
+    // location of an active uniform (-1 if the program has none with this name), looked up in the table
+    // filled after linking; resolve locations once and pass them to the setters below in the render loop
+    GLint uniform(const std::string& name) const;
+
+    // connects a uniform block to a buffer binding point, blocks the program does not use are skipped
+    void bindUniformBlock(const std::string& name, GLuint binding) const;
 
     void setBool(const std::string& name, bool value) const;
     void setInt(const std::string& name, int value) const;
@@ -30,11 +58,46 @@ public:
     void setMat3(const std::string& name, const glm::mat3& mat) const;
     void setMat4(const std::string& name, const glm::mat4& mat) const;
 
+    void setBool(GLint location, bool value) const;
+    void setInt(GLint location, int value) const;
+    void setFloat(GLint location, float value) const;
+    void setVec2(GLint location, const glm::vec2& value) const;
+    void setVec2(GLint location, float x, float y) const;
+    void setVec3(GLint location, const glm::vec3& value) const;
+    void setVec3(GLint location, float x, float y, float z) const;
+    void setVec4(GLint location, const glm::vec4& value) const;
+    void setVec4(GLint location, float x, float y, float z, float w) const;
+    void setMat2(GLint location, const glm::mat2& mat) const;
+    void setMat3(GLint location, const glm::mat3& mat) const;
+    void setMat4(GLint location, const glm::mat4& mat) const;
+
     void use();
 
 private:
 
-    void checkCompilation(GLuint shaderID, std::string type);
+    struct Stage
+    {
+        GLuint id;
+        const char* type;
+    };
+
+    std::string name;
+    ShaderCache* cache;
+    uint64_t cacheKey;
+    bool fromCache;
+    double submitTime;
+
+    // state of a program that was submitted and not checked yet
+    mutable bool pending;
+    mutable std::vector<Stage> stages;
+    mutable std::function<void(Shader&)> onReady;
+    mutable std::unordered_map<std::string, GLint> uniforms;
+
+    void submit(const std::string& vertCode, const std::string& fragCode, const char* geomCode, bool retrievable);
+    // checks a submitted program, `when` tells the log whether it was waited for
+    void complete(const char* when) const;
+    bool checkCompilation(GLuint shaderID, std::string type) const;
+    void loadUniforms() const;
 
 };
 #endif
\ No newline at end of file
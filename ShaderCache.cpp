@@ -0,0 +1,132 @@
+#include "ShaderCache.h"
+#include "GLExtensions.h"
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+namespace fs = std::filesystem;
+
+static uint64_t hashBytes(uint64_t hash, const void* data, size_t size)
+{
+    // FNV-1a, continued from the previous value
+    const unsigned char* bytes = (const unsigned char*)data;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+static uint64_t hashString(uint64_t hash, const char* string)
+{
+    std::string value = string ? string : "";
+    // the terminating zero separates consecutive strings
+    return hashBytes(hash, value.c_str(), value.size() + 1);
+}
+
+ShaderCache::ShaderCache(const std::string& directory)
+    : directory(directory)
+{
+}
+
+bool ShaderCache::enabled()
+{
+    if (supported < 0)
+        supported = hasProgramBinaries() ? 1 : 0;
+    return supported == 1;
+}
+
+uint64_t ShaderCache::key(const std::vector<std::string>& sources) const
+{
+    uint64_t hash = 0xcbf29ce484222325ull;
+    hash = hashString(hash, (const char*)glGetString(GL_VENDOR));
+    hash = hashString(hash, (const char*)glGetString(GL_RENDERER));
+    hash = hashString(hash, (const char*)glGetString(GL_VERSION));
+    for (const std::string& source : sources)
+        hash = hashString(hash, source.c_str());
+    return hash;
+}
+
+bool ShaderCache::load(GLuint program, uint64_t key)
+{
+    if (!enabled()) {
+        misses++;
+        return false;
+    }
+
+    std::ifstream file(entryPath(key), std::ios::binary);
+    ShaderCacheHeader header;
+    if (!file || !file.read((char*)&header, sizeof(header)) || header.magic != SHADER_CACHE_MAGIC
+        || header.version != SHADER_CACHE_VERSION || header.key != key) {
+        misses++;
+        return false;
+    }
+
+    std::vector<char> binary(header.binarySize);
+    if (!file.read(binary.data(), binary.size())) {
+        misses++;
+        return false;
+    }
+
+    glProgramBinary(program, header.binaryFormat, binary.data(), (GLsizei)binary.size());
+
+    // the driver rejects binaries of other versions or hardware even when the key matches
+    GLint success = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if (!success) {
+        misses++;
+        return false;
+    }
+
+    hits++;
+    return true;
+}
+
+void ShaderCache::store(GLuint program, uint64_t key) const
+{
+    if (supported != 1)
+        return;
+
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0)
+        return;
+
+    std::vector<char> binary(length);
+    GLenum binaryFormat = 0;
+    glGetProgramBinary(program, length, &length, &binaryFormat, binary.data());
+
+    ShaderCacheHeader header = { SHADER_CACHE_MAGIC, SHADER_CACHE_VERSION, key, binaryFormat, (uint32_t)length };
+
+    std::error_code error;
+    fs::create_directories(directory, error);
+
+    // written next to the entry and renamed, a crash can not leave a truncated binary behind
+    std::string path = entryPath(key);
+    std::string tempPath = path + ".tmp";
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        if (!file.write((const char*)&header, sizeof(header)) || !file.write(binary.data(), length)) {
+            std::cerr << "ERROR: unable to write shader cache entry " << tempPath << std::endl;
+            return;
+        }
+    }
+    fs::rename(tempPath, path, error);
+    if (error)
+        std::cerr << "ERROR: unable to write shader cache entry " << path << std::endl;
+}
+
+ShaderCache& ShaderCache::shared()
+{
+    static ShaderCache cache;
+    return cache;
+}
+
+std::string ShaderCache::entryPath(uint64_t key) const
+{
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.bin", (unsigned long long)key);
+    return directory + "/" + name;
+}
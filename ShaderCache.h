@@ -0,0 +1,56 @@
+#ifndef SHADER_CACHE_H
+#define SHADER_CACHE_H
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+const uint32_t SHADER_CACHE_MAGIC = 0x42504743; // "CGPB"
+const uint32_t SHADER_CACHE_VERSION = 1;
+
+struct ShaderCacheHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint64_t key;
+    uint32_t binaryFormat;
+    uint32_t binarySize;
+};
+
+// Linked programs saved with glGetProgramBinary, one file per program named after its key.
+// The key covers the sources of all stages and the driver that built the binary, a driver update or
+// an edited shader produce a different key and the program is compiled again.
+class ShaderCache
+{
+public:
+
+    unsigned int hits = 0;
+    unsigned int misses = 0;
+
+    explicit ShaderCache(const std::string& directory = "cache/shaders");
+
+    // false when the context can not export binaries, load and store do nothing then
+    bool enabled();
+
+    uint64_t key(const std::vector<std::string>& sources) const;
+
+    // loads the binary into `program`, false when there is no entry or the driver rejects it;
+    // every call counts as a hit or a miss
+    bool load(GLuint program, uint64_t key);
+    // `program` has to be linked after GL_PROGRAM_BINARY_RETRIEVABLE_HINT was set
+    void store(GLuint program, uint64_t key) const;
+
+    // cache used by Shader when none is given
+    static ShaderCache& shared();
+
+private:
+
+    std::string directory;
+    int supported = -1;
+
+    std::string entryPath(uint64_t key) const;
+
+};
+#endif
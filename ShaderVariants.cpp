@@ -0,0 +1,33 @@
+#include "ShaderVariants.h"
+
+ShaderVariants::ShaderVariants(const char* vertPath, const char* fragPath, const std::vector<std::string>& features,
+    const std::function<void(Shader&)>& setup, const std::vector<std::string>& defines)
+    : vertPath(vertPath), fragPath(fragPath), features(features), defines(defines), setup(setup)
+{
+}
+
+Shader& ShaderVariants::get(unsigned int mask)
+{
+    mask &= (1u << features.size()) - 1;
+
+    std::unique_ptr<Shader>& variant = variants[mask];
+    if (!variant) {
+        std::vector<std::string> defines = this->defines;
+        for (size_t i = 0; i < features.size(); i++) {
+            if (mask & (1u << i))
+                defines.push_back(features[i]);
+        }
+
+        // the variant is only submitted here, setup runs when it is first used
+        variant.reset(new Shader(vertPath.c_str(), fragPath.c_str(), nullptr, defines));
+        if (setup)
+            variant->whenReady(setup);
+    }
+    return *variant;
+}
+
+void ShaderVariants::poll()
+{
+    for (auto& variant : variants)
+        variant.second->ready();
+}
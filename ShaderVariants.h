@@ -0,0 +1,43 @@
+#ifndef SHADER_VARIANTS_H
+#define SHADER_VARIANTS_H
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Shader.h"
+
+// Programs built from the same sources with different sets of feature defines, so that features are
+// compiled in instead of being branched on per fragment. A variant is built the first time it is
+// requested (or loaded from the binary cache) and kept for the following frames.
+class ShaderVariants
+{
+public:
+
+    // `setup` runs once for every new variant when it is first used (sampler units, uniform blocks and
+    // other constant state), `defines` are added to every variant
+    ShaderVariants(const char* vertPath, const char* fragPath, const std::vector<std::string>& features,
+        const std::function<void(Shader&)>& setup = nullptr, const std::vector<std::string>& defines = {});
+
+    // bit i of `mask` enables features[i], higher bits are ignored
+    Shader& get(unsigned int mask);
+    // submits the variant without using it, so that it can be built before it is switched to
+    void prepare(unsigned int mask) { get(mask); }
+    // finishes the variants the driver has completed in the background, see Shader::ready()
+    void poll();
+
+    size_t size() const { return variants.size(); }
+
+private:
+
+    std::string vertPath;
+    std::string fragPath;
+    std::vector<std::string> features;
+    std::vector<std::string> defines;
+    std::function<void(Shader&)> setup;
+    std::unordered_map<unsigned int, std::unique_ptr<Shader>> variants;
+
+};
+#endif
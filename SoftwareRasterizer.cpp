@@ -0,0 +1,390 @@
+#include "SoftwareRasterizer.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+
+// clip space position followed by the varyings
+const unsigned int CLIP_VERTEX_SIZE = 4 + MAX_VARYINGS;
+
+// triangles set up and binned per task, vertices shaded per task
+const size_t SETUP_GRAIN = 256;
+const size_t VERTEX_GRAIN = 1024;
+
+static inline uint32_t packColor(float r, float g, float b, float a)
+{
+    auto channel = [](float value) { return (uint32_t)(std::min(std::max(value, 0.0f), 1.0f) * 255.0f + 0.5f); };
+    return channel(r) | channel(g) << 8 | channel(b) << 16 | channel(a) << 24;
+}
+
+static inline float unpackChannel(uint32_t color, int channel)
+{
+    return (float)(color >> (8 * channel) & 0xFF) * (1.0f / 255.0f);
+}
+
+SoftwareRasterizer::SoftwareRasterizer(ThreadPool& pool)
+    : pool(pool)
+{
+}
+
+void SoftwareRasterizer::begin(unsigned int width, unsigned int height, const glm::vec3& clearColor)
+{
+    frameWidth = width;
+    frameHeight = height;
+    pitch = (width + RASTER_BLOCK_SIZE - 1) / RASTER_BLOCK_SIZE * RASTER_BLOCK_SIZE;
+    unsigned int rows = (height + RASTER_BLOCK_SIZE - 1) / RASTER_BLOCK_SIZE * RASTER_BLOCK_SIZE;
+    tilesX = (width + RASTER_TILE_SIZE - 1) / RASTER_TILE_SIZE;
+    tilesY = (height + RASTER_TILE_SIZE - 1) / RASTER_TILE_SIZE;
+    blocksX = pitch / RASTER_BLOCK_SIZE;
+
+    colorBuffer.assign((size_t)pitch * rows, packColor(clearColor.r, clearColor.g, clearColor.b, 1.0f));
+    depthBuffer.assign((size_t)pitch * rows, 1.0f);
+    blockDepth.assign((size_t)blocksX * (rows / RASTER_BLOCK_SIZE), 1.0f);
+
+    draws.clear();
+    triangles.clear();
+    bins.resize((size_t)tilesX * tilesY);
+    for (std::vector<uint32_t>& bin : bins)
+        bin.clear();
+    stats = RasterStats();
+}
+
+void SoftwareRasterizer::draw(const Mesh& mesh, const SoftwareProgram& program, const RasterState& state, unsigned int instances)
+{
+    size_t vertexCount = mesh.vertexCount();
+    size_t trianglesNum = mesh.indices.size() / 3;
+    if (vertexCount == 0 || trianglesNum == 0 || instances == 0)
+        return;
+
+    Draw draw{ &program, state, std::min(program.varyingsNum(), MAX_VARYINGS) };
+    uint32_t drawIndex = (uint32_t)draws.size();
+    draws.push_back(draw);
+
+    // vertex stage, every vertex of every instance once
+    vertexData.resize(vertexCount * instances * CLIP_VERTEX_SIZE);
+    pool.parallelFor(vertexCount * instances, VERTEX_GRAIN, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            unsigned int instance = (unsigned int)(i / vertexCount);
+            float* out = &vertexData[i * CLIP_VERTEX_SIZE];
+            glm::vec4 position = program.shadeVertex(&mesh.vertices[(i % vertexCount) * mesh.stride], instance, out + 4);
+            out[0] = position.x;
+            out[1] = position.y;
+            out[2] = position.z;
+            out[3] = position.w;
+        }
+    });
+
+    // clipping and setup in parallel, each input triangle has two output slots
+    size_t inputNum = trianglesNum * instances;
+    setupTriangles.resize(inputNum * 2);
+    setupCounts.resize(inputNum);
+    pool.parallelFor(inputNum, SETUP_GRAIN, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            size_t instanceBase = i / trianglesNum * vertexCount;
+            const unsigned int* index = &mesh.indices[(i % trianglesNum) * 3];
+            const float* vertices[3];
+            for (int k = 0; k < 3; k++)
+                vertices[k] = &vertexData[(instanceBase + index[k]) * CLIP_VERTEX_SIZE];
+            setupCounts[i] = (unsigned char)setupTriangle(vertices, draw, drawIndex, &setupTriangles[i * 2]);
+        }
+    });
+
+    // binning keeps the submission order, tiles replay their triangles in it
+    for (size_t i = 0; i < inputNum; i++) {
+        for (unsigned int k = 0; k < setupCounts[i]; k++) {
+            const Triangle& triangle = setupTriangles[i * 2 + k];
+            uint32_t index = (uint32_t)triangles.size();
+            triangles.push_back(triangle);
+
+            unsigned int tileMinX = triangle.minX / RASTER_TILE_SIZE, tileMaxX = triangle.maxX / RASTER_TILE_SIZE;
+            unsigned int tileMinY = triangle.minY / RASTER_TILE_SIZE, tileMaxY = triangle.maxY / RASTER_TILE_SIZE;
+            for (unsigned int y = tileMinY; y <= tileMaxY; y++)
+                for (unsigned int x = tileMinX; x <= tileMaxX; x++)
+                    bins[y * tilesX + x].push_back(index);
+            stats.binEntries += (size_t)(tileMaxX - tileMinX + 1) * (tileMaxY - tileMinY + 1);
+        }
+    }
+}
+
+unsigned int SoftwareRasterizer::setupTriangle(const float* vertices[3], const Draw& draw, uint32_t drawIndex, Triangle* out) const
+{
+    // distances to the near plane (z = -w), the only clipped one: the far plane is applied per pixel and the
+    // bounding box limits the rest to the screen
+    float distances[3];
+    int insideNum = 0;
+    for (int k = 0; k < 3; k++) {
+        distances[k] = vertices[k][2] + vertices[k][3];
+        if (distances[k] >= 0.0f)
+            insideNum++;
+    }
+    if (insideNum == 0)
+        return 0;
+    if (insideNum == 3)
+        return setupClipped(vertices, draw, drawIndex, out[0]) ? 1 : 0;
+
+    // Sutherland-Hodgman against one plane leaves a triangle or a quadrilateral
+    unsigned int size = 4 + draw.varyingsNum;
+    float polygon[4][CLIP_VERTEX_SIZE];
+    int polygonSize = 0;
+    for (int k = 0; k < 3; k++) {
+        int next = (k + 1) % 3;
+        if (distances[k] >= 0.0f)
+            memcpy(polygon[polygonSize++], vertices[k], size * sizeof(float));
+        if ((distances[k] >= 0.0f) != (distances[next] >= 0.0f)) {
+            float t = distances[k] / (distances[k] - distances[next]);
+            for (unsigned int c = 0; c < size; c++)
+                polygon[polygonSize][c] = vertices[k][c] + t * (vertices[next][c] - vertices[k][c]);
+            polygonSize++;
+        }
+    }
+
+    unsigned int count = 0;
+    for (int k = 1; k + 1 < polygonSize; k++) {
+        const float* fan[3] = { polygon[0], polygon[k], polygon[k + 1] };
+        if (setupClipped(fan, draw, drawIndex, out[count]))
+            count++;
+    }
+    return count;
+}
+
+bool SoftwareRasterizer::setupClipped(const float* vertices[3], const Draw& draw, uint32_t drawIndex, Triangle& out) const
+{
+    // window coordinates, y flipped so that rows go down from the top of the image
+    double x[3], y[3];
+    float z[3], inverseW[3];
+    for (int k = 0; k < 3; k++) {
+        float w = vertices[k][3];
+        if (!(w > 0.0f))
+            return false;
+        inverseW[k] = 1.0f / w;
+        x[k] = (vertices[k][0] * (double)inverseW[k] * 0.5 + 0.5) * frameWidth;
+        y[k] = (0.5 - vertices[k][1] * (double)inverseW[k] * 0.5) * frameHeight;
+        z[k] = vertices[k][2] * inverseW[k] * 0.5f + 0.5f;
+    }
+
+    double area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+    if (area == 0.0 || !std::isfinite(area))
+        return false;
+
+    // pixel centres inside the bounding box
+    double minX = std::min({ x[0], x[1], x[2] }), maxX = std::max({ x[0], x[1], x[2] });
+    double minY = std::min({ y[0], y[1], y[2] }), maxY = std::max({ y[0], y[1], y[2] });
+    out.minX = (int)std::max(0.0, std::ceil(minX - 0.5));
+    out.minY = (int)std::max(0.0, std::ceil(minY - 0.5));
+    out.maxX = (int)std::min((double)frameWidth - 1.0, std::floor(maxX - 0.5));
+    out.maxY = (int)std::min((double)frameHeight - 1.0, std::floor(maxY - 0.5));
+    if (out.minX > out.maxX || out.minY > out.maxY)
+        return false;
+
+    // edge k runs from vertex k to the next one and is positive on the side of the third vertex
+    double sign = area > 0.0 ? 1.0 : -1.0;
+    for (int k = 0; k < 3; k++) {
+        int next = (k + 1) % 3;
+        out.edgeA[k] = sign * (y[k] - y[next]);
+        out.edgeB[k] = sign * (x[next] - x[k]);
+        out.edgeC[k] = sign * (x[k] * y[next] - x[next] * y[k]);
+        // of two triangles sharing the edge, whose A and B are opposite, exactly one owns its pixels
+        out.topLeft[k] = out.edgeA[k] > 0.0 || (out.edgeA[k] == 0.0 && out.edgeB[k] > 0.0);
+    }
+
+    // planes of linearly interpolated values: depth, 1 / w and varying / w, the last two give perspective-correct varyings
+    double dx1 = x[1] - x[0], dy1 = y[1] - y[0], dx2 = x[2] - x[0], dy2 = y[2] - y[0];
+    auto plane = [&](float f0, float f1, float f2) {
+        double d1 = (double)f1 - f0, d2 = (double)f2 - f0;
+        return Plane{ f0, (float)((d1 * dy2 - d2 * dy1) / area), (float)((d2 * dx1 - d1 * dx2) / area) };
+    };
+    out.originX = (float)x[0];
+    out.originY = (float)y[0];
+    out.depth = plane(z[0], z[1], z[2]);
+    out.inverseW = plane(inverseW[0], inverseW[1], inverseW[2]);
+    for (unsigned int i = 0; i < draw.varyingsNum; i++)
+        out.varyings[i] = plane(vertices[0][4 + i] * inverseW[0], vertices[1][4 + i] * inverseW[1], vertices[2][4 + i] * inverseW[2]);
+
+    out.minDepth = std::min({ z[0], z[1], z[2] });
+    out.draw = drawIndex;
+    return true;
+}
+
+RasterStats SoftwareRasterizer::finish()
+{
+    stats.triangles = triangles.size();
+
+    // the busiest tiles go first, so that no thread is left alone with a heavy tile at the end
+    std::vector<unsigned int> order(bins.size());
+    std::iota(order.begin(), order.end(), 0u);
+    std::stable_sort(order.begin(), order.end(), [&](unsigned int a, unsigned int b) { return bins[a].size() > bins[b].size(); });
+
+    std::atomic<size_t> quadsShaded{ 0 }, blocksCulled{ 0 };
+    pool.parallelFor(order.size(), 1, [&](size_t begin, size_t end) {
+        RasterStats tileStats;
+        for (size_t i = begin; i < end; i++)
+            rasterizeTile(order[i], tileStats);
+        quadsShaded += tileStats.quadsShaded;
+        blocksCulled += tileStats.blocksCulled;
+    });
+
+    stats.quadsShaded = quadsShaded;
+    stats.blocksCulled = blocksCulled;
+    return stats;
+}
+
+void SoftwareRasterizer::rasterizeTile(unsigned int tile, RasterStats& tileStats)
+{
+    unsigned int tileX = tile % tilesX * RASTER_TILE_SIZE, tileY = tile / tilesX * RASTER_TILE_SIZE;
+    unsigned int tileMaxX = std::min(tileX + RASTER_TILE_SIZE, frameWidth) - 1;
+    unsigned int tileMaxY = std::min(tileY + RASTER_TILE_SIZE, frameHeight) - 1;
+
+    for (uint32_t index : bins[tile]) {
+        const Triangle& triangle = triangles[index];
+        unsigned int minX = std::max<unsigned int>(triangle.minX, tileX), maxX = std::min<unsigned int>(triangle.maxX, tileMaxX);
+        unsigned int minY = std::max<unsigned int>(triangle.minY, tileY), maxY = std::min<unsigned int>(triangle.maxY, tileMaxY);
+        for (unsigned int blockY = minY / RASTER_BLOCK_SIZE; blockY <= maxY / RASTER_BLOCK_SIZE; blockY++)
+            for (unsigned int blockX = minX / RASTER_BLOCK_SIZE; blockX <= maxX / RASTER_BLOCK_SIZE; blockX++)
+                rasterizeBlock(triangle, blockX, blockY, tileStats);
+    }
+}
+
+void SoftwareRasterizer::rasterizeBlock(const Triangle& triangle, unsigned int blockX, unsigned int blockY, RasterStats& tileStats)
+{
+    const Draw& draw = draws[triangle.draw];
+    const RasterState& state = draw.state;
+    float& farthest = blockDepth[(size_t)blockY * blocksX + blockX];
+
+    // hierarchical depth: the nearest point of the triangle is behind everything in the block
+    if ((state.depthTest == DepthTest::LESS && triangle.minDepth >= farthest)
+        || (state.depthTest == DepthTest::LEQUAL && triangle.minDepth > farthest)) {
+        tileStats.blocksCulled++;
+        return;
+    }
+
+    // edge functions at the first pixel centre of the block; the block is skipped when all of it is outside an edge,
+    // edges with all of it inside are not tested per pixel
+    const float span = (float)(RASTER_BLOCK_SIZE - 1);
+    double pixelX = blockX * RASTER_BLOCK_SIZE + 0.5, pixelY = blockY * RASTER_BLOCK_SIZE + 0.5;
+    Float4 edgeBase[3], edgeA[3], edgeB[3], edgeOwned[3];
+    int testedNum = 0;
+    for (int k = 0; k < 3; k++) {
+        double base = triangle.edgeA[k] * pixelX + triangle.edgeB[k] * pixelY + triangle.edgeC[k];
+        double a = triangle.edgeA[k], b = triangle.edgeB[k];
+        if (base + std::max(a, 0.0) * span + std::max(b, 0.0) * span < 0.0)
+            return;
+        if (base + std::min(a, 0.0) * span + std::min(b, 0.0) * span > 0.0)
+            continue;
+        edgeBase[testedNum] = Float4((float)base);
+        edgeA[testedNum] = Float4((float)a);
+        edgeB[testedNum] = Float4((float)b);
+        edgeOwned[testedNum] = Float4::laneMask(triangle.topLeft[k] ? 0xF : 0);
+        testedNum++;
+    }
+
+    const SoftwareProgram& program = *draw.program;
+    const Float4 laneX(0.0f, 1.0f, 0.0f, 1.0f), laneY(0.0f, 0.0f, 1.0f, 1.0f);
+    unsigned int firstX = blockX * RASTER_BLOCK_SIZE, firstY = blockY * RASTER_BLOCK_SIZE;
+    bool clipped = firstX + RASTER_BLOCK_SIZE > frameWidth || firstY + RASTER_BLOCK_SIZE > frameHeight;
+    bool depthWritten = false;
+
+    FragmentQuad quad;
+    for (unsigned int quadY = 0; quadY < RASTER_BLOCK_SIZE; quadY += 2) {
+        for (unsigned int quadX = 0; quadX < RASTER_BLOCK_SIZE; quadX += 2) {
+            Float4 offsetX = laneX + Float4((float)quadX), offsetY = laneY + Float4((float)quadY);
+
+            // coverage: inside every tested edge, pixels on an edge only when the triangle owns it
+            Float4 mask = Float4::laneMask(0xF);
+            for (int k = 0; k < testedNum; k++) {
+                Float4 edge = edgeBase[k] + edgeA[k] * offsetX + edgeB[k] * offsetY;
+                mask = mask & ((edge > Float4(0.0f)) | ((edge == Float4(0.0f)) & edgeOwned[k]));
+            }
+            unsigned int x = firstX + quadX, y = firstY + quadY;
+            if (clipped)
+                mask = mask & (offsetX + Float4((float)firstX) < Float4((float)frameWidth)) & (offsetY + Float4((float)firstY) < Float4((float)frameHeight));
+            if (laneBits(mask) == 0)
+                continue;
+
+            quad.x = offsetX + Float4(firstX + 0.5f);
+            quad.y = offsetY + Float4(firstY + 0.5f);
+            Float4 relativeX = quad.x - Float4(triangle.originX), relativeY = quad.y - Float4(triangle.originY);
+            auto interpolate = [&](const Plane& plane) { return Float4(plane.value) + Float4(plane.dx) * relativeX + Float4(plane.dy) * relativeY; };
+
+            // the far plane and the depth test before shading, depth is written after it (fragments may be discarded)
+            quad.depth = interpolate(triangle.depth);
+            mask = mask & (quad.depth <= Float4(1.0f));
+            size_t pixel = (size_t)y * pitch + x;
+            float* depth = &depthBuffer[pixel];
+            Float4 stored(depth[0], depth[1], depth[pitch], depth[pitch + 1]);
+            if (state.depthTest == DepthTest::LESS)
+                mask = mask & (quad.depth < stored);
+            else if (state.depthTest == DepthTest::LEQUAL)
+                mask = mask & (quad.depth <= stored);
+            if (laneBits(mask) == 0)
+                continue;
+
+            Float4 w = Float4(1.0f) / interpolate(triangle.inverseW);
+            for (unsigned int i = 0; i < draw.varyingsNum; i++)
+                quad.varyings[i] = interpolate(triangle.varyings[i]) * w;
+
+            Color4 color = program.shadeFragments(quad, mask);
+            tileStats.quadsShaded++;
+            int covered = laneBits(mask);
+            if (covered == 0)
+                continue;
+
+            float r[4], g[4], b[4], a[4], depths[4];
+            color.r.store(r);
+            color.g.store(g);
+            color.b.store(b);
+            color.a.store(a);
+            quad.depth.store(depths);
+            for (int lane = 0; lane < 4; lane++) {
+                if (!(covered >> lane & 1))
+                    continue;
+                size_t offset = (lane >> 1) * pitch + (lane & 1);
+                uint32_t& target = colorBuffer[pixel + offset];
+                if (state.blend) {
+                    float alpha = std::min(std::max(a[lane], 0.0f), 1.0f);
+                    target = packColor(r[lane] * alpha + unpackChannel(target, 0) * (1.0f - alpha),
+                        g[lane] * alpha + unpackChannel(target, 1) * (1.0f - alpha),
+                        b[lane] * alpha + unpackChannel(target, 2) * (1.0f - alpha),
+                        a[lane] * alpha + unpackChannel(target, 3) * (1.0f - alpha));
+                }
+                else
+                    target = packColor(r[lane], g[lane], b[lane], a[lane]);
+                if (state.depthWrite)
+                    depth[offset] = depths[lane];
+            }
+            depthWritten = depthWritten || state.depthWrite;
+        }
+    }
+
+    // the farthest depth of the block can only have come nearer
+    if (depthWritten) {
+        Float4 farthestDepth(0.0f);
+        for (unsigned int row = 0; row < RASTER_BLOCK_SIZE; row++) {
+            const float* depth = &depthBuffer[(size_t)(firstY + row) * pitch + firstX];
+            farthestDepth = max(farthestDepth, max(Float4::load(depth), Float4::load(depth + 4)));
+        }
+        farthest = std::max(std::max(farthestDepth[0], farthestDepth[1]), std::max(farthestDepth[2], farthestDepth[3]));
+    }
+}
+
+void SoftwareRasterizer::readRGB(std::vector<unsigned char>& pixels) const
+{
+    pixels.resize((size_t)frameWidth * frameHeight * 3);
+    unsigned char* out = pixels.data();
+    for (unsigned int y = 0; y < frameHeight; y++) {
+        const uint32_t* row = &colorBuffer[(size_t)y * pitch];
+        for (unsigned int x = 0; x < frameWidth; x++) {
+            *out++ = (unsigned char)row[x];
+            *out++ = (unsigned char)(row[x] >> 8);
+            *out++ = (unsigned char)(row[x] >> 16);
+        }
+    }
+}
+
+void SoftwareRasterizer::readRGBA(std::vector<uint32_t>& pixels) const
+{
+    pixels.resize((size_t)frameWidth * frameHeight);
+    for (unsigned int y = 0; y < frameHeight; y++)
+        memcpy(&pixels[(size_t)y * frameWidth], &colorBuffer[(size_t)y * pitch], frameWidth * sizeof(uint32_t));
+}
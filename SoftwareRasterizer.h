@@ -0,0 +1,154 @@
+#ifndef SOFTWARE_RASTERIZER_H
+#define SOFTWARE_RASTERIZER_H
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "Float4.h"
+#include "MeshOptimizer.h"
+#include "SoftwareTexture.h"
+#include "ThreadPool.h"
+
+// most floats a program passes from a vertex to the fragments
+const unsigned int MAX_VARYINGS = 16;
+// screen tiles the triangles are binned into, a tile is rasterized by one task
+const unsigned int RASTER_TILE_SIZE = 64;
+// pixel blocks of the hierarchical depth test, every block keeps the farthest depth in it
+const unsigned int RASTER_BLOCK_SIZE = 8;
+
+// 2x2 pixels being shaded, lane i is pixel (i & 1, i >> 1) of the quad. Lanes outside the triangle are shaded too
+// with extrapolated values, so that differences between the lanes are the derivatives of the values.
+struct FragmentQuad
+{
+    Float4 x, y;                    // pixel centres, y grows downwards from the top row
+    Float4 depth;                   // window depth, 0 on the near plane and 1 on the far one
+    Float4 varyings[MAX_VARYINGS];  // perspective-correct
+};
+
+// vertex and fragment stages of a draw, the counterpart of a shader program
+class SoftwareProgram
+{
+public:
+
+    virtual ~SoftwareProgram() = default;
+
+    virtual unsigned int varyingsNum() const = 0;
+
+    // clip space position of `vertex` (Mesh::stride floats) in instance `instance`, varyingsNum() values go to `varyings`
+    virtual glm::vec4 shadeVertex(const float* vertex, unsigned int instance, float* varyings) const = 0;
+
+    // colours of the quad, lanes taken out of `mask` are discarded
+    virtual Color4 shadeFragments(const FragmentQuad& quad, Float4& mask) const = 0;
+
+};
+
+enum class DepthTest {
+    ALWAYS,
+    LESS,
+    LEQUAL
+};
+
+struct RasterState
+{
+    DepthTest depthTest = DepthTest::LESS;
+    bool depthWrite = true;
+    bool blend = false;     // source alpha over the target, as GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA
+};
+
+struct RasterStats
+{
+    size_t triangles = 0;       // after clipping and setup, with a pixel on the screen
+    size_t binEntries = 0;      // triangles in tiles
+    size_t quadsShaded = 0;
+    size_t blocksCulled = 0;    // blocks of triangles behind the farthest depth of the block
+};
+
+// Tile-based rasterizer. draw() shades the vertices, clips the triangles against the near plane, sets up their edge
+// functions and interpolation planes and bins them into screen tiles; finish() rasterizes the tiles in parallel,
+// each one going through its triangles in draw order, so blending and depth testing work as on the GPU.
+// Edge functions are evaluated for the four pixels of a quad at once, blocks of a triangle are skipped when the
+// whole block is outside it or nearer than it.
+class SoftwareRasterizer
+{
+public:
+
+    explicit SoftwareRasterizer(ThreadPool& pool = ThreadPool::shared());
+
+    // starts a frame of the given size, cleared to `clearColor` and a depth of 1
+    void begin(unsigned int width, unsigned int height, const glm::vec3& clearColor);
+
+    // queues the triangles of `mesh`, `instances` times; the program must stay alive until finish()
+    void draw(const Mesh& mesh, const SoftwareProgram& program, const RasterState& state = RasterState(), unsigned int instances = 1);
+
+    // rasterizes everything queued since begin()
+    RasterStats finish();
+
+    unsigned int width() const { return frameWidth; }
+    unsigned int height() const { return frameHeight; }
+
+    // the finished frame, rows from the top
+    void readRGB(std::vector<unsigned char>& pixels) const;
+    void readRGBA(std::vector<uint32_t>& pixels) const;
+
+private:
+
+    struct Plane
+    {
+        float value;    // at the first vertex
+        float dx;
+        float dy;
+    };
+
+    struct Triangle
+    {
+        double edgeA[3], edgeB[3], edgeC[3];    // A x + B y + C >= 0 inside
+        bool topLeft[3];                        // pixels exactly on the edge belong to the triangle
+        float originX, originY;                 // first vertex, the origin of the planes
+        Plane depth;
+        Plane inverseW;
+        Plane varyings[MAX_VARYINGS];           // varying / w
+        float minDepth;
+        int minX, minY, maxX, maxY;             // pixels of the bounding box
+        uint32_t draw;
+    };
+
+    struct Draw
+    {
+        const SoftwareProgram* program;
+        RasterState state;
+        unsigned int varyingsNum;
+    };
+
+    ThreadPool& pool;
+    unsigned int frameWidth = 0;
+    unsigned int frameHeight = 0;
+    unsigned int pitch = 0;     // buffers are padded to whole blocks
+    unsigned int tilesX = 0;
+    unsigned int tilesY = 0;
+    unsigned int blocksX = 0;
+
+    std::vector<uint32_t> colorBuffer;
+    std::vector<float> depthBuffer;
+    std::vector<float> blockDepth;
+
+    std::vector<Draw> draws;
+    std::vector<Triangle> triangles;
+    std::vector<std::vector<uint32_t>> bins;
+    RasterStats stats;
+
+    // per draw scratch: shaded vertices and up to two triangles per clipped input triangle
+    std::vector<float> vertexData;
+    std::vector<Triangle> setupTriangles;
+    std::vector<unsigned char> setupCounts;
+
+    unsigned int setupTriangle(const float* vertices[3], const Draw& draw, uint32_t drawIndex, Triangle* out) const;
+    bool setupClipped(const float* vertices[3], const Draw& draw, uint32_t drawIndex, Triangle& out) const;
+    void rasterizeTile(unsigned int tile, RasterStats& tileStats);
+    void rasterizeBlock(const Triangle& triangle, unsigned int blockX, unsigned int blockY, RasterStats& tileStats);
+
+};
+
+#endif
@@ -0,0 +1,189 @@
+#include "SoftwareRenderer.h"
+
+#include <algorithm>
+#include <future>
+
+SoftwareRenderer::SoftwareRenderer(ThreadPool& pool)
+    : pool(pool), rasterizer(pool), tracer(pool)
+{
+    groundProgram.frame = &frame;
+    boxProgram.frame = &frame;
+    wallProgram.frame = &frame;
+    lightProgram.frame = &frame;
+    windowProgram.frame = &frame;
+    reflectProgram.frame = &frame;
+    skyboxProgram.frame = &frame;
+
+    groundProgram.texture = &groundTexture;
+    boxProgram.layers = &boxTextures;
+    wallProgram.diffuseMap = &wallDiffuse;
+    wallProgram.normalMap = &wallNormal;
+    wallProgram.bumpMap = &wallBump;
+    wallProgram.bumpScale = bumpScale;
+    windowProgram.texture = &windowTexture;
+    reflectProgram.skybox = &skybox;
+    skyboxProgram.skybox = &skybox;
+    screenProgram.screen = &screenTexture;
+}
+
+bool SoftwareRenderer::load(const SceneTextures& textures)
+{
+    TextureCache cache("cache/software");
+    boxTextures.resize(textures.boxes.size());
+
+    struct Job
+    {
+        SoftwareTexture* texture;
+        std::string file;
+        MipSettings settings;
+        bool loaded;
+    };
+    std::vector<Job> jobs{
+        { &groundTexture, textures.ground, textures.colorMips, false },
+        { &windowTexture, textures.window, textures.windowMips, false },
+        { &wallDiffuse, textures.wallDiffuse, textures.colorMips, false },
+        { &wallNormal, textures.wallNormal, textures.normalMips, false },
+        { &wallBump, textures.wallBump, textures.bumpMips, false }
+    };
+    for (size_t i = 0; i < textures.boxes.size(); i++)
+        jobs.push_back(Job{ &boxTextures[i], textures.boxes[i], textures.colorMips, false });
+
+    std::vector<std::future<void>> futures;
+    for (Job& job : jobs)
+        futures.push_back(pool.submit([&job, &cache]() { job.loaded = job.texture->load(job.file, job.settings, cache); }));
+
+    // the faces are loaded here while the pool decodes the rest
+    bool loaded = skybox.load(textures.skyboxFaces, cache);
+    for (size_t i = 0; i < jobs.size(); i++) {
+        futures[i].wait();
+        loaded = loaded && jobs[i].loaded;
+    }
+    return loaded;
+}
+
+void SoftwareRenderer::prepare(const Camera& camera, float time, unsigned int width, unsigned int height, const SoftwareModes& modes)
+{
+    // the same frame values main.cpp uploads to the uniform buffers
+    frame.view = camera.getViewMatrix();
+    frame.projection = glm::perspective(glm::radians(camera.Zoom), (float)width / (float)height, 0.1f, 100.0f);
+    frame.skyboxView = glm::mat4(glm::mat3(frame.view));
+    frame.viewPosition = camera.Position;
+    frame.lightPosition = lightPosition;
+    frame.lightColor = LIGHT_COLOR;
+    frame.fogDensity = FOG_DENSITY;
+    frame.fogGradient = FOG_GRADIENT;
+    frame.fogColor = FOG_COLOR;
+    frame.camUp = camera.Up;
+    frame.camRight = camera.Right;
+
+    SceneTransforms transforms = animateScene(time);
+    const ShadingFeatures& features = modes.features;
+
+    groundProgram.features = features;
+    groundProgram.instances.assign(1, ObjectInstance(glm::mat4(1.0f), GROUND_SHININESS));
+
+    boxProgram.features = features;
+    boxProgram.instances.clear();
+    for (unsigned int i = 0; i < boxesNum; i++)
+        boxProgram.instances.push_back(ObjectInstance(transforms.boxes[i], boxShininess[i], (float)(i % boxTextures.size())));
+
+    wallProgram.features = features;
+    wallProgram.model = transforms.wall;
+    wallProgram.shininess = WALL_SHININESS;
+
+    lightProgram.model = transforms.light;
+    reflectProgram.model = transforms.reflect;
+
+    // back to front for blending
+    unsigned char visible[windowsNum];
+    std::fill(visible, visible + windowsNum, 1);
+    windowProgram.positions.clear();
+    for (unsigned int window : windowSorter.sort(windowPositions, visible, windowsNum, camera.Position))
+        windowProgram.positions.push_back(windowPositions[window]);
+}
+
+RasterStats SoftwareRenderer::render(const SceneMeshes& meshes, const Camera& camera, float time, unsigned int width, unsigned int height, const SoftwareModes& modes)
+{
+    prepare(camera, time, width, height, modes);
+    rasterizer.begin(width, height, CLEAR_COLOR);
+
+    if (!modes.skybox) {
+        rasterizer.draw(meshes.ground, groundProgram);
+        rasterizer.draw(meshes.cube, boxProgram, RasterState(), boxesNum);
+        rasterizer.draw(meshes.wall, wallProgram);
+        if (modes.features.light)
+            rasterizer.draw(meshes.cube, lightProgram);
+
+        // blended after everything opaque
+        RasterState blended;
+        blended.blend = true;
+        rasterizer.draw(meshes.window, windowProgram, blended, (unsigned int)windowProgram.positions.size());
+    }
+    else {
+        rasterizer.draw(meshes.cube, reflectProgram);
+
+        RasterState sky;
+        sky.depthTest = DepthTest::LEQUAL;
+        rasterizer.draw(meshes.cube, skyboxProgram, sky);
+    }
+
+    RasterStats stats = rasterizer.finish();
+    traced = false;
+    if (!modes.monochrome)
+        return stats;
+
+    rasterizer.readRGBA(scenePixels);
+    RasterStats postStats = postProcess(meshes, width, height);
+    stats.triangles += postStats.triangles;
+    stats.binEntries += postStats.binEntries;
+    stats.quadsShaded += postStats.quadsShaded;
+    return stats;
+}
+
+TraceStats SoftwareRenderer::trace(const SceneMeshes& meshes, const Camera& camera, float time, unsigned int width, unsigned int height, const SoftwareModes& modes)
+{
+    // the mirror cube reflects rays instead of looking the skybox up, the sky is what the rays miss
+    prepare(camera, time, width, height, modes);
+    tracer.begin(width, height, frame.view, frame.projection, CLEAR_COLOR, modes.skybox ? &skybox : nullptr);
+
+    if (!modes.skybox) {
+        tracer.add(meshes.ground, groundProgram);
+        tracer.add(meshes.cube, boxProgram, TracedMaterial::OPAQUE, boxesNum);
+        tracer.add(meshes.wall, wallProgram);
+        if (modes.features.light)
+            tracer.add(meshes.cube, lightProgram);
+        tracer.add(meshes.window, windowProgram, TracedMaterial::BLENDED, (unsigned int)windowProgram.positions.size());
+    }
+    else {
+        tracer.add(meshes.cube, reflectProgram, TracedMaterial::MIRROR);
+    }
+
+    TraceStats stats = tracer.finish();
+    traced = true;
+    if (modes.monochrome) {
+        tracer.readRGBA(scenePixels);
+        postProcess(meshes, width, height);
+        traced = false;
+    }
+    return stats;
+}
+
+RasterStats SoftwareRenderer::postProcess(const SceneMeshes& meshes, unsigned int width, unsigned int height)
+{
+    // the post effect samples the finished scene over the whole screen
+    screenTexture.assign((int)width, (int)height, scenePixels.data());
+    rasterizer.begin(width, height, glm::vec3(1.0f));
+    RasterState screen;
+    screen.depthTest = DepthTest::ALWAYS;
+    screen.depthWrite = false;
+    rasterizer.draw(meshes.screen, screenProgram, screen);
+    return rasterizer.finish();
+}
+
+void SoftwareRenderer::readRGB(std::vector<unsigned char>& pixels) const
+{
+    if (traced)
+        tracer.readRGB(pixels);
+    else
+        rasterizer.readRGB(pixels);
+}
@@ -0,0 +1,80 @@
+#ifndef SOFTWARE_RENDERER_H
+#define SOFTWARE_RENDERER_H
+
+#include <vector>
+
+#include "Camera.h"
+#include "RayTracer.h"
+#include "Scene.h"
+#include "SoftwareRasterizer.h"
+#include "SoftwareShaders.h"
+#include "SoftwareTexture.h"
+#include "ThreadPool.h"
+#include "TransparencySorter.h"
+
+// modes of the frame, the keys Z, M, L, B, F and P of the window
+struct SoftwareModes
+{
+    bool skybox = false;
+    bool monochrome = false;
+    ShadingFeatures features;
+};
+
+// Draws the scene of Scene.h on the CPU with SoftwareRasterizer, or ray traces it with RayTracer, the way main.cpp
+// draws it with OpenGL: ground, boxes, wall, light and sorted windows, or the mirror cube in the skybox, optionally
+// through the monochrome post effect. Needs no GL context; weighted blended transparency is not implemented, windows are always sorted.
+class SoftwareRenderer
+{
+public:
+
+    explicit SoftwareRenderer(ThreadPool& pool = ThreadPool::shared());
+
+    // decodes the textures on the pool, or maps them from cache/software (uncompressed chains, kept apart from the
+    // BC compressed entries of the GL textures)
+    bool load(const SceneTextures& textures);
+
+    // renders the scene `time` seconds into the animation as seen by `camera`
+    RasterStats render(const SceneMeshes& meshes, const Camera& camera, float time, unsigned int width, unsigned int height, const SoftwareModes& modes);
+
+    // the same frame ray traced with RayTracer, as a reference for the rasterized ones
+    TraceStats trace(const SceneMeshes& meshes, const Camera& camera, float time, unsigned int width, unsigned int height, const SoftwareModes& modes);
+
+    // the last frame, rows from the top
+    void readRGB(std::vector<unsigned char>& pixels) const;
+
+private:
+
+    ThreadPool& pool;
+    SoftwareRasterizer rasterizer;
+    RayTracer tracer;
+    bool traced = false;    // the last frame is in the tracer
+    FrameUniforms frame = {};
+    TransparencySorter windowSorter;
+
+    SoftwareTexture groundTexture;
+    std::vector<SoftwareTexture> boxTextures;
+    SoftwareTexture windowTexture;
+    SoftwareTexture wallDiffuse;
+    SoftwareTexture wallNormal;
+    SoftwareTexture wallBump;
+    SoftwareCubeTexture skybox;
+    SoftwareTexture screenTexture;
+    std::vector<uint32_t> scenePixels;
+
+    CommonProgram groundProgram;
+    CommonProgram boxProgram;
+    WallNormalProgram wallProgram;
+    LightProgram lightProgram;
+    WindowProgram windowProgram;
+    ReflectProgram reflectProgram;
+    SkyboxProgram skyboxProgram;
+    ScreenProgram screenProgram;
+
+    // frame values and the parameters of the programs
+    void prepare(const Camera& camera, float time, unsigned int width, unsigned int height, const SoftwareModes& modes);
+    // the monochrome effect over scenePixels, into the rasterizer
+    RasterStats postProcess(const SceneMeshes& meshes, unsigned int width, unsigned int height);
+
+};
+
+#endif
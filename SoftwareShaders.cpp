@@ -0,0 +1,263 @@
+#include "SoftwareShaders.h"
+
+#include <algorithm>
+#include <cmath>
+
+static inline Vec3x4 splat(const glm::vec3& v)
+{
+    return Vec3x4(v.x, v.y, v.z);
+}
+
+static inline float fogFactor(const FrameUniforms& frame, const glm::vec4& viewPosition)
+{
+    float distance = glm::length(glm::vec3(viewPosition));
+    return std::min(std::max(std::exp(-std::pow(distance * frame.fogDensity, frame.fogGradient)), 0.0f), 1.0f);
+}
+
+static inline Color4 applyFog(const FrameUniforms& frame, const Color4& color, Float4 factor)
+{
+    return Color4{
+        mix(Float4(frame.fogColor.r), color.r, factor), mix(Float4(frame.fogColor.g), color.g, factor),
+        mix(Float4(frame.fogColor.b), color.b, factor), mix(Float4(1.0f), color.a, factor)
+    };
+}
+
+// specular term of Blinn-Phong (half vector) or Phong (reflected light)
+static inline Float4 specularTerm(bool blinn, const Vec3x4& normal, const Vec3x4& lightDirection, const Vec3x4& viewDirection, Float4 shininess)
+{
+    Float4 cosine = blinn ? dot(normal, normalize(lightDirection + viewDirection)) : dot(viewDirection, reflect(-lightDirection, normal));
+    return pow(max(cosine, Float4(0.0f)), shininess);
+}
+
+ObjectInstance::ObjectInstance(const glm::mat4& model, float shininess, float layer)
+    : model(model), normalMatrix(glm::transpose(glm::inverse(glm::mat3(model)))), shininess(shininess), layer(layer)
+{
+}
+
+// varyings: FragPosition, Normal, TexCoord, fogFactor, shininess, layer
+glm::vec4 CommonProgram::shadeVertex(const float* vertex, unsigned int instance, float* varyings) const
+{
+    const ObjectInstance& object = instances[instance];
+    glm::vec4 position = object.model * glm::vec4(vertex[0], vertex[1], vertex[2], 1.0f);
+    glm::vec3 normal = glm::normalize(object.normalMatrix * glm::vec3(vertex[3], vertex[4], vertex[5]));
+    glm::vec4 viewPosition = frame->view * position;
+
+    varyings[0] = position.x;
+    varyings[1] = position.y;
+    varyings[2] = position.z;
+    varyings[3] = normal.x;
+    varyings[4] = normal.y;
+    varyings[5] = normal.z;
+    varyings[6] = vertex[6];
+    varyings[7] = vertex[7];
+    varyings[8] = features.fog ? fogFactor(*frame, viewPosition) : 1.0f;
+    varyings[9] = object.shininess;
+    varyings[10] = object.layer;
+    return frame->projection * viewPosition;
+}
+
+Color4 CommonProgram::shadeFragments(const FragmentQuad& quad, Float4&) const
+{
+    const Float4* in = quad.varyings;
+    Color4 texColor;
+    if (layers) {
+        // the layer is the same for the whole instance, so for the whole quad
+        size_t layer = (size_t)std::max(0.0f, in[10][0] + 0.5f);
+        texColor = (*layers)[std::min(layer, layers->size() - 1)].sample(in[6], in[7]);
+    }
+    else
+        texColor = texture->sample(in[6], in[7]);
+
+    Color4 color = texColor;
+    if (features.light) {
+        const float ambientStrength = 0.1f, specularStrength = 0.5f;
+        Vec3x4 position(in[0], in[1], in[2]);
+        Vec3x4 normal = normalize(Vec3x4(in[3], in[4], in[5]));
+        Vec3x4 lightDirection = normalize(splat(frame->lightPosition) - position);
+        Vec3x4 viewDirection = normalize(splat(frame->viewPosition) - position);
+
+        Float4 diffuse = max(dot(normal, lightDirection), Float4(0.0f));
+        Float4 specular = Float4(specularStrength) * specularTerm(features.blinn, normal, lightDirection, viewDirection, in[9]);
+
+        // (ambient + diffuse, 1) * texColor + (specular, 1)
+        Float4 lit = Float4(ambientStrength) + diffuse;
+        color.r = lit * Float4(frame->lightColor.r) * texColor.r + specular * Float4(frame->lightColor.r);
+        color.g = lit * Float4(frame->lightColor.g) * texColor.g + specular * Float4(frame->lightColor.g);
+        color.b = lit * Float4(frame->lightColor.b) * texColor.b + specular * Float4(frame->lightColor.b);
+        color.a = texColor.a + Float4(1.0f);
+    }
+
+    return features.fog ? applyFog(*frame, color, in[8]) : color;
+}
+
+// varyings: TexCoord, TangViewPosition, TangLightPosition, TangFragPosition, fogFactor
+glm::vec4 WallNormalProgram::shadeVertex(const float* vertex, unsigned int, float* varyings) const
+{
+    glm::vec4 position = model * glm::vec4(vertex[0], vertex[1], vertex[2], 1.0f);
+    glm::vec4 viewPosition = frame->view * position;
+
+    varyings[0] = vertex[6];
+    varyings[1] = vertex[7];
+
+    if (features.light) {
+        // tangent frame rebuilt as wallNormal.vs does it from the packed tangent and the bitangent sign
+        glm::vec3 normal(vertex[3], vertex[4], vertex[5]), tangent(vertex[8], vertex[9], vertex[10]), bitangent(vertex[11], vertex[12], vertex[13]);
+        float sign = glm::dot(glm::cross(normal, tangent), bitangent) < 0.0f ? -1.0f : 1.0f;
+        glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(model)));
+        glm::vec3 T = glm::normalize(normalMatrix * tangent);
+        glm::vec3 N = glm::normalize(normalMatrix * normal);
+        T = glm::normalize(T - glm::dot(T, N) * N);
+        glm::vec3 B = glm::cross(N, T) * sign;
+        glm::mat3 TBN = glm::transpose(glm::mat3(T, B, N));
+
+        glm::vec3 tangentView = TBN * frame->viewPosition;
+        glm::vec3 tangentLight = TBN * frame->lightPosition;
+        glm::vec3 tangentFrag = TBN * glm::vec3(position);
+        for (int c = 0; c < 3; c++) {
+            varyings[2 + c] = tangentView[c];
+            varyings[5 + c] = tangentLight[c];
+            varyings[8 + c] = tangentFrag[c];
+        }
+    }
+    else
+        std::fill(varyings + 2, varyings + 11, 0.0f);
+
+    varyings[11] = features.fog ? fogFactor(*frame, viewPosition) : 1.0f;
+    return frame->projection * viewPosition;
+}
+
+Color4 WallNormalProgram::shadeFragments(const FragmentQuad& quad, Float4& mask) const
+{
+    const Float4* in = quad.varyings;
+    if (!features.light) {
+        Color4 color = diffuseMap->sample(in[0], in[1]);
+        return features.fog ? applyFog(*frame, color, in[11]) : color;
+    }
+
+    Vec3x4 tangentView(in[2], in[3], in[4]), tangentLight(in[5], in[6], in[7]), tangentFrag(in[8], in[9], in[10]);
+    Vec3x4 viewDirection = normalize(tangentView - tangentFrag);
+    Float4 u = in[0], v = in[1];
+
+    if (features.parallax && bumpMap) {
+        // steep parallax: steps into the height field along the view ray until it is below the surface, then
+        // interpolates between the last two steps; lanes step until each of them has hit, the whole quad samples
+        // the bump map at the level of detail of its texture coordinates
+        float lod = bumpMap->quadLod(u, v);
+        Float4 layersCount = mix(Float4(32.0f), Float4(8.0f), abs(viewDirection.z));
+        Float4 deltaU = viewDirection.x / viewDirection.z * Float4(bumpScale) / layersCount;
+        Float4 deltaV = viewDirection.y / viewDirection.z * Float4(bumpScale) / layersCount;
+        Float4 layerDepth = Float4(1.0f) / layersCount;
+
+        Float4 currentDepth(0.0f);
+        Float4 currentValue = bumpMap->sampleLod(u, v, lod).r;
+        Float4 stepping = mask & (currentDepth < currentValue);
+        for (int step = 0; laneBits(stepping) != 0 && step < 64; step++) {
+            u = select(stepping, u - deltaU, u);
+            v = select(stepping, v - deltaV, v);
+            currentValue = select(stepping, bumpMap->sampleLod(u, v, lod).r, currentValue);
+            currentDepth = select(stepping, currentDepth + layerDepth, currentDepth);
+            stepping = stepping & (currentDepth < currentValue);
+        }
+
+        Float4 previousU = u + deltaU, previousV = v + deltaV;
+        Float4 depthAfter = currentValue - currentDepth;
+        Float4 depthBefore = bumpMap->sampleLod(previousU, previousV, lod).r - currentDepth + layerDepth;
+        Float4 weight = depthAfter / (depthAfter - depthBefore);
+        u = previousU * weight + u * (Float4(1.0f) - weight);
+        v = previousV * weight + v * (Float4(1.0f) - weight);
+
+        Float4 inside = (u >= Float4(0.0f)) & (u <= Float4(1.0f)) & (v >= Float4(0.0f)) & (v <= Float4(1.0f));
+        mask = mask & inside;
+    }
+
+    Color4 texColor = diffuseMap->sample(u, v);
+    // the normal map may be stored as two channels (BC5), z is reconstructed from x and y
+    Color4 packedNormal = normalMap->sample(u, v);
+    Float4 normalX = packedNormal.r * Float4(2.0f) - Float4(1.0f), normalY = packedNormal.g * Float4(2.0f) - Float4(1.0f);
+    Float4 normalZ = sqrt(max(Float4(1.0f) - normalX * normalX - normalY * normalY, Float4(0.0f)));
+    Vec3x4 normal = normalize(Vec3x4(normalX, normalY, normalZ));
+
+    const float ambientStrength = 0.1f, specularStrength = 0.2f;
+    Vec3x4 lightDirection = normalize(tangentLight - tangentFrag);
+    Float4 diffuse = max(dot(lightDirection, normal), Float4(0.0f));
+    Float4 specular = Float4(specularStrength) * specularTerm(features.blinn, normal, lightDirection, viewDirection, Float4(shininess));
+
+    Float4 lit = Float4(ambientStrength) + diffuse;
+    Color4 color{ lit * texColor.r + specular, lit * texColor.g + specular, lit * texColor.b + specular, Float4(1.0f) };
+    return features.fog ? applyFog(*frame, color, in[11]) : color;
+}
+
+glm::vec4 WindowProgram::shadeVertex(const float* vertex, unsigned int instance, float* varyings) const
+{
+    varyings[0] = vertex[3];
+    varyings[1] = vertex[4];
+    glm::vec3 rotated = frame->camRight * vertex[0] + frame->camUp * vertex[1];
+    glm::vec3 placed = 1.25f * rotated + positions[instance];
+    return frame->projection * frame->view * glm::vec4(placed, 1.0f);
+}
+
+Color4 WindowProgram::shadeFragments(const FragmentQuad& quad, Float4&) const
+{
+    return texture->sample(quad.varyings[0], quad.varyings[1]);
+}
+
+glm::vec4 SkyboxProgram::shadeVertex(const float* vertex, unsigned int, float* varyings) const
+{
+    varyings[0] = vertex[0];
+    varyings[1] = vertex[1];
+    varyings[2] = vertex[2];
+    glm::vec4 position = frame->projection * frame->skyboxView * glm::vec4(vertex[0], vertex[1], vertex[2], 1.0f);
+    return glm::vec4(position.x, position.y, position.w, position.w);
+}
+
+Color4 SkyboxProgram::shadeFragments(const FragmentQuad& quad, Float4&) const
+{
+    return skybox->sample(Vec3x4(quad.varyings[0], quad.varyings[1], quad.varyings[2]));
+}
+
+// varyings: Position, Normal
+glm::vec4 ReflectProgram::shadeVertex(const float* vertex, unsigned int, float* varyings) const
+{
+    glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(model)));
+    glm::vec3 normal = glm::normalize(normalMatrix * glm::vec3(vertex[3], vertex[4], vertex[5]));
+    glm::vec4 position = model * glm::vec4(vertex[0], vertex[1], vertex[2], 1.0f);
+    for (int c = 0; c < 3; c++) {
+        varyings[c] = position[c];
+        varyings[3 + c] = normal[c];
+    }
+    return frame->projection * frame->view * position;
+}
+
+Color4 ReflectProgram::shadeFragments(const FragmentQuad& quad, Float4&) const
+{
+    const Float4* in = quad.varyings;
+    Vec3x4 viewDirection = normalize(Vec3x4(in[0], in[1], in[2]) - splat(frame->viewPosition));
+    Vec3x4 reflection = reflect(viewDirection, normalize(Vec3x4(in[3], in[4], in[5])));
+    Color4 color = skybox->sample(reflection);
+    color.a = Float4(1.0f);
+    return color;
+}
+
+glm::vec4 LightProgram::shadeVertex(const float* vertex, unsigned int, float*) const
+{
+    return frame->projection * frame->view * model * glm::vec4(vertex[0], vertex[1], vertex[2], 1.0f);
+}
+
+Color4 LightProgram::shadeFragments(const FragmentQuad&, Float4&) const
+{
+    return Color4{ Float4(1.0f), Float4(1.0f), Float4(1.0f), Float4(1.0f) };
+}
+
+glm::vec4 ScreenProgram::shadeVertex(const float* vertex, unsigned int, float* varyings) const
+{
+    varyings[0] = vertex[2];
+    varyings[1] = vertex[3];
+    return glm::vec4(vertex[0], vertex[1], 0.0f, 1.0f);
+}
+
+Color4 ScreenProgram::shadeFragments(const FragmentQuad& quad, Float4&) const
+{
+    Color4 color = screen->sample(quad.varyings[0], Float4(1.0f) - quad.varyings[1]);
+    Float4 average = (color.r + color.g + color.b) / Float4(3.0f);
+    return Color4{ average, average, average, Float4(1.0f) };
+}
@@ -0,0 +1,147 @@
+#ifndef SOFTWARE_SHADERS_H
+#define SOFTWARE_SHADERS_H
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+#include "SoftwareRasterizer.h"
+#include "SoftwareTexture.h"
+#include "UniformBuffers.h"
+
+// C++ versions of the scene shaders for SoftwareRasterizer. Every program reads the frame values from the same
+// FrameUniforms the GL renderer uploads and takes the vertices of the float meshes of Scene.h.
+
+// the #define switches of the lit shaders (ShaderVariants)
+struct ShadingFeatures
+{
+    bool light = true;
+    bool blinn = true;
+    bool fog = false;
+    bool parallax = false;
+};
+
+// model transform and material of one drawn object, as ObjectUniforms and the instance attributes carry them
+struct ObjectInstance
+{
+    glm::mat4 model;
+    glm::mat3 normalMatrix;
+    float shininess;
+    float layer;
+
+    ObjectInstance(const glm::mat4& model, float shininess = 0.0f, float layer = 0.0f);
+};
+
+// common.vs / common.fs: textured objects with Phong or Blinn-Phong lighting and fog; vertices are position, normal
+// and texture coordinates; the instances take their texture from `layers` when it is set (the INSTANCED variant)
+class CommonProgram : public SoftwareProgram
+{
+public:
+
+    const FrameUniforms* frame = nullptr;
+    ShadingFeatures features;
+    const SoftwareTexture* texture = nullptr;
+    const std::vector<SoftwareTexture>* layers = nullptr;
+    std::vector<ObjectInstance> instances;
+
+    unsigned int varyingsNum() const override { return 11; }
+    glm::vec4 shadeVertex(const float* vertex, unsigned int instance, float* varyings) const override;
+    Color4 shadeFragments(const FragmentQuad& quad, Float4& mask) const override;
+
+};
+
+// wallNormal.vs / wallNormal.fs: normal mapping, with parallax occlusion mapping of the bump map when enabled;
+// vertices are position, normal, texture coordinates, tangent and bitangent
+class WallNormalProgram : public SoftwareProgram
+{
+public:
+
+    const FrameUniforms* frame = nullptr;
+    ShadingFeatures features;
+    const SoftwareTexture* diffuseMap = nullptr;
+    const SoftwareTexture* normalMap = nullptr;
+    const SoftwareTexture* bumpMap = nullptr;
+    float bumpScale = 0.1f;
+    glm::mat4 model = glm::mat4(1.0f);
+    float shininess = 0.0f;
+
+    unsigned int varyingsNum() const override { return 12; }
+    glm::vec4 shadeVertex(const float* vertex, unsigned int instance, float* varyings) const override;
+    Color4 shadeFragments(const FragmentQuad& quad, Float4& mask) const override;
+
+};
+
+// window.vs / window.fs: camera facing billboards at `positions`, in the order they are given
+// (sorted back to front for blending); vertices are position and texture coordinates
+class WindowProgram : public SoftwareProgram
+{
+public:
+
+    const FrameUniforms* frame = nullptr;
+    const SoftwareTexture* texture = nullptr;
+    std::vector<glm::vec3> positions;
+
+    unsigned int varyingsNum() const override { return 2; }
+    glm::vec4 shadeVertex(const float* vertex, unsigned int instance, float* varyings) const override;
+    Color4 shadeFragments(const FragmentQuad& quad, Float4& mask) const override;
+
+};
+
+// skybox.vs / skybox.fs: the cube around the camera at the far plane, drawn with a LEQUAL depth test
+class SkyboxProgram : public SoftwareProgram
+{
+public:
+
+    const FrameUniforms* frame = nullptr;
+    const SoftwareCubeTexture* skybox = nullptr;
+
+    unsigned int varyingsNum() const override { return 3; }
+    glm::vec4 shadeVertex(const float* vertex, unsigned int instance, float* varyings) const override;
+    Color4 shadeFragments(const FragmentQuad& quad, Float4& mask) const override;
+
+};
+
+// reflect.vs / reflect.fs: the mirror cube reflecting the skybox; vertices are position and normal
+class ReflectProgram : public SoftwareProgram
+{
+public:
+
+    const FrameUniforms* frame = nullptr;
+    const SoftwareCubeTexture* skybox = nullptr;
+    glm::mat4 model = glm::mat4(1.0f);
+
+    unsigned int varyingsNum() const override { return 6; }
+    glm::vec4 shadeVertex(const float* vertex, unsigned int instance, float* varyings) const override;
+    Color4 shadeFragments(const FragmentQuad& quad, Float4& mask) const override;
+
+};
+
+// light.vs / light.fs: the white cube of the light source; vertices are positions
+class LightProgram : public SoftwareProgram
+{
+public:
+
+    const FrameUniforms* frame = nullptr;
+    glm::mat4 model = glm::mat4(1.0f);
+
+    unsigned int varyingsNum() const override { return 0; }
+    glm::vec4 shadeVertex(const float* vertex, unsigned int instance, float* varyings) const override;
+    Color4 shadeFragments(const FragmentQuad& quad, Float4& mask) const override;
+
+};
+
+// screen.vs / screen.fs: the monochrome post effect over the full screen quad; `screen` holds the scene with rows
+// from the top, the quad's texture coordinates start at the bottom like those of a GL framebuffer texture
+class ScreenProgram : public SoftwareProgram
+{
+public:
+
+    const SoftwareTexture* screen = nullptr;
+
+    unsigned int varyingsNum() const override { return 2; }
+    glm::vec4 shadeVertex(const float* vertex, unsigned int instance, float* varyings) const override;
+    Color4 shadeFragments(const FragmentQuad& quad, Float4& mask) const override;
+
+};
+
+#endif
@@ -0,0 +1,268 @@
+#include "SoftwareTexture.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <memory>
+
+static_assert(TEXTURE_TILE_SIZE == 8, "the Morton index below takes three bits of each coordinate");
+static const int TILE_BITS = 3;
+static const int TILE_TEXELS_BITS = 2 * TILE_BITS;
+
+// the three low bits of a coordinate spread to every second bit: x takes the even bits of the index within the tile
+// and y the odd ones, so 2x2 texel blocks are 16 bytes and 4x4 blocks a 64-byte cache line
+static inline uint32_t spreadBits(uint32_t a)
+{
+    return (a & 1) | (a & 2) << 1 | (a & 4) << 2;
+}
+
+static inline Int4 spreadBits(Int4 a)
+{
+    return (a & Int4(1)) | ((a & Int4(2)) << 1) | ((a & Int4(4)) << 2);
+}
+
+TiledLevel::TiledLevel(int width, int height, int layersNum)
+    : width(width), height(height), tilesX((width + TEXTURE_TILE_SIZE - 1) / TEXTURE_TILE_SIZE)
+{
+    int tilesY = (height + TEXTURE_TILE_SIZE - 1) / TEXTURE_TILE_SIZE;
+    layerSize = (size_t)tilesX * tilesY << TILE_TEXELS_BITS;
+    texels.assign(layerSize * layersNum, 0);
+}
+
+size_t TiledLevel::index(int x, int y, int tilesX)
+{
+    size_t tile = (size_t)(y >> TILE_BITS) * tilesX + (x >> TILE_BITS);
+    return tile << TILE_TEXELS_BITS | spreadBits((uint32_t)x) | spreadBits((uint32_t)y) << 1;
+}
+
+static inline Int4 tiledIndex(Int4 x, Int4 y, int tilesX)
+{
+    Int4 tile = (y >> TILE_BITS) * Int4(tilesX) + (x >> TILE_BITS);
+    return (tile << TILE_TEXELS_BITS) | spreadBits(x) | (spreadBits(y) << 1);
+}
+
+// texels at `index` of the four lanes as colours in [0, 1]
+static inline Color4 fetch(const uint32_t* texels, Int4 index)
+{
+    // SSE2 has no gather, the texels are loaded one by one and unpacked together
+    int32_t lanes[4];
+    index.store(lanes);
+    Int4 packed((int32_t)texels[lanes[0]], (int32_t)texels[lanes[1]], (int32_t)texels[lanes[2]], (int32_t)texels[lanes[3]]);
+    Int4 byte(0xFF);
+    Float4 scale(1.0f / 255.0f);
+    return Color4{
+        toFloat4(packed & byte) * scale,
+        toFloat4(packed >> 8 & byte) * scale,
+        toFloat4(packed >> 16 & byte) * scale,
+        toFloat4(packed >> 24) * scale
+    };
+}
+
+static inline Color4 mix(const Color4& a, const Color4& b, Float4 t)
+{
+    return Color4{ mix(a.r, b.r, t), mix(a.g, b.g, t), mix(a.b, b.b, t), mix(a.a, b.a, t) };
+}
+
+// coordinates in [0, 1] by the addressing mode; NaN and huge values would overflow the integer conversions,
+// they read the first texel instead
+static inline Float4 address(Float4 t, TextureWrap wrap)
+{
+    t = select(abs(t) < Float4(1.0e6f), t, Float4(0.0f));
+    if (wrap == TextureWrap::REPEAT)
+        return t - floor(t);
+    return clamp(t, Float4(0.0f), Float4(1.0f));
+}
+
+// the two texel columns (or rows) of a bilinear fetch along one axis and the weight of the second one
+static inline void linearTexels(Float4 t, int size, TextureWrap wrap, Int4& first, Int4& second, Float4& weight)
+{
+    Float4 extent((float)size);
+    Float4 position = address(t, wrap) * extent - Float4(0.5f);
+    Float4 low = floor(position);
+    Float4 high = low + Float4(1.0f);
+    weight = position - low;
+    if (wrap == TextureWrap::REPEAT) {
+        low = select(low < Float4(0.0f), low + extent, low);
+        high = select(high >= extent, high - extent, high);
+    }
+    else {
+        low = max(low, Float4(0.0f));
+        high = min(high, extent - Float4(1.0f));
+    }
+    first = toInt4(low);
+    second = toInt4(high);
+}
+
+static inline Int4 nearestTexel(Float4 t, int size, TextureWrap wrap)
+{
+    Float4 extent((float)size);
+    return toInt4(min(floor(address(t, wrap) * extent), extent - Float4(1.0f)));
+}
+
+// bilinear filtering of `level`, `layer` holds the offsets of the layers the lanes read
+static Color4 bilinear(const TiledLevel& level, Float4 u, Float4 v, TextureWrap wrap, Int4 layer = Int4(0))
+{
+    Int4 x0, x1, y0, y1;
+    Float4 fx, fy;
+    linearTexels(u, level.width, wrap, x0, x1, fx);
+    linearTexels(v, level.height, wrap, y0, y1, fy);
+
+    const uint32_t* texels = level.texels.data();
+    Color4 top = mix(fetch(texels, layer + tiledIndex(x0, y0, level.tilesX)), fetch(texels, layer + tiledIndex(x1, y0, level.tilesX)), fx);
+    Color4 bottom = mix(fetch(texels, layer + tiledIndex(x0, y1, level.tilesX)), fetch(texels, layer + tiledIndex(x1, y1, level.tilesX)), fx);
+    return mix(top, bottom, fy);
+}
+
+bool SoftwareTexture::load(const std::string& file, const MipSettings& settings, const TextureCache& cache, bool mipmaps)
+{
+    levels.clear();
+
+    int channelsNum = 0;
+    std::vector<MipLevel> chainLevels;
+    const unsigned char* data = nullptr;
+
+    MipChain chain;
+    std::unique_ptr<CachedTexture> cached = cache.load(file, settings.key(), BlockFormat::NONE);
+    if (cached) {
+        const TextureCacheHeader& header = *cached->header;
+        const TextureCacheLevel& last = cached->levels[header.levelsNum - 1];
+        bool complete = mipmaps ? last.width == 1 && last.height == 1 : header.levelsNum == 1;
+        if (!complete)
+            cached.reset();
+    }
+
+    if (cached) {
+        channelsNum = (int)cached->header->channelsNum;
+        for (uint32_t i = 0; i < cached->header->levelsNum; i++) {
+            const TextureCacheLevel& level = cached->levels[i];
+            chainLevels.push_back(MipLevel{ (int)level.width, (int)level.height, (size_t)level.offset, (size_t)level.size });
+        }
+        data = cached->file.data();
+    }
+    else if (cache.build(file, settings, BlockFormat::NONE, mipmaps, chain)) {
+        channelsNum = chain.channelsNum;
+        chainLevels = chain.levels;
+        data = chain.pixels.data();
+    }
+    else {
+        std::cerr << "ERROR: unable to load texture from file " << file << std::endl;
+        return false;
+    }
+
+    // grey images fill red only, like GL_RED textures; missing alpha is opaque
+    for (const MipLevel& chainLevel : chainLevels) {
+        TiledLevel level(chainLevel.width, chainLevel.height);
+        const unsigned char* src = data + chainLevel.offset;
+        for (int y = 0; y < level.height; y++) {
+            for (int x = 0; x < level.width; x++, src += channelsNum) {
+                uint32_t r = src[0];
+                uint32_t g = channelsNum >= 3 ? src[1] : 0;
+                uint32_t b = channelsNum >= 3 ? src[2] : 0;
+                uint32_t a = channelsNum == 4 ? src[3] : channelsNum == 2 ? src[1] : 0xFF;
+                level.texels[TiledLevel::index(x, y, level.tilesX)] = r | g << 8 | b << 16 | a << 24;
+            }
+        }
+        levels.push_back(std::move(level));
+    }
+    return true;
+}
+
+void SoftwareTexture::assign(int width, int height, const uint32_t* pixels)
+{
+    levels.assign(1, TiledLevel(width, height));
+    TiledLevel& level = levels[0];
+    for (int y = 0; y < height; y++)
+        for (int x = 0; x < width; x++)
+            level.texels[TiledLevel::index(x, y, level.tilesX)] = *pixels++;
+}
+
+float SoftwareTexture::quadLod(Float4 u, Float4 v) const
+{
+    if (levels.empty())
+        return 0.0f;
+    float dudx = (u[1] - u[0]) * levels[0].width, dvdx = (v[1] - v[0]) * levels[0].height;
+    float dudy = (u[2] - u[0]) * levels[0].width, dvdy = (v[2] - v[0]) * levels[0].height;
+    float rho2 = std::max(dudx * dudx + dvdx * dvdx, dudy * dudy + dvdy * dvdy);
+    return rho2 > 0.0f ? 0.5f * std::log2(rho2) : 0.0f;
+}
+
+Color4 SoftwareTexture::sampleLod(Float4 u, Float4 v, float lod) const
+{
+    // magnification and the first level are plain bilinear, otherwise the two nearest levels are blended
+    if (!(lod > 0.0f) || levels.size() <= 1)
+        return sampleLevel(u, v, 0);
+    float maxLod = (float)(levels.size() - 1);
+    if (lod >= maxLod)
+        return sampleLevel(u, v, levels.size() - 1);
+
+    size_t level = (size_t)lod;
+    return mix(sampleLevel(u, v, level), sampleLevel(u, v, level + 1), Float4(lod - (float)level));
+}
+
+Color4 SoftwareTexture::sampleLevel(Float4 u, Float4 v, size_t level) const
+{
+    if (levels.empty())
+        return Color4{ 0.0f, 0.0f, 0.0f, 1.0f };
+    return bilinear(levels[level], u, v, wrap);
+}
+
+Color4 SoftwareTexture::sampleNearest(Float4 u, Float4 v, size_t level) const
+{
+    if (levels.empty())
+        return Color4{ 0.0f, 0.0f, 0.0f, 1.0f };
+    const TiledLevel& source = levels[level];
+    return fetch(source.texels.data(), tiledIndex(nearestTexel(u, source.width, wrap), nearestTexel(v, source.height, wrap), source.tilesX));
+}
+
+bool SoftwareCubeTexture::load(const std::vector<std::string>& files, const TextureCache& cache)
+{
+    faces = TiledLevel();
+    if (files.size() != 6) {
+        std::cerr << "ERROR: a cube texture takes 6 faces, " << files.size() << " given" << std::endl;
+        return false;
+    }
+
+    for (size_t i = 0; i < files.size(); i++) {
+        SoftwareTexture face;
+        if (!face.load(files[i], MipSettings(), cache, false)) {
+            faces = TiledLevel();
+            return false;
+        }
+        const TiledLevel& level = face.level(0);
+        if (i == 0)
+            faces = TiledLevel(level.width, level.height, 6);
+        if (level.width != faces.width || level.height != faces.height) {
+            std::cerr << "ERROR: cube face " << files[i] << " differs in size from " << files[0] << std::endl;
+            faces = TiledLevel();
+            return false;
+        }
+        std::copy(level.texels.begin(), level.texels.end(), faces.texels.begin() + i * faces.layerSize);
+    }
+    return true;
+}
+
+Color4 SoftwareCubeTexture::sample(const Vec3x4& direction) const
+{
+    if (faces.texels.empty())
+        return Color4{ 0.0f, 0.0f, 0.0f, 1.0f };
+
+    // major axis, face and the face coordinates of the OpenGL cube map table, x wins the ties over y and y over z
+    Float4 zero(0.0f), one(1.0f);
+    Float4 x = direction.x, y = direction.y, z = direction.z;
+    Float4 ax = abs(x), ay = abs(y), az = abs(z);
+    Float4 xMajor = (ax >= ay) & (ax >= az);
+    Float4 yMajor = andNot(ay >= az, xMajor);
+    Float4 xPositive = x >= zero, yPositive = y >= zero, zPositive = z >= zero;
+
+    Float4 face = select(xMajor, select(xPositive, zero, one),
+        select(yMajor, select(yPositive, Float4(2.0f), Float4(3.0f)), select(zPositive, Float4(4.0f), Float4(5.0f))));
+    Float4 sc = select(xMajor, select(xPositive, -z, z), select(yMajor, x, select(zPositive, x, -x)));
+    Float4 tc = select(yMajor, select(yPositive, z, -z), -y);
+    Float4 ma = select(xMajor, ax, select(yMajor, ay, az));
+    // a zero direction has no face, it reads the centre of +X
+    ma = select(ma > zero, ma, one);
+
+    Float4 half(0.5f);
+    Float4 u = half * (sc / ma + one), v = half * (tc / ma + one);
+    return bilinear(faces, u, v, TextureWrap::CLAMP_TO_EDGE, toInt4(face) * Int4((int32_t)faces.layerSize));
+}
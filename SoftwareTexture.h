@@ -0,0 +1,104 @@
+#ifndef SOFTWARE_TEXTURE_H
+#define SOFTWARE_TEXTURE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Float4.h"
+#include "MipmapGenerator.h"
+#include "TextureCache.h"
+
+// colours of the four lanes of a quad
+struct Color4
+{
+    Float4 r, g, b, a;
+};
+
+// addressing of coordinates outside [0, 1], GL_REPEAT and GL_CLAMP_TO_EDGE
+enum class TextureWrap
+{
+    REPEAT,
+    CLAMP_TO_EDGE
+};
+
+// side of the square tiles texels are stored in
+const int TEXTURE_TILE_SIZE = 8;
+
+// One level of RGBA8 texels (red in the low byte) in tiles of TEXTURE_TILE_SIZE squared, the tiles in rows and the
+// texels of a tile in Morton order, so that the four texels of a bilinear fetch mostly share a cache line.
+// The level is padded to whole tiles; `texels` may hold several layers of `layerSize` texels each.
+struct TiledLevel
+{
+    int width = 0;
+    int height = 0;
+    int tilesX = 0;
+    size_t layerSize = 0;
+    std::vector<uint32_t> texels;
+
+    TiledLevel() = default;
+    TiledLevel(int width, int height, int layersNum = 1);
+
+    // position of texel (x, y) within a layer
+    static size_t index(int x, int y, int tilesX);
+};
+
+// Textures of the software renderer: RGBA8 mip chains sampled like the textures TextureLoader creates,
+// GL_REPEAT with GL_LINEAR_MIPMAP_LINEAR for 2D images and GL_CLAMP_TO_EDGE with GL_LINEAR for cube faces.
+// Addressing, fetches and filtering take four lanes at a time. Images come from the texture cache as
+// uncompressed chains (the GL textures are BC compressed, colours differ by the compression error).
+class SoftwareTexture
+{
+public:
+
+    TextureWrap wrap = TextureWrap::REPEAT;
+
+    // the image with its full mip chain, mapped from `cache` or decoded and stored there
+    bool load(const std::string& file, const MipSettings& settings, const TextureCache& cache, bool mipmaps = true);
+
+    // a single level of RGBA pixels, rows from the top
+    void assign(int width, int height, const uint32_t* pixels);
+
+    bool empty() const { return levels.empty(); }
+    int width() const { return levels.empty() ? 0 : levels[0].width; }
+    int height() const { return levels.empty() ? 0 : levels[0].height; }
+    size_t levelsNum() const { return levels.size(); }
+    const TiledLevel& level(size_t i) const { return levels[i]; }
+
+    // level of detail of a quad from the differences of its texture coordinates between the lanes,
+    // the way the GPU takes the derivatives of a 2x2 pixel quad
+    float quadLod(Float4 u, Float4 v) const;
+
+    // GL_LINEAR_MIPMAP_LINEAR: bilinear on the first level when magnified, trilinear otherwise
+    Color4 sample(Float4 u, Float4 v) const { return sampleLod(u, v, quadLod(u, v)); }
+    Color4 sampleLod(Float4 u, Float4 v, float lod) const;
+
+    // GL_LINEAR and GL_NEAREST filtering of one level
+    Color4 sampleLevel(Float4 u, Float4 v, size_t level) const;
+    Color4 sampleNearest(Float4 u, Float4 v, size_t level) const;
+
+private:
+
+    std::vector<TiledLevel> levels;
+
+};
+
+class SoftwareCubeTexture
+{
+public:
+
+    // faces in the order +X, -X, +Y, -Y, +Z, -Z, all of one size
+    bool load(const std::vector<std::string>& files, const TextureCache& cache);
+
+    // the face is picked per lane by the major axis of `direction` as in the OpenGL specification;
+    // filtering stays within the face, there is no seamless filtering in the core profile by default
+    Color4 sample(const Vec3x4& direction) const;
+
+private:
+
+    // the six faces as layers of one level
+    TiledLevel faces;
+
+};
+
+#endif
@@ -0,0 +1,182 @@
+#include "TangentGenerator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+#include "Float4.h"
+
+namespace {
+
+const size_t TRIANGLE_GRAIN = 4096;
+const size_t VERTEX_GRAIN = 4096;
+
+// unit tangent of a triangle times its area and the handedness of its texture mapping, 0 without texture area
+struct TriangleTangent
+{
+    glm::vec3 tangent;
+    float sign;
+};
+
+void triangleTangents(const Mesh& mesh, const TangentLayout& layout, size_t begin, size_t end, TriangleTangent* out)
+{
+    const float* vertices = mesh.vertices.data();
+    const unsigned int* indices = mesh.indices.data();
+    Float4 zero(0.0f);
+
+    for (size_t first = begin; first < end; first += 4) {
+        // corners of four triangles by lane, the last triangle fills the lanes past the end
+        float p[3][3][4], uv[3][2][4];
+        for (size_t lane = 0; lane < 4; lane++) {
+            size_t triangle = std::min(first + lane, end - 1);
+            for (int corner = 0; corner < 3; corner++) {
+                const float* vertex = vertices + (size_t)indices[triangle * 3 + corner] * mesh.stride;
+                for (int i = 0; i < 3; i++)
+                    p[corner][i][lane] = vertex[layout.position + i];
+                for (int i = 0; i < 2; i++)
+                    uv[corner][i][lane] = vertex[layout.texCoord + i];
+            }
+        }
+
+        Vec3x4 p0(Float4::load(p[0][0]), Float4::load(p[0][1]), Float4::load(p[0][2]));
+        Vec3x4 edge1 = Vec3x4(Float4::load(p[1][0]), Float4::load(p[1][1]), Float4::load(p[1][2])) - p0;
+        Vec3x4 edge2 = Vec3x4(Float4::load(p[2][0]), Float4::load(p[2][1]), Float4::load(p[2][2])) - p0;
+        Float4 u0 = Float4::load(uv[0][0]), v0 = Float4::load(uv[0][1]);
+        Float4 du1 = Float4::load(uv[1][0]) - u0, dv1 = Float4::load(uv[1][1]) - v0;
+        Float4 du2 = Float4::load(uv[2][0]) - u0, dv2 = Float4::load(uv[2][1]) - v0;
+
+        // the directions of growing u and v times the determinant of the texture edges, whose sign
+        // cancels out of the handedness
+        Float4 det = du1 * dv2 - du2 * dv1;
+        Vec3x4 tangent = edge1 * dv2 - edge2 * dv1;
+        Vec3x4 bitangent = edge2 * du1 - edge1 * du2;
+        Vec3x4 faceNormal = cross(edge1, edge2);
+        Float4 handedness = dot(cross(faceNormal, tangent), bitangent);
+
+        Float4 length2 = dot(tangent, tangent);
+        Float4 area = sqrt(dot(faceNormal, faceNormal));
+        Float4 valid = (abs(det) > zero) & (length2 > zero) & (abs(handedness) > zero);
+        tangent = tangent * select(valid, select(det < zero, -area, area) / sqrt(length2), zero);
+        Float4 sign = select(valid, select(handedness < zero, Float4(-1.0f), Float4(1.0f)), zero);
+
+        float x[4], y[4], z[4], s[4];
+        tangent.x.store(x);
+        tangent.y.store(y);
+        tangent.z.store(z);
+        sign.store(s);
+        for (size_t lane = 0; lane < 4 && first + lane < end; lane++)
+            out[first + lane] = TriangleTangent{ glm::vec3(x[lane], y[lane], z[lane]), s[lane] };
+    }
+}
+
+glm::vec3 vertexNormal(const float* vertex, const TangentLayout& layout)
+{
+    glm::vec3 normal(vertex[layout.normal], vertex[layout.normal + 1], vertex[layout.normal + 2]);
+    float length = glm::length(normal);
+    return length > 0.0f ? normal / length : normal;
+}
+
+// Gram-Schmidt: the tangent without its part along the normal; a vertex without texture direction
+// takes any unit vector of its tangent plane
+glm::vec3 orthogonalize(const glm::vec3& normal, const glm::vec3& tangent)
+{
+    glm::vec3 projected = tangent - normal * glm::dot(normal, tangent);
+    float length2 = glm::dot(projected, projected);
+    if (length2 > 1.0e-12f * glm::dot(tangent, tangent))
+        return projected / std::sqrt(length2);
+
+    glm::vec3 axis = std::fabs(normal.x) < 0.9f ? glm::vec3(1.0f, 0.0f, 0.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+    return glm::normalize(axis - normal * glm::dot(normal, axis));
+}
+
+}
+
+void generateTangents(Mesh& mesh, const TangentLayout& layout, std::vector<glm::vec4>& tangents, ThreadPool& pool)
+{
+    size_t vertexCount = mesh.vertexCount();
+    size_t trianglesNum = mesh.indices.size() / 3;
+    tangents.assign(vertexCount, glm::vec4(0.0f));
+    if (std::max({ layout.position + 3, layout.normal + 3, layout.texCoord + 2 }) > mesh.stride) {
+        std::cerr << "ERROR: tangent attributes lie outside the vertices of " << mesh.stride << " floats" << std::endl;
+        return;
+    }
+
+    std::vector<TriangleTangent> triangles(trianglesNum);
+    pool.parallelFor(trianglesNum, TRIANGLE_GRAIN, [&](size_t begin, size_t end) {
+        triangleTangents(mesh, layout, begin, end, triangles.data());
+    });
+
+    // corners around every vertex, the sums below gather them instead of scattering into shared vertices
+    std::vector<unsigned int> offsets(vertexCount + 1, 0);
+    for (size_t corner = 0; corner < trianglesNum * 3; corner++)
+        offsets[mesh.indices[corner] + 1]++;
+    for (size_t i = 0; i < vertexCount; i++)
+        offsets[i + 1] += offsets[i];
+    std::vector<unsigned int> corners(trianglesNum * 3);
+    std::vector<unsigned int> cursors(offsets.begin(), offsets.end() - 1);
+    for (size_t corner = 0; corner < trianglesNum * 3; corner++)
+        corners[cursors[mesh.indices[corner]]++] = (unsigned int)corner;
+
+    // the frame of the triangles of the prevailing handedness at each vertex and of the mirrored ones, if any
+    std::vector<glm::vec4> mirrored(vertexCount, glm::vec4(0.0f));
+    pool.parallelFor(vertexCount, VERTEX_GRAIN, [&](size_t begin, size_t end) {
+        for (size_t vertex = begin; vertex < end; vertex++) {
+            glm::vec3 sums[2] = { glm::vec3(0.0f), glm::vec3(0.0f) };
+            unsigned int counts[2] = { 0, 0 };
+            for (unsigned int i = offsets[vertex]; i < offsets[vertex + 1]; i++) {
+                const TriangleTangent& triangle = triangles[corners[i] / 3];
+                if (triangle.sign != 0.0f) {
+                    int side = triangle.sign < 0.0f;
+                    sums[side] += triangle.tangent;
+                    counts[side]++;
+                }
+            }
+
+            glm::vec3 normal = vertexNormal(&mesh.vertices[vertex * mesh.stride], layout);
+            int primary = counts[1] > counts[0];
+            tangents[vertex] = glm::vec4(orthogonalize(normal, sums[primary]), primary ? -1.0f : 1.0f);
+            if (counts[1 - primary])
+                mirrored[vertex] = glm::vec4(orthogonalize(normal, sums[1 - primary]), primary ? 1.0f : -1.0f);
+        }
+    });
+
+    // copies of the mirrored vertices go to the end, the corners of their triangles are moved to them
+    for (size_t vertex = 0; vertex < vertexCount; vertex++) {
+        if (mirrored[vertex].w == 0.0f)
+            continue;
+        unsigned int copy = (unsigned int)mesh.vertexCount();
+        mesh.vertices.resize(mesh.vertices.size() + mesh.stride);
+        std::copy_n(mesh.vertices.begin() + vertex * mesh.stride, mesh.stride, mesh.vertices.begin() + (size_t)copy * mesh.stride);
+        tangents.push_back(mirrored[vertex]);
+        for (unsigned int i = offsets[vertex]; i < offsets[vertex + 1]; i++)
+            if (triangles[corners[i] / 3].sign == mirrored[vertex].w)
+                mesh.indices[corners[i]] = copy;
+    }
+}
+
+void appendTangentFrames(Mesh& mesh, const TangentLayout& layout, const std::vector<glm::vec4>& tangents)
+{
+    size_t vertexCount = mesh.vertexCount();
+    if (tangents.size() != vertexCount) {
+        std::cerr << "ERROR: " << tangents.size() << " tangent frames given for " << vertexCount << " vertices" << std::endl;
+        return;
+    }
+
+    unsigned int stride = mesh.stride + 6;
+    std::vector<float> vertices(vertexCount * stride);
+    for (size_t vertex = 0; vertex < vertexCount; vertex++) {
+        const float* source = &mesh.vertices[vertex * mesh.stride];
+        float* target = &vertices[vertex * stride];
+        std::copy(source, source + mesh.stride, target);
+
+        glm::vec3 tangent(tangents[vertex]);
+        glm::vec3 bitangent = glm::cross(vertexNormal(source, layout), tangent) * tangents[vertex].w;
+        float* frame = target + mesh.stride;
+        for (int i = 0; i < 3; i++) {
+            frame[i] = tangent[i];
+            frame[3 + i] = bitangent[i];
+        }
+    }
+    mesh.vertices.swap(vertices);
+    mesh.stride = stride;
+}
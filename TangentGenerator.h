@@ -0,0 +1,31 @@
+#ifndef TANGENT_GENERATOR_H
+#define TANGENT_GENERATOR_H
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+#include "MeshOptimizer.h"
+#include "ThreadPool.h"
+
+// first floats of the attributes the tangents are generated from within a vertex
+struct TangentLayout
+{
+    unsigned int position = 0;
+    unsigned int normal = 3;
+    unsigned int texCoord = 6;
+};
+
+// Tangent frames of an indexed mesh for normal mapping. The tangents of the triangles are taken four at a time with
+// SSE and summed per vertex weighted by the triangle areas, then made orthogonal to the vertex normal (Gram-Schmidt).
+// `tangents` gets one frame per vertex: the unit tangent in xyz and in w the sign of the bitangent, which is
+// cross(normal, tangent) * w. Vertices at texture seams are distinct vertices of the mesh already; a vertex shared by
+// triangles mirrored against each other in texture space is split, its copy taking the mirrored ones, so the mesh
+// may grow. Triangles without texture area take no part in the sums. Both passes run on the pool.
+void generateTangents(Mesh& mesh, const TangentLayout& layout, std::vector<glm::vec4>& tangents,
+    ThreadPool& pool = ThreadPool::shared());
+
+// widens the vertices by the frames as tangent and bitangent, 3 floats each, the layout VertexQuantizer takes
+void appendTangentFrames(Mesh& mesh, const TangentLayout& layout, const std::vector<glm::vec4>& tangents);
+
+#endif
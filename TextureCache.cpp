@@ -0,0 +1,308 @@
+#include "TextureCache.h"
+#include "BlockCompressor.h"
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+// MappedFile
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+bool MappedFile::open(const std::string& path)
+{
+    close();
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+        CloseHandle(file);
+        return false;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (mapping == NULL) {
+        CloseHandle(file);
+        return false;
+    }
+
+    void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (view == NULL) {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+
+    fileHandle = file;
+    mappingHandle = mapping;
+    mapped = (const unsigned char*)view;
+    mappedSize = (size_t)fileSize.QuadPart;
+#else
+    int file = ::open(path.c_str(), O_RDONLY);
+    if (file < 0)
+        return false;
+
+    struct stat fileStat;
+    if (fstat(file, &fileStat) != 0 || fileStat.st_size == 0) {
+        ::close(file);
+        return false;
+    }
+
+    void* view = mmap(nullptr, (size_t)fileStat.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+    ::close(file);
+    if (view == MAP_FAILED)
+        return false;
+
+    mapped = (const unsigned char*)view;
+    mappedSize = (size_t)fileStat.st_size;
+#endif
+
+    return true;
+}
+
+void MappedFile::close()
+{
+    if (!mapped)
+        return;
+
+#ifdef _WIN32
+    UnmapViewOfFile(mapped);
+    CloseHandle(mappingHandle);
+    CloseHandle(fileHandle);
+    mappingHandle = nullptr;
+    fileHandle = nullptr;
+#else
+    munmap((void*)mapped, mappedSize);
+#endif
+
+    mapped = nullptr;
+    mappedSize = 0;
+}
+
+// TextureCache
+
+TextureCache::TextureCache(const std::string& directory)
+    : directory(directory)
+{
+}
+
+std::string TextureCache::entryPath(const std::string& source) const
+{
+    std::string name = source;
+    for (char& c : name)
+        if (c == '/' || c == '\\' || c == ':')
+            c = '_';
+    return directory + "/" + name + ".tex";
+}
+
+uint64_t TextureCache::hash(const unsigned char* data, size_t size)
+{
+    // FNV-1a
+    uint64_t result = 14695981039346656037ull;
+    for (size_t i = 0; i < size; i++) {
+        result ^= data[i];
+        result *= 1099511628211ull;
+    }
+    return result;
+}
+
+// the level records must describe the chain of the header: each level half the size of the previous one down to
+// 1x1, with exactly the data its size and format take, inside the entry; anything else is a corrupt entry whose
+// levels would be read past the end of the mapping
+static bool validLevels(const TextureCacheHeader& header, const TextureCacheLevel* levels, size_t size)
+{
+    // larger than any texture GL takes, and small enough for the level sizes below not to overflow
+    const uint32_t MAX_SIZE = 1u << 16;
+    if (header.channelsNum < 1 || header.channelsNum > 4 || header.width == 0 || header.height == 0
+        || header.width > MAX_SIZE || header.height > MAX_SIZE)
+        return false;
+
+    uint32_t width = header.width, height = header.height;
+    for (uint32_t i = 0; i < header.levelsNum; i++) {
+        const TextureCacheLevel& level = levels[i];
+        if (i > 0) {
+            if (width == 1 && height == 1)
+                return false;
+            width = std::max(1u, width / 2);
+            height = std::max(1u, height / 2);
+        }
+        if (level.width != width || level.height != height)
+            return false;
+
+        BlockFormat format = (BlockFormat)header.format;
+        uint64_t expected = format != BlockFormat::NONE ? compressedLevelSize(format, (int)width, (int)height)
+            : (uint64_t)width * height * header.channelsNum;
+        if (level.size != expected || level.offset > size || level.size > size - level.offset)
+            return false;
+    }
+    return true;
+}
+
+std::unique_ptr<CachedTexture> TextureCache::load(const std::string& source, uint32_t settingsKey, BlockFormat format) const
+{
+    std::error_code error;
+    uint64_t sourceSize = fs::file_size(source, error);
+    if (error)
+        return nullptr;
+    int64_t sourceTime = (int64_t)fs::last_write_time(source, error).time_since_epoch().count();
+    if (error)
+        return nullptr;
+
+    std::unique_ptr<CachedTexture> entry(new CachedTexture());
+    if (!entry->file.open(entryPath(source)))
+        return nullptr;
+
+    const unsigned char* data = entry->file.data();
+    size_t size = entry->file.size();
+    if (size < sizeof(TextureCacheHeader))
+        return nullptr;
+
+    const TextureCacheHeader* header = (const TextureCacheHeader*)data;
+    if (header->magic != TEXTURE_CACHE_MAGIC || header->version != TEXTURE_CACHE_VERSION || header->levelsNum == 0)
+        return nullptr;
+    if (sizeof(TextureCacheHeader) + (size_t)header->levelsNum * sizeof(TextureCacheLevel) > size)
+        return nullptr;
+
+    if (header->settingsKey != settingsKey || header->format != (uint32_t)format || header->sourceSize != sourceSize)
+        return nullptr;
+
+    const TextureCacheLevel* levels = (const TextureCacheLevel*)(data + sizeof(TextureCacheHeader));
+    if (!validLevels(*header, levels, size))
+        return nullptr;
+
+    // the file was touched (e.g. by a checkout), it is still fresh if the contents did not change; the entry then
+    // takes the new time so that later startups skip the hash
+    if (header->sourceTime != sourceTime) {
+        std::ifstream file(source, std::ios::binary);
+        std::vector<unsigned char> contents((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        if (hash(contents.data(), contents.size()) != header->sourceHash)
+            return nullptr;
+
+        // the mapping is closed first, Windows does not open a mapped file for writing
+        entry->file.close();
+        updateSourceTime(entryPath(source), sourceTime);
+        if (!entry->file.open(entryPath(source)) || entry->file.size() != size)
+            return nullptr;
+        data = entry->file.data();
+        header = (const TextureCacheHeader*)data;
+        levels = (const TextureCacheLevel*)(data + sizeof(TextureCacheHeader));
+    }
+
+    entry->header = header;
+    entry->levels = levels;
+    return entry;
+}
+
+void TextureCache::updateSourceTime(const std::string& path, int64_t sourceTime)
+{
+    // a single field written in place, a reader mapping the entry meanwhile sees the old time or the new one
+    std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+    file.seekp(offsetof(TextureCacheHeader, sourceTime));
+    file.write((const char*)&sourceTime, sizeof(sourceTime));
+    if (!file)
+        std::cerr << "ERROR: unable to update texture cache entry " << path << std::endl;
+}
+
+bool TextureCache::store(const std::string& source, const std::vector<unsigned char>& sourceData, const MipChain& chain, uint32_t settingsKey) const
+{
+    std::error_code error;
+    fs::create_directories(directory, error);
+
+    TextureCacheHeader header;
+    header.magic = TEXTURE_CACHE_MAGIC;
+    header.version = TEXTURE_CACHE_VERSION;
+    header.width = (uint32_t)chain.width;
+    header.height = (uint32_t)chain.height;
+    header.channelsNum = (uint32_t)chain.channelsNum;
+    header.levelsNum = (uint32_t)chain.levels.size();
+    header.settingsKey = settingsKey;
+    header.format = (uint32_t)chain.format;
+    header.sourceSize = fs::file_size(source, error);
+    header.sourceTime = (int64_t)fs::last_write_time(source, error).time_since_epoch().count();
+    header.sourceHash = hash(sourceData.data(), sourceData.size());
+    if (error) {
+        std::cerr << "ERROR: unable to stat texture source " << source << std::endl;
+        return false;
+    }
+
+    uint64_t dataOffset = sizeof(TextureCacheHeader) + chain.levels.size() * sizeof(TextureCacheLevel);
+    std::vector<TextureCacheLevel> levels;
+    for (const MipLevel& level : chain.levels)
+        levels.push_back(TextureCacheLevel{ (uint32_t)level.width, (uint32_t)level.height, dataOffset + level.offset, level.size });
+
+    // written next to the entry and renamed over it so that a reader never maps a half-written file
+    std::string path = entryPath(source);
+    std::string tempPath = path + ".tmp";
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        file.write((const char*)&header, sizeof(header));
+        file.write((const char*)levels.data(), levels.size() * sizeof(TextureCacheLevel));
+        file.write((const char*)chain.pixels.data(), chain.pixels.size());
+        if (!file) {
+            std::cerr << "ERROR: unable to write texture cache entry " << tempPath << std::endl;
+            return false;
+        }
+    }
+
+    fs::rename(tempPath, path, error);
+    if (error) {
+        std::cerr << "ERROR: unable to write texture cache entry " << path << std::endl;
+        fs::remove(tempPath, error);
+        return false;
+    }
+
+    return true;
+}
+
+bool TextureCache::build(const std::string& source, const MipSettings& settings, BlockFormat format, bool mipmaps, MipChain& chain,
+    bool* stored) const
+{
+    if (stored)
+        *stored = false;
+
+    std::ifstream file(source, std::ios::binary);
+    std::vector<unsigned char> sourceData((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    if (sourceData.empty())
+        return false;
+
+    int width, height, channelsNum;
+    unsigned char* pixels = stbi_load_from_memory(sourceData.data(), (int)sourceData.size(), &width, &height, &channelsNum, 0);
+    if (!pixels)
+        return false;
+
+    chain = buildMipChain(pixels, width, height, channelsNum, settings, mipmaps);
+    stbi_image_free(pixels);
+    if (format != BlockFormat::NONE)
+        chain = compressMipChain(chain, format);
+
+    bool written = store(source, sourceData, chain, settings.key());
+    if (stored)
+        *stored = written;
+    return true;
+}
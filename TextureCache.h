@@ -0,0 +1,103 @@
+#ifndef TEXTURE_CACHE_H
+#define TEXTURE_CACHE_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "MipmapGenerator.h"
+
+// read-only memory mapping of a whole file
+class MappedFile
+{
+public:
+
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool open(const std::string& path);
+    void close();
+
+    const unsigned char* data() const { return mapped; }
+    size_t size() const { return mappedSize; }
+
+private:
+
+    const unsigned char* mapped = nullptr;
+    size_t mappedSize = 0;
+#ifdef _WIN32
+    void* fileHandle = nullptr;
+    void* mappingHandle = nullptr;
+#endif
+
+};
+
+const uint32_t TEXTURE_CACHE_MAGIC = 0x58544743; // "CGTX"
+const uint32_t TEXTURE_CACHE_VERSION = 3;
+
+// cache entry layout: header, levelsNum level records, then the pixel data of every level
+struct TextureCacheHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t width;
+    uint32_t height;
+    uint32_t channelsNum;
+    uint32_t levelsNum;
+    uint32_t settingsKey; // MipSettings::key() of the chain
+    uint32_t format;      // BlockFormat of the chain
+    uint64_t sourceSize;
+    int64_t sourceTime;
+    uint64_t sourceHash;
+};
+
+struct TextureCacheLevel
+{
+    uint32_t width;
+    uint32_t height;
+    uint64_t offset; // from the start of the entry
+    uint64_t size;
+};
+
+struct CachedTexture
+{
+    MappedFile file;
+    const TextureCacheHeader* header = nullptr;
+    const TextureCacheLevel* levels = nullptr;
+
+    const unsigned char* levelData(size_t level) const { return file.data() + levels[level].offset; }
+};
+
+class TextureCache
+{
+public:
+
+    explicit TextureCache(const std::string& directory = "cache/textures");
+
+    // maps the entry of `source` if it was built from the current version of the file with the same settings
+    // and format, nullptr otherwise
+    std::unique_ptr<CachedTexture> load(const std::string& source, uint32_t settingsKey, BlockFormat format) const;
+
+    // `sourceData` is the encoded file the chain was decoded from, its hash goes into the header
+    bool store(const std::string& source, const std::vector<unsigned char>& sourceData, const MipChain& chain, uint32_t settingsKey) const;
+
+    // decodes `source`, builds its mip chain, compresses it and stores the entry; returns false when the source
+    // can not be read or decoded, the chain is usable even if storing it failed, which `stored` tells
+    bool build(const std::string& source, const MipSettings& settings, BlockFormat format, bool mipmaps, MipChain& chain,
+        bool* stored = nullptr) const;
+
+    static uint64_t hash(const unsigned char* data, size_t size);
+
+private:
+
+    std::string directory;
+
+    std::string entryPath(const std::string& source) const;
+    static void updateSourceTime(const std::string& path, int64_t sourceTime);
+
+};
+#endif
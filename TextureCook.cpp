@@ -0,0 +1,162 @@
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "SceneTextures.h"
+#include "TextureCache.h"
+#include "ThreadPool.h"
+
+// Offline texture cooker: fills the texture cache with the same entries CompGraph would build on its first run,
+// so the application only maps them at startup. Options apply to every file that follows them; --scene takes the
+// files with their settings from SceneTextures, the table the application loads them by.
+
+struct CookJob
+{
+    std::string source;
+    std::string directory;
+    MipSettings settings;
+    BlockFormat format;
+    bool mipmaps;
+    bool force;
+};
+
+static void printUsage()
+{
+    std::cout << "usage: TextureCook [options] file...\n"
+        "options apply to every file that follows them:\n"
+        "  --scene                       cook the textures of the scene with the settings CompGraph loads them by\n"
+        "  --cache <dir>                 cache directory (cache/textures by default)\n"
+        "  --filter box|kaiser|lanczos   mip filter (kaiser by default)\n"
+        "  --srgb                        colour channels are sRGB encoded\n"
+        "  --normal                      image is a tangent space normal map\n"
+        "  --coverage <ref>              keep alpha test coverage for the reference value\n"
+        "  --format none|bc1|bc3|bc5     block compression (none by default)\n"
+        "  --no-mipmaps                  store the base level only (cube map faces)\n"
+        "  --force                       rebuild entries that are up to date\n"
+        "  --reset                       restore the default settings\n";
+}
+
+static bool parseFilter(const char* name, MipFilter& filter)
+{
+    if (!strcmp(name, "box"))
+        filter = MipFilter::BOX;
+    else if (!strcmp(name, "kaiser"))
+        filter = MipFilter::KAISER;
+    else if (!strcmp(name, "lanczos"))
+        filter = MipFilter::LANCZOS;
+    else
+        return false;
+    return true;
+}
+
+static bool parseFormat(const char* name, BlockFormat& format)
+{
+    if (!strcmp(name, "none"))
+        format = BlockFormat::NONE;
+    else if (!strcmp(name, "bc1"))
+        format = BlockFormat::BC1;
+    else if (!strcmp(name, "bc3"))
+        format = BlockFormat::BC3;
+    else if (!strcmp(name, "bc5"))
+        format = BlockFormat::BC5;
+    else
+        return false;
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    std::vector<CookJob> jobs;
+    CookJob defaults{ "", "cache/textures", MipSettings(), BlockFormat::NONE, true, false };
+    CookJob current = defaults;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        bool valid = true;
+
+        if (arg == "--scene") {
+            for (const SceneTextureEntry& entry : SceneTextures().cacheEntries())
+                jobs.push_back(CookJob{ entry.file, current.directory, entry.settings, entry.format, entry.mipmaps, current.force });
+        }
+        else if (arg == "--cache" && hasValue)
+            current.directory = argv[++i];
+        else if (arg == "--filter" && hasValue)
+            valid = parseFilter(argv[++i], current.settings.filter);
+        else if (arg == "--srgb")
+            current.settings.srgb = true;
+        else if (arg == "--normal")
+            current.settings.normalMap = true;
+        else if (arg == "--coverage" && hasValue)
+            current.settings.alphaCoverage = (float)atof(argv[++i]);
+        else if (arg == "--format" && hasValue)
+            valid = parseFormat(argv[++i], current.format);
+        else if (arg == "--no-mipmaps")
+            current.mipmaps = false;
+        else if (arg == "--force")
+            current.force = true;
+        else if (arg == "--reset") {
+            std::string directory = current.directory;
+            current = defaults;
+            current.directory = directory;
+        }
+        else if (arg.compare(0, 2, "--") == 0)
+            valid = false;
+        else {
+            current.source = arg;
+            jobs.push_back(current);
+        }
+
+        if (!valid) {
+            std::cerr << "ERROR: invalid option " << arg << std::endl;
+            printUsage();
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (jobs.empty()) {
+        printUsage();
+        return EXIT_FAILURE;
+    }
+
+    // files are cooked in parallel, each of them also splits its levels across the same pool
+    std::mutex outputMutex;
+    unsigned int cooked = 0, failed = 0;
+    ThreadPool::shared().parallelFor(jobs.size(), 1, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            const CookJob& job = jobs[i];
+            TextureCache cache(job.directory);
+
+            // an entry is fresh only if TextureLoader would take it, which also needs the levels the job asks for
+            if (!job.force) {
+                std::unique_ptr<CachedTexture> cached = cache.load(job.source, job.settings.key(), job.format);
+                if (cached && cached->header->levelsNum == (job.mipmaps ? mipChainLength(cached->header->width, cached->header->height) : 1))
+                    continue;
+            }
+
+            MipChain chain;
+            bool stored = false;
+            bool built = cache.build(job.source, job.settings, job.format, job.mipmaps, chain, &stored);
+
+            // store() has printed why the entry was not written
+            std::lock_guard<std::mutex> lock(outputMutex);
+            if (built && stored) {
+                std::cout << "Cooked " << job.source << " (" << chain.width << "x" << chain.height << ", "
+                    << chain.levels.size() << " levels, " << chain.pixels.size() << " bytes)\n";
+                cooked++;
+            }
+            else {
+                std::cerr << "ERROR: unable to cook texture from file " << job.source << std::endl;
+                failed++;
+            }
+        }
+    });
+
+    std::cout << "Cooked " << cooked << " of " << jobs.size() << " textures, "
+        << jobs.size() - cooked - failed << " up to date, " << failed << " failed\n";
+    return failed > 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,287 @@
+#include "TextureLoader.h"
+#include "GLExtensions.h"
+#include "GLStateCache.h"
+
+#include <algorithm>
+#include <iostream>
+
+static bool formatSupported(BlockFormat format)
+{
+    if (format == BlockFormat::BC1 || format == BlockFormat::BC3)
+        return hasGLExtension("GL_EXT_texture_compression_s3tc");
+    return true;
+}
+
+static GLenum pixelFormat(int channelsNum)
+{
+    if (channelsNum == 1)
+        return GL_RED;
+    if (channelsNum == 4)
+        return GL_RGBA;
+    return GL_RGB;
+}
+
+static GLenum compressedFormat(BlockFormat format)
+{
+    switch (format) {
+    case BlockFormat::BC1:
+        return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+    case BlockFormat::BC3:
+        return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+    default:
+        return GL_COMPRESSED_RG_RGTC2;
+    }
+}
+
+TextureLoader::TextureLoader(ThreadPool& pool, const TextureCache& cache)
+    : pool(pool), cache(cache)
+{
+}
+
+TextureLoader::~TextureLoader()
+{
+    for (std::future<void>& job : jobs)
+        job.wait();
+}
+
+unsigned int TextureLoader::addTexture(const char* filename, const MipSettings& settings, BlockFormat format)
+{
+    return addRequest(GL_TEXTURE_2D, std::vector<std::string>{ filename }, settings, format);
+}
+
+unsigned int TextureLoader::addCubeTexture(const std::vector<std::string>& faces, BlockFormat format)
+{
+    return addRequest(GL_TEXTURE_CUBE_MAP, faces, MipSettings(), format);
+}
+
+unsigned int TextureLoader::addTextureArray(const std::vector<std::string>& files, const MipSettings& settings, BlockFormat format)
+{
+    return addRequest(GL_TEXTURE_2D_ARRAY, files, settings, format);
+}
+
+unsigned int TextureLoader::addRequest(GLenum target, const std::vector<std::string>& files, const MipSettings& settings, BlockFormat format)
+{
+    if (!formatSupported(format))
+        format = BlockFormat::NONE;
+
+    if (pendingImages == 0) {
+        startTime = std::chrono::steady_clock::now();
+        cacheHits = 0;
+    }
+
+    Request request;
+    glGenTextures(1, &request.tex);
+    request.target = target;
+    request.settings = settings;
+    request.format = format;
+    request.files = files;
+    request.images.resize(files.size());
+    request.pendingImages = (unsigned int)files.size();
+    requests.push_back(std::move(request));
+
+    // cube faces are sampled without mipmaps
+    bool mipmaps = target != GL_TEXTURE_CUBE_MAP;
+    size_t index = requests.size() - 1;
+    for (size_t i = 0; i < files.size(); i++) {
+        pendingImages++;
+        jobs.push_back(pool.submit([this, index, i, filename = files[i], settings, format, mipmaps]() {
+            decode(index, i, filename, settings, format, mipmaps);
+        }));
+    }
+
+    return requests.back().tex;
+}
+
+void TextureLoader::decode(size_t request, size_t face, std::string filename, MipSettings settings, BlockFormat format, bool mipmaps)
+{
+    DecodedImage result{ request, face, TextureImage() };
+    TextureImage& image = result.image;
+
+    std::unique_ptr<CachedTexture> cached = cache.load(filename, settings.key(), format);
+    if (cached) {
+        const TextureCacheHeader& header = *cached->header;
+        if (header.levelsNum != (mipmaps ? mipChainLength(header.width, header.height) : 1))
+            cached.reset();
+    }
+
+    if (cached) {
+        const TextureCacheHeader& header = *cached->header;
+        image.width = header.width;
+        image.height = header.height;
+        image.channelsNum = header.channelsNum;
+        image.format = format;
+        for (uint32_t i = 0; i < header.levelsNum; i++) {
+            const TextureCacheLevel& level = cached->levels[i];
+            image.levels.push_back(MipLevel{ (int)level.width, (int)level.height, (size_t)level.offset, (size_t)level.size });
+        }
+        image.data = cached->file.data();
+        image.cached = std::move(cached);
+        cacheHits++;
+    }
+    else if (cache.build(filename, settings, format, mipmaps, image.chain)) {
+        image.width = image.chain.width;
+        image.height = image.chain.height;
+        image.channelsNum = image.chain.channelsNum;
+        image.format = image.chain.format;
+        image.levels = image.chain.levels;
+        image.data = image.chain.pixels.data();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(decodedMutex);
+        decoded.push(std::move(result));
+    }
+    decodedCondition.notify_one();
+}
+
+void TextureLoader::finish()
+{
+    size_t imagesNum = pendingImages;
+
+    while (pendingImages > 0) {
+        DecodedImage result;
+        {
+            std::unique_lock<std::mutex> lock(decodedMutex);
+            decodedCondition.wait(lock, [this]() { return !decoded.empty(); });
+            result = std::move(decoded.front());
+            decoded.pop();
+        }
+        pendingImages--;
+
+        Request& request = requests[result.request];
+        request.images[result.face] = std::move(result.image);
+        if (--request.pendingImages == 0)
+            upload(request);
+    }
+
+    for (std::future<void>& job : jobs)
+        job.get();
+    jobs.clear();
+
+    if (imagesNum > 0) {
+        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startTime);
+        std::cout << "Loaded " << imagesNum << " images (" << cacheHits << " from cache) on " << pool.size()
+            << " threads in " << elapsed.count() << " ms\n";
+    }
+}
+
+void TextureLoader::upload(Request& request)
+{
+    // mip levels of RGB images have rows that are not 4-byte aligned
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+    if (request.target == GL_TEXTURE_CUBE_MAP)
+        uploadCubeTexture(request);
+    else if (request.target == GL_TEXTURE_2D_ARRAY)
+        uploadTextureArray(request);
+    else
+        uploadTexture(request);
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+    for (TextureImage& image : request.images)
+        image = TextureImage();
+}
+
+void TextureLoader::uploadTexture(Request& request)
+{
+    TextureImage& image = request.images[0];
+    if (!image.data) {
+        std::cerr << "ERROR: unable to load texture from file " << request.files[0] << std::endl;
+        return;
+    }
+
+    GLenum internalFormat = pixelFormat(image.channelsNum), dataFormat = internalFormat;
+
+    GLStateCache::shared().bindTexture(GL_TEXTURE_2D, request.tex);
+    for (size_t i = 0; i < image.levels.size(); i++) {
+        const MipLevel& level = image.levels[i];
+        if (image.format != BlockFormat::NONE)
+            glCompressedTexImage2D(GL_TEXTURE_2D, (GLint)i, compressedFormat(image.format), level.width, level.height, 0, (GLsizei)level.size, image.data + level.offset);
+        else
+            glTexImage2D(GL_TEXTURE_2D, (GLint)i, internalFormat, level.width, level.height, 0, dataFormat, GL_UNSIGNED_BYTE, image.data + level.offset);
+    }
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint)image.levels.size() - 1);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+}
+
+void TextureLoader::uploadCubeTexture(Request& request)
+{
+    GLStateCache::shared().bindTexture(GL_TEXTURE_CUBE_MAP, request.tex);
+
+    for (unsigned int i = 0; i < request.images.size(); i++) {
+        TextureImage& image = request.images[i];
+        MipLevel level = image.levels.empty() ? MipLevel() : image.levels[0];
+        if (image.data && image.format != BlockFormat::NONE)
+            glCompressedTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, compressedFormat(image.format), level.width, level.height, 0, (GLsizei)level.size, image.data + level.offset);
+        else if (image.data)
+            glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB, level.width, level.height, 0, GL_RGB, GL_UNSIGNED_BYTE, image.data + level.offset);
+        else
+            std::cerr << "ERROR: unable to load cubemap from file " << request.files[i] << std::endl;
+    }
+
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+}
+
+void TextureLoader::uploadTextureArray(Request& request)
+{
+    const TextureImage* base = nullptr;
+    for (size_t i = 0; i < request.images.size(); i++) {
+        const TextureImage& image = request.images[i];
+        if (!image.data)
+            std::cerr << "ERROR: unable to load texture from file " << request.files[i] << std::endl;
+        else if (!base || image.width < base->width)
+            base = &image;
+    }
+    if (!base)
+        return;
+
+    // every level is allocated for all layers first, the layers are then copied in level by level
+    GLsizei layersNum = (GLsizei)request.images.size();
+    BlockFormat format = base->format;
+    GLenum internalFormat = format != BlockFormat::NONE ? compressedFormat(format) : GL_RGBA8;
+    GLStateCache::shared().bindTexture(GL_TEXTURE_2D_ARRAY, request.tex);
+    for (size_t i = 0; i < base->levels.size(); i++) {
+        const MipLevel& level = base->levels[i];
+        if (format != BlockFormat::NONE)
+            glCompressedTexImage3D(GL_TEXTURE_2D_ARRAY, (GLint)i, internalFormat, level.width, level.height, layersNum, 0, (GLsizei)level.size * layersNum, nullptr);
+        else
+            glTexImage3D(GL_TEXTURE_2D_ARRAY, (GLint)i, internalFormat, level.width, level.height, layersNum, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    }
+
+    for (size_t layer = 0; layer < request.images.size(); layer++) {
+        const TextureImage& image = request.images[layer];
+        if (!image.data)
+            continue;
+
+        size_t first = 0;
+        while (first < image.levels.size() && image.levels[first].width > base->width)
+            first++;
+        if (image.format != format || image.levels.size() - first != base->levels.size()
+            || image.levels[first].height != base->height) {
+            std::cerr << "ERROR: texture " << request.files[layer] << " does not match the size or format of the other layers" << std::endl;
+            continue;
+        }
+
+        for (size_t i = 0; i < base->levels.size(); i++) {
+            const MipLevel& level = image.levels[first + i];
+            if (format != BlockFormat::NONE)
+                glCompressedTexSubImage3D(GL_TEXTURE_2D_ARRAY, (GLint)i, 0, 0, (GLint)layer, level.width, level.height, 1, internalFormat, (GLsizei)level.size, image.data + level.offset);
+            else
+                glTexSubImage3D(GL_TEXTURE_2D_ARRAY, (GLint)i, 0, 0, (GLint)layer, level.width, level.height, 1, pixelFormat(image.channelsNum), GL_UNSIGNED_BYTE, image.data + level.offset);
+        }
+    }
+
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, (GLint)base->levels.size() - 1);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+}
@@ -0,0 +1,93 @@
+#ifndef TEXTURE_LOADER_H
+#define TEXTURE_LOADER_H
+
+#include <glad/glad.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <vector>
+
+#include "ThreadPool.h"
+#include "MipmapGenerator.h"
+#include "TextureCache.h"
+
+// pixels of one image with its mip levels, either freshly decoded or mapped from the texture cache
+struct TextureImage
+{
+    int width = 0;
+    int height = 0;
+    int channelsNum = 0;
+    BlockFormat format = BlockFormat::NONE;
+    std::vector<MipLevel> levels; // offsets are relative to data
+    const unsigned char* data = nullptr;
+
+    MipChain chain;
+    std::unique_ptr<CachedTexture> cached;
+};
+
+// Decodes images on the worker pool as soon as they are requested and uploads them on the GL thread in finish().
+// Decoded images are stored in the texture cache together with their mip chains, later runs map them instead.
+class TextureLoader
+{
+public:
+
+    explicit TextureLoader(ThreadPool& pool = ThreadPool::shared(), const TextureCache& cache = TextureCache());
+    ~TextureLoader();
+
+    // both return the texture name right away, its storage is filled by finish();
+    // BC1/BC3 fall back to uncompressed data when the driver has no S3TC support
+    unsigned int addTexture(const char* filename, const MipSettings& settings = MipSettings(), BlockFormat format = BlockFormat::NONE);
+    unsigned int addCubeTexture(const std::vector<std::string>& faces, BlockFormat format = BlockFormat::NONE);
+    // GL_TEXTURE_2D_ARRAY with a layer per file; layers share the size of the smallest image,
+    // larger images start at their mip level of that size
+    unsigned int addTextureArray(const std::vector<std::string>& files, const MipSettings& settings = MipSettings(), BlockFormat format = BlockFormat::NONE);
+
+    // uploads images in completion order until everything requested so far is on the GPU
+    void finish();
+
+private:
+
+    struct Request
+    {
+        unsigned int tex;
+        GLenum target;
+        MipSettings settings;
+        BlockFormat format;
+        std::vector<std::string> files;
+        std::vector<TextureImage> images;
+        unsigned int pendingImages;
+    };
+
+    struct DecodedImage
+    {
+        size_t request;
+        size_t face;
+        TextureImage image;
+    };
+
+    ThreadPool& pool;
+    TextureCache cache;
+    std::vector<Request> requests;
+    std::vector<std::future<void>> jobs;
+    std::queue<DecodedImage> decoded;
+    std::mutex decodedMutex;
+    std::condition_variable decodedCondition;
+    size_t pendingImages = 0;
+    std::atomic<size_t> cacheHits{ 0 };
+    std::chrono::steady_clock::time_point startTime;
+
+    unsigned int addRequest(GLenum target, const std::vector<std::string>& files, const MipSettings& settings, BlockFormat format);
+    void decode(size_t request, size_t face, std::string filename, MipSettings settings, BlockFormat format, bool mipmaps);
+    void upload(Request& request);
+    void uploadTexture(Request& request);
+    void uploadCubeTexture(Request& request);
+    void uploadTextureArray(Request& request);
+
+};
+#endif
@@ -0,0 +1,100 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+
+ThreadPool::ThreadPool(unsigned int threadsNum)
+{
+    if (threadsNum == 0)
+        threadsNum = std::max(1u, std::thread::hardware_concurrency());
+
+    workers.reserve(threadsNum);
+    for (unsigned int i = 0; i < threadsNum; i++)
+        workers.emplace_back(&ThreadPool::workerLoop, this);
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(tasksMutex);
+        stopping = true;
+    }
+    tasksCondition.notify_all();
+    for (std::thread& worker : workers)
+        worker.join();
+}
+
+void ThreadPool::enqueue(std::function<void()> task)
+{
+    {
+        std::lock_guard<std::mutex> lock(tasksMutex);
+        tasks.push(std::move(task));
+    }
+    tasksCondition.notify_one();
+}
+
+void ThreadPool::workerLoop()
+{
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(tasksMutex);
+            tasksCondition.wait(lock, [this]() { return stopping || !tasks.empty(); });
+            if (stopping && tasks.empty())
+                return;
+            task = std::move(tasks.front());
+            tasks.pop();
+        }
+        task();
+    }
+}
+
+void ThreadPool::parallelFor(size_t count, size_t grain, const std::function<void(size_t begin, size_t end)>& body)
+{
+    if (count == 0)
+        return;
+    if (grain == 0)
+        grain = 1;
+
+    size_t chunksNum = (count + grain - 1) / grain;
+    if (chunksNum == 1) {
+        body(0, count);
+        return;
+    }
+
+    // chunks are claimed through a shared counter, helpers that arrive late simply find nothing left
+    struct Shared
+    {
+        std::atomic<size_t> nextChunk{ 0 };
+        std::atomic<size_t> doneChunks{ 0 };
+        std::mutex doneMutex;
+        std::condition_variable doneCondition;
+    };
+    auto state = std::make_shared<Shared>();
+
+    auto run = [state, count, grain, chunksNum, &body]() {
+        size_t chunk;
+        while ((chunk = state->nextChunk.fetch_add(1)) < chunksNum) {
+            size_t begin = chunk * grain;
+            size_t end = std::min(count, begin + grain);
+            body(begin, end);
+            if (state->doneChunks.fetch_add(1) + 1 == chunksNum) {
+                std::lock_guard<std::mutex> lock(state->doneMutex);
+                state->doneCondition.notify_all();
+            }
+        }
+    };
+
+    size_t helpersNum = std::min<size_t>(workers.size(), chunksNum - 1);
+    for (size_t i = 0; i < helpersNum; i++)
+        enqueue(run);
+    run();
+
+    std::unique_lock<std::mutex> lock(state->doneMutex);
+    state->doneCondition.wait(lock, [&]() { return state->doneChunks.load() == chunksNum; });
+}
+
+ThreadPool& ThreadPool::shared()
+{
+    static ThreadPool pool;
+    return pool;
+}
@@ -0,0 +1,54 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+class ThreadPool
+{
+public:
+
+    // threadsNum == 0 means one worker per hardware thread
+    explicit ThreadPool(unsigned int threadsNum = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    unsigned int size() const { return (unsigned int)workers.size(); }
+
+    template<class F>
+    std::future<void> submit(F&& task)
+    {
+        auto packaged = std::make_shared<std::packaged_task<void()>>(std::forward<F>(task));
+        std::future<void> result = packaged->get_future();
+        enqueue([packaged]() { (*packaged)(); });
+        return result;
+    }
+
+    // splits [0, count) into chunks of `grain` items; the calling thread takes part in the work,
+    // so it is safe to call from inside a pool task
+    void parallelFor(size_t count, size_t grain, const std::function<void(size_t begin, size_t end)>& body);
+
+    static ThreadPool& shared();
+
+private:
+
+    std::vector<std::thread> workers;
+    std::queue<std::function<void()>> tasks;
+    std::mutex tasksMutex;
+    std::condition_variable tasksCondition;
+    bool stopping = false;
+
+    void enqueue(std::function<void()> task);
+    void workerLoop();
+
+};
+#endif
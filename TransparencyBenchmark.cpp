@@ -0,0 +1,58 @@
+#include "TransparencyBenchmark.h"
+
+#include <cstdio>
+#include <iostream>
+#include <random>
+
+TransparencyBenchmark::TransparencyBenchmark()
+    : counts{ 6, 100, 1000, 10000, 100000, 1000000 }
+{
+}
+
+void TransparencyBenchmark::start(const glm::vec3& center, const glm::vec3& extent)
+{
+    this->center = center;
+    this->extent = extent;
+    results.clear();
+    startSteps(counts.size() * 2);
+    generate();
+    std::cout << "Transparency benchmark started\n";
+}
+
+void TransparencyBenchmark::generate()
+{
+    // the same positions for both paths of a count
+    unsigned int count = counts[currentStep() / 2];
+    std::mt19937 random(count);
+    std::uniform_real_distribution<float> offset(-1.0f, 1.0f);
+    instances.resize(count);
+    for (glm::vec3& position : instances)
+        position = center + extent * glm::vec3(offset(random), offset(random), offset(random));
+}
+
+void TransparencyBenchmark::stepMeasured(size_t step, const BenchmarkTimes& times)
+{
+    if (step % 2 == 0)
+        results.push_back(Result{ counts[step / 2], { 0.0, 0.0 }, { 0.0, 0.0 } });
+    results.back().cpuTime[step % 2] = times.cpu;
+    results.back().gpuTime[step % 2] = times.gpu;
+
+    if (active()) {
+        if (currentStep() % 2 == 0)
+            generate();
+    }
+    else
+        printResults();
+}
+
+void TransparencyBenchmark::printResults() const
+{
+    std::cout << "Transparency benchmark, ms per frame (CPU: culling, sorting and upload, GPU: transparent pass)\n";
+    std::cout << " instances |  sorted CPU |  sorted GPU | weighted CPU | weighted GPU\n";
+    for (const Result& result : results) {
+        char line[128];
+        snprintf(line, sizeof(line), "%10u | %11.3f | %11.3f | %12.3f | %12.3f\n", result.count,
+            result.cpuTime[0], result.gpuTime[0], result.cpuTime[1], result.gpuTime[1]);
+        std::cout << line;
+    }
+}
@@ -0,0 +1,46 @@
+#ifndef TRANSPARENCY_BENCHMARK_H
+#define TRANSPARENCY_BENCHMARK_H
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+#include "Benchmark.h"
+
+// Replaces the windows with growing numbers of randomly placed ones and renders every count with the sorted
+// and the weighted blended path. Each frame records the CPU time of culling, sorting and uploading the instances
+// and the GPU time of the transparent pass (with the composite), the averages are printed as a table at the end.
+class TransparencyBenchmark : public Benchmark
+{
+public:
+
+    TransparencyBenchmark();
+
+    // instances are spread over the box (center, extent)
+    void start(const glm::vec3& center, const glm::vec3& extent);
+
+    // instances and path of the current step
+    const std::vector<glm::vec3>& positions() const { return instances; }
+    bool weightedBlended() const { return currentStep() % 2 == 1; }
+
+private:
+
+    struct Result
+    {
+        unsigned int count;
+        double cpuTime[2];
+        double gpuTime[2];
+    };
+
+    std::vector<unsigned int> counts;
+    glm::vec3 center;
+    glm::vec3 extent;
+    std::vector<glm::vec3> instances;
+    std::vector<Result> results;
+
+    void stepMeasured(size_t step, const BenchmarkTimes& times) override;
+    void generate();
+    void printResults() const;
+
+};
+#endif
@@ -0,0 +1,188 @@
+#include "TransparencySorter.h"
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SORTER_SSE2
+#include <emmintrin.h>
+#endif
+#if defined(__AVX__)
+#define SORTER_AVX
+#include <immintrin.h>
+#endif
+
+const uint32_t INVISIBLE_SLOT = 0xFFFFFFFF;
+
+// the refinement may move every instance by one place on average before it is cheaper to sort again
+const size_t REFINE_MOVES_PER_INSTANCE = 1;
+
+const int RADIX_BITS = 11;
+const uint32_t RADIX_SIZE = 1u << RADIX_BITS;
+
+// Non-negative floats compare like their bit patterns, inverting them makes the far instances sort first
+static inline uint32_t farFirstKey(float squaredDistance)
+{
+    uint32_t bits;
+    memcpy(&bits, &squaredDistance, sizeof(bits));
+    return ~bits;
+}
+
+const std::vector<unsigned int>& TransparencySorter::sort(const glm::vec3* positions, const unsigned char* visible, size_t count, const glm::vec3& viewPosition)
+{
+    // dropping invisible instances, the visible ones are gathered into coordinate arrays for the key computation
+    indices.resize(count);
+    x.resize(count);
+    y.resize(count);
+    z.resize(count);
+    slots.resize(count);
+    size_t visibleNum = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (visible && !visible[i]) {
+            slots[i] = INVISIBLE_SLOT;
+            continue;
+        }
+        slots[i] = (uint32_t)visibleNum;
+        indices[visibleNum] = (unsigned int)i;
+        x[visibleNum] = positions[i].x;
+        y[visibleNum] = positions[i].y;
+        z[visibleNum] = positions[i].z;
+        visibleNum++;
+    }
+    indices.resize(visibleNum);
+    x.resize(visibleNum);
+    y.resize(visibleNum);
+    z.resize(visibleNum);
+
+    computeKeys(viewPosition);
+
+    refined = previousCount == count && refine();
+    if (!refined)
+        radixSort();
+
+    previousOrder = order;
+    previousCount = count;
+    return order;
+}
+
+void TransparencySorter::computeKeys(const glm::vec3& viewPosition)
+{
+    size_t n = indices.size();
+    keys.resize(n);
+    size_t i = 0;
+
+#ifdef SORTER_AVX
+    __m256 vx8 = _mm256_set1_ps(viewPosition.x), vy8 = _mm256_set1_ps(viewPosition.y), vz8 = _mm256_set1_ps(viewPosition.z);
+    __m256i ones8 = _mm256_set1_epi32(-1);
+    for (; i + 8 <= n; i += 8) {
+        __m256 dx = _mm256_sub_ps(_mm256_loadu_ps(&x[i]), vx8);
+        __m256 dy = _mm256_sub_ps(_mm256_loadu_ps(&y[i]), vy8);
+        __m256 dz = _mm256_sub_ps(_mm256_loadu_ps(&z[i]), vz8);
+        __m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)), _mm256_mul_ps(dz, dz));
+        __m256i bits = _mm256_castps_si256(distance);
+        // inverting without AVX2 integer operations
+        __m256i key = _mm256_castps_si256(_mm256_xor_ps(_mm256_castsi256_ps(bits), _mm256_castsi256_ps(ones8)));
+        _mm256_storeu_si256((__m256i*)&keys[i], key);
+    }
+#endif
+#ifdef SORTER_SSE2
+    __m128 vx4 = _mm_set1_ps(viewPosition.x), vy4 = _mm_set1_ps(viewPosition.y), vz4 = _mm_set1_ps(viewPosition.z);
+    __m128i ones4 = _mm_set1_epi32(-1);
+    for (; i + 4 <= n; i += 4) {
+        __m128 dx = _mm_sub_ps(_mm_loadu_ps(&x[i]), vx4);
+        __m128 dy = _mm_sub_ps(_mm_loadu_ps(&y[i]), vy4);
+        __m128 dz = _mm_sub_ps(_mm_loadu_ps(&z[i]), vz4);
+        __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+        _mm_storeu_si128((__m128i*)&keys[i], _mm_xor_si128(_mm_castps_si128(distance), ones4));
+    }
+#endif
+    for (; i < n; i++) {
+        float dx = x[i] - viewPosition.x, dy = y[i] - viewPosition.y, dz = z[i] - viewPosition.z;
+        keys[i] = farFirstKey(dx * dx + dy * dy + dz * dz);
+    }
+}
+
+// Insertion sort over the previous order: instances that stayed visible keep their place, newly visible ones
+// are appended and sink to theirs. Returns false when the move budget runs out.
+bool TransparencySorter::refine()
+{
+    size_t n = indices.size();
+    order.clear();
+    for (unsigned int instance : previousOrder) {
+        if (slots[instance] != INVISIBLE_SLOT)
+            order.push_back(instance);
+    }
+    if (order.size() != n) {
+        // marking the instances already placed to find the newly visible ones
+        for (unsigned int instance : order)
+            slots[instance] |= 0x80000000u;
+        for (unsigned int instance : indices) {
+            if (!(slots[instance] & 0x80000000u))
+                order.push_back(instance);
+        }
+        for (unsigned int instance : order)
+            slots[instance] &= 0x7FFFFFFFu;
+    }
+
+    tempKeys.resize(n);
+    for (size_t i = 0; i < n; i++)
+        tempKeys[i] = keys[slots[order[i]]];
+
+    size_t budget = n * REFINE_MOVES_PER_INSTANCE;
+    for (size_t i = 1; i < n; i++) {
+        uint32_t key = tempKeys[i];
+        unsigned int instance = order[i];
+        size_t j = i;
+        while (j > 0 && tempKeys[j - 1] > key) {
+            if (budget-- == 0)
+                return false;
+            tempKeys[j] = tempKeys[j - 1];
+            order[j] = order[j - 1];
+            j--;
+        }
+        tempKeys[j] = key;
+        order[j] = instance;
+    }
+    return true;
+}
+
+// LSD radix sort of (key, instance) pairs, 11 bits per pass; passes in which every key has the same digit are skipped
+void TransparencySorter::radixSort()
+{
+    size_t n = indices.size();
+    order = indices;
+    tempKeys.resize(n);
+    tempOrder.resize(n);
+
+    uint32_t* srcKeys = keys.data();
+    uint32_t* dstKeys = tempKeys.data();
+    unsigned int* srcOrder = order.data();
+    unsigned int* dstOrder = tempOrder.data();
+
+    std::vector<uint32_t> histogram(RADIX_SIZE);
+    for (int shift = 0; shift < 32; shift += RADIX_BITS) {
+        std::fill(histogram.begin(), histogram.end(), 0);
+        for (size_t i = 0; i < n; i++)
+            histogram[(srcKeys[i] >> shift) & (RADIX_SIZE - 1)]++;
+        if (n == 0 || histogram[(srcKeys[0] >> shift) & (RADIX_SIZE - 1)] == n)
+            continue;
+
+        uint32_t offset = 0;
+        for (uint32_t& bucket : histogram) {
+            uint32_t size = bucket;
+            bucket = offset;
+            offset += size;
+        }
+        for (size_t i = 0; i < n; i++) {
+            uint32_t position = histogram[(srcKeys[i] >> shift) & (RADIX_SIZE - 1)]++;
+            dstKeys[position] = srcKeys[i];
+            dstOrder[position] = srcOrder[i];
+        }
+        std::swap(srcKeys, dstKeys);
+        std::swap(srcOrder, dstOrder);
+    }
+
+    if (srcOrder != order.data())
+        memcpy(order.data(), srcOrder, n * sizeof(unsigned int));
+}
@@ -0,0 +1,43 @@
+#ifndef TRANSPARENCY_SORTER_H
+#define TRANSPARENCY_SORTER_H
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Back to front order of transparent instances, keyed by their squared distance to the camera.
+// Invisible instances are dropped first, the keys of the rest are computed with SSE/AVX and sorted with an LSD radix sort.
+// While the camera moves little the order of the previous frame is almost right, it is then only refined
+// with an insertion sort, which gives up and falls back to the radix sort once it has moved too many instances.
+class TransparencySorter
+{
+public:
+
+    // true when the last sort reused the previous order
+    bool refined = false;
+
+    // returns indices of the visible positions, farthest first; `visible` may be null when every position is visible
+    const std::vector<unsigned int>& sort(const glm::vec3* positions, const unsigned char* visible, size_t count, const glm::vec3& viewPosition);
+
+private:
+
+    std::vector<unsigned int> order;
+    std::vector<unsigned int> previousOrder;
+    size_t previousCount = 0;
+
+    // scratch buffers of the visible instances, indexed by their position in `indices`
+    std::vector<unsigned int> indices;
+    std::vector<float> x, y, z;
+    std::vector<uint32_t> keys;
+    std::vector<uint32_t> slots;   // instance -> position in `indices`, or UINT32_MAX when invisible
+    std::vector<uint32_t> tempKeys;
+    std::vector<unsigned int> tempOrder;
+
+    void computeKeys(const glm::vec3& viewPosition);
+    bool refine();
+    void radixSort();
+
+};
+#endif
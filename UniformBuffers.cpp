@@ -0,0 +1,74 @@
+#include "UniformBuffers.h"
+
+#include <cstring>
+#include <iostream>
+
+static size_t alignUp(size_t value, size_t alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+UniformBuffers::UniformBuffers(unsigned int maxObjects)
+    : frame(), maxObjects(maxObjects), objectsNum(0)
+{
+    // ranges bound with glBindBufferRange have to start at a multiple of the offset alignment
+    GLint alignment = 256;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    objectsOffset = alignUp(sizeof(FrameUniforms), (size_t)alignment);
+    objectStride = alignUp(sizeof(ObjectUniforms), (size_t)alignment);
+    data.resize(objectsOffset + objectStride * maxObjects);
+
+    glGenBuffers(1, &buffer);
+    glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+    glBufferData(GL_UNIFORM_BUFFER, data.size(), nullptr, GL_STREAM_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+UniformBuffers::~UniformBuffers()
+{
+    glDeleteBuffers(1, &buffer);
+}
+
+void UniformBuffers::attach(const Shader& shader) const
+{
+    shader.bindUniformBlock("FrameUniforms", FRAME_UNIFORMS_BINDING);
+    shader.bindUniformBlock("ObjectUniforms", OBJECT_UNIFORMS_BINDING);
+}
+
+void UniformBuffers::beginFrame()
+{
+    objectsNum = 0;
+}
+
+unsigned int UniformBuffers::addObject(const glm::mat4& model, float shininess)
+{
+    if (objectsNum == maxObjects) {
+        std::cerr << "ERROR: too many objects in the frame, the limit is " << maxObjects << std::endl;
+        return maxObjects - 1;
+    }
+
+    ObjectUniforms object = {};
+    object.model = model;
+    object.normalMatrix = glm::mat4(glm::transpose(glm::inverse(glm::mat3(model))));
+    object.shininess = shininess;
+    memcpy(&data[objectsOffset + objectStride * objectsNum], &object, sizeof(object));
+    return objectsNum++;
+}
+
+void UniformBuffers::upload()
+{
+    memcpy(&data[0], &frame, sizeof(frame));
+
+    // orphaning the storage keeps the driver from waiting for draws of the previous frame
+    glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+    glBufferData(GL_UNIFORM_BUFFER, data.size(), nullptr, GL_STREAM_DRAW);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, objectsOffset + objectStride * objectsNum, data.data());
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    glBindBufferRange(GL_UNIFORM_BUFFER, FRAME_UNIFORMS_BINDING, buffer, 0, sizeof(FrameUniforms));
+}
+
+void UniformBuffers::bindObject(unsigned int object) const
+{
+    glBindBufferRange(GL_UNIFORM_BUFFER, OBJECT_UNIFORMS_BINDING, buffer, objectsOffset + objectStride * object, sizeof(ObjectUniforms));
+}
@@ -0,0 +1,94 @@
+#ifndef UNIFORM_BUFFERS_H
+#define UNIFORM_BUFFERS_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <vector>
+
+#include "Shader.h"
+
+// binding points of the uniform blocks declared in the shaders
+const GLuint FRAME_UNIFORMS_BINDING = 0;
+const GLuint OBJECT_UNIFORMS_BINDING = 1;
+
+// std140 layout of the FrameUniforms block (shaders/uniforms.glsl), vec3 members are aligned to 16 bytes
+struct FrameUniforms
+{
+    glm::mat4 view;
+    glm::mat4 projection;
+    glm::mat4 skyboxView;   // view without translation
+    glm::vec3 viewPosition;
+    float fogDensity;
+    glm::vec3 lightPosition;
+    float fogGradient;
+    glm::vec3 lightColor;
+    float padding0;
+    glm::vec3 fogColor;
+    float padding1;
+    glm::vec3 camUp;
+    float padding2;
+    glm::vec3 camRight;
+    float padding3;
+};
+
+static_assert(offsetof(FrameUniforms, view) == 0, "FrameUniforms layout does not match std140");
+static_assert(offsetof(FrameUniforms, projection) == 64, "FrameUniforms layout does not match std140");
+static_assert(offsetof(FrameUniforms, skyboxView) == 128, "FrameUniforms layout does not match std140");
+static_assert(offsetof(FrameUniforms, viewPosition) == 192, "FrameUniforms layout does not match std140");
+static_assert(offsetof(FrameUniforms, fogDensity) == 204, "FrameUniforms layout does not match std140");
+static_assert(offsetof(FrameUniforms, lightPosition) == 208, "FrameUniforms layout does not match std140");
+static_assert(offsetof(FrameUniforms, fogGradient) == 220, "FrameUniforms layout does not match std140");
+static_assert(offsetof(FrameUniforms, lightColor) == 224, "FrameUniforms layout does not match std140");
+static_assert(offsetof(FrameUniforms, fogColor) == 240, "FrameUniforms layout does not match std140");
+static_assert(offsetof(FrameUniforms, camUp) == 256, "FrameUniforms layout does not match std140");
+static_assert(offsetof(FrameUniforms, camRight) == 272, "FrameUniforms layout does not match std140");
+static_assert(sizeof(FrameUniforms) == 288, "FrameUniforms layout does not match std140");
+
+// std140 layout of the ObjectUniforms block (shaders/uniforms.glsl)
+struct ObjectUniforms
+{
+    glm::mat4 model;
+    glm::mat4 normalMatrix; // inverse transpose of the upper 3x3 of model
+    float shininess;
+    float padding[3];
+};
+
+static_assert(offsetof(ObjectUniforms, model) == 0, "ObjectUniforms layout does not match std140");
+static_assert(offsetof(ObjectUniforms, normalMatrix) == 64, "ObjectUniforms layout does not match std140");
+static_assert(offsetof(ObjectUniforms, shininess) == 128, "ObjectUniforms layout does not match std140");
+static_assert(sizeof(ObjectUniforms) == 144, "ObjectUniforms layout does not match std140");
+
+// One buffer holds the frame block followed by a slot per object drawn in the frame.
+// Objects are collected while the frame is prepared and the whole buffer is uploaded at once,
+// draws then only rebind the range of their slot.
+class UniformBuffers
+{
+public:
+
+    FrameUniforms frame;
+
+    explicit UniformBuffers(unsigned int maxObjects);
+    ~UniformBuffers();
+
+    // connects the FrameUniforms and ObjectUniforms blocks of the program to the binding points
+    void attach(const Shader& shader) const;
+
+    void beginFrame();
+    unsigned int addObject(const glm::mat4& model, float shininess = 0.0f);
+    void upload();
+
+    void bindObject(unsigned int object) const;
+
+private:
+
+    GLuint buffer;
+    size_t objectsOffset;
+    size_t objectStride;
+    unsigned int maxObjects;
+    unsigned int objectsNum;
+    std::vector<unsigned char> data;
+
+};
+#endif
@@ -0,0 +1,227 @@
+#include "VertexQuantizer.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/packing.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+const float PACKED_DIRECTION_SCALE = 511.0f;    // largest value of a signed 10-bit component
+const float SNORM16_SCALE = 32767.0f;
+
+static float angleDegrees(const glm::vec3& a, const glm::vec3& b)
+{
+    if (glm::length(a) == 0.0f || glm::length(b) == 0.0f)
+        return 0.0f;
+    float cosine = glm::clamp(glm::dot(glm::normalize(a), glm::normalize(b)), -1.0f, 1.0f);
+    return glm::degrees(acosf(cosine));
+}
+
+static glm::vec3 safeNormalize(const glm::vec3& v)
+{
+    float length = glm::length(v);
+    return length > 0.0f ? v / length : glm::vec3(0.0f);
+}
+
+// GL_INT_2_10_10_10_REV: x in the lowest bits, w in the highest two
+static uint32_t packDirection(const glm::vec3& direction, int w, glm::vec3& unpacked)
+{
+    int x = (int)roundf(glm::clamp(direction.x, -1.0f, 1.0f) * PACKED_DIRECTION_SCALE);
+    int y = (int)roundf(glm::clamp(direction.y, -1.0f, 1.0f) * PACKED_DIRECTION_SCALE);
+    int z = (int)roundf(glm::clamp(direction.z, -1.0f, 1.0f) * PACKED_DIRECTION_SCALE);
+    unpacked = glm::vec3((float)x, (float)y, (float)z) / PACKED_DIRECTION_SCALE;
+    return ((uint32_t)x & 0x3FF) | (((uint32_t)y & 0x3FF) << 10) | (((uint32_t)z & 0x3FF) << 20) | (((uint32_t)w & 0x3) << 30);
+}
+
+static float halfError(float value)
+{
+    return fabsf(glm::unpackHalf1x16(glm::packHalf1x16(value)) - value);
+}
+
+static float unorm16Error(float value)
+{
+    if (value < 0.0f || value > 1.0f)
+        return INFINITY;
+    return fabsf(roundf(value * 65535.0f) / 65535.0f - value);
+}
+
+static const char* positionFormatName(PositionFormat format)
+{
+    return format == PositionFormat::HALF ? "half" : "snorm16";
+}
+
+static const char* texCoordFormatName(TexCoordFormat format)
+{
+    return format == TexCoordFormat::HALF ? "half" : "unorm16";
+}
+
+static unsigned int positionSize(const QuantizedMesh& mesh)
+{
+    // three 16-bit components are padded to four so that the next attribute stays 4-byte aligned
+    return mesh.layout.positionComponents == 2 ? 4 : 8;
+}
+
+void QuantizedMesh::setAttributes() const
+{
+    GLuint location = 0;
+    size_t offset = 0;
+
+    GLenum positionType = positionFormat == PositionFormat::HALF ? GL_HALF_FLOAT : GL_SHORT;
+    glEnableVertexAttribArray(location);
+    glVertexAttribPointer(location++, layout.positionComponents, positionType, GL_FALSE, stride, (void*)offset);
+    offset += positionSize(*this);
+
+    if (layout.normal) {
+        glEnableVertexAttribArray(location);
+        glVertexAttribPointer(location++, 4, GL_INT_2_10_10_10_REV, GL_FALSE, stride, (void*)offset);
+        offset += 4;
+    }
+    if (layout.texCoord) {
+        if (texCoordFormat == TexCoordFormat::HALF) {
+            glEnableVertexAttribArray(location);
+            glVertexAttribPointer(location++, 2, GL_HALF_FLOAT, GL_FALSE, stride, (void*)offset);
+        }
+        else {
+            glEnableVertexAttribArray(location);
+            glVertexAttribPointer(location++, 2, GL_UNSIGNED_SHORT, GL_TRUE, stride, (void*)offset);
+        }
+        offset += 4;
+    }
+    if (layout.tangentFrame) {
+        glEnableVertexAttribArray(location);
+        glVertexAttribPointer(location++, 4, GL_INT_2_10_10_10_REV, GL_FALSE, stride, (void*)offset);
+    }
+}
+
+QuantizedMesh quantizeMesh(const std::string& name, const Mesh& mesh, const VertexLayout& layout)
+{
+    QuantizedMesh result;
+    result.layout = layout;
+    size_t vertexCount = mesh.vertexCount();
+    unsigned int components = layout.positionComponents;
+    unsigned int normalOffset = components;
+    unsigned int texCoordOffset = normalOffset + (layout.normal ? 3 : 0);
+    unsigned int tangentOffset = texCoordOffset + (layout.texCoord ? 2 : 0);
+    if (layout.stride() != mesh.stride)
+        std::cerr << "ERROR: mesh " << name << " has " << mesh.stride << " floats per vertex, its layout " << layout.stride() << std::endl;
+
+    // positions: half floats keep small integers and simple fractions exact, 16-bit integers spread their
+    // precision evenly over the bounds, whichever is closer to the source wins
+    glm::vec3 low(INFINITY), high(-INFINITY);
+    float halfPositionError = 0.0f;
+    for (size_t v = 0; v < vertexCount; v++) {
+        const float* position = &mesh.vertices[v * mesh.stride];
+        for (unsigned int c = 0; c < components; c++) {
+            low[c] = std::min(low[c], position[c]);
+            high[c] = std::max(high[c], position[c]);
+            halfPositionError = std::max(halfPositionError, halfError(position[c]));
+        }
+    }
+    for (unsigned int c = components; c < 3; c++)
+        low[c] = high[c] = 0.0f;
+
+    glm::vec3 center = (low + high) * 0.5f;
+    float extent = std::max(std::max(high.x - low.x, high.y - low.y), high.z - low.z) * 0.5f;
+    float scale = extent > 0.0f ? extent / SNORM16_SCALE : 1.0f;
+    float snormPositionError = 0.0f;
+    for (size_t v = 0; v < vertexCount; v++) {
+        const float* position = &mesh.vertices[v * mesh.stride];
+        for (unsigned int c = 0; c < components; c++) {
+            float quantized = roundf((position[c] - center[c]) / scale);
+            snormPositionError = std::max(snormPositionError, fabsf(center[c] + quantized * scale - position[c]));
+        }
+    }
+
+    bool snorm = layout.modelTransform && snormPositionError < halfPositionError;
+    result.positionFormat = snorm ? PositionFormat::SNORM16 : PositionFormat::HALF;
+    result.error.position = snorm ? snormPositionError : halfPositionError;
+    if (snorm)
+        result.dequantize = glm::scale(glm::translate(glm::mat4(1.0f), center), glm::vec3(scale));
+
+    if (layout.texCoord) {
+        float halfTexCoordError = 0.0f, unormTexCoordError = 0.0f;
+        for (size_t v = 0; v < vertexCount; v++) {
+            const float* texCoord = &mesh.vertices[v * mesh.stride + texCoordOffset];
+            for (int c = 0; c < 2; c++) {
+                halfTexCoordError = std::max(halfTexCoordError, halfError(texCoord[c]));
+                unormTexCoordError = std::max(unormTexCoordError, unorm16Error(texCoord[c]));
+            }
+        }
+        bool unorm = unormTexCoordError < halfTexCoordError;
+        result.texCoordFormat = unorm ? TexCoordFormat::UNORM16 : TexCoordFormat::HALF;
+        result.error.texCoord = unorm ? unormTexCoordError : halfTexCoordError;
+    }
+
+    result.stride = positionSize(result) + (layout.normal ? 4 : 0) + (layout.texCoord ? 4 : 0) + (layout.tangentFrame ? 4 : 0);
+    result.vertices.resize(vertexCount * result.stride);
+
+    for (size_t v = 0; v < vertexCount; v++) {
+        const float* source = &mesh.vertices[v * mesh.stride];
+        unsigned char* target = &result.vertices[v * result.stride];
+
+        uint16_t position[4] = { 0, 0, 0, 0 };
+        for (unsigned int c = 0; c < components; c++) {
+            if (snorm)
+                position[c] = (uint16_t)(int16_t)roundf((source[c] - center[c]) / scale);
+            else
+                position[c] = glm::packHalf1x16(source[c]);
+        }
+        memcpy(target, position, positionSize(result));
+        target += positionSize(result);
+
+        glm::vec3 normal(0.0f), unpackedNormal(0.0f);
+        if (layout.normal) {
+            normal = safeNormalize(glm::vec3(source[normalOffset], source[normalOffset + 1], source[normalOffset + 2]));
+            uint32_t packed = packDirection(normal, 0, unpackedNormal);
+            memcpy(target, &packed, 4);
+            target += 4;
+            result.error.normal = std::max(result.error.normal, angleDegrees(normal, unpackedNormal));
+        }
+
+        if (layout.texCoord) {
+            uint16_t texCoord[2];
+            for (int c = 0; c < 2; c++) {
+                float value = source[texCoordOffset + c];
+                if (result.texCoordFormat == TexCoordFormat::UNORM16)
+                    texCoord[c] = (uint16_t)roundf(value * 65535.0f);
+                else
+                    texCoord[c] = glm::packHalf1x16(value);
+            }
+            memcpy(target, texCoord, 4);
+            target += 4;
+        }
+
+        if (layout.tangentFrame) {
+            glm::vec3 tangent = safeNormalize(glm::vec3(source[tangentOffset], source[tangentOffset + 1], source[tangentOffset + 2]));
+            glm::vec3 bitangent(source[tangentOffset + 3], source[tangentOffset + 4], source[tangentOffset + 5]);
+            int sign = glm::dot(glm::cross(normal, tangent), bitangent) < 0.0f ? -1 : 1;
+            glm::vec3 unpackedTangent;
+            uint32_t packed = packDirection(tangent, sign, unpackedTangent);
+            memcpy(target, &packed, 4);
+            result.error.tangent = std::max(result.error.tangent, angleDegrees(tangent, unpackedTangent));
+
+            // the shader rebuilds the bitangent from the orthogonalized tangent, as wallNormal.vs does
+            glm::vec3 orthogonal = safeNormalize(unpackedTangent - glm::dot(unpackedTangent, unpackedNormal) * unpackedNormal);
+            glm::vec3 rebuilt = glm::cross(unpackedNormal, orthogonal) * (float)sign;
+            result.error.bitangent = std::max(result.error.bitangent, angleDegrees(bitangent, rebuilt));
+        }
+    }
+
+    char line[320];
+    int length = snprintf(line, sizeof(line), "Mesh %s: %u -> %u bytes per vertex, positions %s (error %g)", name.c_str(),
+        (unsigned int)(mesh.stride * sizeof(float)), result.stride, positionFormatName(result.positionFormat), result.error.position);
+    if (layout.normal)
+        length += snprintf(line + length, sizeof(line) - length, ", normals 10:10:10 (%.3f deg)", result.error.normal);
+    if (layout.texCoord)
+        length += snprintf(line + length, sizeof(line) - length, ", texture coordinates %s (error %g)",
+            texCoordFormatName(result.texCoordFormat), result.error.texCoord);
+    if (layout.tangentFrame)
+        length += snprintf(line + length, sizeof(line) - length, ", tangents 10:10:10:2 (%.3f deg, bitangents %.3f deg)",
+            result.error.tangent, result.error.bitangent);
+    std::cout << line << "\n";
+    return result;
+}
@@ -0,0 +1,62 @@
+#ifndef VERTEX_QUANTIZER_H
+#define VERTEX_QUANTIZER_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <string>
+#include <vector>
+
+#include "MeshOptimizer.h"
+
+// attributes of the float vertices, in this order: position, normal, texture coordinates, tangent and bitangent
+struct VertexLayout
+{
+    unsigned int positionComponents = 3;
+    bool normal = false;
+    bool texCoord = false;
+    bool tangentFrame = false;      // tangent and bitangent, 3 floats each
+    bool modelTransform = true;     // the shader transforms positions by a model matrix, which can take the dequantization
+
+    unsigned int stride() const { return positionComponents + (normal ? 3 : 0) + (texCoord ? 2 : 0) + (tangentFrame ? 6 : 0); }
+};
+
+enum class PositionFormat { HALF, SNORM16 };
+enum class TexCoordFormat { HALF, UNORM16 };
+
+// Largest error of every quantized attribute, positions and texture coordinates in their own units,
+// directions as angles in degrees.
+struct QuantizationError
+{
+    float position = 0.0f;
+    float normal = 0.0f;
+    float texCoord = 0.0f;
+    float tangent = 0.0f;
+    float bitangent = 0.0f;
+};
+
+// Vertices of a mesh packed attribute by attribute into the smallest formats:
+// - positions as half floats or as 16-bit integers scaled to the mesh bounds, `dequantize` maps the integers back
+//   and has to be applied to the model matrix (it is the identity for half floats);
+// - normals and tangents as GL_INT_2_10_10_10_REV integers, the shaders divide them by 511 and take the
+//   bitangent sign from the 2-bit w of the tangent instead of a stored bitangent;
+// - texture coordinates as half floats or normalized 16-bit integers when they stay within [0, 1].
+// Attribute locations follow the order of VertexLayout, the tangent takes the place of the bitangent pair.
+struct QuantizedMesh
+{
+    std::vector<unsigned char> vertices;
+    unsigned int stride = 0;
+    VertexLayout layout;
+    PositionFormat positionFormat = PositionFormat::HALF;
+    TexCoordFormat texCoordFormat = TexCoordFormat::HALF;
+    glm::mat4 dequantize = glm::mat4(1.0f);
+    QuantizationError error;
+
+    // sets up the attributes of the bound vertex array from the bound GL_ARRAY_BUFFER
+    void setAttributes() const;
+};
+
+// picks the formats with the smaller error for the mesh and prints them with the errors and vertex sizes
+QuantizedMesh quantizeMesh(const std::string& name, const Mesh& mesh, const VertexLayout& layout);
+
+#endif
@@ -0,0 +1,89 @@
+#include "WeightedBlendedOIT.h"
+
+#include <iostream>
+
+#include "GLStateCache.h"
+
+static GLuint createTarget(GLenum internalFormat, GLenum format, int width, int height)
+{
+    GLStateCache& state = GLStateCache::shared();
+    GLuint tex;
+    glGenTextures(1, &tex);
+    state.bindTexture(GL_TEXTURE_2D, tex);
+    glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, format, GL_FLOAT, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    state.bindTexture(GL_TEXTURE_2D, 0);
+    return tex;
+}
+
+WeightedBlendedOIT::WeightedBlendedOIT(int width, int height)
+    : width(width), height(height)
+{
+    accumulationTex = createTarget(GL_RGBA16F, GL_RGBA, width, height);
+    weightTex = createTarget(GL_R16F, GL_RED, width, height);
+
+    // same format as the depth of the window and of the monochrome framebuffer, depth blits need matching formats
+    glGenRenderbuffers(1, &depthBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+
+    GLStateCache& state = GLStateCache::shared();
+    glGenFramebuffers(1, &framebuffer);
+    state.bindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, accumulationTex, 0);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, weightTex, 0);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
+    GLenum drawBuffers[] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+    glDrawBuffers(2, drawBuffers);
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        std::cerr << "ERROR: transparency framebuffer is not complete" << std::endl;
+    state.bindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+WeightedBlendedOIT::~WeightedBlendedOIT()
+{
+    glDeleteFramebuffers(1, &framebuffer);
+    glDeleteTextures(1, &accumulationTex);
+    glDeleteTextures(1, &weightTex);
+    glDeleteRenderbuffers(1, &depthBuffer);
+    GLStateCache::shared().invalidate();
+}
+
+void WeightedBlendedOIT::begin(GLuint target)
+{
+    GLStateCache& state = GLStateCache::shared();
+    state.bindFramebuffer(GL_READ_FRAMEBUFFER, target);
+    state.bindFramebuffer(GL_DRAW_FRAMEBUFFER, framebuffer);
+    glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+    state.bindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+
+    // revealage starts at 1 (nothing covers the scene), colour and weights at 0
+    const GLfloat clearAccumulation[] = { 0.0f, 0.0f, 0.0f, 1.0f };
+    const GLfloat clearWeight[] = { 0.0f, 0.0f, 0.0f, 0.0f };
+    glClearBufferfv(GL_COLOR, 0, clearAccumulation);
+    glClearBufferfv(GL_COLOR, 1, clearWeight);
+
+    state.depthMask(GL_FALSE);
+    state.enable(GL_BLEND);
+    state.blendFuncSeparate(GL_ONE, GL_ONE, GL_ZERO, GL_ONE_MINUS_SRC_ALPHA);
+}
+
+void WeightedBlendedOIT::composite(GLuint target, Shader& shader, const GeometryBuffer& geometry, GeometryHandle screenQuad)
+{
+    GLStateCache& state = GLStateCache::shared();
+    state.bindFramebuffer(GL_FRAMEBUFFER, target);
+    state.depthMask(GL_TRUE);
+    state.disable(GL_DEPTH_TEST);
+    state.blendFunc(GL_ONE_MINUS_SRC_ALPHA, GL_SRC_ALPHA);
+
+    shader.use();
+    state.bindTexture(0, GL_TEXTURE_2D, accumulationTex);
+    state.bindTexture(1, GL_TEXTURE_2D, weightTex);
+    geometry.draw(screenQuad);
+    state.activeTexture(GL_TEXTURE0);
+
+    state.enable(GL_DEPTH_TEST);
+    state.blendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+}
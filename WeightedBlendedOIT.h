@@ -0,0 +1,38 @@
+#ifndef WEIGHTED_BLENDED_OIT_H
+#define WEIGHTED_BLENDED_OIT_H
+
+#include <glad/glad.h>
+
+#include "GeometryBuffer.h"
+#include "Shader.h"
+
+// Weighted blended order-independent transparency (McGuire and Bavoil, 2013).
+// Transparent fragments are summed in any order into an accumulation target (weighted premultiplied colour,
+// revealage in alpha) and a weight target, the composite pass then resolves their weighted average over the scene.
+// Both targets are written with one blend function, glBlendFuncSeparate(ONE, ONE, ZERO, ONE_MINUS_SRC_ALPHA),
+// so that no per-target blending (GL 4.0) is needed.
+class WeightedBlendedOIT
+{
+public:
+
+    WeightedBlendedOIT(int width, int height);
+    ~WeightedBlendedOIT();
+
+    // copies the depth of `target` so that opaque geometry hides transparent fragments,
+    // then clears and binds the accumulation targets with depth writes off
+    void begin(GLuint target);
+    // resolves the accumulated fragments over the colour of `target`; `shader` is shaders/oitComposite.fs
+    // and `screenQuad` a quad covering the screen
+    void composite(GLuint target, Shader& shader, const GeometryBuffer& geometry, GeometryHandle screenQuad);
+
+private:
+
+    int width;
+    int height;
+    GLuint framebuffer;
+    GLuint accumulationTex;
+    GLuint weightTex;
+    GLuint depthBuffer;
+
+};
+#endif
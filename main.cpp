@@ -1,4 +1,6 @@
-﻿#include <iostream>
+﻿#include <chrono>
+#include <cstdio>
+#include <iostream>
 #include <vector>
 #include <map>
 
@@ -10,9 +12,26 @@
 
 #include "Shader.h"
 #include "Camera.h"
-
-#define STB_IMAGE_IMPLEMENTATION
-#include "stb_image.h"
+#include "TextureLoader.h"
+#include "ShaderVariants.h"
+#include "UniformBuffers.h"
+#include "InstanceBuffer.h"
+#include "TransparencySorter.h"
+#include "TransparencyBenchmark.h"
+#include "WeightedBlendedOIT.h"
+#include "GLExtensions.h"
+#include "MeshOptimizer.h"
+#include "VertexQuantizer.h"
+#include "GeometryBuffer.h"
+#include "IndirectDrawBuffer.h"
+#include "DrawBenchmark.h"
+#include "GLStateCache.h"
+#include "RenderQueue.h"
+#include "Headless.h"
+#include "CameraPath.h"
+#include "PngWriter.h"
+#include "Scene.h"
+#include "SoftwareRenderer.h"
 
 // function prototypes
 
@@ -21,9 +40,6 @@ void framebufferSizeCallback(GLFWwindow* window, int width, int height);
 void scrollCallback(GLFWwindow* window, double xoffset, double yoffset);
 void mouseCallback(GLFWwindow* window, double xpos, double ypos);
 
-unsigned int loadTexture(char const* filename);
-unsigned int loadCubeTexture(std::vector<std::string> faces);
-
 // global constants
 
 const unsigned int SCREEN_WIDTH = 1280;
@@ -36,519 +52,366 @@ float lastY = SCREEN_HEIGHT / 2.0f;
 float deltaTime = 0.0f;
 float lastFrame = 0.0f;
 
-glm::vec3 lightPosition(0.0f, 10.0f, 0.0f);
-
-const unsigned int windowsNum = 6;
+// features compiled into the scene programs, bit i enables the i-th define of their ShaderVariants
 
-float bumpScale = 0.1;
+enum ShaderFeature : unsigned int {
+    LIGHT_ON = 1,
+    BLINN = 2,
+    FOG_ON = 4,
+    PARALLAX_ON = 8
+};
 
 // input flags
 
 bool skyboxOn = false;
 bool zPressed = false;
-bool lightOn = true;
+unsigned int shaderFeatures = LIGHT_ON | BLINN;
 bool lPressed = false;
-bool Blinn = true;
 bool bPressed = false;
-bool fogOn = false;
 bool fPressed = false;
 bool monochromeOn = false;
 bool mPressed = false;
-bool parallaxOn = false;
 bool pPressed = true;
+bool oitOn = false;
+bool oPressed = false;
+bool tPressed = false;
+bool benchmarkRequested = false;
+bool indirectOn = false;
+bool iPressed = false;
+bool gPressed = false;
+bool drawBenchmarkRequested = false;
+bool cPressed = false;
+bool stateCountersRequested = false;
 
 static void glfwError(int id, const char* description)
 {
     std::cout << description << std::endl;
 }
 
-int main()
+// headless runs follow the camera keys or circle the scene, starting where the interactive camera starts
+static bool loadCameraPath(const HeadlessOptions& headless, CameraPath& cameraPath)
+{
+    cameraPath = CameraPath::orbit(glm::vec3(0.0f, 8.0f, 0.0f), 23.6f, 4.0f, 20.0f);
+    return headless.cameraPath.empty() || cameraPath.load(headless.cameraPath);
+}
+
+static std::string framePath(const HeadlessOptions& headless, unsigned int frameIndex)
 {
-    // initialization
+    char name[32];
+    snprintf(name, sizeof(name), "/frame_%04u.png", frameIndex);
+    return headless.pngDirectory + name;
+}
 
-    glfwSetErrorCallback(&glfwError);
-    glfwInit();
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+// headless frames of the CPU renderer, without any GL context
+static int runSoftware(const HeadlessOptions& headless)
+{
+    SceneMeshes meshes = buildSceneMeshes();
+    SoftwareRenderer renderer;
+    if (!renderer.load(SceneTextures()))
+        return -1;
 
-    GLFWwindow* window = glfwCreateWindow(SCREEN_WIDTH, SCREEN_HEIGHT, "CompGraph", NULL, NULL);
-    if (window == NULL) {
-        std::cerr << "ERROR: GLFW window creation failed" << std::endl;
-        glfwTerminate();
+    CameraPath cameraPath;
+    if (!loadCameraPath(headless, cameraPath))
         return -1;
+
+    SoftwareModes modes;
+    modes.skybox = headless.skybox;
+    modes.monochrome = headless.monochrome;
+    if (headless.weightedBlended)
+        std::cout << "The software renderer has no weighted blended transparency, windows are sorted\n";
+
+    FrameTimings frameTimings;
+    RasterStats totals;
+    TraceStats traceTotals;
+    double renderSeconds = 0.0;
+    std::vector<unsigned char> pixels;
+    for (unsigned int frameIndex = 0; frameIndex < headless.frames; frameIndex++) {
+        float time = frameIndex / headless.frameRate;
+        glm::vec3 position, target;
+        cameraPath.sample(time, position, target);
+        camera.lookAt(position, target);
+
+        auto frameStart = std::chrono::steady_clock::now();
+        if (headless.raytrace) {
+            TraceStats stats = renderer.trace(meshes, camera, time, headless.width, headless.height, modes);
+            traceTotals.triangles += stats.triangles;
+            traceTotals.bvhNodes += stats.bvhNodes;
+            traceTotals.primaryRays += stats.primaryRays;
+            traceTotals.secondaryRays += stats.secondaryRays;
+            traceTotals.buildMs += stats.buildMs;
+        }
+        else {
+            RasterStats stats = renderer.render(meshes, camera, time, headless.width, headless.height, modes);
+            totals.triangles += stats.triangles;
+            totals.quadsShaded += stats.quadsShaded;
+            totals.blocksCulled += stats.blocksCulled;
+        }
+        double frameMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frameStart).count();
+        frameTimings.add(time, frameMs, frameMs);
+        renderSeconds += frameMs / 1000.0;
+
+        if (!headless.pngDirectory.empty()) {
+            renderer.readRGB(pixels);
+            writePNG(framePath(headless, frameIndex), headless.width, headless.height, 3, pixels.data());
+        }
     }
-    glfwMakeContextCurrent(window);
-    glfwSetFramebufferSizeCallback(window, framebufferSizeCallback);
-    glfwSetCursorPosCallback(window, mouseCallback);
-    glfwSetScrollCallback(window, scrollCallback);
-    glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
 
-    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
-        std::cerr << "ERROR: GLAD initialization failed" << std::endl;
+    if (headless.raytrace) {
+        size_t rays = traceTotals.primaryRays + traceTotals.secondaryRays;
+        std::cout << "Ray traced " << headless.frames << " frames of " << headless.width << "x" << headless.height << " on "
+            << ThreadPool::shared().size() << " threads, per frame " << traceTotals.triangles / headless.frames << " triangles in "
+            << traceTotals.bvhNodes / headless.frames << " BVH nodes built in " << traceTotals.buildMs / headless.frames << " ms, "
+            << rays / headless.frames << " rays (" << traceTotals.secondaryRays / headless.frames << " secondary), "
+            << rays / renderSeconds / 1e6 << " Mrays/s\n";
+    }
+    else {
+        std::cout << "Rendered " << headless.frames << " frames of " << headless.width << "x" << headless.height << " in software on "
+            << ThreadPool::shared().size() << " threads, per frame " << totals.triangles / headless.frames << " triangles, "
+            << totals.quadsShaded / headless.frames << " quads shaded, " << totals.blocksCulled / headless.frames << " blocks culled by depth\n";
+    }
+    frameTimings.report();
+    if (!headless.timingsPath.empty())
+        frameTimings.writeCSV(headless.timingsPath);
+    return 0;
+}
+
+int main(int argc, char* argv[])
+{
+    // initialization (a window, or a context without one in headless mode)
+
+    HeadlessOptions headless;
+    if (!parseHeadlessOptions(argc, argv, headless))
         return -1;
+    if (headless.enabled && headless.software) {
+        if (headless.transparencyBenchmark || headless.drawBenchmark) {
+            std::cerr << "ERROR: the benchmarks measure the OpenGL renderer, --software has none" << std::endl;
+            return -1;
+        }
+        return runSoftware(headless);
+    }
+    unsigned int frameWidth = headless.enabled ? headless.width : SCREEN_WIDTH;
+    unsigned int frameHeight = headless.enabled ? headless.height : SCREEN_HEIGHT;
+
+    GLFWwindow* window = NULL;
+    HeadlessContext headlessContext;
+    GLADloadproc loader;
+    if (headless.enabled) {
+        if (!headlessContext.create())
+            return -1;
+        loader = HeadlessContext::loader();
+    }
+    else {
+        glfwSetErrorCallback(&glfwError);
+        glfwInit();
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+        glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+
+        window = glfwCreateWindow(SCREEN_WIDTH, SCREEN_HEIGHT, "CompGraph", NULL, NULL);
+        if (window == NULL) {
+            std::cerr << "ERROR: GLFW window creation failed" << std::endl;
+            glfwTerminate();
+            return -1;
+        }
+        glfwMakeContextCurrent(window);
+        glfwSetFramebufferSizeCallback(window, framebufferSizeCallback);
+        glfwSetCursorPosCallback(window, mouseCallback);
+        glfwSetScrollCallback(window, scrollCallback);
+        glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+        loader = (GLADloadproc)glfwGetProcAddress;
     }
 
-    glEnable(GL_DEPTH_TEST);
+    if (!gladLoadGLLoader(loader)) {
+        std::cerr << "ERROR: GLAD initialization failed" << std::endl;
+        return -1;
+    }
+    loadGLExtensions(loader);
+
+    // headless runs start in the modes given on the command line, the context has no default framebuffer
+    if (headless.enabled) {
+        skyboxOn = headless.skybox;
+        monochromeOn = headless.monochrome;
+        oitOn = headless.weightedBlended;
+        indirectOn = headless.indirect && hasMultiDrawIndirect();
+        if (headless.indirect && !indirectOn)
+            std::cerr << "ERROR: multi-draw indirect is not supported" << std::endl;
+        glViewport(0, 0, frameWidth, frameHeight);
+    }
 
-    // loading shaders
+    // shaders are compiled on driver threads when supported, as many as the driver wants to use
+    if (glMaxShaderCompilerThreadsKHR)
+        glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+
+    // every binding and blend/depth change of the renderer goes through the state cache
+    GLStateCache& glState = GLStateCache::shared();
+    glState.enable(GL_DEPTH_TEST);
+
+    // loading textures (decoded on worker threads while shaders and buffers are being set up)
+
+    TextureLoader textureLoader;
+
+    SceneTextures textures;
+    unsigned int groundTex = textureLoader.addTexture(textures.ground.c_str(), textures.colorMips, textures.colorFormat);
+
+    // boxes are drawn in one instanced call, their textures are the layers of one array
+    unsigned int boxTextures = textureLoader.addTextureArray(textures.boxes, textures.colorMips, textures.colorFormat);
+
+    unsigned int windowTex = textureLoader.addTexture(textures.window.c_str(), textures.windowMips, textures.windowFormat);
+
+    unsigned int wallDiffuse = textureLoader.addTexture(textures.wallDiffuse.c_str(), textures.colorMips, textures.colorFormat);
+    unsigned int wallNormal = textureLoader.addTexture(textures.wallNormal.c_str(), textures.normalMips, textures.normalFormat);
+    unsigned int wallBump = textureLoader.addTexture(textures.wallBump.c_str(), textures.bumpMips, textures.bumpFormat);
+
+    unsigned int skyTex = textureLoader.addCubeTexture(textures.skyboxFaces, textures.skyboxFormat);
+
+    // loading shaders (linked programs are kept in cache/shaders and loaded back on the next launch);
+    // all programs are submitted before any of them is checked, they are finished when first used
+
+    // uniform buffers with the camera, light and fog state shared by all programs and a slot per drawn object
+    // (ground, wall, light source and reflecting cube, boxes and windows are instanced)
+
+    UniformBuffers uniformBuffers(4);
+
+    auto shadersStart = std::chrono::steady_clock::now();
+
+    // lit programs are compiled per combination of features, other combinations are built when they are toggled
+    ShaderVariants commonShaders("shaders/common.vs", "shaders/common.fs", { "LIGHT_ON", "BLINN", "FOG_ON" }, [&](Shader& shader) {
+        uniformBuffers.attach(shader);
+        shader.use();
+        shader.setInt("tex", 0);
+    });
+    ShaderVariants wallNormalShaders("shaders/wallNormal.vs", "shaders/wallNormal.fs", { "LIGHT_ON", "BLINN", "FOG_ON", "PARALLAX_ON" }, [&](Shader& shader) {
+        uniformBuffers.attach(shader);
+        shader.use();
+        shader.setInt("diffuseMap", 0);
+        shader.setInt("normalMap", 1);
+        shader.setInt("bumpMap", 2);
+        shader.setFloat("bumpScale", bumpScale);
+    });
+    ShaderVariants boxShaders("shaders/common.vs", "shaders/common.fs", { "LIGHT_ON", "BLINN", "FOG_ON" }, [&](Shader& shader) {
+        uniformBuffers.attach(shader);
+        shader.use();
+        shader.setInt("tex", 0);
+    }, { "INSTANCED" });
+    ShaderVariants indirectBoxShaders("shaders/common.vs", "shaders/common.fs", { "LIGHT_ON", "BLINN", "FOG_ON" }, [&](Shader& shader) {
+        uniformBuffers.attach(shader);
+        shader.use();
+        shader.setInt("tex", 0);
+        shader.setInt("drawData", DRAW_DATA_TEXTURE_UNIT);
+    }, { "INSTANCED", "DRAW_ID" });
+    Shader* commonShader = &commonShaders.get(shaderFeatures);
+    Shader* boxShader = &boxShaders.get(shaderFeatures);
+    // boxes are only drawn with gl_DrawIDARB when multi-draw indirect is there to submit them
+    bool multiDrawIndirect = hasMultiDrawIndirect();
+    Shader* indirectBoxShader = multiDrawIndirect ? &indirectBoxShaders.get(shaderFeatures) : nullptr;
+    Shader* wallNormalShader = &wallNormalShaders.get(shaderFeatures);
+    unsigned int activeFeatures = shaderFeatures;
+
+    // with parallel compilation the variants one key press away are submitted too and finished by polling
+    // before they are switched to; without it submitting them would compile them right away, so they are
+    // left until they are toggled
+    auto prepareToggles = [&](unsigned int features) {
+        if (!glMaxShaderCompilerThreadsKHR)
+            return;
+        for (unsigned int feature : { LIGHT_ON, BLINN, FOG_ON, PARALLAX_ON }) {
+            commonShaders.prepare(features ^ feature);
+            boxShaders.prepare(features ^ feature);
+            if (multiDrawIndirect)
+                indirectBoxShaders.prepare(features ^ feature);
+            wallNormalShaders.prepare(features ^ feature);
+        }
+    };
+    auto pollShaders = [&]() {
+        commonShaders.poll();
+        boxShaders.poll();
+        indirectBoxShaders.poll();
+        wallNormalShaders.poll();
+    };
 
-    Shader commonShader("shaders/common.vs", "shaders/common.fs");
     Shader lightShader("shaders/light.vs", "shaders/light.fs");
     Shader skyboxShader("shaders/skybox.vs", "shaders/skybox.fs");
     Shader reflectShader("shaders/reflect.vs", "shaders/reflect.fs");
     Shader posteffectShader("shaders/screen.vs", "shaders/screen.fs");
-    Shader wallNormalShader("shaders/wallNormal.vs", "shaders/wallNormal.fs");
     Shader windowShader("shaders/window.vs", "shaders/window.fs");
-
-    // object vertices
-
-    float groundVertices[] = {
-        10.0f, -0.5f,  10.0f,  0.0f, 1.0f, 0.0f, 10.0f,  0.0f,
-        -10.0f, -0.5f,  10.0f, 0.0f, 1.0f, 0.0f, 0.0f,  0.0f,
-        -10.0f, -0.5f, -10.0f, 0.0f, 1.0f, 0.0f, 0.0f, 10.0f,
-         10.0f, -0.5f,  10.0f,  0.0f, 1.0f, 0.0f, 10.0f,  0.0f,
-        -10.0f, -0.5f, -10.0f,  0.0f, 1.0f, 0.0f, 0.0f, 10.0f,
-         10.0f, -0.5f, -10.0f, 0.0f, 1.0f, 0.0f, 10.0f, 10.0f
-    };
-
-    float boxVertices[] = {
-        // back
-        -1.0f, -1.0f, -1.0f,  0.0f,  0.0f, -1.0f, 0.0f, 0.0f,
-        1.0f,  1.0f, -1.0f,  0.0f,  0.0f, -1.0f, 1.0f, 1.0f,
-        1.0f, -1.0f, -1.0f,  0.0f,  0.0f, -1.0f, 1.0f, 0.0f,
-        1.0f,  1.0f, -1.0f,  0.0f,  0.0f, -1.0f, 1.0f, 1.0f,
-        -1.0f, -1.0f, -1.0f,  0.0f,  0.0f, -1.0f, 0.0f, 0.0f,
-        -1.0f,  1.0f, -1.0f,  0.0f,  0.0f, -1.0f, 0.0f, 1.0f,
-        // front
-        -1.0f, -1.0f,  1.0f,  0.0f,  0.0f,  1.0f, 0.0f, 0.0f,
-        1.0f, -1.0f,  1.0f,  0.0f,  0.0f,  1.0f, 1.0f, 0.0f,
-        1.0f,  1.0f,  1.0f,  0.0f,  0.0f,  1.0f, 1.0f, 1.0f,
-        1.0f,  1.0f,  1.0f,  0.0f,  0.0f,  1.0f, 1.0f, 1.0f,
-        -1.0f,  1.0f,  1.0f,  0.0f,  0.0f,  1.0f, 0.0f, 1.0f,
-        -1.0f, -1.0f,  1.0f,  0.0f,  0.0f,  1.0f, 0.0f, 0.0f,
-        // left
-        -1.0f,  1.0f,  1.0f, -1.0f,  0.0f,  0.0f, 1.0f, 0.0f,
-        -1.0f,  1.0f, -1.0f, -1.0f,  0.0f,  0.0f, 1.0f, 1.0f,
-        -1.0f, -1.0f, -1.0f, -1.0f,  0.0f,  0.0f, 0.0f, 1.0f,
-        -1.0f, -1.0f, -1.0f, -1.0f,  0.0f,  0.0f, 0.0f, 1.0f,
-        -1.0f, -1.0f,  1.0f, -1.0f,  0.0f,  0.0f, 0.0f, 0.0f,
-        -1.0f,  1.0f,  1.0f, -1.0f,  0.0f,  0.0f, 1.0f, 0.0f,
-        // right
-        1.0f,  1.0f,  1.0f,  1.0f,  0.0f,  0.0f, 1.0f, 0.0f,
-        1.0f, -1.0f, -1.0f,  1.0f,  0.0f,  0.0f, 0.0f, 1.0f,
-        1.0f,  1.0f, -1.0f,  1.0f,  0.0f,  0.0f, 1.0f, 1.0f,
-        1.0f, -1.0f, -1.0f,  1.0f,  0.0f,  0.0f, 0.0f, 1.0f,
-        1.0f,  1.0f,  1.0f,  1.0f,  0.0f,  0.0f, 1.0f, 0.0f,
-        1.0f, -1.0f,  1.0f,  1.0f,  0.0f,  0.0f, 0.0f, 0.0f,
-        // bottom
-        -1.0f, -1.0f, -1.0f,  0.0f, -1.0f,  0.0f, 0.0f, 1.0f,
-        1.0f, -1.0f, -1.0f,  0.0f, -1.0f,  0.0f, 1.0f, 1.0f,
-        1.0f, -1.0f,  1.0f,  0.0f, -1.0f,  0.0f, 1.0f, 0.0f,
-        1.0f, -1.0f,  1.0f,  0.0f, -1.0f,  0.0f, 1.0f, 0.0f,
-        -1.0f, -1.0f,  1.0f,  0.0f, -1.0f,  0.0f, 0.0f, 0.0f,
-        -1.0f, -1.0f, -1.0f,  0.0f, -1.0f,  0.0f, 0.0f, 1.0f,
-        // top
-        -1.0f,  1.0f, -1.0f,  0.0f,  1.0f,  0.0f, 0.0f, 1.0f,
-        1.0f,  1.0f , 1.0f,  0.0f,  1.0f,  0.0f, 1.0f, 0.0f,
-        1.0f,  1.0f, -1.0f,  0.0f,  1.0f,  0.0f, 1.0f, 1.0f,
-        1.0f,  1.0f,  1.0f,  0.0f,  1.0f,  0.0f, 1.0f, 0.0f,
-        -1.0f,  1.0f, -1.0f,  0.0f,  1.0f,  0.0f, 0.0f, 1.0f,
-        -1.0f,  1.0f,  1.0f,  0.0f,  1.0f,  0.0f, 0.0f, 0.0f
-    };
-    glm::vec3 boxPositions[] = {
-        glm::vec3(0.0f,  1.2f,  0.0f),
-        glm::vec3(-3.2f,  5.5f, 4.3f),
-        glm::vec3(6.1f, 2.7f, 2.4f),
-        glm::vec3(7.6f, 3.9f, -5.8f),
-        glm::vec3(-5.9f, 4.4f, -3.3f)
-    };
-
-    float mirrorCubeVertices[] = {
-        // back
-        -1.0f, -1.0f, -1.0f,  0.0f,  0.0f, -1.0f,
-        1.0f,  1.0f, -1.0f,  0.0f,  0.0f, -1.0f,
-        1.0f, -1.0f, -1.0f,  0.0f,  0.0f, -1.0f,
-        1.0f,  1.0f, -1.0f,  0.0f,  0.0f, -1.0f,
-        -1.0f, -1.0f, -1.0f,  0.0f,  0.0f, -1.0f,
-        -1.0f,  1.0f, -1.0f,  0.0f,  0.0f, -1.0f,
-        // front
-        -1.0f, -1.0f,  1.0f,  0.0f,  0.0f,  1.0f,
-        1.0f, -1.0f,  1.0f,  0.0f,  0.0f,  1.0f,
-        1.0f,  1.0f,  1.0f,  0.0f,  0.0f,  1.0f,
-        1.0f,  1.0f,  1.0f,  0.0f,  0.0f,  1.0f,
-        -1.0f,  1.0f,  1.0f,  0.0f,  0.0f,  1.0f,
-        -1.0f, -1.0f,  1.0f,  0.0f,  0.0f,  1.0f,
-        // left
-        -1.0f,  1.0f,  1.0f, -1.0f,  0.0f,  0.0f,
-        -1.0f,  1.0f, -1.0f, -1.0f,  0.0f,  0.0f,
-        -1.0f, -1.0f, -1.0f, -1.0f,  0.0f,  0.0f,
-        -1.0f, -1.0f, -1.0f, -1.0f,  0.0f,  0.0f,
-        -1.0f, -1.0f,  1.0f, -1.0f,  0.0f,  0.0f,
-        -1.0f,  1.0f,  1.0f, -1.0f,  0.0f,  0.0f,
-        // right
-        1.0f,  1.0f,  1.0f,  1.0f,  0.0f,  0.0f,
-        1.0f, -1.0f, -1.0f,  1.0f,  0.0f,  0.0f,
-        1.0f,  1.0f, -1.0f,  1.0f,  0.0f,  0.0f,
-        1.0f, -1.0f, -1.0f,  1.0f,  0.0f,  0.0f,
-        1.0f,  1.0f,  1.0f,  1.0f,  0.0f,  0.0f,
-        1.0f, -1.0f,  1.0f,  1.0f,  0.0f,  0.0f,
-        // bottom
-        -1.0f, -1.0f, -1.0f,  0.0f, -1.0f,  0.0f,
-        1.0f, -1.0f, -1.0f,  0.0f, -1.0f,  0.0f,
-        1.0f, -1.0f,  1.0f,  0.0f, -1.0f,  0.0f,
-        1.0f, -1.0f,  1.0f,  0.0f, -1.0f,  0.0f,
-        -1.0f, -1.0f,  1.0f,  0.0f, -1.0f,  0.0f,
-        -1.0f, -1.0f, -1.0f,  0.0f, -1.0f,  0.0f,
-        // top
-        -1.0f,  1.0f, -1.0f,  0.0f,  1.0f,  0.0f,
-        1.0f,  1.0f , 1.0f,  0.0f,  1.0f,  0.0f,
-        1.0f,  1.0f, -1.0f,  0.0f,  1.0f,  0.0f,
-        1.0f,  1.0f,  1.0f,  0.0f,  1.0f,  0.0f,
-        -1.0f,  1.0f, -1.0f,  0.0f,  1.0f,  0.0f,
-        -1.0f,  1.0f,  1.0f,  0.0f,  1.0f,  0.0f,
+    Shader windowOITShader("shaders/window.vs", "shaders/window.fs", nullptr, { "WEIGHTED_OIT" });
+    Shader oitCompositeShader("shaders/screen.vs", "shaders/oitComposite.fs");
+    // after the programs of the first frame, so that the driver takes those first
+    prepareToggles(activeFeatures);
+
+    ShaderCache& shaderCache = ShaderCache::shared();
+    std::cout << "Submitted " << shaderCache.hits + shaderCache.misses << " shader programs (" << shaderCache.hits << " from binary cache, "
+        << shaderCache.misses << " compiling) in " << (int)std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - shadersStart).count() << " ms\n";
+
+    // object meshes, generated at compile time and with triangles reordered for the vertex cache and overdraw
+
+    SceneMeshes meshes = buildSceneMeshes();
+
+    // packing the vertices, layouts are { position components, normal, texture coordinates, tangent frame, model transform }
+    QuantizedMesh groundPacked = quantizeMesh("ground", meshes.ground, VertexLayout{ 3, true, true });
+    // the skybox takes the cube positions without a model transform
+    QuantizedMesh cubePacked = quantizeMesh("cube", meshes.cube, VertexLayout{ 3, true, true, false, false });
+    QuantizedMesh windowPacked = quantizeMesh("window", meshes.window, VertexLayout{ 3, false, true, false, false });
+    QuantizedMesh wallPacked = quantizeMesh("wall", meshes.wall, VertexLayout{ 3, true, true, true });
+    QuantizedMesh screenPacked = quantizeMesh("screen", meshes.screen, VertexLayout{ 2, false, true, false, false });
+
+    // uploading the meshes, the ones sharing a vertex format share buffers and a vertex array
+
+    GeometryBuffer geometry;
+    GeometryHandle groundGeometry = geometry.add(groundPacked, meshes.ground.indices);
+    GeometryHandle cubeGeometry = geometry.add(cubePacked, meshes.cube.indices);
+    GeometryHandle windowGeometry = geometry.add(windowPacked, meshes.window.indices);
+    GeometryHandle wallGeometry = geometry.add(wallPacked, meshes.wall.indices);
+    GeometryHandle screenGeometry = geometry.add(screenPacked, meshes.screen.indices);
+
+    InstanceBuffer boxInstances;
+    boxInstances.attach(geometry.vertexArray(cubeGeometry));
+    InstanceBuffer windowInstances;
+    windowInstances.attach(geometry.vertexArray(windowGeometry));
+    IndirectDrawBuffer boxDraws;
+    RenderQueue renderQueue(geometry, uniformBuffers);
+
+    // framebuffers with a colour texture and a depth-stencil renderbuffer: the target of the scene in monochrome mode
+    // and the screen of headless mode
+    auto createFramebuffer = [&](GLuint& colour) {
+        GLuint framebuffer;
+        glGenFramebuffers(1, &framebuffer);
+        glState.bindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+
+        glGenTextures(1, &colour);
+        glState.bindTexture(GL_TEXTURE_2D, colour);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, frameWidth, frameHeight, 0, GL_RGB, GL_UNSIGNED_BYTE, NULL);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, colour, 0);
+
+        GLuint RBO;
+        glGenRenderbuffers(1, &RBO);
+        glBindRenderbuffer(GL_RENDERBUFFER, RBO);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, frameWidth, frameHeight);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, RBO);
+
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            std::cerr << "ERROR: framebuffer is not complete" << std::endl;
+        glState.bindFramebuffer(GL_FRAMEBUFFER, 0);
+        return framebuffer;
     };
 
-    float windowVertices[] = {
-        0.0f,  0.5f,  0.0f,  0.0f,  0.0f,
-        0.0f, -0.5f,  0.0f,  0.0f,  1.0f,
-        1.0f, -0.5f,  0.0f,  1.0f,  1.0f,
+    GLuint texColorBuffer;
+    GLuint frameBuffer = createFramebuffer(texColorBuffer);
+    GLuint screenColorBuffer = 0;
+    GLuint screenFramebuffer = headless.enabled ? createFramebuffer(screenColorBuffer) : 0;
 
-        0.0f,  0.5f,  0.0f,  0.0f,  0.0f,
-        1.0f, -0.5f,  0.0f,  1.0f,  1.0f,
-        1.0f,  0.5f,  0.0f,  1.0f,  0.0f
-    };
-    glm::vec3 windowPositions[]
-    {
-        glm::vec3(0.0f, 4.0f, -6.0f),
-        glm::vec3(-0.6f, 4.0f, -7.1f),
-        glm::vec3(1.5f, 4.0f, -6.5f),
-        glm::vec3(-1.3f, 4.0f, -8.7f),
-        glm::vec3(0.85f, 4.0f, -7.4f),
-        glm::vec3(-0.2f, 4.0f, -8.2f)
-    };
+    // targets of weighted blended transparency
+    WeightedBlendedOIT transparency(frameWidth, frameHeight);
+    TransparencyBenchmark benchmark;
+    DrawBenchmark drawBenchmark;
 
-    float lightVertices[] = {
-        // back
-        -1.0f, -1.0f, -1.0f,
-        1.0f,  1.0f, -1.0f,
-        1.0f, -1.0f, -1.0f,
-        1.0f,  1.0f, -1.0f,
-        -1.0f, -1.0f, -1.0f,
-        -1.0f,  1.0f, -1.0f,
-        // front
-        -1.0f, -1.0f,  1.0f,
-        1.0f, -1.0f,  1.0f,
-        1.0f,  1.0f,  1.0f,
-        1.0f,  1.0f,  1.0f,
-        -1.0f,  1.0f,  1.0f,
-        -1.0f, -1.0f,  1.0f,
-        // left
-        -1.0f,  1.0f,  1.0f,
-        -1.0f,  1.0f, -1.0f,
-        -1.0f, -1.0f, -1.0f,
-        -1.0f, -1.0f, -1.0f,
-        -1.0f, -1.0f,  1.0f,
-        -1.0f,  1.0f,  1.0f,
-        // right
-        1.0f,  1.0f,  1.0f,
-        1.0f, -1.0f, -1.0f,
-        1.0f,  1.0f, -1.0f,
-        1.0f, -1.0f, -1.0f,
-        1.0f,  1.0f,  1.0f,
-        1.0f, -1.0f,  1.0f,
-        // bottom
-        -1.0f, -1.0f, -1.0f,
-        1.0f, -1.0f, -1.0f,
-        1.0f, -1.0f,  1.0f,
-        1.0f, -1.0f,  1.0f,
-        -1.0f, -1.0f,  1.0f,
-        -1.0f, -1.0f, -1.0f,
-        // top
-        -1.0f,  1.0f, -1.0f,
-        1.0f,  1.0f , 1.0f,
-        1.0f,  1.0f, -1.0f,
-        1.0f,  1.0f,  1.0f,
-        -1.0f,  1.0f, -1.0f,
-        -1.0f,  1.0f,  1.0f,
-    };
+    // waiting for the textures queued at startup
 
-    float skyboxVertices[] = {
-        -1.0f,  1.0f, -1.0f,
-        -1.0f, -1.0f, -1.0f,
-         1.0f, -1.0f, -1.0f,
-         1.0f, -1.0f, -1.0f,
-         1.0f,  1.0f, -1.0f,
-        -1.0f,  1.0f, -1.0f,
-
-        -1.0f, -1.0f,  1.0f,
-        -1.0f, -1.0f, -1.0f,
-        -1.0f,  1.0f, -1.0f,
-        -1.0f,  1.0f, -1.0f,
-        -1.0f,  1.0f,  1.0f,
-        -1.0f, -1.0f,  1.0f,
-
-         1.0f, -1.0f, -1.0f,
-         1.0f, -1.0f,  1.0f,
-         1.0f,  1.0f,  1.0f,
-         1.0f,  1.0f,  1.0f,
-         1.0f,  1.0f, -1.0f,
-         1.0f, -1.0f, -1.0f,
-
-        -1.0f, -1.0f,  1.0f,
-        -1.0f,  1.0f,  1.0f,
-         1.0f,  1.0f,  1.0f,
-         1.0f,  1.0f,  1.0f,
-         1.0f, -1.0f,  1.0f,
-        -1.0f, -1.0f,  1.0f,
-
-        -1.0f,  1.0f, -1.0f,
-         1.0f,  1.0f, -1.0f,
-         1.0f,  1.0f,  1.0f,
-         1.0f,  1.0f,  1.0f,
-        -1.0f,  1.0f,  1.0f,
-        -1.0f,  1.0f, -1.0f,
-
-        -1.0f, -1.0f, -1.0f,
-        -1.0f, -1.0f,  1.0f,
-         1.0f, -1.0f, -1.0f,
-         1.0f, -1.0f, -1.0f,
-        -1.0f, -1.0f,  1.0f,
-         1.0f, -1.0f,  1.0f
-    };
-
-    float screenVertices[] = {
-        -1.0f,  1.0f,  0.0f, 1.0f,
-        -1.0f, -1.0f,  0.0f, 0.0f,
-         1.0f, -1.0f,  1.0f, 0.0f,
-        -1.0f,  1.0f,  0.0f, 1.0f,
-         1.0f, -1.0f,  1.0f, 0.0f,
-         1.0f,  1.0f,  1.0f, 1.0f
-    };
-
-    // calculating vertices for normal mapping
-
-    glm::vec3 pos1(-1.0f, 1.0f, 0.0f), pos2(-1.0f, -1.0f, 0.0f), pos3(1.0f, -1.0f, 0.0f), pos4(1.0f, 1.0f, 0.0f);
-    glm::vec3 normal(0.0f, 0.0f, 1.0f);
-    glm::vec2 tex1(0.0f, 1.0f), tex2(0.0f, 0.0f), tex3(1.0f, 0.0f), tex4(1.0f, 1.0f);
-    glm::vec3 tang1, tang2, bitang1, bitang2;
-
-    glm::vec3 edge1 = pos2 - pos1, edge2 = pos3 - pos1;
-    glm::vec2 delta1 = tex2 - tex1, delta2 = tex3 - tex1;
-    float frac = 1.0f / (delta1.x * delta2.y - delta2.x * delta1.y);
-
-    tang1.x = frac * (delta2.y * edge1.x - delta1.y * edge2.x);
-    tang1.y = frac * (delta2.y * edge1.y - delta1.y * edge2.y);
-    tang1.z = frac * (delta2.y * edge1.z - delta1.y * edge2.z);
-    bitang1.x = frac * (-delta2.x * edge1.x + delta1.x * edge2.x);
-    bitang1.y = frac * (-delta2.x * edge1.y + delta1.x * edge2.y);
-    bitang1.z = frac * (-delta2.x * edge1.z + delta1.x * edge2.z);
-
-    edge1 = pos3 - pos1, edge2 = pos4 - pos1;
-    delta1 = tex3 - tex1, delta2 = tex4 - tex1;
-    frac = 1.0f / (delta1.x * delta2.y - delta2.x * delta1.y);
-
-    tang2.x = frac * (delta2.y * edge1.x - delta1.y * edge2.x);
-    tang2.y = frac * (delta2.y * edge1.y - delta1.y * edge2.y);
-    tang2.z = frac * (delta2.y * edge1.z - delta1.y * edge2.z);
-    bitang2.x = frac * (-delta2.x * edge1.x + delta1.x * edge2.x);
-    bitang2.y = frac * (-delta2.x * edge1.y + delta1.x * edge2.y);
-    bitang2.z = frac * (-delta2.x * edge1.z + delta1.x * edge2.z);
-
-    float wallVertices[] = {
-        pos1.x, pos1.y, pos1.z, normal.x, normal.y, normal.z, tex1.x, tex1.y, tang1.x, tang1.y, tang1.z, bitang1.x, bitang1.y, bitang1.z,
-        pos2.x, pos2.y, pos2.z, normal.x, normal.y, normal.z, tex2.x, tex2.y, tang1.x, tang1.y, tang1.z, bitang1.x, bitang1.y, bitang1.z,
-        pos3.x, pos3.y, pos3.z, normal.x, normal.y, normal.z, tex3.x, tex3.y, tang1.x, tang1.y, tang1.z, bitang1.x, bitang1.y, bitang1.z,
-
-        pos1.x, pos1.y, pos1.z, normal.x, normal.y, normal.z, tex1.x, tex1.y, tang2.x, tang2.y, tang2.z, bitang2.x, bitang2.y, bitang2.z,
-        pos3.x, pos3.y, pos3.z, normal.x, normal.y, normal.z, tex3.x, tex3.y, tang2.x, tang2.y, tang2.z, bitang2.x, bitang2.y, bitang2.z,
-        pos4.x, pos4.y, pos4.z, normal.x, normal.y, normal.z, tex4.x, tex4.y, tang2.x, tang2.y, tang2.z, bitang2.x, bitang2.y, bitang2.z
-    };
-    glm::vec3 wallPosition(-7.0f, 5.0f, 2.0f);
-
-    // generating vertex arrays and buffers
-
-    // ground
-    unsigned int groundVAO, groundVBO;
-    glGenVertexArrays(1, &groundVAO);
-    glGenBuffers(1, &groundVBO);
-    glBindVertexArray(groundVAO);
-    glBindBuffer(GL_ARRAY_BUFFER, groundVBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(groundVertices), groundVertices, GL_STATIC_DRAW);
-
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (GLvoid*)0);
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (GLvoid*)(3 * sizeof(float)));
-    glEnableVertexAttribArray(2);
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (GLvoid*)(6 * sizeof(float)));
-    glBindVertexArray(0);
-
-    // boxes
-    unsigned int boxVAO, boxVBO;
-    glGenVertexArrays(1, &boxVAO);
-    glGenBuffers(1, &boxVBO);
-    glBindVertexArray(boxVAO);
-    glBindBuffer(GL_ARRAY_BUFFER, boxVBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(boxVertices), boxVertices, GL_STATIC_DRAW);
-
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (GLvoid*)0);
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (GLvoid*)(3 * sizeof(float)));
-    glEnableVertexAttribArray(2);
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (GLvoid*)(6 * sizeof(float)));
-    glBindVertexArray(0);
-
-    // reflecting cube
-    unsigned int mirrorCubeVAO, mirrorCubeVBO;
-    glGenVertexArrays(1, &mirrorCubeVAO);
-    glGenBuffers(1, &mirrorCubeVBO);
-    glBindVertexArray(mirrorCubeVAO);
-    glBindBuffer(GL_ARRAY_BUFFER, mirrorCubeVBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(mirrorCubeVertices), &mirrorCubeVertices, GL_STATIC_DRAW);
-
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(3 * sizeof(float)));
-
-    // windows
-    unsigned int windowVAO, windowVBO;
-    glGenVertexArrays(1, &windowVAO);
-    glGenBuffers(1, &windowVBO);
-    glBindVertexArray(windowVAO);
-    glBindBuffer(GL_ARRAY_BUFFER, windowVBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(windowVertices), windowVertices, GL_STATIC_DRAW);
-
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));
-    glBindVertexArray(0);
-
-    // wall quad
-    unsigned int wallVAO, wallVBO;
-    glGenVertexArrays(1, &wallVAO);
-    glGenBuffers(1, &wallVBO);
-    glBindVertexArray(wallVAO);
-    glBindBuffer(GL_ARRAY_BUFFER, wallVBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(wallVertices), &wallVertices, GL_STATIC_DRAW);
-
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 14 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 14 * sizeof(float), (void*)(3 * sizeof(float)));
-    glEnableVertexAttribArray(2);
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 14 * sizeof(float), (void*)(6 * sizeof(float)));
-    glEnableVertexAttribArray(3);
-    glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, 14 * sizeof(float), (void*)(8 * sizeof(float)));
-    glEnableVertexAttribArray(4);
-    glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, 14 * sizeof(float), (void*)(11 * sizeof(float)));
-
-    // light source
-    unsigned int lightVAO, lightVBO;
-    glGenVertexArrays(1, &lightVAO);
-    glGenBuffers(1, &lightVBO);
-    glBindVertexArray(lightVAO);
-    glBindBuffer(GL_ARRAY_BUFFER, lightVBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(lightVertices), lightVertices, GL_STATIC_DRAW);
-
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (GLvoid*)0);
-    glBindVertexArray(0);
-
-    // skybox
-    unsigned int skyboxVAO, skyboxVBO;
-    glGenVertexArrays(1, &skyboxVAO);
-    glGenBuffers(1, &skyboxVBO);
-    glBindVertexArray(skyboxVAO);
-    glBindBuffer(GL_ARRAY_BUFFER, skyboxVBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(skyboxVertices), &skyboxVertices, GL_STATIC_DRAW);
-
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (GLvoid*)0);
-    glBindVertexArray(0);
-
-    // screen quad (for monochrome mode)
-    unsigned int screenVAO, screenVBO;
-    glGenVertexArrays(1, &screenVAO);
-    glGenBuffers(1, &screenVBO);
-    glBindVertexArray(screenVAO);
-    glBindBuffer(GL_ARRAY_BUFFER, screenVBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(screenVertices), &screenVertices, GL_STATIC_DRAW);
-
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)(2 * sizeof(float)));
-    glBindVertexArray(0);
-
-    // framebuffer (for monochrome mode)
-    unsigned int frameBuffer;
-    glGenFramebuffers(1, &frameBuffer);
-    glBindFramebuffer(GL_FRAMEBUFFER, frameBuffer);
-
-    unsigned int texColorBuffer;
-    glGenTextures(1, &texColorBuffer);
-    glBindTexture(GL_TEXTURE_2D, texColorBuffer);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, SCREEN_WIDTH, SCREEN_HEIGHT, 0, GL_RGB, GL_UNSIGNED_BYTE, NULL);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texColorBuffer, 0);
-
-    unsigned int RBO;
-    glGenRenderbuffers(1, &RBO);
-    glBindRenderbuffer(GL_RENDERBUFFER, RBO);
-    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, SCREEN_WIDTH, SCREEN_HEIGHT);
-    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, RBO);
-
-    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
-        std::cerr << "ERROR: framebuffer is not complete" << std::endl;
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
-
-    // loading textures
-
-    unsigned int groundTex = loadTexture("textures/Cement.jpg");
-
-    unsigned int boxTextures[5];
-    boxTextures[0] = loadTexture("textures/granite.jpg");
-    boxTextures[1] = loadTexture("textures/bricks.jpg");
-    boxTextures[2] = loadTexture("textures/stone.jpg");
-    boxTextures[3] = loadTexture("textures/wood.png");
-    boxTextures[4] = loadTexture("textures/yellowstone.jpg");
-
-    unsigned int windowTex = loadTexture("textures/window.png");
-
-    unsigned int wallDiffuse = loadTexture("textures/wall_diffuse.jpg");
-    unsigned int wallNormal = loadTexture("textures/wall_normal.jpg");
-    unsigned int wallBump = loadTexture("textures/wall_bump.jpg");
-
-    std::vector<std::string> skyboxFaces{
-        "textures/posx.jpg", "textures/negx.jpg",
-        "textures/posy.jpg", "textures/negy.jpg",
-        "textures/posz.jpg", "textures/negz.jpg"
-    };
-    unsigned int skyTex = loadCubeTexture(skyboxFaces);
+    textureLoader.finish();
 
     // setting uniforms
 
-    commonShader.use();
-    commonShader.setInt("tex", 0);
-    commonShader.setVec3("lightColor", 1.0f, 1.0f, 1.0f);
-    commonShader.setFloat("fogDensity", 0.1f);
-    commonShader.setFloat("fogGradient", 0.9f);
-    commonShader.setVec3("fogColor", 0.1f, 0.1f, 0.1f);
-
-    wallNormalShader.use();
-    wallNormalShader.setInt("diffuseMap", 0);
-    wallNormalShader.setInt("normalMap", 1);
-    wallNormalShader.setInt("bumpMap", 2);
-    wallNormalShader.setFloat("bumpScale", bumpScale);
-    wallNormalShader.setFloat("fogDensity", 0.1f);
-    wallNormalShader.setFloat("fogGradient", 0.9f);
-    wallNormalShader.setVec3("fogColor", 0.1f, 0.1f, 0.1f);
-
     skyboxShader.use();
     skyboxShader.setInt("skybox", 0);
 
@@ -558,264 +421,392 @@ int main()
     windowShader.use();
     windowShader.setInt("tex", 0);
 
+    windowOITShader.use();
+    windowOITShader.setInt("tex", 0);
+
+    oitCompositeShader.use();
+    oitCompositeShader.setInt("accumulation", 0);
+    oitCompositeShader.setInt("weightSum", 1);
+
     posteffectShader.use();
     posteffectShader.setInt("scrTexture", 0);
 
+    Shader* sceneShaders[] = { &lightShader, &skyboxShader, &reflectShader, &windowShader, &windowOITShader };
+    for (Shader* shader : sceneShaders)
+        uniformBuffers.attach(*shader);
+
+    uniformBuffers.frame.lightColor = LIGHT_COLOR;
+    uniformBuffers.frame.fogDensity = FOG_DENSITY;
+    uniformBuffers.frame.fogGradient = FOG_GRADIENT;
+    uniformBuffers.frame.fogColor = FOG_COLOR;
+
     // print controls to console
 
-    std::cout << "CONTROLS:\n\n";
-    std::cout << "WASD - camera movement, mouse - camera rotation, mousewheel - zoom in/out\n";
-    std::cout << "Z - toggle skybox and reflecting cube (off by default)\n";
-    std::cout << "L - toggle lighting (on by default)\n";
-    std::cout << "B - switch the lighting between Blinn-Phong model and Phong model (Blinn-Phong model is set by default)\n";
-    std::cout << "M - toggle monochrome mode (off by default)\n";
-    std::cout << "P - switch between simple normal mapping and parallax mapping (simple normal mapping is set by default)\n\n";
+    if (!headless.enabled) {
+        std::cout << "CONTROLS:\n\n";
+        std::cout << "WASD - camera movement, mouse - camera rotation, mousewheel - zoom in/out\n";
+        std::cout << "Z - toggle skybox and reflecting cube (off by default)\n";
+        std::cout << "L - toggle lighting (on by default)\n";
+        std::cout << "B - switch the lighting between Blinn-Phong model and Phong model (Blinn-Phong model is set by default)\n";
+        std::cout << "M - toggle monochrome mode (off by default)\n";
+        std::cout << "P - switch between simple normal mapping and parallax mapping (simple normal mapping is set by default)\n";
+        std::cout << "O - switch between sorted and weighted blended transparency (sorted is set by default)\n";
+        std::cout << "I - switch the boxes between instanced and multi-draw indirect submission (instanced is set by default)\n";
+        std::cout << "T - run the transparency benchmark\n";
+        std::cout << "G - run the draw count benchmark\n";
+        std::cout << "C - print the GL state calls of the last frame, issued and dropped as redundant\n\n";
+    }
+
+    // world space bounds of the objects, refilled every frame and culled against the camera frustum
+    BoundingBoxes sceneBounds, boxBounds;
+    BoundingSpheres windowBounds;
+    std::vector<unsigned char> sceneVisible, boxesVisible, windowsVisible;
+    TransparencySorter windowSorter;
+
+    CameraPath cameraPath;
+    if (headless.enabled && !loadCameraPath(headless, cameraPath))
+        return -1;
+    FrameTimings frameTimings;
+    unsigned int frameIndex = 0;
+
+    // a headless run with benchmarks lasts until they have measured every step
+    if (headless.enabled) {
+        benchmarkRequested = headless.transparencyBenchmark;
+        drawBenchmarkRequested = headless.drawBenchmark;
+    }
+    auto running = [&]() {
+        if (!headless.enabled)
+            return !glfwWindowShouldClose(window);
+        if (headless.transparencyBenchmark || headless.drawBenchmark)
+            return benchmarkRequested || benchmark.active() || drawBenchmarkRequested || drawBenchmark.active();
+        return frameIndex < headless.frames;
+    };
+
+    // the counters of the first frame should not include the setup
+    glState.endFrame();
 
-    while (!glfwWindowShouldClose(window))
+    while (running())
     {
-        float currentFrame = glfwGetTime();
+        auto frameStart = std::chrono::steady_clock::now();
+        // headless frames are stepped by a scripted clock, so that every run renders the same images
+        float currentFrame = headless.enabled ? frameIndex / headless.frameRate : (float)glfwGetTime();
         deltaTime = currentFrame - lastFrame;
         lastFrame = currentFrame;
-        processInput(window);
+        if (headless.enabled) {
+            glm::vec3 position, target;
+            cameraPath.sample(currentFrame, position, target);
+            camera.lookAt(position, target);
+        }
+        else
+            processInput(window);
 
-        glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
+        if (benchmarkRequested) {
+            // random windows in a box around the ones of the scene
+            benchmark.start(glm::vec3(0.0f, 4.0f, -7.0f), glm::vec3(4.0f, 3.0f, 4.0f));
+            benchmarkRequested = false;
+        }
+        if (drawBenchmarkRequested) {
+            // random boxes over the ground
+            drawBenchmark.start(glm::vec3(0.0f, 2.0f, 0.0f), glm::vec3(9.0f, 2.0f, 9.0f));
+            drawBenchmarkRequested = false;
+        }
+
+        // switching to the programs compiled for the features toggled from the keyboard
+        if (shaderFeatures != activeFeatures) {
+            commonShader = &commonShaders.get(shaderFeatures);
+            boxShader = &boxShaders.get(shaderFeatures);
+            if (multiDrawIndirect)
+                indirectBoxShader = &indirectBoxShaders.get(shaderFeatures);
+            wallNormalShader = &wallNormalShaders.get(shaderFeatures);
+            activeFeatures = shaderFeatures;
+            prepareToggles(activeFeatures);
+        }
+        pollShaders();
+
+        // the scene goes to the framebuffer of the post effect in monochrome mode, which has to be cleared as well
+        unsigned int sceneFramebuffer = monochromeOn ? frameBuffer : screenFramebuffer;
+        glState.bindFramebuffer(GL_FRAMEBUFFER, sceneFramebuffer);
+        glClearColor(CLEAR_COLOR.r, CLEAR_COLOR.g, CLEAR_COLOR.b, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-        glEnable(GL_BLEND);
-        glEnable(GL_DEPTH_TEST);
-        if (monochromeOn)
-            glBindFramebuffer(GL_FRAMEBUFFER, frameBuffer);
+        glState.enable(GL_BLEND);
+        glState.enable(GL_DEPTH_TEST);
 
-        glActiveTexture(GL_TEXTURE0);
+        glState.activeTexture(GL_TEXTURE0);
 
-        // sorting windows
+        // updating uniform buffers
 
-        float windowDistances[windowsNum];
-        glm::vec3 sortedWindows[windowsNum];
-        for (int i = 0; i < windowsNum; i++) {
-            windowDistances[i] = glm::length(camera.Position - windowPositions[i]);
-            sortedWindows[i] = windowPositions[i];
+        glm::mat4 view = camera.getViewMatrix();
+        glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)frameWidth / (float)frameHeight, 0.1f, 100.0f);
+
+        FrameUniforms& frame = uniformBuffers.frame;
+        frame.view = view;
+        frame.projection = projection;
+        frame.skyboxView = glm::mat4(glm::mat3(view));
+        frame.viewPosition = camera.Position;
+        frame.lightPosition = lightPosition;
+        frame.camUp = camera.Up;
+        frame.camRight = camera.Right;
+
+        // object transforms
+
+        SceneTransforms transforms = animateScene(currentFrame);
+        const glm::mat4& wallModel = transforms.wall;
+        const glm::mat4& lightModel = transforms.light;
+        const glm::mat4& reflectModel = transforms.reflect;
+
+        // frustum culling, objects outside the view get neither a uniform slot nor a draw call
+
+        Frustum frustum = camera.getFrustum(projection);
+
+        sceneBounds.clear();
+        unsigned int groundBounds = sceneBounds.add(glm::vec3(0.0f, -0.5f, 0.0f), glm::vec3(10.0f, 0.0f, 10.0f));
+        unsigned int wallBounds = sceneBounds.add(wallModel, glm::vec3(0.0f), glm::vec3(1.0f, 1.0f, 0.0f));
+        unsigned int lightBounds = sceneBounds.add(lightModel, glm::vec3(0.0f), glm::vec3(1.0f));
+        unsigned int reflectBounds = sceneBounds.add(reflectModel, glm::vec3(0.0f), glm::vec3(1.0f));
+        cullBoxes(frustum, sceneBounds, sceneVisible);
+
+        // the draw benchmark replaces the boxes with its own and picks how they are submitted
+        const glm::mat4* boxes = transforms.boxes;
+        size_t boxesCount = boxesNum;
+        DrawSubmission boxSubmission = indirectOn ? DrawSubmission::MULTI_DRAW : DrawSubmission::INSTANCED;
+        if (drawBenchmark.active()) {
+            boxes = drawBenchmark.models().data();
+            boxesCount = drawBenchmark.models().size();
+            boxSubmission = drawBenchmark.submission();
+            drawBenchmark.beginCPU();
         }
-        float tempDist;
-        glm::vec3 tempVec = glm::vec3(0.0f);
-        for (int i = 1; i < windowsNum; i++) {
-            for (int j = 0; j < windowsNum - i; j++) {
-                if (windowDistances[j] < windowDistances[j + 1]) {
-                    tempDist = windowDistances[j];
-                    tempVec = sortedWindows[j];
-                    windowDistances[j] = windowDistances[j + 1];
-                    sortedWindows[j] = sortedWindows[j + 1];
-                    windowDistances[j + 1] = tempDist;
-                    sortedWindows[j + 1] = tempVec;
-                }
-            }
+
+        boxBounds.clear();
+        for (size_t i = 0; i < boxesCount; i++)
+            boxBounds.add(boxes[i], glm::vec3(0.0f), glm::vec3(1.0f));
+        cullBoxes(frustum, boxBounds, boxesVisible);
+
+        // visible boxes become instances of one draw or draws of one indirect call
+        boxInstances.clear();
+        boxDraws.clear();
+        for (size_t i = 0; i < boxesCount; i++) {
+            if (!boxesVisible[i])
+                continue;
+            glm::mat4 model = boxes[i] * cubePacked.dequantize;
+            float shininess = boxShininess[i % boxesNum];
+            float layer = (float)(i % textures.boxes.size());
+            if (boxSubmission == DrawSubmission::INSTANCED)
+                boxInstances.add(model, shininess, layer);
+            else
+                boxDraws.add(geometry, cubeGeometry, model, shininess, layer);
+        }
+        boxInstances.upload();
+        boxDraws.upload();
+
+        if (drawBenchmark.active())
+            drawBenchmark.endCPU();
+
+        // the benchmark replaces the windows with its own instances and picks the transparency path
+        const glm::vec3* windows = windowPositions;
+        size_t windowsCount = windowsNum;
+        bool weightedBlended = oitOn;
+        if (benchmark.active()) {
+            windows = benchmark.positions().data();
+            windowsCount = benchmark.positions().size();
+            weightedBlended = benchmark.weightedBlended();
+            benchmark.beginCPU();
         }
 
-        // setting uniforms
+        // a window quad spans 1.25 units to the right of its position and 0.625 units up and down
+        windowBounds.clear();
+        for (size_t i = 0; i < windowsCount; i++)
+            windowBounds.add(windows[i] + 0.625f * camera.Right, 0.625f * glm::sqrt(2.0f));
+        cullSpheres(frustum, windowBounds, windowsVisible);
+
+        // windows are billboards, only the translation of their model matrix is used;
+        // sorted blending needs them back to front, weighted blended transparency takes them in any order
+        windowInstances.clear();
+        if (weightedBlended) {
+            for (size_t i = 0; i < windowsCount; i++)
+                if (windowsVisible[i])
+                    windowInstances.add(glm::translate(glm::mat4(1.0f), windows[i]));
+        }
+        else {
+            for (unsigned int window : windowSorter.sort(windows, windowsVisible.data(), windowsCount, camera.Position))
+                windowInstances.add(glm::translate(glm::mat4(1.0f), windows[window]));
+        }
+        windowInstances.upload();
 
-        commonShader.use();
-        commonShader.setBool("lightOn", lightOn);
-        commonShader.setBool("Blinn", Blinn);
-        commonShader.setBool("fogOn", fogOn);
-        commonShader.setVec3("lightPosition", lightPosition);
-        commonShader.setVec3("viewPosition", camera.Position);
+        if (benchmark.active())
+            benchmark.endCPU();
 
-        glm::mat4 view = camera.getViewMatrix();
-        glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)SCREEN_WIDTH / (float)SCREEN_HEIGHT, 0.1f, 100.0f);
-        commonShader.setMat4("view", view);
-        commonShader.setMat4("projection", projection);
+        uniformBuffers.beginFrame();
+
+        unsigned int groundObject = 0;
+        if (sceneVisible[groundBounds])
+            groundObject = uniformBuffers.addObject(groundPacked.dequantize, GROUND_SHININESS);
+
+        unsigned int wallObject = 0;
+        if (sceneVisible[wallBounds])
+            wallObject = uniformBuffers.addObject(wallModel * wallPacked.dequantize, WALL_SHININESS);
+
+        unsigned int lightObject = 0;
+        if (sceneVisible[lightBounds])
+            lightObject = uniformBuffers.addObject(lightModel * cubePacked.dequantize);
+
+        unsigned int reflectObject = 0;
+        if (sceneVisible[reflectBounds])
+            reflectObject = uniformBuffers.addObject(reflectModel * cubePacked.dequantize);
+
+        uniformBuffers.upload();
+
+        // queueing the draws: ground, textured boxes, wall with normal mapping, light source and windows if skybox is off,
+        // reflecting cube and skybox if it is on; the queue sorts them by program, textures and depth
 
-        // rendering ground, textured boxes, windows and wall with normal mapping if skybox is off
+        auto viewDepth = [&](const glm::mat4& model) { return -(view * model[3]).z; };
+
+        renderQueue.clear();
 
         if (!skyboxOn) {
+            if (sceneVisible[groundBounds]) {
+                DrawPacket ground(*commonShader, groundGeometry);
+                ground.object = groundObject;
+                ground.addTexture(GL_TEXTURE_2D, groundTex);
+                renderQueue.submit(RenderPass::SCENE, RenderLayer::SOLID, ground, viewDepth(glm::mat4(1.0f)));
+            }
 
-            // rendering ground
-
-            glBindVertexArray(groundVAO);
-            glm::mat4 groundModel = glm::mat4(1.0f);
-            commonShader.setMat4("model", groundModel);
-            commonShader.setFloat("shininess", 2.0);
-            glBindTexture(GL_TEXTURE_2D, groundTex);
-            glDrawArrays(GL_TRIANGLES, 0, 6);
-            glBindVertexArray(0);
-
-            // rendering boxes 
-
-            glBindVertexArray(boxVAO);
-            for (unsigned int i = 0; i < 5; i++) {
-                glm::mat4 boxModel = glm::mat4(1.0f);
-                boxModel = glm::translate(boxModel, boxPositions[i]);
-                if (i == 0) {
-                    boxModel = glm::rotate(boxModel, 0.25f * (float)glfwGetTime(), glm::vec3(0.0f, 1.0f, 0.0f));
-                    boxModel = glm::scale(boxModel, glm::vec3(1.25));
-                    commonShader.setFloat("shininess", 25.0);
-                }
-                else if (i == 1) {
-                    boxModel = glm::rotate(boxModel, 0.5f * (float)glfwGetTime(), glm::vec3(3.4f, 1.1f, 2.8f));
-                    boxModel = glm::scale(boxModel, glm::vec3(0.5f));
-                    commonShader.setFloat("shininess", 10.0);
-                }
-                else if (i == 2) {
-                    boxModel = glm::rotate(boxModel, 0.75f * (float)glfwGetTime(), glm::vec3(-4.1f, 2.5f, -1.7f));
-                    boxModel = glm::scale(boxModel, glm::vec3(0.75f));
-                    commonShader.setFloat("shininess", 20.0);
-                }
-                else if (i == 3) {
-                    boxModel = glm::rotate(boxModel, 1.25f * (float)glfwGetTime(), glm::vec3(-2.0f, 1.5f, 4.5f));
-                    boxModel = glm::scale(boxModel, glm::vec3(1.1f));
-                    commonShader.setFloat("shininess", 15.0);
-                }
-                else if (i == 4) {
-                    boxModel = glm::rotate(boxModel, (float)glfwGetTime(), glm::vec3(1.4f, 3.3f, -3.6f));
-                    boxModel = glm::scale(boxModel, glm::vec3(0.9f));
-                    commonShader.setFloat("shininess", 10.0);
-                }
-                commonShader.setMat4("model", boxModel);
-
-                glBindTexture(GL_TEXTURE_2D, boxTextures[i]);
-                glDrawArrays(GL_TRIANGLES, 0, 36);
+            if (boxInstances.size() > 0) {
+                DrawPacket boxPacket(*boxShader, cubeGeometry, boxInstances.size());
+                boxPacket.addTexture(GL_TEXTURE_2D_ARRAY, boxTextures);
+                renderQueue.submit(RenderPass::SCENE, RenderLayer::SOLID, boxPacket);
             }
-            glBindVertexArray(0);
-
-            // rendering wall with normal mapping
-
-            wallNormalShader.use();
-            wallNormalShader.setMat4("view", view);
-            wallNormalShader.setMat4("projection", projection);
-            wallNormalShader.setBool("lightOn", lightOn);
-            wallNormalShader.setBool("Blinn", Blinn);
-            wallNormalShader.setBool("fogOn", fogOn);
-            wallNormalShader.setBool("parallaxOn", parallaxOn);
-            wallNormalShader.setVec3("viewPosition", camera.Position);
-            wallNormalShader.setVec3("lightPosition", lightPosition);
-            glm::mat4 wallModel = glm::mat4(1.0f);
-            wallModel = glm::translate(wallModel, wallPosition);
-            wallModel = glm::rotate(wallModel, -0.1f * (float)glfwGetTime(), glm::vec3(3.0f, 1.0f, 2.0f));
-            wallModel = glm::scale(wallModel, glm::vec3(2.5f));
-            wallNormalShader.setMat4("model", wallModel);
-            wallNormalShader.setFloat("shininess", 15.0);
-            glBindVertexArray(wallVAO);
-            glActiveTexture(GL_TEXTURE0);
-            glBindTexture(GL_TEXTURE_2D, wallDiffuse);
-            glActiveTexture(GL_TEXTURE1);
-            glBindTexture(GL_TEXTURE_2D, wallNormal);
-            if (parallaxOn) {
-                glActiveTexture(GL_TEXTURE2);
-                glBindTexture(GL_TEXTURE_2D, wallBump);
+            if (boxDraws.size() > 0) {
+                DrawPacket boxPacket(*indirectBoxShader, boxDraws, boxSubmission);
+                boxPacket.addTexture(GL_TEXTURE_2D_ARRAY, boxTextures);
+                renderQueue.submit(RenderPass::SCENE, RenderLayer::SOLID, boxPacket);
             }
-            glDrawArrays(GL_TRIANGLES, 0, 6);
-            glBindVertexArray(0);
-            glActiveTexture(GL_TEXTURE0);
-
-            // rendering light source if light is on
-
-            if (lightOn) {
-                lightShader.use();
-                lightShader.setMat4("view", view);
-                lightShader.setMat4("projection", projection);
-                glm::mat4 lightModel = glm::mat4(1.0f);
-                lightModel = glm::translate(lightModel, lightPosition);
-                lightModel = glm::scale(lightModel, glm::vec3(0.1f));
-                lightShader.setMat4("model", lightModel);
-                glBindVertexArray(lightVAO);
-                glDrawArrays(GL_TRIANGLES, 0, 36);
-                glBindVertexArray(0);
+
+            if (sceneVisible[wallBounds]) {
+                DrawPacket wall(*wallNormalShader, wallGeometry);
+                wall.object = wallObject;
+                wall.addTexture(GL_TEXTURE_2D, wallDiffuse);
+                wall.addTexture(GL_TEXTURE_2D, wallNormal);
+                if (shaderFeatures & PARALLAX_ON)
+                    wall.addTexture(GL_TEXTURE_2D, wallBump);
+                renderQueue.submit(RenderPass::SCENE, RenderLayer::SOLID, wall, viewDepth(wallModel));
             }
 
-            // rendering windows
-
-            glEnable(GL_BLEND);
-            glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-            glBindVertexArray(windowVAO);
-            glActiveTexture(GL_TEXTURE0);
-            glBindTexture(GL_TEXTURE_2D, windowTex);
-            windowShader.use();
-            windowShader.setMat4("view", view);
-            windowShader.setMat4("projection", projection);
-            windowShader.setVec3("camUp", camera.Up);
-            windowShader.setVec3("camRight", camera.Right);
-            for (int i = 0; i < windowsNum; i++) {
-                windowShader.setVec3("placing", sortedWindows[i]);
-                glDrawArrays(GL_TRIANGLES, 0, 6);
+            if ((shaderFeatures & LIGHT_ON) && sceneVisible[lightBounds]) {
+                DrawPacket light(lightShader, cubeGeometry);
+                light.object = lightObject;
+                renderQueue.submit(RenderPass::SCENE, RenderLayer::SOLID, light, viewDepth(lightModel));
             }
-            glBindVertexArray(0);
-        }
 
+            // the windows are one draw, their instances are already in blending order
+            if (windowInstances.size() > 0) {
+                DrawPacket windowPacket(weightedBlended ? windowOITShader : windowShader, windowGeometry, windowInstances.size());
+                windowPacket.addTexture(GL_TEXTURE_2D, windowTex);
+                renderQueue.submit(RenderPass::SCENE, RenderLayer::TRANSLUCENT, windowPacket);
+            }
+        }
         else {
+            if (sceneVisible[reflectBounds]) {
+                DrawPacket reflect(reflectShader, cubeGeometry);
+                reflect.object = reflectObject;
+                reflect.addTexture(GL_TEXTURE_CUBE_MAP, skyTex);
+                renderQueue.submit(RenderPass::SCENE, RenderLayer::SOLID, reflect, viewDepth(reflectModel));
+            }
+
+            DrawPacket sky(skyboxShader, cubeGeometry);
+            sky.addTexture(GL_TEXTURE_CUBE_MAP, skyTex);
+            renderQueue.submit(RenderPass::SCENE, RenderLayer::SKY, sky);
+        }
 
-            // rendering reflecting cube if skybox is on
-
-            glm::mat4 reflectModel = glm::mat4(1.0f);
-            reflectModel = glm::translate(reflectModel, glm::vec3(0.0f, 1.2f, 0.0f));
-            reflectModel = glm::rotate(reflectModel, 0.1f * (float)glfwGetTime(), glm::vec3(0.0f, 1.0f, 0.0f));
-            reflectModel = glm::scale(reflectModel, glm::vec3(1.25));
-
-            reflectShader.use();
-            reflectShader.setMat4("model", reflectModel);
-            reflectShader.setMat4("view", view);
-            reflectShader.setMat4("projection", projection);
-            reflectShader.setVec3("viewPosition", camera.Position);
-            glBindVertexArray(mirrorCubeVAO);
-            glActiveTexture(GL_TEXTURE0);
-            glBindTexture(GL_TEXTURE_CUBE_MAP, skyTex);
-            glDrawArrays(GL_TRIANGLES, 0, 36);
-            glBindVertexArray(0);
-
-            // rendering skybox
-
-            glDepthFunc(GL_LEQUAL);
-
-            skyboxShader.use();
-            view = glm::mat4(glm::mat3(camera.getViewMatrix()));
-            skyboxShader.setMat4("view", view);
-            skyboxShader.setMat4("projection", projection);
-            glBindVertexArray(skyboxVAO);
-            glActiveTexture(GL_TEXTURE0);
-            glBindTexture(GL_TEXTURE_CUBE_MAP, skyTex);
-            glDrawArrays(GL_TRIANGLES, 0, 36);
-            glBindVertexArray(0);
-
-            glDepthFunc(GL_LESS);
+        if (monochromeOn) {
+            DrawPacket posteffect(posteffectShader, screenGeometry);
+            posteffect.addTexture(GL_TEXTURE_2D, texColorBuffer);
+            renderQueue.submit(RenderPass::POSTPROCESS, RenderLayer::SOLID, posteffect);
+        }
+
+        renderQueue.sort();
+
+        // rendering opaque objects, the draw benchmark times them as a whole (its boxes are nearly all of them)
+
+        if (drawBenchmark.active())
+            drawBenchmark.beginGPU();
+
+        renderQueue.execute(RenderPass::SCENE, RenderLayer::SOLID);
+
+        if (drawBenchmark.active()) {
+            drawBenchmark.endSubmit();
+            drawBenchmark.endGPU();
+        }
+
+        // rendering skybox
+
+        if (renderQueue.count(RenderPass::SCENE, RenderLayer::SKY) > 0) {
+            glState.depthFunc(GL_LEQUAL);
+            renderQueue.execute(RenderPass::SCENE, RenderLayer::SKY);
+            glState.depthFunc(GL_LESS);
         }
 
+        // rendering windows
+
+        if (benchmark.active())
+            benchmark.beginGPU();
+
+        if (renderQueue.count(RenderPass::SCENE, RenderLayer::TRANSLUCENT) > 0) {
+            if (weightedBlended)
+                transparency.begin(sceneFramebuffer);
+            else {
+                glState.enable(GL_BLEND);
+                glState.blendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+            }
+            renderQueue.execute(RenderPass::SCENE, RenderLayer::TRANSLUCENT);
+            if (weightedBlended)
+                transparency.composite(sceneFramebuffer, oitCompositeShader, geometry, screenGeometry);
+        }
+
+        if (benchmark.active())
+            benchmark.endGPU();
+
         // monochrome (grayscale) mode
 
         if (monochromeOn) {
-            glBindFramebuffer(GL_FRAMEBUFFER, 0);
-            glDisable(GL_DEPTH_TEST);
+            glState.bindFramebuffer(GL_FRAMEBUFFER, screenFramebuffer);
+            glState.disable(GL_DEPTH_TEST);
             glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
             glClear(GL_COLOR_BUFFER_BIT);
 
-            posteffectShader.use();
-            glBindVertexArray(screenVAO);
-            glBindTexture(GL_TEXTURE_2D, texColorBuffer);
-            glDrawArrays(GL_TRIANGLES, 0, 6);
-            glBindVertexArray(0);
+            renderQueue.execute(RenderPass::POSTPROCESS, RenderLayer::SOLID);
         }
 
-        glfwSwapBuffers(window);
-        glfwPollEvents();
+        if (headless.enabled) {
+            double cpuMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frameStart).count();
+            glFinish();
+            double frameMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frameStart).count();
+            frameTimings.add(currentFrame, cpuMs, frameMs);
+
+            if (!headless.pngDirectory.empty())
+                captureFrame(screenFramebuffer, frameWidth, frameHeight, framePath(headless, frameIndex));
+            frameIndex++;
+        }
+        else
+            glfwSwapBuffers(window);
+        GLStateCounters stateCounters = glState.endFrame();
+        if (stateCountersRequested) {
+            std::cout << "GL state calls in the last frame: " << stateCounters.issued << " issued, " << stateCounters.elided << " elided\n";
+            stateCountersRequested = false;
+        }
+        benchmark.endFrame();
+        drawBenchmark.endFrame();
+        if (!headless.enabled)
+            glfwPollEvents();
     }
 
-    // memory cleaning
-
-    glDeleteVertexArrays(1, &groundVAO);
-    glDeleteVertexArrays(1, &boxVAO);
-    glDeleteVertexArrays(1, &mirrorCubeVAO);
-    glDeleteVertexArrays(1, &windowVAO);
-    glDeleteVertexArrays(1, &wallVAO);
-    glDeleteVertexArrays(1, &lightVAO);
-    glDeleteVertexArrays(1, &skyboxVAO);
-    glDeleteVertexArrays(1, &screenVAO);
-    glDeleteBuffers(1, &groundVBO);
-    glDeleteBuffers(1, &boxVBO);
-    glDeleteBuffers(1, &mirrorCubeVBO);
-    glDeleteBuffers(1, &windowVBO);
-    glDeleteBuffers(1, &wallVBO);
-    glDeleteBuffers(1, &lightVBO);
-    glDeleteBuffers(1, &skyboxVBO);
-    glDeleteBuffers(1, &screenVBO);
-
-    glfwTerminate();
+    if (headless.enabled) {
+        std::cout << "Rendered " << frameIndex << " frames of " << frameWidth << "x" << frameHeight << "\n";
+        frameTimings.report();
+        if (!headless.timingsPath.empty())
+            frameTimings.writeCSV(headless.timingsPath);
+    }
+    else
+        glfwTerminate();
 
     return 0;
 }
@@ -842,15 +833,15 @@ void processInput(GLFWwindow* window)
         zPressed = false;
 
     if (glfwGetKey(window, GLFW_KEY_L) == GLFW_PRESS && !lPressed) {
-        lightOn = !lightOn;
+        shaderFeatures ^= LIGHT_ON;
         lPressed = true;
     }
     if (glfwGetKey(window, GLFW_KEY_L) == GLFW_RELEASE)
         lPressed = false;
 
     if (glfwGetKey(window, GLFW_KEY_B) == GLFW_PRESS && !bPressed) {
-        Blinn = !Blinn;
-        if (Blinn)
+        shaderFeatures ^= BLINN;
+        if (shaderFeatures & BLINN)
             std::cout << "Switched to Blinn-Phong\n";
         else
             std::cout << "Switched to Phong\n";
@@ -860,7 +851,7 @@ void processInput(GLFWwindow* window)
         bPressed = false;
 
     if (glfwGetKey(window, GLFW_KEY_F) == GLFW_PRESS && !skyboxOn && !fPressed) {
-        fogOn = !fogOn;
+        shaderFeatures ^= FOG_ON;
         fPressed = true;
     }
     if (glfwGetKey(window, GLFW_KEY_F) == GLFW_RELEASE)
@@ -874,8 +865,8 @@ void processInput(GLFWwindow* window)
         mPressed = false;
 
     if (glfwGetKey(window, GLFW_KEY_P) == GLFW_PRESS && !pPressed) {
-        parallaxOn = !parallaxOn;
-        if (parallaxOn)
+        shaderFeatures ^= PARALLAX_ON;
+        if (shaderFeatures & PARALLAX_ON)
             std::cout << "Parallax mapping on\n";
         else
             std::cout << "Simple normal mapping on\n";
@@ -883,6 +874,53 @@ void processInput(GLFWwindow* window)
     }
     if (glfwGetKey(window, GLFW_KEY_P) == GLFW_RELEASE)
         pPressed = false;
+
+    if (glfwGetKey(window, GLFW_KEY_O) == GLFW_PRESS && !oPressed) {
+        oitOn = !oitOn;
+        if (oitOn)
+            std::cout << "Weighted blended transparency on\n";
+        else
+            std::cout << "Sorted transparency on\n";
+        oPressed = true;
+    }
+    if (glfwGetKey(window, GLFW_KEY_O) == GLFW_RELEASE)
+        oPressed = false;
+
+    if (glfwGetKey(window, GLFW_KEY_T) == GLFW_PRESS && !tPressed) {
+        benchmarkRequested = true;
+        tPressed = true;
+    }
+    if (glfwGetKey(window, GLFW_KEY_T) == GLFW_RELEASE)
+        tPressed = false;
+
+    if (glfwGetKey(window, GLFW_KEY_I) == GLFW_PRESS && !iPressed) {
+        if (!hasMultiDrawIndirect())
+            std::cerr << "ERROR: multi-draw indirect is not supported" << std::endl;
+        else {
+            indirectOn = !indirectOn;
+            if (indirectOn)
+                std::cout << "Multi-draw indirect boxes on\n";
+            else
+                std::cout << "Instanced boxes on\n";
+        }
+        iPressed = true;
+    }
+    if (glfwGetKey(window, GLFW_KEY_I) == GLFW_RELEASE)
+        iPressed = false;
+
+    if (glfwGetKey(window, GLFW_KEY_G) == GLFW_PRESS && !gPressed) {
+        drawBenchmarkRequested = true;
+        gPressed = true;
+    }
+    if (glfwGetKey(window, GLFW_KEY_G) == GLFW_RELEASE)
+        gPressed = false;
+
+    if (glfwGetKey(window, GLFW_KEY_C) == GLFW_PRESS && !cPressed) {
+        stateCountersRequested = true;
+        cPressed = true;
+    }
+    if (glfwGetKey(window, GLFW_KEY_C) == GLFW_RELEASE)
+        cPressed = false;
 }
 
 void framebufferSizeCallback(GLFWwindow* window, int width, int height)
@@ -910,68 +948,4 @@ void mouseCallback(GLFWwindow* window, double xpos, double ypos)
     lastY = ypos;
 
     camera.processMouseMovement(xoffset, yoffset);
-}
-
-unsigned int loadTexture(char const* filename)
-{
-    unsigned int tex;
-    int width, height, channelsNum;
-
-    glGenTextures(1, &tex);
-    unsigned char* data = stbi_load(filename, &width, &height, &channelsNum, 0);
-    if (data) {
-        GLenum internalFormat = GL_RGB, dataFormat = GL_RGB;
-        if (channelsNum == 1) {
-            internalFormat = GL_RED;
-            dataFormat = GL_RED;
-        }
-        else if (channelsNum == 3) {
-            internalFormat = GL_RGB;
-            dataFormat = GL_RGB;
-        }
-        else if (channelsNum == 4) {
-            internalFormat = GL_RGBA;
-            dataFormat = GL_RGBA;
-        }
-
-        glBindTexture(GL_TEXTURE_2D, tex);
-        glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, dataFormat, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    }
-    else
-        std::cerr << "ERROR: unable to load texture from file " << filename << std::endl;
-
-    stbi_image_free(data);
-
-    return tex;
-}
-
-unsigned int loadCubeTexture(std::vector<std::string> faces)
-{
-    unsigned int tex;
-    int width, height, channelsNum;
-
-    glGenTextures(1, &tex);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, tex);
-
-    for (unsigned int i = 0; i < faces.size(); i++) {
-        unsigned char* data = stbi_load(faces[i].c_str(), &width, &height, &channelsNum, 0);
-        if (data)
-            glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
-        else
-            std::cerr << "ERROR: unable to load cubemap from file " << faces[i] << std::endl;
-        stbi_image_free(data);
-    }
-
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-
-    return tex;
 }
\ No newline at end of file
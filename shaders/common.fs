@@ -5,50 +5,57 @@ in vec3 FragPosition;
 in vec3 Normal;
 in vec2 TexCoord;
 
+#ifdef FOG_ON
 in float fogFactor;
+#endif
 
-uniform vec3 lightPosition;
-uniform vec3 viewPosition;
-uniform vec3 lightColor;
-uniform vec3 fogColor;
- 
+#include "uniforms.glsl"
+
+#ifdef INSTANCED
+flat in float shininess;
+flat in float layer;
+
+uniform sampler2DArray tex;
+#else
 uniform sampler2D tex;
+#endif
 
-uniform bool lightOn;
-uniform bool Blinn;
-uniform bool fogOn;
-uniform float shininess; 
+// features are compiled in with #define (LIGHT_ON, BLINN, FOG_ON, INSTANCED), see ShaderVariants
 
 void main()
 {
-    if (lightOn) {
-        float ambientStrength = 0.1;
-        float specularStrength = 0.5;
-
-        vec3 norm = normalize(Normal);
-        vec3 lightDirection = normalize(lightPosition - FragPosition);
-        vec3 viewDirection = normalize(viewPosition - FragPosition);
-
-        vec3 ambient = ambientStrength * lightColor;
-        vec3 diffuse = max(dot(norm, lightDirection), 0.0) * lightColor; 
-        vec3 specular = vec3(0.0);
-
-        float spec = 0.0;
-        if (Blinn)
-            spec = pow(max(dot(norm, normalize(lightDirection + viewDirection)), 0.0), shininess);
-        else
-            spec = pow(max(dot(viewDirection, reflect(-lightDirection, norm)), 0.0), shininess);
-
-        specular = specularStrength * spec * lightColor;
-
-        vec4 texColor = texture(tex, TexCoord);
-        FragColor = vec4(ambient + diffuse, 1.0) * texColor + vec4(specular, 1.0);
-        if (fogOn)
-            FragColor = mix(vec4(fogColor, 1.0f), FragColor, fogFactor);
-    }
-    else {
-        FragColor = texture(tex, TexCoord);
-        if (fogOn)
-            FragColor = mix(vec4(fogColor, 1.0f), FragColor, fogFactor);
-    }
+#ifdef INSTANCED
+    vec4 texColor = texture(tex, vec3(TexCoord, layer));
+#else
+    vec4 texColor = texture(tex, TexCoord);
+#endif
+
+#ifdef LIGHT_ON
+    float ambientStrength = 0.1;
+    float specularStrength = 0.5;
+
+    vec3 norm = normalize(Normal);
+    vec3 lightDirection = normalize(lightPosition - FragPosition);
+    vec3 viewDirection = normalize(viewPosition - FragPosition);
+
+    vec3 ambient = ambientStrength * lightColor;
+    vec3 diffuse = max(dot(norm, lightDirection), 0.0) * lightColor; 
+    vec3 specular = vec3(0.0);
+
+#ifdef BLINN
+    float spec = pow(max(dot(norm, normalize(lightDirection + viewDirection)), 0.0), shininess);
+#else
+    float spec = pow(max(dot(viewDirection, reflect(-lightDirection, norm)), 0.0), shininess);
+#endif
+
+    specular = specularStrength * spec * lightColor;
+
+    FragColor = vec4(ambient + diffuse, 1.0) * texColor + vec4(specular, 1.0);
+#else
+    FragColor = texColor;
+#endif
+
+#ifdef FOG_ON
+    FragColor = mix(vec4(fogColor, 1.0f), FragColor, fogFactor);
+#endif
 }
\ No newline at end of file
@@ -1,33 +1,64 @@
 #version 330 core
+#ifdef DRAW_ID
+#extension GL_ARB_shader_draw_parameters : enable
+#endif
 layout (location = 0) in vec3 position;
-layout (location = 1) in vec3 normals;
+layout (location = 1) in vec4 normals;   // GL_INT_2_10_10_10_REV
 layout (location = 2) in vec2 texCoords;
 
 out vec3 FragPosition;
 out vec3 Normal;
 out vec2 TexCoord;
 
+#ifdef FOG_ON
 out float fogFactor;
+#endif
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+#ifdef INSTANCED
+#ifdef DRAW_ID
+// multi-draw indirect: 8 texels per draw with model, normal matrix and material (IndirectDrawBuffer.h)
+uniform samplerBuffer drawData;
+uniform int drawOffset;
+#else
+layout (location = 3) in mat4 model;
+layout (location = 7) in mat3 normalMatrix;
+layout (location = 10) in vec2 material;
+#endif
 
-uniform float fogDensity;
-uniform float fogGradient;
+flat out float shininess;
+flat out float layer;
+#endif
+
+#include "uniforms.glsl"
 
 void main()
 {
-	mat3 normalMatrix = mat3(transpose(inverse(model)));
+#ifdef DRAW_ID
+#ifdef GL_ARB_shader_draw_parameters
+	int draw = (drawOffset + gl_DrawIDARB) * 8;
+#else
+	int draw = drawOffset * 8;
+#endif
+	mat4 model = mat4(texelFetch(drawData, draw), texelFetch(drawData, draw + 1), texelFetch(drawData, draw + 2), texelFetch(drawData, draw + 3));
+	mat3 normalMatrix = mat3(texelFetch(drawData, draw + 4).xyz, texelFetch(drawData, draw + 5).xyz, texelFetch(drawData, draw + 6).xyz);
+	vec2 material = texelFetch(drawData, draw + 7).xy;
+#endif
 
 	FragPosition = vec3(model * vec4(position, 1.0f));
-	Normal = normalize(normalMatrix * normals);
+	Normal = normalize(mat3(normalMatrix) * (normals.xyz / 511.0));
 	TexCoord = texCoords; 
 
+#ifdef INSTANCED
+	shininess = material.x;
+	layer = material.y;
+#endif
+
+#ifdef FOG_ON
 	vec4 CameraPosition = view * model * vec4(position, 1.0f);
 	float distance = length(CameraPosition.xyz);
 	fogFactor = exp(-pow((distance * fogDensity), fogGradient));
     fogFactor = clamp(fogFactor, 0.0f, 1.0f);
+#endif
 
 	gl_Position = projection * view * model * vec4(position, 1.0f);
 }
\ No newline at end of file
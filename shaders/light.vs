@@ -1,9 +1,7 @@
 #version 330 core
 layout (location = 0) in vec3 position;
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+#include "uniforms.glsl"
 
 void main()
 {
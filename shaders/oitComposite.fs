@@ -0,0 +1,19 @@
+#version 330 core
+out vec4 FragColor;
+
+// accumulated colour in rgb and revealage (product of 1 - alpha) in a, sum of the weights in r
+uniform sampler2D accumulation;
+uniform sampler2D weightSum;
+
+void main()
+{
+    ivec2 texel = ivec2(gl_FragCoord.xy);
+    vec4 accum = texelFetch(accumulation, texel, 0);
+    float revealage = accum.a;
+    if (revealage >= 1.0)
+        discard;
+
+    // blended with GL_ONE_MINUS_SRC_ALPHA, GL_SRC_ALPHA: the average colour covers 1 - revealage of the scene
+    vec3 average = accum.rgb / max(texelFetch(weightSum, texel, 0).r, 0.00001);
+    FragColor = vec4(average, revealage);
+}
@@ -4,7 +4,7 @@ out vec4 FragColor;
 in vec3 Position;
 in vec3 Normal;
 
-uniform vec3 viewPosition;
+#include "uniforms.glsl"
 uniform samplerCube skybox;
 
 void main()
@@ -1,18 +1,15 @@
 #version 330 core
 layout (location = 0) in vec3 position;
-layout (location = 1) in vec3 normals;
+layout (location = 1) in vec4 normals;   // GL_INT_2_10_10_10_REV
 
 out vec3 Position;
 out vec3 Normal;
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+#include "uniforms.glsl"
 
 void main()
 {
-	mat3 normalMatrix = mat3(transpose(inverse(model)));
-	Normal = normalize(normalMatrix * normals);
+	Normal = normalize(mat3(normalMatrix) * (normals.xyz / 511.0));
 	Position = vec3(model * vec4(position, 1.0f));
 	gl_Position = projection * view * model * vec4(position, 1.0f);
 }
\ No newline at end of file
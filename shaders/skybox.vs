@@ -3,12 +3,11 @@ layout (location = 0) in vec3 position;
 
 out vec3 TexCoord;
 
-uniform mat4 view;
-uniform mat4 projection;
+#include "uniforms.glsl"
 
 void main()
 {
     TexCoord = position;
-    vec4 pos = projection * view * vec4(position, 1.0);
+    vec4 pos = projection * skyboxView * vec4(position, 1.0);
     gl_Position = pos.xyww;
 }  
@@ -0,0 +1,26 @@
+// blocks shared by the scene programs, see FrameUniforms and ObjectUniforms in UniformBuffers.h
+
+layout (std140) uniform FrameUniforms
+{
+    mat4 view;
+    mat4 projection;
+    mat4 skyboxView;
+    vec3 viewPosition;
+    float fogDensity;
+    vec3 lightPosition;
+    float fogGradient;
+    vec3 lightColor;
+    vec3 fogColor;
+    vec3 camUp;
+    vec3 camRight;
+};
+
+// instanced programs take these from vertex attributes instead, see InstanceBuffer.h
+#ifndef INSTANCED
+layout (std140) uniform ObjectUniforms
+{
+    mat4 model;
+    mat4 normalMatrix;
+    float shininess;
+};
+#endif
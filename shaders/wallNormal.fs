@@ -4,89 +4,89 @@ out vec4 FragColor;
 in vec3 FragPosition;
 in vec2 TexCoord;
 
+#ifdef LIGHT_ON
 in vec3 TangViewPosition;
 in vec3 TangLightPosition;
 in vec3 TangFragPosition;
+#endif
 
+#ifdef FOG_ON
 in float fogFactor;
+#endif
 
-uniform vec3 viewPosition;
-uniform vec3 lightPosition;
-uniform vec3 fogColor;
+#include "uniforms.glsl"
 
 uniform sampler2D diffuseMap;
 uniform sampler2D normalMap;
 uniform sampler2D bumpMap;
 uniform float bumpScale;
 
-uniform bool lightOn;
-uniform bool Blinn;
-uniform bool fogOn;
-uniform bool parallaxOn;
-uniform float shininess; 
+// features are compiled in with #define (LIGHT_ON, BLINN, FOG_ON, PARALLAX_ON), see ShaderVariants
 
 void main()
 {
-    if (lightOn) {
-        vec2 coords = vec2(0.0);
-        vec3 viewDirection = normalize(TangViewPosition - TangFragPosition);
-
-        if (parallaxOn) {
-            coords = TexCoord;
-            float minLayers = 8, maxLayers = 32;
-            float layersCount = mix(maxLayers, minLayers, abs(dot(vec3(0.0, 0.0, 1.0), viewDirection)));
-            vec2 P = viewDirection.xy / viewDirection.z * bumpScale;
-            vec2 deltaCoords = P / layersCount;
-            float lDepth = 1.0 / layersCount;
-            
-            float currDepth = 0.0;
-            float currValue = texture(bumpMap, coords).r;
-            while (currDepth < currValue) {
-                coords -= deltaCoords;
-                currValue = texture(bumpMap, coords).r;
-                currDepth += lDepth;
-            }
-
-            vec2 prev = coords + deltaCoords;
-            float depthAfter = currValue - currDepth;
-            float depthBefore = texture(bumpMap, prev).r - currDepth + lDepth;
-            float weight = depthAfter / (depthAfter - depthBefore);
-            coords = prev * weight + coords * (1.0 - weight);
-
-            if (coords.x > 1.0 || coords.y > 1.0 || coords.x < 0.0 || coords.y < 0.0)
-                discard;
-        }
-        else 
-            coords = TexCoord;
-        
+#ifdef LIGHT_ON
+    vec2 coords = vec2(0.0);
+    vec3 viewDirection = normalize(TangViewPosition - TangFragPosition);
+
+#ifdef PARALLAX_ON
+    coords = TexCoord;
+    float minLayers = 8, maxLayers = 32;
+    float layersCount = mix(maxLayers, minLayers, abs(dot(vec3(0.0, 0.0, 1.0), viewDirection)));
+    vec2 P = viewDirection.xy / viewDirection.z * bumpScale;
+    vec2 deltaCoords = P / layersCount;
+    float lDepth = 1.0 / layersCount;
+    
+    float currDepth = 0.0;
+    float currValue = texture(bumpMap, coords).r;
+    while (currDepth < currValue) {
+        coords -= deltaCoords;
+        currValue = texture(bumpMap, coords).r;
+        currDepth += lDepth;
+    }
+
+    vec2 prev = coords + deltaCoords;
+    float depthAfter = currValue - currDepth;
+    float depthBefore = texture(bumpMap, prev).r - currDepth + lDepth;
+    float weight = depthAfter / (depthAfter - depthBefore);
+    coords = prev * weight + coords * (1.0 - weight);
+
+    if (coords.x > 1.0 || coords.y > 1.0 || coords.x < 0.0 || coords.y < 0.0)
+        discard;
+#else
+    coords = TexCoord;
+#endif
+    
 	    vec3 texColor = texture(diffuseMap, coords).rgb;
-	    vec3 normal = texture(normalMap, coords).rgb;
-	    normal = normalize(normal * 2.0 - 1.0);
+	    // the normal map may be stored as two channels (BC5), z is reconstructed from x and y
+	    vec3 normal;
+	    normal.xy = texture(normalMap, coords).rg * 2.0 - 1.0;
+	    normal.z = sqrt(max(1.0 - dot(normal.xy, normal.xy), 0.0));
+	    normal = normalize(normal);
 
 	    float ambientStrength = 0.1;
-        float specularStrength = 0.2;
+    float specularStrength = 0.2;
 
-        vec3 lightDirection = normalize(TangLightPosition - TangFragPosition);
-        
-        vec3 ambient = ambientStrength * texColor;
-        vec3 diffuse = max(dot(lightDirection, normal), 0.0) * texColor;
-        vec3 specular = vec3(0.0);
+    vec3 lightDirection = normalize(TangLightPosition - TangFragPosition);
+    
+    vec3 ambient = ambientStrength * texColor;
+    vec3 diffuse = max(dot(lightDirection, normal), 0.0) * texColor;
+    vec3 specular = vec3(0.0);
 
-        float spec = 0.0;
-        if (Blinn)
-            spec = pow(max(dot(normal, normalize(lightDirection + viewDirection)), 0.0), shininess);
-        else
-            spec = pow(max(dot(viewDirection, reflect(-lightDirection, normal)), 0.0), shininess);
+#ifdef BLINN
+    float spec = pow(max(dot(normal, normalize(lightDirection + viewDirection)), 0.0), shininess);
+#else
+    float spec = pow(max(dot(viewDirection, reflect(-lightDirection, normal)), 0.0), shininess);
+#endif
 
-        specular = vec3(specularStrength) * spec;
+    specular = vec3(specularStrength) * spec;
 
-        FragColor = vec4(ambient + diffuse + specular, 1.0);
-        if (fogOn)
-            FragColor = mix(vec4(fogColor, 1.0f), FragColor, fogFactor);
-    }
-    else {
-        FragColor = texture(diffuseMap, TexCoord);
-        if (fogOn)
-            FragColor = mix(vec4(fogColor, 1.0f), FragColor, fogFactor);
-    }
+    FragColor = vec4(ambient + diffuse + specular, 1.0);
+#else
+    FragColor = texture(diffuseMap, TexCoord);
+#endif
+
+#ifdef FOG_ON
+    FragColor = mix(vec4(fogColor, 1.0f), FragColor, fogFactor);
+#endif
 }
\ No newline at end of file
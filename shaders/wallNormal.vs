@@ -1,49 +1,47 @@
 #version 330 core
 layout (location = 0) in vec3 position;
-layout (location = 1) in vec3 normals;
+layout (location = 1) in vec4 normals;   // GL_INT_2_10_10_10_REV
 layout (location = 2) in vec2 texCoords;
-layout (location = 3) in vec3 tangents;
-layout (location = 4) in vec3 bitangents;
+layout (location = 3) in vec4 tangents;  // GL_INT_2_10_10_10_REV, bitangent sign in w
 
 out vec3 FragPosition;
 out vec2 TexCoord;
 
+#ifdef LIGHT_ON
 out vec3 TangViewPosition;
 out vec3 TangLightPosition;
 out vec3 TangFragPosition;
+#endif
 
+#ifdef FOG_ON
 out float fogFactor;
+#endif
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
-
-uniform vec3 viewPosition;
-uniform vec3 lightPosition;
-
-uniform float fogDensity;
-uniform float fogGradient;
+#include "uniforms.glsl"
 
 void main()
 {
-	mat3 normalMatrix = transpose(inverse(mat3(model)));
-	vec3 Tang = normalize(normalMatrix * tangents);
-	vec3 Norm = normalize(normalMatrix * normals);
-	Tang = normalize(Tang - dot(Tang, Norm) * Norm);
-	vec3 Bitang = cross(Norm, Tang);
-	mat3 TBN = transpose(mat3(Tang, Bitang, Norm));
-
 	FragPosition = vec3(model * vec4(position, 1.0));
 	TexCoord = texCoords; 
+
+#ifdef LIGHT_ON
+	vec3 Tang = normalize(mat3(normalMatrix) * (tangents.xyz / 511.0));
+	vec3 Norm = normalize(mat3(normalMatrix) * (normals.xyz / 511.0));
+	Tang = normalize(Tang - dot(Tang, Norm) * Norm);
+	vec3 Bitang = cross(Norm, Tang) * tangents.w;
+	mat3 TBN = transpose(mat3(Tang, Bitang, Norm));
 	
 	TangViewPosition = TBN * viewPosition;
 	TangLightPosition = TBN * lightPosition;
 	TangFragPosition = TBN * FragPosition;
+#endif
 
+#ifdef FOG_ON
 	vec4 CameraPosition = view * model * vec4(position, 1.0);
 	float distance = length(CameraPosition.xyz);
 	fogFactor = exp(-pow((distance * fogDensity), fogGradient));
     fogFactor = clamp(fogFactor, 0.0, 1.0);
+#endif
 
 	gl_Position = projection * view * model * vec4(position, 1.0);
 }
\ No newline at end of file
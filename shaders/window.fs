@@ -1,11 +1,26 @@
 #version 330 core
-out vec4 FragColor;
 
 in vec2 TexCoord;
 
 uniform sampler2D tex;
 
+#ifdef WEIGHTED_OIT
+// weighted blended order-independent transparency, see WeightedBlendedOIT.h
+layout (location = 0) out vec4 accumulation;
+layout (location = 1) out vec4 weightSum;
+#else
+out vec4 FragColor;
+#endif
+
 void main()
 {             
+#ifdef WEIGHTED_OIT
+    vec4 color = texture(tex, TexCoord);
+    // closer fragments get larger weights, so they dominate the average where layers overlap
+    float weight = color.a * clamp(3000.0 * pow(1.0 - gl_FragCoord.z, 3.0), 0.01, 3000.0);
+    accumulation = vec4(color.rgb * weight, color.a);
+    weightSum = vec4(weight);
+#else
     FragColor = texture(tex, TexCoord);
+#endif
 }
\ No newline at end of file
@@ -4,16 +4,16 @@ layout (location = 1) in vec2 texCoords;
 
 out vec2 TexCoord;
 
-uniform mat4 view;
-uniform mat4 projection;
-uniform vec3 camUp;
-uniform vec3 camRight;
-uniform vec3 placing;
+// windows are always drawn instanced, only the translation of the instance model is used
+#define INSTANCED
+#include "uniforms.glsl"
+
+layout (location = 3) in mat4 model;
 
 void main()
 {
     TexCoord = texCoords;
     vec3 rotatedModel = camRight * position.x + camUp * position.y;
-    vec3 placedModel = 1.25 * rotatedModel + placing;
+    vec3 placedModel = 1.25 * rotatedModel + vec3(model[3]);
     gl_Position = projection * view * vec4(placedModel, 1.0);
 }
\ No newline at end of file